@@ -737,6 +737,7 @@ namespace Magick
   using MagickLib::HeightResource;
   using MagickLib::ReadResource;
   using MagickLib::WriteResource;
+  using MagickLib::FontsResource;
 
   // Virtual pixel methods
   using MagickLib::VirtualPixelMethod;
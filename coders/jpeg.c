@@ -50,6 +50,7 @@
 #include "magick/monitor.h"
 #include "magick/pixel_cache.h"
 #include "magick/profile.h"
+#include "magick/resize.h"
 #include "magick/resource.h"
 #include "magick/utility.h"
 
@@ -201,6 +202,15 @@ typedef struct _MagickClientData
   magick_jpeg_pixels_t
     *jpeg_pixels;
 
+  ResizeRowsInfo
+    *resize_rows_info;    /* Thumbnail mode row resizer */
+
+  PixelPacket
+    *row_pixels;          /* Thumbnail mode scanline */
+
+  IndexPacket
+    *row_indexes;         /* Thumbnail mode scanline indexes */
+
 } MagickClientData;
 
 typedef struct _SourceManager
@@ -243,6 +253,9 @@ static MagickClientData *FreeMagickClientData(MagickClientData *client_data)
         }
       if (client_data->jpeg_pixels != (magick_jpeg_pixels_t *) NULL)
         MagickFreeResourceLimitedMemory(client_data->jpeg_pixels->t.v);
+      DestroyResizeRowsInfo(client_data->resize_rows_info);
+      MagickFreeResourceLimitedMemory(client_data->row_pixels);
+      MagickFreeResourceLimitedMemory(client_data->row_indexes);
 
       MagickFreeMemory(client_data);
     }
@@ -1369,7 +1382,9 @@ static Image *ReadJPEGImage(const ImageInfo *image_info,
     status;
 
   unsigned long
-    number_pixels;
+    number_pixels,
+    thumbnail_columns = 0,
+    thumbnail_rows = 0;
 
   /*
     Open image file.
@@ -1498,17 +1513,51 @@ static Image *ReadJPEGImage(const ImageInfo *image_info,
         }
     }
 
+  /*
+    In thumbnail mode the image is decoded directly to the requested
+    thumbnail geometry.  The JPEG library subsamples as far as it can
+    and each decoded scanline is then resized as it is read so that
+    the full size image is never stored.
+  */
+  if ((value=AccessDefinition(image_info,"jpeg","thumbnail")))
+    {
+      long
+        x_offset = 0,
+        y_offset = 0;
+
+      thumbnail_columns=jpeg_info.image_width;
+      thumbnail_rows=jpeg_info.image_height;
+      (void) GetMagickGeometry(value,&x_offset,&y_offset,&thumbnail_columns,
+                               &thumbnail_rows);
+      if ((thumbnail_columns == 0) || (thumbnail_rows == 0) ||
+          ((thumbnail_columns >= jpeg_info.image_width) &&
+           (thumbnail_rows >= jpeg_info.image_height)))
+        {
+          thumbnail_columns=0;
+          thumbnail_rows=0;
+        }
+      else
+        {
+          image->columns=thumbnail_columns;
+          image->rows=thumbnail_rows;
+        }
+      if (image->logging)
+        (void) LogMagickEvent(CoderEvent,GetMagickModule(),
+                              "Thumbnail geometry \"%s\": %lux%lu",
+                              value,thumbnail_columns,thumbnail_rows);
+    }
+
   /*
     If the desired image size is pre-set (e.g. by using -size), then
-    let the JPEG library subsample for us.
+    let the JPEG library subsample for us.  In thumbnail mode the
+    scaling ratio is the ratio of the thumbnail size to the image size
+    in the dimension which allows the least reduction, and the JPEG
+    library selects the largest reduction it supports which does not
+    exceed it.  Otherwise only integral scaling ratios are used.
   */
   number_pixels=image->columns*image->rows;
   if (number_pixels != 0)
     {
-      double
-        scale_factor;
-
-
       if (image->logging)
         (void) LogMagickEvent(CoderEvent,GetMagickModule(),
                               "Requested Geometry: %lux%lu",
@@ -1520,18 +1569,42 @@ static Image *ReadJPEGImage(const ImageInfo *image_info,
         (void) LogMagickEvent(CoderEvent,GetMagickModule(),
                               "magick_geometry=%lux%lu",
                               image->magick_columns, image->magick_rows);
-      scale_factor=(double) jpeg_info.output_width/image->columns;
-      if (scale_factor > ((double) jpeg_info.output_height/image->rows))
-        scale_factor=(double) jpeg_info.output_height/image->rows;
-      jpeg_info.scale_denom *=(unsigned int) scale_factor;
+      if (thumbnail_columns == 0)
+        {
+          double
+            scale_factor;
+
+          scale_factor=(double) jpeg_info.output_width/image->columns;
+          if (scale_factor > ((double) jpeg_info.output_height/image->rows))
+            scale_factor=(double) jpeg_info.output_height/image->rows;
+          jpeg_info.scale_denom *=(unsigned int) scale_factor;
+        }
+      else if (((double) image->columns*jpeg_info.output_height) >=
+               ((double) image->rows*jpeg_info.output_width))
+        {
+          if (image->columns < jpeg_info.output_width)
+            {
+              jpeg_info.scale_num=(unsigned int) image->columns;
+              jpeg_info.scale_denom=(unsigned int) jpeg_info.output_width;
+            }
+        }
+      else
+        {
+          if (image->rows < jpeg_info.output_height)
+            {
+              jpeg_info.scale_num=(unsigned int) image->rows;
+              jpeg_info.scale_denom=(unsigned int) jpeg_info.output_height;
+            }
+        }
       jpeg_calc_output_dimensions(&jpeg_info);
       if (image->logging)
         (void) LogMagickEvent(CoderEvent,GetMagickModule(),
                               "Original Geometry: %lux%lu,"
-                              " Scale_factor: %ld (scale_num=%d,"
+                              " Scaled Geometry: %ux%u (scale_num=%d,"
                               " scale_denom=%d)",
                               image->magick_columns, image->magick_rows,
-                              (long) scale_factor,
+                              (unsigned int) jpeg_info.output_width,
+                              (unsigned int) jpeg_info.output_height,
                               jpeg_info.scale_num,jpeg_info.scale_denom);
     }
 #if 0
@@ -1730,6 +1803,11 @@ static Image *ReadJPEGImage(const ImageInfo *image_info,
 
   if (image_info->ping)
     {
+      if (thumbnail_columns != 0)
+        {
+          image->columns=thumbnail_columns;
+          image->rows=thumbnail_rows;
+        }
       jpeg_destroy_decompress(&jpeg_info);
       client_data=FreeMagickClientData(client_data);
       CloseBlob(image);
@@ -1831,6 +1909,31 @@ static Image *ReadJPEGImage(const ImageInfo *image_info,
       ThrowJPEGReaderException(ResourceLimitError,MemoryAllocationFailed,image);
     }
 
+  /*
+    Prepare to resize scanlines in thumbnail mode.
+  */
+  if (thumbnail_columns != 0)
+    {
+      client_data->resize_rows_info=
+        AllocateResizeRowsInfo(image,thumbnail_columns,thumbnail_rows,
+                               (image->filter != UndefinedFilter ?
+                                image->filter : DefaultThumbnailFilter),
+                               image->blur,exception);
+      client_data->row_pixels=
+        MagickAllocateResourceLimitedArray(PixelPacket *,image->columns,
+                                           sizeof(PixelPacket));
+      client_data->row_indexes=
+        MagickAllocateResourceLimitedArray(IndexPacket *,image->columns,
+                                           sizeof(IndexPacket));
+      if ((client_data->resize_rows_info == (ResizeRowsInfo *) NULL) ||
+          (client_data->row_pixels == (PixelPacket *) NULL) ||
+          (client_data->row_indexes == (IndexPacket *) NULL))
+        {
+          jpeg_destroy_decompress(&jpeg_info);
+          ThrowJPEGReaderException(ResourceLimitError,MemoryAllocationFailed,image);
+        }
+    }
+
   /*
     Extended longjmp-based error handler (with jpeg_pixels)
   */
@@ -1841,6 +1944,14 @@ static Image *ReadJPEGImage(const ImageInfo *image_info,
       /* Error handling code executed if longjmp was invoked */
       MagickFreeResourceLimitedMemory(jpeg_pixels.t.v);
       jpeg_destroy_decompress(&jpeg_info);
+      if (client_data->resize_rows_info != (ResizeRowsInfo *) NULL)
+        {
+          /*
+            A partially decoded thumbnail is not returned.
+          */
+          image->columns=0;
+          image->rows=0;
+        }
       if (image->exception.severity > exception->severity)
         CopyException(exception,&image->exception);
       client_data=FreeMagickClientData(client_data);
@@ -1915,13 +2026,21 @@ static Image *ReadJPEGImage(const ImageInfo *image_info,
               }
           }
 
-      q=SetImagePixels(image,0,y,image->columns,1);
-      if (q == (PixelPacket *) NULL)
+      if (client_data->resize_rows_info != (ResizeRowsInfo *) NULL)
         {
-          status=MagickFail;
-          break;
+          q=client_data->row_pixels;
+          indexes=client_data->row_indexes;
+        }
+      else
+        {
+          q=SetImagePixels(image,0,y,image->columns,1);
+          if (q == (PixelPacket *) NULL)
+            {
+              status=MagickFail;
+              break;
+            }
+          indexes=AccessMutableIndexes(image);
         }
-      indexes=AccessMutableIndexes(image);
 
       if (jpeg_info.output_components == 1)
         {
@@ -2082,7 +2201,8 @@ static Image *ReadJPEGImage(const ImageInfo *image_info,
               /*
                 CMYK pixels are inverted.
               */
-              q=AccessMutablePixels(image);
+              q=(client_data->resize_rows_info != (ResizeRowsInfo *) NULL ?
+                 client_data->row_pixels : AccessMutablePixels(image));
               for (x=0; x < (long) image->columns; x++)
                 {
                   q->red=MaxRGB-q->red;
@@ -2093,7 +2213,19 @@ static Image *ReadJPEGImage(const ImageInfo *image_info,
                 }
             }
         }
-      if (!SyncImagePixels(image))
+      if (client_data->resize_rows_info != (ResizeRowsInfo *) NULL)
+        {
+          if (ResizeRow(client_data->resize_rows_info,client_data->row_pixels,
+                        (image->storage_class == PseudoClass ?
+                         client_data->row_indexes :
+                         (const IndexPacket *) NULL),
+                        (unsigned long) y,exception) != MagickPass)
+            {
+              status=MagickFail;
+              break;
+            }
+        }
+      else if (!SyncImagePixels(image))
         {
           status=MagickFail;
           break;
@@ -2137,6 +2269,17 @@ static Image *ReadJPEGImage(const ImageInfo *image_info,
     }
   jpeg_destroy_decompress(&jpeg_info);
   MagickFreeResourceLimitedMemory(jpeg_pixels.t.v);
+  if (client_data->resize_rows_info != (ResizeRowsInfo *) NULL)
+    {
+      /*
+        Apply the vertical filter to produce the thumbnail.
+      */
+      image->columns=thumbnail_columns;
+      image->rows=thumbnail_rows;
+      if (FinishResizeRows(client_data->resize_rows_info,image,exception)
+          != MagickPass)
+        status=MagickFail;
+    }
   client_data=FreeMagickClientData(client_data);
   CloseBlob(image);
 
@@ -460,6 +460,9 @@ typedef struct _MngInfo
   unsigned char
     *png_pixels;
 
+  struct _PNGDeflateInfo
+    *png_deflate;
+
   Quantum
     *quantum_scanline;
 
@@ -7148,6 +7151,727 @@ png_write_raw_profile(const ImageInfo *image_info,png_struct *ping,
   png_free(ping,text);
 }
 
+/*
+  Set up a tEXt or zTXt chunk for each image attribute.
+*/
+static void
+png_set_text_attributes(const ImageInfo *image_info,png_struct *ping,
+                        png_info *ping_info,const Image *image,
+                        const unsigned int logging)
+{
+  const ImageAttribute
+    *attribute;
+
+  attribute=GetImageAttribute(image,(char *) NULL);
+  for ( ; attribute != (const ImageAttribute *) NULL;
+        attribute=attribute->next)
+    {
+      png_textp
+        text;
+
+      if (*attribute->key == '[')
+        continue;
+      if (LocaleCompare(attribute->key,"png:IHDR.color-type-orig") == 0 ||
+          LocaleCompare(attribute->key,"png:IHDR.bit-depth-orig") == 0)
+        continue;
+#if PNG_LIBPNG_VER >= 14000
+      text=(png_textp) png_malloc(ping,(png_alloc_size_t) sizeof(png_text));
+#else
+      text=(png_textp) png_malloc(ping,(png_size_t) sizeof(png_text));
+#endif
+      text[0].key=attribute->key;
+      text[0].text=attribute->value;
+      text[0].text_length=strlen(attribute->value);
+      text[0].compression=image_info->compression == NoCompression ||
+        (image_info->compression == UndefinedCompression &&
+         text[0].text_length < 128) ? -1 : 0;
+      if (logging)
+        {
+          (void) LogMagickEvent(CoderEvent,GetMagickModule(),
+                                "  Setting up text chunk");
+          (void) LogMagickEvent(CoderEvent,GetMagickModule(),
+                                "    keyword: %s",text[0].key);
+        }
+      png_set_text(ping,ping_info,text,1);
+      png_free(ping,text);
+    }
+}
+
+/*
+  When more than one thread is available, the IDAT datastream is filtered
+  and deflated as independent blocks of rows on worker threads, and the
+  blocks are joined into a single zlib stream.  Every block except the
+  last ends with a sync flush so that it finishes on a byte boundary, each
+  block is primed with the preceding 32K of filtered data so compression
+  is close to that of a single stream, and the Adler-32 checksums of the
+  blocks are combined into the checksum of the whole stream.
+*/
+#define PNG_DEFLATE_BLOCK_SIZE 131072
+#define PNG_DEFLATE_WINDOW_SIZE 32768
+#define PNG_IDAT_CHUNK_SIZE 32768
+
+typedef struct _PNGDeflateBlock
+{
+  unsigned char
+    *data,               /* compressed data */
+    *scratch;            /* trial row for adaptive filtering */
+
+  size_t
+    data_size,           /* allocated size of data */
+    length,              /* compressed bytes in data */
+    offset,              /* offset of filtered rows in batch */
+    input_length;        /* filtered bytes to deflate */
+
+  unsigned long
+    row,                 /* first row in batch */
+    rows;                /* number of rows */
+
+  uLong
+    adler;               /* Adler-32 of filtered bytes */
+
+  MagickPassFail
+    status;
+} PNGDeflateBlock;
+
+typedef struct _PNGDeflateInfo
+{
+  int
+    level,               /* zlib compression level */
+    strategy,            /* zlib compression strategy */
+    filters;             /* mask of PNG_FILTER_* values to try */
+
+  unsigned int
+    bit_depth,           /* PNG sample depth */
+    filter_bytes,        /* bytes per complete pixel, at least one */
+    logging;
+
+  size_t
+    samples,             /* samples per row */
+    row_bytes,           /* packed bytes per row */
+    window_length,       /* filtered bytes preceding the batch */
+    idat_length;         /* bytes pending in IDAT chunk */
+
+  unsigned long
+    rows,                /* rows in image */
+    rows_done,           /* rows already deflated */
+    rows_per_block,
+    blocks_per_batch,
+    batch_rows,          /* rows per batch */
+    batch_count;         /* rows in current batch */
+
+  unsigned char
+    *raw,                /* packed rows, preceded by the prior row */
+    *filtered,           /* filtered rows, preceded by the window */
+    *idat;               /* pending IDAT chunk data */
+
+  PNGDeflateBlock
+    *blocks;
+
+  uLong
+    adler;               /* Adler-32 of the whole stream */
+} PNGDeflateInfo;
+
+static void DestroyPNGDeflateInfo(PNGDeflateInfo *deflate_info)
+{
+  unsigned long
+    i;
+
+  if (deflate_info == (PNGDeflateInfo *) NULL)
+    return;
+  if (deflate_info->blocks != (PNGDeflateBlock *) NULL)
+    {
+      for (i=0; i < deflate_info->blocks_per_batch; i++)
+        {
+          MagickFreeResourceLimitedMemory(deflate_info->blocks[i].data);
+          MagickFreeResourceLimitedMemory(deflate_info->blocks[i].scratch);
+        }
+      MagickFreeMemory(deflate_info->blocks);
+    }
+  MagickFreeResourceLimitedMemory(deflate_info->raw);
+  MagickFreeResourceLimitedMemory(deflate_info->filtered);
+  MagickFreeResourceLimitedMemory(deflate_info->idat);
+  MagickFreeMemory(deflate_info);
+}
+
+static PNGDeflateInfo *AllocatePNGDeflateInfo(png_struct *ping,
+                                              png_info *ping_info,
+                                              const int level,
+                                              const int strategy,
+                                              const int base_filter,
+                                              const unsigned int logging)
+{
+  PNGDeflateInfo
+    *deflate_info;
+
+  size_t
+    pixel_bits;
+
+  unsigned int
+    flevel,
+    header;
+
+  unsigned long
+    i;
+
+  deflate_info=MagickAllocateClearedMemory(PNGDeflateInfo *,
+                                           sizeof(PNGDeflateInfo));
+  if (deflate_info == (PNGDeflateInfo *) NULL)
+    return((PNGDeflateInfo *) NULL);
+  deflate_info->level=level;
+  deflate_info->bit_depth=png_get_bit_depth(ping,ping_info);
+  /*
+    Map the value passed to png_set_filter() to a mask of filters.  Like
+    libpng, PNG_NO_FILTERS selects adaptive filtering unless the image is
+    palette or has fewer than 8 bits per sample.
+  */
+  if (base_filter & PNG_ALL_FILTERS)
+    deflate_info->filters=base_filter & PNG_ALL_FILTERS;
+  else if (base_filter != PNG_NO_FILTERS)
+    deflate_info->filters=PNG_FILTER_NONE << (base_filter & 0x07);
+  else if ((png_get_color_type(ping,ping_info) == PNG_COLOR_TYPE_PALETTE) ||
+           (deflate_info->bit_depth < 8))
+    deflate_info->filters=PNG_FILTER_NONE;
+  else
+    deflate_info->filters=PNG_ALL_FILTERS;
+  /*
+    Like libpng, use Z_FILTERED for filtered rows unless a strategy was
+    requested (a negative strategy requests none).
+  */
+  if (strategy >= 0)
+    deflate_info->strategy=strategy;
+  else if (deflate_info->filters != PNG_FILTER_NONE)
+    deflate_info->strategy=Z_FILTERED;
+  else
+    deflate_info->strategy=Z_DEFAULT_STRATEGY;
+  deflate_info->logging=logging;
+  deflate_info->samples=(size_t) png_get_image_width(ping,ping_info)*
+    png_get_channels(ping,ping_info);
+  pixel_bits=(size_t) png_get_channels(ping,ping_info)*
+    deflate_info->bit_depth;
+  deflate_info->filter_bytes=(unsigned int) Max(1,pixel_bits/8);
+  deflate_info->row_bytes=(deflate_info->samples*deflate_info->bit_depth+7)/8;
+  deflate_info->rows=png_get_image_height(ping,ping_info);
+  deflate_info->rows_per_block=(unsigned long)
+    Max(1,PNG_DEFLATE_BLOCK_SIZE/(deflate_info->row_bytes+1));
+  deflate_info->blocks_per_batch=2*(unsigned long) omp_get_max_threads();
+  deflate_info->batch_rows=deflate_info->rows_per_block*
+    deflate_info->blocks_per_batch;
+  if (deflate_info->batch_rows > deflate_info->rows)
+    {
+      deflate_info->batch_rows=deflate_info->rows;
+      deflate_info->blocks_per_batch=(deflate_info->rows+
+        deflate_info->rows_per_block-1)/deflate_info->rows_per_block;
+    }
+  deflate_info->raw=MagickAllocateResourceLimitedClearedArray(unsigned char *,
+    (size_t) deflate_info->batch_rows+1,deflate_info->row_bytes);
+  deflate_info->filtered=MagickAllocateResourceLimitedArray(unsigned char *,
+    PNG_DEFLATE_WINDOW_SIZE+(size_t) deflate_info->batch_rows*
+    (deflate_info->row_bytes+1),1);
+  deflate_info->idat=MagickAllocateResourceLimitedMemory(unsigned char *,
+    PNG_IDAT_CHUNK_SIZE);
+  deflate_info->blocks=MagickAllocateClearedArray(PNGDeflateBlock *,
+    deflate_info->blocks_per_batch,sizeof(PNGDeflateBlock));
+  if ((deflate_info->raw == (unsigned char *) NULL) ||
+      (deflate_info->filtered == (unsigned char *) NULL) ||
+      (deflate_info->idat == (unsigned char *) NULL) ||
+      (deflate_info->blocks == (PNGDeflateBlock *) NULL))
+    {
+      DestroyPNGDeflateInfo(deflate_info);
+      return((PNGDeflateInfo *) NULL);
+    }
+  for (i=0; i < deflate_info->blocks_per_batch; i++)
+    {
+      deflate_info->blocks[i].scratch=
+        MagickAllocateResourceLimitedMemory(unsigned char *,
+                                            deflate_info->row_bytes+1);
+      if (deflate_info->blocks[i].scratch == (unsigned char *) NULL)
+        {
+          DestroyPNGDeflateInfo(deflate_info);
+          return((PNGDeflateInfo *) NULL);
+        }
+    }
+  /*
+    Start the IDAT data with a zlib header declaring a 32K window and the
+    compression level, as deflate() would write it.
+  */
+  if ((deflate_info->strategy >= Z_HUFFMAN_ONLY) || (level < 2))
+    flevel=0;
+  else if (level < 6)
+    flevel=1;
+  else if (level == 6)
+    flevel=2;
+  else
+    flevel=3;
+  header=(0x78U << 8) | (flevel << 6);
+  header+=31-(header % 31);
+  deflate_info->idat[0]=(unsigned char) (header >> 8);
+  deflate_info->idat[1]=(unsigned char) (header & 0xff);
+  deflate_info->idat_length=2;
+  deflate_info->adler=adler32(0L,Z_NULL,0);
+  if (logging)
+    (void) LogMagickEvent(CoderEvent,GetMagickModule(),
+                          "    Deflating %lu rows per block, %lu blocks"
+                          " per batch",deflate_info->rows_per_block,
+                          deflate_info->blocks_per_batch);
+  return(deflate_info);
+}
+
+/*
+  Apply one PNG filter type to a packed row, writing the filter type byte
+  followed by the filtered bytes.  Returns the sum of the absolute values
+  of the filtered bytes taken as signed, which libpng uses to choose an
+  adaptive filter.
+*/
+static unsigned long FilterPNGRow(const unsigned int filter,
+                                  const unsigned int bpp,
+                                  const unsigned char *row,
+                                  const unsigned char *prior,
+                                  const size_t length,
+                                  unsigned char *out)
+{
+  register size_t
+    i;
+
+  register unsigned char
+    v;
+
+  int
+    a,
+    b,
+    c,
+    p,
+    pa,
+    pb,
+    pc;
+
+  unsigned long
+    sum;
+
+  sum=0;
+  *out++=(unsigned char) filter;
+  for (i=0; i < length; i++)
+    {
+      switch (filter)
+        {
+        case PNG_FILTER_VALUE_SUB:
+          v=(unsigned char) (row[i]-(i >= bpp ? row[i-bpp] : 0));
+          break;
+        case PNG_FILTER_VALUE_UP:
+          v=(unsigned char) (row[i]-prior[i]);
+          break;
+        case PNG_FILTER_VALUE_AVG:
+          v=(unsigned char) (row[i]-(((i >= bpp ? row[i-bpp] : 0)+
+                                      prior[i]) >> 1));
+          break;
+        case PNG_FILTER_VALUE_PAETH:
+          a=(i >= bpp ? row[i-bpp] : 0);
+          b=prior[i];
+          c=(i >= bpp ? prior[i-bpp] : 0);
+          p=b-c;
+          pc=a-c;
+          pa=p < 0 ? -p : p;
+          pb=pc < 0 ? -pc : pc;
+          pc=(p+pc) < 0 ? -(p+pc) : p+pc;
+          if ((pa <= pb) && (pa <= pc))
+            p=a;
+          else if (pb <= pc)
+            p=b;
+          else
+            p=c;
+          v=(unsigned char) (row[i]-p);
+          break;
+        default:
+          v=row[i];
+          break;
+        }
+      out[i]=v;
+      sum+=(v < 128U) ? v : 256U-v;
+    }
+  return(sum);
+}
+
+/*
+  Filter the rows of one block, choosing among several filters for each
+  row using the same heuristic as libpng.
+*/
+static void FilterPNGBlock(const PNGDeflateInfo *deflate_info,
+                           PNGDeflateBlock *block)
+{
+  const unsigned char
+    *prior,
+    *row;
+
+  size_t
+    filtered_bytes;
+
+  unsigned char
+    *out;
+
+  MagickBool
+    filtered;
+
+  unsigned int
+    filter;
+
+  unsigned long
+    best_sum,
+    sum,
+    y;
+
+  filtered_bytes=deflate_info->row_bytes+1;
+  for (y=block->row; y < block->row+block->rows; y++)
+    {
+      prior=deflate_info->raw+(size_t) y*deflate_info->row_bytes;
+      row=prior+deflate_info->row_bytes;
+      out=deflate_info->filtered+PNG_DEFLATE_WINDOW_SIZE+
+        (size_t) y*filtered_bytes;
+      filtered=MagickFalse;
+      best_sum=0;
+      for (filter=PNG_FILTER_VALUE_NONE; filter < PNG_FILTER_VALUE_LAST;
+           filter++)
+        {
+          if (!(deflate_info->filters & (PNG_FILTER_NONE << filter)))
+            continue;
+          if (!filtered)
+            {
+              best_sum=FilterPNGRow(filter,deflate_info->filter_bytes,row,
+                                    prior,deflate_info->row_bytes,out);
+              filtered=MagickTrue;
+              continue;
+            }
+          sum=FilterPNGRow(filter,deflate_info->filter_bytes,row,prior,
+                           deflate_info->row_bytes,block->scratch);
+          if (sum < best_sum)
+            {
+              (void) memcpy(out,block->scratch,filtered_bytes);
+              best_sum=sum;
+            }
+        }
+    }
+}
+
+/*
+  Deflate the filtered rows of one block.  The block is compressed as a
+  raw deflate stream primed with the filtered data preceding it, and is
+  terminated by a sync flush unless it is the last block of the image.
+*/
+static MagickPassFail DeflatePNGBlock(const PNGDeflateInfo *deflate_info,
+                                      PNGDeflateBlock *block,
+                                      const MagickBool finish)
+{
+  const unsigned char
+    *input;
+
+  size_t
+    dictionary_length,
+    size;
+
+  z_stream
+    stream;
+
+  int
+    result;
+
+  input=deflate_info->filtered+PNG_DEFLATE_WINDOW_SIZE+block->offset;
+  block->adler=adler32(0L,Z_NULL,0);
+  block->adler=adler32(block->adler,input,(uInt) block->input_length);
+
+  (void) memset(&stream,0,sizeof(stream));
+  if (deflateInit2(&stream,deflate_info->level,Z_DEFLATED,-MAX_WBITS,9,
+                   deflate_info->strategy) != Z_OK)
+    return(MagickFail);
+  dictionary_length=Min(PNG_DEFLATE_WINDOW_SIZE,
+                        deflate_info->window_length+block->offset);
+  if ((dictionary_length != 0) &&
+      (deflateSetDictionary(&stream,input-dictionary_length,
+                            (uInt) dictionary_length) != Z_OK))
+    {
+      (void) deflateEnd(&stream);
+      return(MagickFail);
+    }
+  /*
+    Allow for the empty stored block written by the sync flush.
+  */
+  size=deflateBound(&stream,(uLong) block->input_length)+16;
+  if (size > block->data_size)
+    {
+      MagickFreeResourceLimitedMemory(block->data);
+      block->data_size=0;
+      block->data=MagickAllocateResourceLimitedMemory(unsigned char *,size);
+      if (block->data == (unsigned char *) NULL)
+        {
+          (void) deflateEnd(&stream);
+          return(MagickFail);
+        }
+      block->data_size=size;
+    }
+  stream.next_in=(Bytef *) input;
+  stream.avail_in=(uInt) block->input_length;
+  stream.next_out=block->data;
+  stream.avail_out=(uInt) block->data_size;
+  result=deflate(&stream,finish ? Z_FINISH : Z_SYNC_FLUSH);
+  block->length=block->data_size-stream.avail_out;
+  (void) deflateEnd(&stream);
+  if (finish)
+    return(result == Z_STREAM_END ? MagickPass : MagickFail);
+  return(((result == Z_OK) && (stream.avail_in == 0) &&
+          (stream.avail_out != 0)) ? MagickPass : MagickFail);
+}
+
+static MagickPassFail WritePNGIDATChunk(Image *image,
+                                        PNGDeflateInfo *deflate_info)
+{
+  unsigned char
+    chunk[4];
+
+  if (deflate_info->idat_length == 0)
+    return(MagickPass);
+  (void) WriteBlobMSBULong(image,(magick_uint32_t) deflate_info->idat_length);
+  PNGType(chunk,mng_IDAT);
+  LogPNGChunk(deflate_info->logging,mng_IDAT,deflate_info->idat_length);
+  (void) WriteBlob(image,4,chunk);
+  if (WriteBlob(image,deflate_info->idat_length,deflate_info->idat) !=
+      deflate_info->idat_length)
+    return(MagickFail);
+  if (WriteBlobMSBULong(image,crc32(crc32(0,chunk,4),deflate_info->idat,
+                                    (uInt) deflate_info->idat_length)) != 4)
+    return(MagickFail);
+  deflate_info->idat_length=0;
+  return(MagickPass);
+}
+
+static MagickPassFail WritePNGDeflateData(Image *image,
+                                          PNGDeflateInfo *deflate_info,
+                                          const unsigned char *data,
+                                          size_t length)
+{
+  size_t
+    count;
+
+  while (length != 0)
+    {
+      count=Min(length,PNG_IDAT_CHUNK_SIZE-deflate_info->idat_length);
+      (void) memcpy(deflate_info->idat+deflate_info->idat_length,data,count);
+      deflate_info->idat_length+=count;
+      data+=count;
+      length-=count;
+      if (deflate_info->idat_length == PNG_IDAT_CHUNK_SIZE)
+        if (WritePNGIDATChunk(image,deflate_info) == MagickFail)
+          return(MagickFail);
+    }
+  return(MagickPass);
+}
+
+/*
+  Filter and then deflate the batch of rows on worker threads, and append
+  the compressed blocks to the IDAT data in order.  All blocks are filtered
+  before any is deflated since each is primed with the filtered data of
+  the blocks preceding it.
+*/
+static MagickPassFail FlushPNGDeflateBatch(Image *image,
+                                           PNGDeflateInfo *deflate_info)
+{
+  MagickBool
+    last_batch;
+
+  MagickPassFail
+    status;
+
+  size_t
+    batch_length,
+    keep;
+
+  long
+    block;
+
+  unsigned long
+    blocks,
+    i;
+
+  if (deflate_info->batch_count == 0)
+    return(MagickPass);
+  last_batch=(deflate_info->rows_done+deflate_info->batch_count ==
+              deflate_info->rows);
+  blocks=(deflate_info->batch_count+deflate_info->rows_per_block-1)/
+    deflate_info->rows_per_block;
+  for (i=0; i < blocks; i++)
+    {
+      PNGDeflateBlock
+        *p;
+
+      p=deflate_info->blocks+i;
+      p->row=i*deflate_info->rows_per_block;
+      p->rows=Min(deflate_info->rows_per_block,
+                  deflate_info->batch_count-p->row);
+      p->offset=(size_t) p->row*(deflate_info->row_bytes+1);
+      p->input_length=(size_t) p->rows*(deflate_info->row_bytes+1);
+      p->status=MagickPass;
+    }
+
+#if defined(HAVE_OPENMP)
+#  if defined(TUNE_OPENMP)
+#    pragma omp parallel for schedule(runtime)
+#  else
+#    pragma omp parallel for schedule(dynamic,1)
+#  endif
+#endif
+  for (block=0; block < (long) blocks; block++)
+    FilterPNGBlock(deflate_info,deflate_info->blocks+block);
+
+  status=MagickPass;
+#if defined(HAVE_OPENMP)
+#  if defined(TUNE_OPENMP)
+#    pragma omp parallel for schedule(runtime) shared(status)
+#  else
+#    pragma omp parallel for schedule(dynamic,1) shared(status)
+#  endif
+#endif
+  for (block=0; block < (long) blocks; block++)
+    {
+      MagickPassFail
+        thread_status;
+
+#if defined(HAVE_OPENMP)
+#  pragma omp critical (GM_FlushPNGDeflateBatch)
+#endif
+      thread_status=status;
+      if (thread_status == MagickFail)
+        continue;
+
+      thread_status=DeflatePNGBlock(deflate_info,deflate_info->blocks+block,
+                                    last_batch &&
+                                    ((unsigned long) block == blocks-1));
+      if (thread_status == MagickFail)
+        {
+#if defined(HAVE_OPENMP)
+#  pragma omp critical (GM_FlushPNGDeflateBatch)
+#endif
+          status=MagickFail;
+        }
+    }
+  if (status == MagickFail)
+    return(MagickFail);
+
+  for (i=0; i < blocks; i++)
+    {
+      PNGDeflateBlock
+        *p;
+
+      p=deflate_info->blocks+i;
+      deflate_info->adler=adler32_combine(deflate_info->adler,p->adler,
+                                          (z_off_t) p->input_length);
+      if (WritePNGDeflateData(image,deflate_info,p->data,p->length)
+          == MagickFail)
+        return(MagickFail);
+    }
+
+  /*
+    Keep the last 32K of filtered data to prime the next batch, and the
+    last row as the prior row of the next batch.
+  */
+  batch_length=(size_t) deflate_info->batch_count*(deflate_info->row_bytes+1);
+  keep=Min(PNG_DEFLATE_WINDOW_SIZE,deflate_info->window_length+batch_length);
+  (void) memmove(deflate_info->filtered+PNG_DEFLATE_WINDOW_SIZE-keep,
+                 deflate_info->filtered+PNG_DEFLATE_WINDOW_SIZE+
+                 batch_length-keep,keep);
+  deflate_info->window_length=keep;
+  (void) memcpy(deflate_info->raw,deflate_info->raw+
+                (size_t) deflate_info->batch_count*deflate_info->row_bytes,
+                deflate_info->row_bytes);
+  deflate_info->rows_done+=deflate_info->batch_count;
+  deflate_info->batch_count=0;
+  return(MagickPass);
+}
+
+/*
+  Add a row of pixels, as they would be passed to png_write_row() with
+  png_set_packing() in effect, to the current batch.
+*/
+static MagickPassFail WritePNGDeflateRow(Image *image,
+                                         PNGDeflateInfo *deflate_info,
+                                         const unsigned char *pixels)
+{
+  register unsigned char
+    *q;
+
+  register size_t
+    i;
+
+  unsigned int
+    shift,
+    value;
+
+  if (deflate_info->rows_done+deflate_info->batch_count >=
+      deflate_info->rows)
+    return(MagickFail);
+  q=deflate_info->raw+(size_t) (deflate_info->batch_count+1)*
+    deflate_info->row_bytes;
+  if (deflate_info->bit_depth >= 8)
+    (void) memcpy(q,pixels,deflate_info->row_bytes);
+  else
+    {
+      /*
+        Pack samples most significant bits first, as png_do_pack() does.
+      */
+      (void) memset(q,0,deflate_info->row_bytes);
+      shift=8;
+      for (i=0; i < deflate_info->samples; i++)
+        {
+          if (deflate_info->bit_depth == 1)
+            value=(pixels[i] != 0);
+          else
+            value=pixels[i] & ((1U << deflate_info->bit_depth)-1);
+          shift-=deflate_info->bit_depth;
+          *q|=(unsigned char) (value << shift);
+          if (shift == 0)
+            {
+              q++;
+              shift=8;
+            }
+        }
+    }
+  deflate_info->batch_count++;
+  if (deflate_info->batch_count == deflate_info->batch_rows)
+    return(FlushPNGDeflateBatch(image,deflate_info));
+  return(MagickPass);
+}
+
+/*
+  Deflate any remaining rows and write the final IDAT chunk, ending with
+  the Adler-32 checksum of the whole stream.
+*/
+static MagickPassFail FinishPNGDeflate(Image *image,
+                                       PNGDeflateInfo *deflate_info)
+{
+  unsigned char
+    trailer[4];
+
+  if (FlushPNGDeflateBatch(image,deflate_info) == MagickFail)
+    return(MagickFail);
+  if (deflate_info->rows_done != deflate_info->rows)
+    return(MagickFail);
+  PNGLong(trailer,(png_uint_32) deflate_info->adler);
+  if (WritePNGDeflateData(image,deflate_info,trailer,4) == MagickFail)
+    return(MagickFail);
+  return(WritePNGIDATChunk(image,deflate_info));
+}
+
+/*
+  Write a row of pixels with libpng, or add it to the rows deflated on
+  worker threads.
+*/
+static void WritePNGRow(png_struct *ping,Image *image,
+                        PNGDeflateInfo *deflate_info,png_bytep pixels)
+{
+  if (deflate_info == (PNGDeflateInfo *) NULL)
+    {
+      png_write_row(ping,pixels);
+      return;
+    }
+  if (WritePNGDeflateRow(image,deflate_info,pixels) == MagickFail)
+    png_error(ping, "Could not deflate IDAT");
+}
+
 static MagickPassFail WriteOnePNGImage(MngInfo *mng_info,
                                        const ImageInfo *image_info,Image *imagep)
 {
@@ -7168,21 +7892,24 @@ static MagickPassFail WriteOnePNGImage(MngInfo *mng_info,
     *image;                      /* Use only 'image' after setjmp() */
 
   /* Write one PNG image */
-  const ImageAttribute
-    *attribute;
-
   char
     s[2];
 
   int
     num_passes,
     pass,
+    ping_base_filter = 0,
     ping_bit_depth = 0,
     ping_colortype = 0,
+    ping_compression_level = Z_DEFAULT_COMPRESSION,
     ping_interlace_method = 0,
     ping_compression_method = 0;
 
+  PNGDeflateInfo
+    *deflate_info;
+
   volatile int
+    ping_compression_strategy = -1, /* None requested */
     ping_filter_method = 0,
     ping_num_trans = 0,
     ping_valid_trns = 0;
@@ -7239,6 +7966,7 @@ static MagickPassFail WriteOnePNGImage(MngInfo *mng_info,
                          "  enter WriteOnePNGImage()");
 
   assert(mng_info->png_pixels == (unsigned char *) NULL);
+  assert(mng_info->png_deflate == (PNGDeflateInfo *) NULL);
 
   if (imagev == (Image *) NULL)
     return(MagickFalse);
@@ -7329,6 +8057,8 @@ static MagickPassFail WriteOnePNGImage(MngInfo *mng_info,
                             "PNG write has failed!");
       png_destroy_write_struct(&ping,&ping_info);
       MagickFreeResourceLimitedMemory(mng_info->png_pixels);
+      DestroyPNGDeflateInfo(mng_info->png_deflate);
+      mng_info->png_deflate=(PNGDeflateInfo *) NULL;
 #if defined(GMPNG_SETJMP_NOT_THREAD_SAFE)
       UnlockSemaphoreInfo(png_semaphore);
 #endif
@@ -8068,6 +8798,7 @@ static MagickPassFail WriteOnePNGImage(MngInfo *mng_info,
         (void) LogMagickEvent(CoderEvent,GetMagickModule(),
                               "    Compression level: %d",level);
       png_set_compression_level(ping,level);
+      ping_compression_level=level;
     }
   else
     {
@@ -8076,6 +8807,8 @@ static MagickPassFail WriteOnePNGImage(MngInfo *mng_info,
                               "    Compression strategy: Z_HUFFMAN_ONLY");
       png_set_compression_strategy(ping, Z_HUFFMAN_ONLY);
       png_set_compression_level(ping,2);
+      ping_compression_strategy=Z_HUFFMAN_ONLY;
+      ping_compression_level=2;
     }
   if (logging)
     (void) LogMagickEvent(CoderEvent,GetMagickModule(),
@@ -8121,6 +8854,7 @@ static MagickPassFail WriteOnePNGImage(MngInfo *mng_info,
                                 "    Base filter method: NONE");
       }
     png_set_filter(ping,PNG_FILTER_TYPE_BASE,base_filter);
+    ping_base_filter=base_filter;
   }
 
   ping_interlace_method=(image_info->interlace == LineInterlace);
@@ -8419,6 +9153,32 @@ static MagickPassFail WriteOnePNGImage(MngInfo *mng_info,
         }
     }
 
+  /*
+    Deflate IDAT on several threads when there is more than one block of
+    image data.  The IDAT chunks and IEND are then written directly, so
+    text chunks must be set up now to be written by png_write_info().
+  */
+  deflate_info=(PNGDeflateInfo *) NULL;
+  if ((omp_get_max_threads() > 1) && !ping_interlace_method &&
+      (ping_filter_method == PNG_FILTER_TYPE_BASE) &&
+      ((magick_uint64_t) ping_height*
+       (((magick_uint64_t) ping_width*png_get_channels(ping,ping_info)*
+         ping_bit_depth+7)/8+1) > PNG_DEFLATE_BLOCK_SIZE))
+    {
+      deflate_info=AllocatePNGDeflateInfo(ping,ping_info,
+                                          ping_compression_level,
+                                          ping_compression_strategy,
+                                          ping_base_filter,logging);
+      if (deflate_info == (PNGDeflateInfo *) NULL)
+        png_error(ping, "Could not allocate deflate blocks");
+      mng_info->png_deflate=deflate_info; /* For free in setjmp handler */
+      if (logging)
+        (void) LogMagickEvent(CoderEvent,GetMagickModule(),
+                              "  Deflating IDAT on %d threads",
+                              omp_get_max_threads());
+      png_set_text_attributes(image_info,ping,ping_info,image,logging);
+    }
+
   png_write_info(ping,ping_info);
 
   /* write orNT if image->orientation is defined and not TopLeft */
@@ -8545,7 +9305,7 @@ static MagickPassFail WriteOnePNGImage(MngInfo *mng_info,
                                           quantum_size,png_pixels,0,0);
             for (i=0; i < (long) image->columns; i++)
               *(png_pixels+i)=(*(png_pixels+i) > 128) ? 255 : 0;
-            png_write_row(ping,png_pixels);
+            WritePNGRow(ping,image,deflate_info,png_pixels);
             if (image->previous == (Image *) NULL)
               if (QuantumTick((magick_uint64_t) y*((magick_uint64_t)pass+1),
                               (magick_uint64_t) image->rows * num_passes))
@@ -8604,7 +9364,7 @@ static MagickPassFail WriteOnePNGImage(MngInfo *mng_info,
                                                 quantum_size,
                                                 png_pixels,0,0);
                   }
-                png_write_row(ping,png_pixels);
+                WritePNGRow(ping,image,deflate_info,png_pixels);
                 if (image->previous == (Image *) NULL)
                   if (QuantumTick((magick_uint64_t) y*((magick_uint64_t) pass+1),
                                   (magick_uint64_t) image->rows * num_passes))
@@ -8668,7 +9428,7 @@ static MagickPassFail WriteOnePNGImage(MngInfo *mng_info,
                                                       quantum_size,
                                                       png_pixels,0,0);
                         }
-                      png_write_row(ping,png_pixels);
+                      WritePNGRow(ping,image,deflate_info,png_pixels);
                       if (image->previous == (Image *) NULL)
                       if (QuantumTick((magick_uint64_t) y * ((magick_uint64_t) pass+1),
                                       (magick_uint64_t) image->rows *
@@ -8714,7 +9474,7 @@ static MagickPassFail WriteOnePNGImage(MngInfo *mng_info,
                                                     IndexQuantum,
                                                     quantum_size,
                                                     png_pixels,0,0);
-                      png_write_row(ping,png_pixels);
+                      WritePNGRow(ping,image,deflate_info,png_pixels);
                       if (image->previous == (Image *) NULL)
                         if (QuantumTick((magick_uint64_t) y * ((magick_uint64_t) pass+1),
                                         (magick_uint64_t) image->rows *
@@ -8737,6 +9497,10 @@ static MagickPassFail WriteOnePNGImage(MngInfo *mng_info,
   MagickFreeResourceLimitedMemory(png_pixels);
   mng_info->png_pixels = (unsigned char *) NULL;
 
+  if ((deflate_info != (PNGDeflateInfo *) NULL) &&
+      (FinishPNGDeflate(image,deflate_info) == MagickFail))
+    png_error(ping, "Could not deflate IDAT");
+
   if (logging)
     {
       (void) LogMagickEvent(CoderEvent,GetMagickModule(),
@@ -8758,42 +9522,12 @@ static MagickPassFail WriteOnePNGImage(MngInfo *mng_info,
                             ping_interlace_method);
     }
   /*
-    Generate text chunks.
+    Generate text chunks, unless IDAT was deflated on several threads, in
+    which case they were set up before png_write_info() since
+    png_write_end() is not used.
   */
-  attribute=GetImageAttribute(image,(char *) NULL);
-  for ( ; attribute != (const ImageAttribute *) NULL;
-        attribute=attribute->next)
-    {
-      png_textp
-        text;
-
-      if (*attribute->key == '[')
-        continue;
-      if (LocaleCompare(attribute->key,"png:IHDR.color-type-orig") == 0 ||
-          LocaleCompare(attribute->key,"png:IHDR.bit-depth-orig") == 0)
-        continue;
-#if PNG_LIBPNG_VER >= 14000
-            text=(png_textp) png_malloc(ping,
-                 (png_alloc_size_t) sizeof(png_text));
-#else
-            text=(png_textp) png_malloc(ping,(png_size_t) sizeof(png_text));
-#endif
-      text[0].key=attribute->key;
-      text[0].text=attribute->value;
-      text[0].text_length=strlen(attribute->value);
-      text[0].compression=image_info->compression == NoCompression ||
-        (image_info->compression == UndefinedCompression &&
-         text[0].text_length < 128) ? -1 : 0;
-      if (logging)
-        {
-          (void) LogMagickEvent(CoderEvent,GetMagickModule(),
-                                "  Setting up text chunk");
-          (void) LogMagickEvent(CoderEvent,GetMagickModule(),
-                                "    keyword: %s",text[0].key);
-        }
-      png_set_text(ping,ping_info,text,1);
-      png_free(ping,text);
-    }
+  if (deflate_info == (PNGDeflateInfo *) NULL)
+    png_set_text_attributes(image_info,ping,ping_info,image,logging);
 
   /* write eXIf profile */
   {
@@ -8857,10 +9591,28 @@ static MagickPassFail WriteOnePNGImage(MngInfo *mng_info,
       }
     }
 
-  if (logging)
-    (void) LogMagickEvent(CoderEvent,GetMagickModule(),
-                          "  Writing PNG end info");
-  png_write_end(ping,ping_info);
+  if (deflate_info != (PNGDeflateInfo *) NULL)
+    {
+      unsigned char
+        chunk[4];
+
+      DestroyPNGDeflateInfo(deflate_info);
+      mng_info->png_deflate=(PNGDeflateInfo *) NULL;
+
+      /* Write IEND chunk */
+      (void) WriteBlobMSBULong(image,0L);
+      PNGType(chunk,mng_IEND);
+      LogPNGChunk(logging,mng_IEND,0);
+      (void) WriteBlob(image,4,(char *) chunk);
+      (void) WriteBlobMSBULong(image,crc32(0,chunk,4));
+    }
+  else
+    {
+      if (logging)
+        (void) LogMagickEvent(CoderEvent,GetMagickModule(),
+                              "  Writing PNG end info");
+      png_write_end(ping,ping_info);
+    }
   if (mng_info->need_fram && (int) image->dispose == BackgroundDispose)
     {
       if (mng_info->page.x || mng_info->page.y || (ping_width !=
@@ -50,12 +50,14 @@
 #include "magick/log.h"
 #include "magick/magick.h"
 #include "magick/monitor.h"
+#include "magick/omp_data_view.h"
 #include "magick/pixel_cache.h"
 #include "magick/profile.h"
 #include "magick/quantize.h"
 #include "magick/resize.h"
 #include "magick/resource.h"
 #include "magick/tempfile.h"
+#include "magick/transform.h"
 #include "magick/tsd.h"
 #include "magick/utility.h"
 #include "magick/version.h"
@@ -156,6 +158,34 @@ typedef struct _Magick_TIFF_ClientData
   const ImageInfo
     *image_info;
 } Magick_TIFF_ClientData;
+
+/*
+  In-memory file used to compress one strip or tile with libtiff on a
+  worker thread.
+*/
+typedef struct _Magick_TIFF_Sink
+{
+  unsigned char
+    *data;               /* file data */
+
+  size_t
+    length,              /* bytes in file */
+    extent,              /* bytes allocated */
+    offset;              /* current offset */
+} Magick_TIFF_Sink;
+
+/*
+  Client data for an additional read-only handle on the input blob,
+  used by one thread to decode strips or tiles concurrently with others.
+*/
+typedef struct _Magick_TIFF_ThreadData
+{
+  Image
+    *image;              /* image owning the shared blob */
+
+  magick_off_t
+    offset;              /* this handle's current offset */
+} Magick_TIFF_ThreadData;
 
 /*
   Forward declarations.
@@ -1167,6 +1197,232 @@ TIFFWriteBlob(thandle_t image_handle,tdata_t data,tsize_t size)
   return result;
 }
 
+/* Close in-memory sink (memory is owned by the caller) */
+static int
+TIFFCloseSink(thandle_t sink_handle)
+{
+  ARG_NOT_USED(sink_handle);
+  return 0;
+}
+
+/* In-memory sink is never mapped */
+static int
+TIFFMapSink(thandle_t sink_handle,tdata_t *base,toff_t *size)
+{
+  ARG_NOT_USED(sink_handle);
+  ARG_NOT_USED(base);
+  ARG_NOT_USED(size);
+  return 0;
+}
+
+/* Read in-memory sink data at current offset */
+static tsize_t
+TIFFReadSink(thandle_t sink_handle,tdata_t data,tsize_t size)
+{
+  Magick_TIFF_Sink
+    *sink = (Magick_TIFF_Sink *) sink_handle;
+
+  size_t
+    count=0;
+
+  if (sink->offset < sink->length)
+    {
+      count=Min((size_t) size,sink->length-sink->offset);
+      (void) memcpy(data,sink->data+sink->offset,count);
+      sink->offset+=count;
+    }
+  return (tsize_t) count;
+}
+
+/* Seek to in-memory sink offset */
+static toff_t
+TIFFSeekSink(thandle_t sink_handle,toff_t offset,int whence)
+{
+  Magick_TIFF_Sink
+    *sink = (Magick_TIFF_Sink *) sink_handle;
+
+  switch (whence)
+    {
+    case SEEK_SET:
+      sink->offset=(size_t) offset;
+      break;
+    case SEEK_CUR:
+      sink->offset+=(size_t) offset;
+      break;
+    case SEEK_END:
+      sink->offset=sink->length+(size_t) offset;
+      break;
+    default:
+      return (toff_t) -1;
+    }
+  return (toff_t) sink->offset;
+}
+
+/* Obtain in-memory sink size */
+static toff_t
+TIFFGetSinkSize(thandle_t sink_handle)
+{
+  return (toff_t) ((Magick_TIFF_Sink *) sink_handle)->length;
+}
+
+/* Unmap in-memory sink (never mapped) */
+static void
+TIFFUnmapSink(thandle_t sink_handle,tdata_t base,toff_t size)
+{
+  ARG_NOT_USED(sink_handle);
+  ARG_NOT_USED(base);
+  ARG_NOT_USED(size);
+}
+
+/* Close thread handle (the blob is owned by the main handle) */
+static int
+TIFFCloseThreadBlob(thandle_t thread_handle)
+{
+  ARG_NOT_USED(thread_handle);
+  return 0;
+}
+
+/* Obtain BLOB size for thread handle */
+static toff_t
+TIFFGetThreadBlobSize(thandle_t thread_handle)
+{
+  Image
+    *image = ((Magick_TIFF_ThreadData *) thread_handle)->image;
+
+  toff_t
+    result;
+
+#if defined(HAVE_OPENMP)
+#  pragma omp critical (GM_TIFFThreadBlob)
+#endif
+  result=(toff_t) GetBlobSize(image);
+  return result;
+}
+
+/* Map BLOB for thread handle if the BLOB is already in memory */
+static int
+TIFFMapThreadBlob(thandle_t thread_handle,tdata_t *base,toff_t *size)
+{
+  Image
+    *image = ((Magick_TIFF_ThreadData *) thread_handle)->image;
+
+  *base = (tdata_t *) GetBlobStreamData(image);
+  if (*base)
+    {
+      *size = (toff_t) GetBlobSize(image);
+      return 1;
+    }
+  return 0;
+}
+
+/*
+  Read BLOB data at thread handle's offset.  The BLOB is shared by all
+  handles so it is positioned and read within a critical section.
+*/
+static tsize_t
+TIFFReadThreadBlob(thandle_t thread_handle,tdata_t data,tsize_t size)
+{
+  Magick_TIFF_ThreadData
+    *thread_data = (Magick_TIFF_ThreadData *) thread_handle;
+
+  tsize_t
+    result=0;
+
+#if defined(HAVE_OPENMP)
+#  pragma omp critical (GM_TIFFThreadBlob)
+#endif
+  {
+    if (SeekBlob(thread_data->image,thread_data->offset,SEEK_SET) ==
+        thread_data->offset)
+      result=(tsize_t) ReadBlob(thread_data->image,(size_t) size,data);
+  }
+  if (result > 0)
+    thread_data->offset+=result;
+  return result;
+}
+
+/* Seek to thread handle offset */
+static toff_t
+TIFFSeekThreadBlob(thandle_t thread_handle,toff_t offset,int whence)
+{
+  Magick_TIFF_ThreadData
+    *thread_data = (Magick_TIFF_ThreadData *) thread_handle;
+
+  switch (whence)
+    {
+    case SEEK_SET:
+      thread_data->offset=(magick_off_t) offset;
+      break;
+    case SEEK_CUR:
+      thread_data->offset+=(magick_off_t) offset;
+      break;
+    case SEEK_END:
+      thread_data->offset=(magick_off_t) TIFFGetThreadBlobSize(thread_handle)+
+        (magick_off_t) offset;
+      break;
+    default:
+      return (toff_t) -1;
+    }
+  return (toff_t) thread_data->offset;
+}
+
+/* Unmap BLOB memory for thread handle */
+static void
+TIFFUnmapThreadBlob(thandle_t thread_handle,tdata_t base,toff_t size)
+{
+  ARG_NOT_USED(thread_handle);
+  ARG_NOT_USED(base);
+  ARG_NOT_USED(size);
+}
+
+/* Thread handles are read-only */
+static tsize_t
+TIFFWriteThreadBlob(thandle_t thread_handle,tdata_t data,tsize_t size)
+{
+  ARG_NOT_USED(thread_handle);
+  ARG_NOT_USED(data);
+  ARG_NOT_USED(size);
+  return -1;
+}
+
+/* Write in-memory sink data at current offset, growing as required */
+static tsize_t
+TIFFWriteSink(thandle_t sink_handle,tdata_t data,tsize_t size)
+{
+  Magick_TIFF_Sink
+    *sink = (Magick_TIFF_Sink *) sink_handle;
+
+  size_t
+    end;
+
+  end=sink->offset+(size_t) size;
+  if (end < sink->offset)
+    return -1;
+  if (end > sink->extent)
+    {
+      unsigned char
+        *grown;
+
+      size_t
+        extent;
+
+      extent=Max(end,2*sink->extent);
+      grown=MagickReallocateResourceLimitedMemory(unsigned char *,sink->data,
+                                                  extent);
+      if (grown == (unsigned char *) NULL)
+        return -1;
+      sink->data=grown;
+      sink->extent=extent;
+    }
+  if (sink->offset > sink->length)
+    (void) memset(sink->data+sink->length,0,sink->offset-sink->length);
+  (void) memcpy(sink->data+sink->offset,data,(size_t) size);
+  sink->offset=end;
+  if (end > sink->length)
+    sink->length=end;
+  return size;
+}
+
 /*
   Convert TIFF data from libtiff "native" format to byte-parsable big endian
 */
@@ -1732,6 +1988,43 @@ CompactSamples( const unsigned long total_pixels,
 }
 
 
+/*
+  Shift a row of packed samples left in place so that it starts at
+  pixel skip_pixels.  Used when the first pixel to import does not
+  start on a byte boundary.
+*/
+static void
+SkipSamples( const unsigned long skip_pixels,
+             const unsigned long total_pixels,
+             const unsigned int bits_per_pixel,
+             unsigned char *samples)
+{
+  size_t
+    end,
+    i,
+    length,
+    offset;
+
+  unsigned int
+    shift;
+
+  offset=((size_t) skip_pixels*bits_per_pixel)/8;
+  shift=(unsigned int) (((size_t) skip_pixels*bits_per_pixel)%8);
+  length=((size_t) total_pixels*bits_per_pixel+7)/8;
+  end=((size_t) (skip_pixels+total_pixels)*bits_per_pixel+7)/8;
+  if (shift == 0)
+    {
+      (void) memmove(samples,samples+offset,length);
+      return;
+    }
+  for (i=0; i < length; i++)
+    {
+      samples[i]=(unsigned char) (samples[offset+i] << shift);
+      if (offset+i+1 < end)
+        samples[i] |= (unsigned char) (samples[offset+i+1] >> (8-shift));
+    }
+}
+
 /*
   Convert selected pixel area to associated alpha representation.
 */
@@ -1806,38 +2099,635 @@ DisassociateAlphaRegion(Image *image)
     }
 }
 
-#if defined(__cplusplus) || defined(c_plusplus)
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+/*
+  Copy a possibly unterminated sized string to an image attribute.
+*/
+#define CopySizedFieldToAttribute(key,count,text)                       \
+  do                                                                    \
+    {                                                                   \
+      char _attribute[MaxTextExtent];                                   \
+      (void) memcpy(_attribute,text,Min(sizeof(_attribute),count));     \
+      _attribute[Min(sizeof(_attribute)-1,count)]='\0';                 \
+      (void) SetImageAttribute(image,key,_attribute);                   \
+    } while(0);
+
+
+typedef enum
+{
+  ScanLineMethod,            /* Scanline method */
+  StrippedMethod,            /* Stripped method */
+  TiledMethod,               /* Tiled method */
+  RGBAStrippedMethod,        /* RGBA stripped method */
+  RGBATiledMethod,           /* RGBA tiled method */
+  RGBAPuntMethod             /* RGBA whole-image method (last resort) */
+} TIFFMethod;
+
+#define ThrowTIFFReaderException(code_,reason_,image_) \
+{ \
+  if (tiff != (TIFF *) NULL)                  \
+    TIFFClose(tiff);                          \
+  ThrowReaderException(code_,reason_,image_); \
+}
+
+/*
+  Strip or tile geometry and sample layout needed to decode and import
+  chunks, possibly on several threads.
+*/
+typedef struct _Magick_TIFF_DecodeInfo
+{
+  MagickBool
+    tiled,               /* chunks are tiles rather than strips */
+    parallel;            /* decode chunks on several threads */
+
+  uint32
+    columns,             /* directory width */
+    rows,                /* directory height */
+    chunk_columns,       /* tile width or image width */
+    chunk_rows;          /* tile height or rows per strip */
+
+  RectangleInfo
+    region;              /* area of directory stored in image */
+
+  tsize_t
+    chunk_size,          /* decode buffer size */
+    stride;              /* bytes per chunk row */
+
+  int
+    max_sample;          /* number of planes to read */
+
+  uint16
+    bits_per_sample,
+    compress_tag,
+    photometric,
+    planar_config,
+    sample_format,
+    samples_per_pixel;
+
+  AlphaType
+    alpha_type;
+
+  const ImportPixelAreaOptions
+    *import_options;
+} Magick_TIFF_DecodeInfo;
+
+/*
+  Strips and tiles compressed with these codecs are decoded
+  independently of each other, so a file with more than one may be
+  decoded by several threads, each using its own TIFF handle.
+*/
+static MagickBool
+TIFFParallelDecodeSupported(const uint16 compress_tag,
+                            const unsigned long chunks)
+{
+  if ((omp_get_max_threads() < 2) || (chunks < 2))
+    return MagickFalse;
+  switch (compress_tag)
+    {
+    case COMPRESSION_NONE:
+    case COMPRESSION_ADOBE_DEFLATE:
+    case COMPRESSION_DEFLATE:
+    case COMPRESSION_JPEG:
+    case COMPRESSION_LZW:
+    case COMPRESSION_PACKBITS:
+#if defined(COMPRESSION_LZMA)
+    case COMPRESSION_LZMA:
+#endif /* defined(COMPRESSION_LZMA) */
+#if defined(COMPRESSION_ZSTD)
+    case COMPRESSION_ZSTD:
+#endif /* defined(COMPRESSION_ZSTD) */
+      return MagickTrue;
+    default:
+      return MagickFalse;
+    }
+}
+
+static void
+DestroyTIFFThreadHandle(void *handle)
+{
+  TIFF
+    *thread_tiff = (TIFF *) handle;
+
+  thandle_t
+    thread_data;
+
+  if (thread_tiff == (TIFF *) NULL)
+    return;
+  thread_data=TIFFClientdata(thread_tiff);
+  TIFFClose(thread_tiff);
+  MagickFreeMemory(thread_data);
+}
+
+/*
+  Open an additional handle on the image blob and select the directory
+  at dir_offset.  A non-negative jpeg_color_mode is applied as for the
+  main handle.
+*/
+static TIFF *
+OpenTIFFThreadHandle(Image *image,const toff_t dir_offset,
+                     const int jpeg_color_mode)
+{
+  Magick_TIFF_ThreadData
+    *thread_data;
+
+  TIFF
+    *thread_tiff;
+
+  thread_data=MagickAllocateMemory(Magick_TIFF_ThreadData *,
+                                   sizeof(Magick_TIFF_ThreadData));
+  if (thread_data == (Magick_TIFF_ThreadData *) NULL)
+    return (TIFF *) NULL;
+  thread_data->image=image;
+  thread_data->offset=0;
+  thread_tiff=TIFFClientOpen(image->filename,"rb",(thandle_t) thread_data,
+                             TIFFReadThreadBlob,TIFFWriteThreadBlob,
+                             TIFFSeekThreadBlob,TIFFCloseThreadBlob,
+                             TIFFGetThreadBlobSize,TIFFMapThreadBlob,
+                             TIFFUnmapThreadBlob);
+  if (thread_tiff == (TIFF *) NULL)
+    {
+      MagickFreeMemory(thread_data);
+      return (TIFF *) NULL;
+    }
+  if (!TIFFSetSubDirectory(thread_tiff,dir_offset))
+    {
+      DestroyTIFFThreadHandle(thread_tiff);
+      return (TIFF *) NULL;
+    }
+  if (jpeg_color_mode >= 0)
+    (void) TIFFSetField(thread_tiff,TIFFTAG_JPEGCOLORMODE,jpeg_color_mode);
+  return thread_tiff;
+}
+
+/*
+  Obtain the area of a columns x rows directory requested by a
+  "file.tif[WxH+X+Y]" read specification, clipped to the directory as
+  CropImage() would clip it.  The region is the whole directory if no
+  such specification was given.  Returns MagickFail if the requested
+  area lies outside of the directory.
+*/
+static MagickPassFail
+GetTIFFReadRegion(const ImageInfo *image_info,const unsigned long columns,
+                  const unsigned long rows,RectangleInfo *region)
+{
+  long
+    x,
+    y;
+
+  unsigned long
+    height,
+    width;
+
+  region->x=0;
+  region->y=0;
+  region->width=columns;
+  region->height=rows;
+  if ((image_info->tile == (char *) NULL) ||
+      IsSubimage(image_info->tile,False))
+    return MagickPass;
+  x=y=0;
+  width=height=0;
+  (void) GetGeometry(image_info->tile,&x,&y,&width,&height);
+  if ((width == 0) || (height == 0))
+    return MagickPass;
+  if (((x+(long) width) <= 0) || ((y+(long) height) <= 0) ||
+      (x >= (long) columns) || (y >= (long) rows))
+    return MagickFail;
+  if (x < 0)
+    {
+      width+=x;
+      x=0;
+    }
+  if (y < 0)
+    {
+      height+=y;
+      y=0;
+    }
+  if ((x+(long) width) > (long) columns)
+    width=columns-x;
+  if ((y+(long) height) > (long) rows)
+    height=rows-y;
+  region->x=x;
+  region->y=y;
+  region->width=width;
+  region->height=height;
+  return MagickPass;
+}
+
+/*
+  Decode the strips or tiles of the current directory which intersect
+  decode_info->region and import that region into the image.  Chunks
+  are decoded concurrently if decode_info->parallel is set, each thread
+  reading through its own TIFF handle.  Otherwise they are read in
+  order through the main handle.
+*/
+static MagickPassFail
+ReadTIFFChunks(Image *image,TIFF *tiff,
+               const Magick_TIFF_DecodeInfo *decode_info,
+               ExceptionInfo *exception)
+{
+  ThreadViewDataSet
+    *chunk_set,
+    *handle_set;
+
+  toff_t
+    dir_offset;
+
+  const RectangleInfo
+    *region = &decode_info->region;
+
+  unsigned long
+    chunks_across,
+    chunks_done=0,
+    chunks_per_plane,
+    chunks_total,
+    first_chunk_column,
+    first_chunk_row;
+
+  int
+    jpeg_color_mode=-1,
+    sample;
+
+  MagickPassFail
+    status=MagickPass;
+
+#if defined(HAVE_OPENMP)
+  int num_threads=(decode_info->parallel ? omp_get_max_threads() : 1);
+#endif /* defined(HAVE_OPENMP) */
+
+  dir_offset=TIFFCurrentDirOffset(tiff);
+  if (decode_info->compress_tag == COMPRESSION_JPEG)
+    (void) TIFFGetField(tiff,TIFFTAG_JPEGCOLORMODE,&jpeg_color_mode);
+  /*
+    Only chunks which intersect the region are decoded.
+  */
+  first_chunk_column=region->x/decode_info->chunk_columns;
+  first_chunk_row=region->y/decode_info->chunk_rows;
+  chunks_across=(region->x+region->width-1)/decode_info->chunk_columns-
+    first_chunk_column+1;
+  chunks_per_plane=chunks_across*
+    ((region->y+region->height-1)/decode_info->chunk_rows-first_chunk_row+1);
+  chunks_total=chunks_per_plane*decode_info->max_sample;
+  handle_set=AllocateThreadViewDataSet(DestroyTIFFThreadHandle,image,exception);
+  chunk_set=AllocateThreadViewDataArray(image,exception,
+                                        (size_t) decode_info->chunk_size,1);
+  if ((handle_set == (ThreadViewDataSet *) NULL) ||
+      (chunk_set == (ThreadViewDataSet *) NULL))
+    {
+      DestroyThreadViewDataSet(handle_set);
+      DestroyThreadViewDataSet(chunk_set);
+      return MagickFail;
+    }
+
+  for (sample=0; (status != MagickFail) && (sample < decode_info->max_sample);
+       sample++)
+    {
+      QuantumType
+        quantum_type;
+
+      int
+        quantum_samples;
+
+      long
+        chunk;
+
+      /*
+        Determine quantum parse method.
+      */
+      if (QuantumTransferMode(image,decode_info->photometric,
+                              decode_info->compress_tag,
+                              decode_info->sample_format,
+                              decode_info->samples_per_pixel,
+                              decode_info->planar_config,sample,
+                              &quantum_type,&quantum_samples,exception)
+          == MagickFail)
+        {
+          status=MagickFail;
+          break;
+        }
+
+#if defined(HAVE_OPENMP)
+#  if defined(TUNE_OPENMP)
+#    pragma omp parallel for if(num_threads > 1) num_threads(num_threads) schedule(runtime) shared(chunks_done, status)
+#  else
+#    pragma omp parallel for if(num_threads > 1) num_threads(num_threads) schedule(dynamic,1) shared(chunks_done, status)
+#  endif
+#endif
+      for (chunk=0; chunk < (long) chunks_per_plane; chunk++)
+        {
+          ExceptionInfo
+            chunk_exception;
+
+          TIFF
+            *thread_tiff;
+
+          unsigned char
+            *chunk_pixels,
+            *p;
+
+          void
+            *tsd_exception;
+
+          tsize_t
+            chunk_size;
+
+          unsigned long
+            chunk_set_columns,
+            chunk_set_rows,
+            import_bits,
+            import_columns,
+            pixel_bits,
+            x,
+            x_end,
+            x_start,
+            y,
+            y_end,
+            y_start,
+            yy;
+
+          MagickPassFail
+            thread_status;
+
+#if defined(HAVE_OPENMP)
+#  pragma omp critical (GM_ReadTIFFChunks)
+#endif
+          thread_status=status;
+          if (thread_status == MagickFail)
+            continue;
+
+          /*
+            Route libtiff errors raised by this thread to a private
+            exception, merged into the caller's exception below.
+          */
+          GetExceptionInfo(&chunk_exception);
+          tsd_exception=MagickTsdGetSpecific(tsd_key);
+          (void) MagickTsdSetSpecific(tsd_key,(void *) &chunk_exception);
+
+          if (!decode_info->parallel)
+            thread_tiff=tiff;
+          else
+            thread_tiff=(TIFF *) AccessThreadViewData(handle_set);
+          if (thread_tiff == (TIFF *) NULL)
+            {
+              thread_tiff=OpenTIFFThreadHandle(image,dir_offset,
+                                               jpeg_color_mode);
+              if (thread_tiff != (TIFF *) NULL)
+                AssignThreadViewData(handle_set,omp_get_thread_num(),
+                                     thread_tiff);
+              else
+                thread_status=MagickFail;
+            }
+          chunk_pixels=(unsigned char *) AccessThreadViewData(chunk_set);
+
+          /*
+            Compute directory area corresponding to chunk, and the part
+            of it within the region.
+          */
+          x=(first_chunk_column+chunk % chunks_across)*
+            decode_info->chunk_columns;
+          y=(first_chunk_row+chunk / chunks_across)*decode_info->chunk_rows;
+          chunk_set_columns=Min(decode_info->chunk_columns,
+                                decode_info->columns-x);
+          chunk_set_rows=Min(decode_info->chunk_rows,decode_info->rows-y);
+          x_start=Max(x,(unsigned long) region->x);
+          x_end=Min(x+chunk_set_columns,region->x+region->width);
+          y_start=Max(y,(unsigned long) region->y);
+          y_end=Min(y+chunk_set_rows,region->y+region->height);
+          import_columns=x_end-x_start;
+
+          /*
+            Decode the chunk.
+          */
+          chunk_size=-1;
+          if (thread_status != MagickFail)
+            {
+              if (decode_info->tiled)
+                chunk_size=TIFFReadTile(thread_tiff,chunk_pixels,(uint32) x,
+                                        (uint32) y,0,(tsample_t) sample);
+              else
+                chunk_size=TIFFReadEncodedStrip(thread_tiff,
+                                                TIFFComputeStrip(thread_tiff,(uint32) y,
+                                                                 (tsample_t) sample),
+                                                chunk_pixels,
+                                                decode_info->chunk_size);
+              if (chunk_size == -1)
+                thread_status=MagickFail;
+            }
+          (void) MagickTsdSetSpecific(tsd_key,tsd_exception);
+#if !defined(WORDS_BIGENDIAN)
+          if ((thread_status != MagickFail) &&
+              (24 == decode_info->bits_per_sample))
+            SwabDataToBigEndian(decode_info->bits_per_sample,chunk_pixels,
+                                chunk_size);
+#endif
+
+          /*
+            Import chunk rows within the region into image.
+          */
+          pixel_bits=decode_info->bits_per_sample;
+          if (decode_info->planar_config == PLANARCONFIG_CONTIG)
+            pixel_bits*=Min(decode_info->samples_per_pixel,quantum_samples);
+          import_bits=(x_start-x)*pixel_bits;
+          for (yy=y_start; (thread_status != MagickFail) && (yy < y_end); yy++)
+            {
+              PixelPacket
+                *q;
+
+              if (sample == 0)
+                q=SetImagePixelsEx(image,(long) (x_start-region->x),
+                                   (long) (yy-region->y),import_columns,1,
+                                   &chunk_exception);
+              else
+                q=GetImagePixelsEx(image,(long) (x_start-region->x),
+                                   (long) (yy-region->y),import_columns,1,
+                                   &chunk_exception);
+              if (q == (PixelPacket *) NULL)
+                {
+                  thread_status=MagickFail;
+                  break;
+                }
+              if ((sample == 0) && (decode_info->max_sample > 1))
+                (void) memset(q,0,import_columns*sizeof(PixelPacket));
+              p=chunk_pixels+(yy-y)*decode_info->stride;
+              /*
+                Compact chunk row to only contain raster data.
+              */
+              if ((decode_info->samples_per_pixel > quantum_samples) &&
+                  (decode_info->planar_config == PLANARCONFIG_CONTIG))
+                CompactSamples(chunk_set_columns,decode_info->bits_per_sample,
+                               decode_info->samples_per_pixel,quantum_samples,p);
+              /*
+                Skip chunk columns to the left of the region.
+              */
+              if ((import_bits % 8) == 0)
+                p+=import_bits/8;
+              else
+                SkipSamples(x_start-x,import_columns,(unsigned int) pixel_bits,p);
+              if (ImportImagePixelArea(image,quantum_type,
+                                       decode_info->bits_per_sample,p,
+                                       decode_info->import_options,0)
+                  == MagickFail)
+                {
+                  thread_status=MagickFail;
+                  break;
+                }
+              /*
+                Disassociate alpha from pixels if necessary.
+              */
+              if ((PHOTOMETRIC_RGB == decode_info->photometric) &&
+                  (image->matte) &&
+                  (decode_info->alpha_type == AssociatedAlpha) &&
+                  (sample == (decode_info->max_sample-1)))
+                DisassociateAlphaRegion(image);
+              if (!SyncImagePixelsEx(image,&chunk_exception))
+                {
+                  thread_status=MagickFail;
+                  break;
+                }
+            }
+
+#if defined(HAVE_OPENMP)
+#  pragma omp critical (GM_ReadTIFFChunks)
+#endif
+          {
+            if (chunk_exception.severity > exception->severity)
+              CopyException(exception,&chunk_exception);
+            if ((thread_status == MagickFail) &&
+                (image->exception.severity > exception->severity))
+              CopyException(exception,&image->exception);
+
+            chunks_done++;
+            if ((thread_status != MagickFail) &&
+                (image->previous == (Image *) NULL))
+              if (QuantumTick(chunks_done,chunks_total))
+                if (!MagickMonitorFormatted(chunks_done,chunks_total,exception,
+                                            LoadImageText,image->filename,
+                                            image->columns,image->rows))
+                  thread_status=MagickFail;
+
+            if (thread_status == MagickFail)
+              status=MagickFail;
+          }
+          DestroyExceptionInfo(&chunk_exception);
+        }
+    }
+  DestroyThreadViewDataSet(chunk_set);
+  DestroyThreadViewDataSet(handle_set);
+  return status;
+}
+
+/*
+  Return MagickTrue if the current directory is flagged as a
+  reduced-resolution image.  If it is also smaller than the best
+  directory found so far but at least columns x rows, it becomes the
+  best directory.
+*/
+static MagickBool
+CheckTIFFReducedDirectory(TIFF *tiff,const unsigned long columns,
+                          const unsigned long rows,toff_t *best_offset,
+                          uint32 *best_columns,uint32 *best_rows)
+{
+  uint32
+    height,
+    subfiletype,
+    width;
+
+  if ((TIFFGetFieldDefaulted(tiff,TIFFTAG_SUBFILETYPE,&subfiletype) != 1) ||
+      !(subfiletype & FILETYPE_REDUCEDIMAGE) ||
+      (subfiletype & FILETYPE_MASK))
+    return MagickFalse;
+  if ((TIFFGetField(tiff,TIFFTAG_IMAGEWIDTH,&width) == 1) &&
+      (TIFFGetField(tiff,TIFFTAG_IMAGELENGTH,&height) == 1) &&
+      (width >= columns) && (height >= rows) &&
+      (width <= *best_columns) && (height <= *best_rows) &&
+      ((double) width*height < (double) *best_columns*(*best_rows)))
+    {
+      *best_offset=TIFFCurrentDirOffset(tiff);
+      *best_columns=width;
+      *best_rows=height;
+    }
+  return MagickTrue;
 }
-#endif
 
 /*
-  Copy a possibly unterminated sized string to an image attribute.
+  Select the smallest version of the current directory which is at
+  least columns x rows, and make it current.  Candidates are the current
+  directory, its SubIFDs, and the directories immediately following it
+  which are flagged as reduced-resolution images.  The offset of the
+  last of those following directories, from which reading continues
+  with the next page, is returned in last_offset, and their number in
+  reduced_pages.  The size of the current directory is returned in
+  base_columns and base_rows.
 */
-#define CopySizedFieldToAttribute(key,count,text)                       \
-  do                                                                    \
-    {                                                                   \
-      char _attribute[MaxTextExtent];                                   \
-      (void) memcpy(_attribute,text,Min(sizeof(_attribute),count));     \
-      _attribute[Min(sizeof(_attribute)-1,count)]='\0';                 \
-      (void) SetImageAttribute(image,key,_attribute);                   \
-    } while(0);
+static MagickPassFail
+SelectTIFFReducedDirectory(TIFF *tiff,const unsigned long columns,
+                           const unsigned long rows,toff_t *last_offset,
+                           unsigned int *reduced_pages,uint32 *base_columns,
+                           uint32 *base_rows)
+{
+  toff_t
+    best_offset,
+    *subifd_offsets = (toff_t *) NULL,
+    *offsets;
 
+  uint32
+    best_columns,
+    best_rows;
 
-typedef enum
-{
-  ScanLineMethod,            /* Scanline method */
-  StrippedMethod,            /* Stripped method */
-  TiledMethod,               /* Tiled method */
-  RGBAStrippedMethod,        /* RGBA stripped method */
-  RGBATiledMethod,           /* RGBA tiled method */
-  RGBAPuntMethod             /* RGBA whole-image method (last resort) */
-} TIFFMethod;
+  uint16
+    subifd_count = 0;
 
-#define ThrowTIFFReaderException(code_,reason_,image_) \
-{ \
-  if (tiff != (TIFF *) NULL)                  \
-    TIFFClose(tiff);                          \
-  ThrowReaderException(code_,reason_,image_); \
+  unsigned int
+    i;
+
+  if ((TIFFGetField(tiff,TIFFTAG_IMAGEWIDTH,base_columns) != 1) ||
+      (TIFFGetField(tiff,TIFFTAG_IMAGELENGTH,base_rows) != 1))
+    return MagickFail;
+  best_offset=TIFFCurrentDirOffset(tiff);
+  best_columns=*base_columns;
+  best_rows=*base_rows;
+  *last_offset=best_offset;
+  *reduced_pages=0;
+
+  /*
+    Save SubIFD offsets before leaving the directory.
+  */
+  if ((TIFFGetField(tiff,TIFFTAG_SUBIFD,&subifd_count,&offsets) == 1) &&
+      (subifd_count != 0))
+    {
+      subifd_offsets=MagickAllocateArray(toff_t *,subifd_count,sizeof(toff_t));
+      if (subifd_offsets == (toff_t *) NULL)
+        subifd_count=0;
+      else
+        (void) memcpy(subifd_offsets,offsets,subifd_count*sizeof(toff_t));
+    }
+
+  /*
+    Examine reduced-resolution directories following this one.
+  */
+  while (TIFFReadDirectory(tiff) &&
+         CheckTIFFReducedDirectory(tiff,columns,rows,&best_offset,
+                                   &best_columns,&best_rows))
+    {
+      *last_offset=TIFFCurrentDirOffset(tiff);
+      (*reduced_pages)++;
+    }
+
+  /*
+    Examine SubIFDs.
+  */
+  for (i=0; i < subifd_count; i++)
+    if (TIFFSetSubDirectory(tiff,subifd_offsets[i]))
+      (void) CheckTIFFReducedDirectory(tiff,columns,rows,&best_offset,
+                                       &best_columns,&best_rows);
+  MagickFreeMemory(subifd_offsets);
+
+  if (!TIFFSetSubDirectory(tiff,best_offset))
+    return MagickFail;
+  return MagickPass;
 }
 
 static Image *
@@ -1893,11 +2783,23 @@ ReadTIFFImage(const ImageInfo *image_info,ExceptionInfo *exception)
     units;
 
   uint32
+    base_columns,
+    base_rows,
     count,
     height,
     rows_per_strip,
     width;
 
+  unsigned long
+    size_columns=0,
+    size_rows=0;
+
+  unsigned int
+    reduced_pages=0;
+
+  toff_t
+    last_offset=0;
+
   TIFFMethod
     method;
 
@@ -1910,9 +2812,13 @@ ReadTIFFImage(const ImageInfo *image_info,ExceptionInfo *exception)
   AlphaType
     alpha_type=UnspecifiedAlpha;
 
+  RectangleInfo
+    region;
+
   MagickBool
     logging,
-    more_frames;
+    more_frames,
+    read_region;
 
   MagickPassFail
     status;
@@ -1956,6 +2862,20 @@ ReadTIFFImage(const ImageInfo *image_info,ExceptionInfo *exception)
       return (Image *) NULL;
     }
 
+  /*
+    A size hint selects the smallest reduced-resolution version of each
+    page which is at least that size.
+  */
+  if ((definition_value=AccessDefinition(image_info,"tiff","size")))
+    {
+      long
+        size_x,
+        size_y;
+
+      (void) GetGeometry(definition_value,&size_x,&size_y,&size_columns,
+                         &size_rows);
+    }
+
   if (image_info->subrange != 0)
     while (image->scene < image_info->subimage)
       {
@@ -1972,6 +2892,25 @@ ReadTIFFImage(const ImageInfo *image_info,ExceptionInfo *exception)
       }
   do
     {
+      if ((size_columns != 0) || (size_rows != 0))
+        {
+          if (SelectTIFFReducedDirectory(tiff,size_columns,size_rows,
+                                         &last_offset,&reduced_pages,
+                                         &base_columns,&base_rows)
+              == MagickFail)
+            ThrowTIFFReaderException(CorruptImageError,UnableToReadSubImageData,
+                                     image);
+          image->magick_columns=base_columns;
+          image->magick_rows=base_rows;
+          if (logging)
+            (void) LogMagickEvent(CoderEvent,GetMagickModule(),
+                                  "Size hint %lux%lu for %ux%u page"
+                                  " followed by %u reduced-resolution pages",
+                                  size_columns,size_rows,
+                                  (unsigned int) base_columns,
+                                  (unsigned int) base_rows,reduced_pages);
+        }
+
       if (image_info->verbose > 1)
         TIFFPrintDirectory(tiff,stdout,False);
 
@@ -2249,6 +3188,21 @@ ReadTIFFImage(const ImageInfo *image_info,ExceptionInfo *exception)
       image->rows=height;
       image->depth=bits_per_sample;
 
+      /*
+        Determine the area of the directory to read.
+      */
+      if (GetTIFFReadRegion(image_info,image->columns,image->rows,&region)
+          == MagickFail)
+        ThrowTIFFReaderException(OptionError,GeometryDoesNotContainImage,
+                                 image);
+      read_region=((region.width != image->columns) ||
+                   (region.height != image->rows));
+      if (read_region && logging)
+        (void) LogMagickEvent(CoderEvent,GetMagickModule(),
+                              "Reading region %lux%lu%+ld%+ld",
+                              region.width,region.height,
+                              region.x,region.y);
+
       if (image->scene != 0)
         status=MagickMonitorFormatted(image->scene-1,image->scene,
                                       &image->exception,
@@ -2485,6 +3439,12 @@ ReadTIFFImage(const ImageInfo *image_info,ExceptionInfo *exception)
       */
       if (image_info->ping)
         {
+          if (read_region)
+            {
+              image->columns=region.width;
+              image->rows=region.height;
+              image->page=region;
+            }
           if (image_info->subrange != 0)
             if (image->scene >= (image_info->subimage+image_info->subrange-1))
               break;
@@ -2658,6 +3618,12 @@ ReadTIFFImage(const ImageInfo *image_info,ExceptionInfo *exception)
               method=TiledMethod;
             else if (TIFFStripSize(tiff) <= 1024*256)
               method=StrippedMethod;
+            else if ((TIFFStripSize(tiff) <= 4*TIFF_BYTES_PER_STRIP) &&
+                     (read_region ||
+                      TIFFParallelDecodeSupported(compress_tag,
+                                                  TIFFNumberOfStrips(tiff))))
+              /* Strips may be decoded concurrently or selectively */
+              method=StrippedMethod;
             if (photometric == PHOTOMETRIC_MINISWHITE)
               import_options.grayscale_miniswhite=MagickTrue;
           }
@@ -2972,6 +3938,49 @@ ReadTIFFImage(const ImageInfo *image_info,ExceptionInfo *exception)
                                          image);
               }
 
+            /*
+              Decode strips concurrently if possible, and only the
+              strips intersecting the region if one was requested.
+            */
+            if (read_region ||
+                ((rows_per_strip < image->rows) &&
+                 TIFFParallelDecodeSupported(compress_tag,TIFFNumberOfStrips(tiff))))
+              {
+                Magick_TIFF_DecodeInfo
+                  decode_info;
+
+                decode_info.tiled=MagickFalse;
+                decode_info.parallel=
+                  TIFFParallelDecodeSupported(compress_tag,TIFFNumberOfStrips(tiff));
+                if (logging && decode_info.parallel)
+                  (void) LogMagickEvent(CoderEvent,GetMagickModule(),
+                                        "Decoding strips concurrently");
+                decode_info.columns=width;
+                decode_info.rows=height;
+                decode_info.chunk_columns=width;
+                decode_info.chunk_rows=Min(rows_per_strip,height);
+                decode_info.region=region;
+                decode_info.chunk_size=strip_size_max;
+                decode_info.stride=TIFFVStripSize(tiff,1);
+                decode_info.max_sample=max_sample;
+                decode_info.bits_per_sample=bits_per_sample;
+                decode_info.compress_tag=compress_tag;
+                decode_info.photometric=photometric;
+                decode_info.planar_config=planar_config;
+                decode_info.sample_format=sample_format;
+                decode_info.samples_per_pixel=samples_per_pixel;
+                decode_info.alpha_type=alpha_type;
+                decode_info.import_options=&import_options;
+                if (read_region)
+                  {
+                    image->columns=region.width;
+                    image->rows=region.height;
+                    image->page=region;
+                  }
+                status=ReadTIFFChunks(image,tiff,&decode_info,exception);
+                break;
+              }
+
             strip=MagickAllocateResourceLimitedClearedMemory(unsigned char *,(size_t) strip_size_max);
             if (strip == (unsigned char *) NULL)
               {
@@ -3215,6 +4224,48 @@ ReadTIFFImage(const ImageInfo *image_info,ExceptionInfo *exception)
                                          image);
               }
 
+            /*
+              Decode tiles concurrently if possible, and only the tiles
+              intersecting the region if one was requested.
+            */
+            if (read_region ||
+                TIFFParallelDecodeSupported(compress_tag,TIFFNumberOfTiles(tiff)))
+              {
+                Magick_TIFF_DecodeInfo
+                  decode_info;
+
+                decode_info.tiled=MagickTrue;
+                decode_info.parallel=
+                  TIFFParallelDecodeSupported(compress_tag,TIFFNumberOfTiles(tiff));
+                if (logging && decode_info.parallel)
+                  (void) LogMagickEvent(CoderEvent,GetMagickModule(),
+                                        "Decoding tiles concurrently");
+                decode_info.columns=width;
+                decode_info.rows=height;
+                decode_info.chunk_columns=tile_columns;
+                decode_info.chunk_rows=tile_rows;
+                decode_info.region=region;
+                decode_info.chunk_size=tile_size_max;
+                decode_info.stride=TIFFTileRowSize(tiff);
+                decode_info.max_sample=max_sample;
+                decode_info.bits_per_sample=bits_per_sample;
+                decode_info.compress_tag=compress_tag;
+                decode_info.photometric=photometric;
+                decode_info.planar_config=planar_config;
+                decode_info.sample_format=sample_format;
+                decode_info.samples_per_pixel=samples_per_pixel;
+                decode_info.alpha_type=alpha_type;
+                decode_info.import_options=&import_options;
+                if (read_region)
+                  {
+                    image->columns=region.width;
+                    image->rows=region.height;
+                    image->page=region;
+                  }
+                status=ReadTIFFChunks(image,tiff,&decode_info,exception);
+                break;
+              }
+
             /*
               Allocate tile buffer
             */
@@ -3825,6 +4876,27 @@ ReadTIFFImage(const ImageInfo *image_info,ExceptionInfo *exception)
         }
 
     read_next_frame:
+      if ((status == MagickPass) && read_region &&
+          ((image->columns != region.width) || (image->rows != region.height)))
+        {
+          /*
+            The read method decoded the whole directory so crop it to
+            the requested region.
+          */
+          Image
+            *crop_image;
+
+          crop_image=CropImage(image,&region,exception);
+          if (crop_image == (Image *) NULL)
+            {
+              status=MagickFail;
+              break;
+            }
+          DestroyBlob(crop_image);
+          crop_image->blob=ReferenceBlob(image->blob);
+          ReplaceImageInList(&image,crop_image);
+          client_data.image=image;
+        }
       if (status == MagickPass)
         {
           StopTimer(&image->timer);
@@ -3842,7 +4914,15 @@ ReadTIFFImage(const ImageInfo *image_info,ExceptionInfo *exception)
           if (image_info->subrange != 0)
             if (image->scene >= (image_info->subimage+image_info->subrange-1))
               break;
-          more_frames=TIFFReadDirectory(tiff);
+          /*
+            Continue with the page after any reduced-resolution versions
+            of this page.
+          */
+          if (((size_columns != 0) || (size_rows != 0)) &&
+              !TIFFSetSubDirectory(tiff,last_offset))
+            more_frames=0;
+          else
+            more_frames=TIFFReadDirectory(tiff);
           if (logging)
             (void) LogMagickEvent(CoderEvent,GetMagickModule(),
                                   "TIFFReadDirectory() returned %d",more_frames);
@@ -3867,6 +4947,7 @@ ReadTIFFImage(const ImageInfo *image_info,ExceptionInfo *exception)
                   return((Image *) NULL);
                 }
               image=SyncNextImageInList(image);
+              image->scene+=reduced_pages;
             }
         }
 
@@ -4849,72 +5930,441 @@ WriteNewsProfile(TIFF *tiff,
                  const unsigned char *profile_data,
                  const size_t profile_length)
 {
-  unsigned char
-    *profile=0;
+  unsigned char
+    *profile=0;
+
+  size_t
+    length;
+
+  assert(tiff != (TIFF *) NULL);
+  assert(profile_tag != 0);
+  assert(profile_data != (const unsigned char *) NULL);
+
+  length = (uint32) profile_length;
+  if (length == 0)
+    return;
+
+  if (profile_tag == TIFFTAG_RICHTIFFIPTC)
+    {
+      /*
+        Handle TIFFTAG_RICHTIFFIPTC tag.
+      */
+      length += (4-(length & 0x03)); /* Round up for long word alignment */
+      profile=MagickAllocateResourceLimitedClearedMemory(unsigned char *,length);
+      if (profile == (unsigned char *) NULL)
+        return;
+      (void) memcpy(profile,profile_data,profile_length);
+
+      if (TIFFIsByteSwapped(tiff))
+        TIFFSwabArrayOfLong((uint32 *) profile,length/4);
+
+      /* Tag is type TIFF_LONG so byte length is divided by four */
+      (void) LogMagickEvent(CoderEvent,GetMagickModule(),
+                            "TIFFSetField(tiff=0x%p,tag=%d,"
+                            "length=%"MAGICK_SIZE_T_F"u,data=0x%p)",
+                            tiff,profile_tag,(MAGICK_SIZE_T) length/4,profile);
+      (void) TIFFSetField(tiff,profile_tag,(uint32) length/4,(void *) profile);
+    }
+  else if (profile_tag == TIFFTAG_PHOTOSHOP)
+    {
+      /*
+        Handle TIFFTAG_PHOTOSHOP tag.
+      */
+      length += (length & 0x01); /* Round up for Photoshop */
+#if defined(GET_ONLY_IPTC_DATA)
+      length += 12;              /* Space for 8BIM header */
+      profile=MagickAllocateResourceLimitedClearedMemory(unsigned char *,length);
+      if (profile == (unsigned char *) NULL)
+        return;
+      (void) memcpy(profile,"8BIM\04\04\0\0",8);
+      profile[8]=(length >> 24) & 0xff;
+      profile[9]=(length >> 16) & 0xff;
+      profile[10]=(length >> 8) & 0xff;
+      profile[11]=length & 0xff;
+      (void) memcpy(profile+12,profile_data,profile_length);
+#else
+      profile=MagickAllocateResourceLimitedClearedMemory(unsigned char *,length);
+      if (profile == (unsigned char *) NULL)
+        return;
+      (void) memcpy(profile,profile_data,profile_length);
+#endif
+      (void) LogMagickEvent(CoderEvent,GetMagickModule(),
+                            "TIFFSetField(tiff=0x%p,tag=%d,"
+                            "length=%"MAGICK_SIZE_T_F"u,data=0x%p)",
+                            tiff,profile_tag,(MAGICK_SIZE_T) length,profile);
+      (void) TIFFSetField(tiff,profile_tag,(uint32) length,(void *) profile);
+    }
+
+  MagickFreeResourceLimitedMemory(profile);
+}
+
+/*
+  Strips and tiles compressed with these codecs depend only on their
+  own pixels, so each may be compressed independently by libtiff on a
+  worker thread and then written as raw data in file order.  The output
+  is the same as TIFFWriteScanline()/TIFFWriteTile() would produce.
+*/
+typedef struct _Magick_TIFF_EncodeInfo
+{
+  MagickBool
+    big_endian,          /* file byte order */
+    tiled;               /* chunks are tiles rather than strips */
+
+  uint32
+    columns,             /* image width or tile width */
+    tile_rows;           /* tile height */
+
+  uint16
+    bits_per_sample,
+    compress_tag,
+    fill_order,
+    photometric,
+    planar_config,
+    predictor,
+    sample_format,
+    samples_per_pixel;
+
+  int
+    lzma_preset,
+    zip_quality,
+    zstd_level;
+} Magick_TIFF_EncodeInfo;
+
+typedef struct _Magick_TIFF_Chunk
+{
+  unsigned char
+    *pixels;             /* uncompressed strip or tile */
+
+  tsize_t
+    pixels_size;         /* uncompressed bytes to encode */
+
+  uint32
+    index,               /* strip or tile number in output file */
+    rows;                /* rows in strip */
+
+  Magick_TIFF_Sink
+    sink;                /* in-memory file holding the encoded chunk */
+
+  size_t
+    encoded_offset,      /* offset of encoded chunk in sink */
+    encoded_length;      /* length of encoded chunk */
+} Magick_TIFF_Chunk;
+
+static MagickBool
+TIFFParallelEncodeSupported(TIFF *tiff)
+{
+  uint16
+    compress_tag,
+    photometric;
+
+  if (omp_get_max_threads() < 2)
+    return MagickFalse;
+  if (!TIFFGetFieldDefaulted(tiff,TIFFTAG_COMPRESSION,&compress_tag) ||
+      !TIFFGetFieldDefaulted(tiff,TIFFTAG_PHOTOMETRIC,&photometric))
+    return MagickFalse;
+  if (photometric == PHOTOMETRIC_YCBCR)
+    return MagickFalse;
+  switch (compress_tag)
+    {
+    case COMPRESSION_ADOBE_DEFLATE:
+    case COMPRESSION_DEFLATE:
+    case COMPRESSION_LZW:
+#if defined(COMPRESSION_LZMA)
+    case COMPRESSION_LZMA:
+#endif /* defined(COMPRESSION_LZMA) */
+#if defined(COMPRESSION_ZSTD)
+    case COMPRESSION_ZSTD:
+#endif /* defined(COMPRESSION_ZSTD) */
+      return MagickTrue;
+    default:
+      return MagickFalse;
+    }
+}
+
+static void
+TIFFGetEncodeInfo(TIFF *tiff,Magick_TIFF_EncodeInfo *encode_info)
+{
+  (void) memset(encode_info,0,sizeof(*encode_info));
+  encode_info->big_endian=(TIFFIsBigEndian(tiff) ? MagickTrue : MagickFalse);
+  encode_info->tiled=(TIFFIsTiled(tiff) ? MagickTrue : MagickFalse);
+  (void) TIFFGetFieldDefaulted(tiff,TIFFTAG_BITSPERSAMPLE,
+                               &encode_info->bits_per_sample);
+  (void) TIFFGetFieldDefaulted(tiff,TIFFTAG_COMPRESSION,
+                               &encode_info->compress_tag);
+  (void) TIFFGetFieldDefaulted(tiff,TIFFTAG_FILLORDER,
+                               &encode_info->fill_order);
+  (void) TIFFGetFieldDefaulted(tiff,TIFFTAG_PHOTOMETRIC,
+                               &encode_info->photometric);
+  (void) TIFFGetFieldDefaulted(tiff,TIFFTAG_PLANARCONFIG,
+                               &encode_info->planar_config);
+  (void) TIFFGetFieldDefaulted(tiff,TIFFTAG_PREDICTOR,
+                               &encode_info->predictor);
+  (void) TIFFGetFieldDefaulted(tiff,TIFFTAG_SAMPLEFORMAT,
+                               &encode_info->sample_format);
+  (void) TIFFGetFieldDefaulted(tiff,TIFFTAG_SAMPLESPERPIXEL,
+                               &encode_info->samples_per_pixel);
+  if (encode_info->tiled)
+    {
+      (void) TIFFGetField(tiff,TIFFTAG_TILEWIDTH,&encode_info->columns);
+      (void) TIFFGetField(tiff,TIFFTAG_TILELENGTH,&encode_info->tile_rows);
+    }
+  else
+    {
+      (void) TIFFGetField(tiff,TIFFTAG_IMAGEWIDTH,&encode_info->columns);
+    }
+  switch (encode_info->compress_tag)
+    {
+    case COMPRESSION_ADOBE_DEFLATE:
+    case COMPRESSION_DEFLATE:
+      (void) TIFFGetField(tiff,TIFFTAG_ZIPQUALITY,&encode_info->zip_quality);
+      break;
+#if defined(COMPRESSION_LZMA)
+    case COMPRESSION_LZMA:
+      (void) TIFFGetField(tiff,TIFFTAG_LZMAPRESET,&encode_info->lzma_preset);
+      break;
+#endif /* defined(COMPRESSION_LZMA) */
+#if defined(COMPRESSION_ZSTD)
+    case COMPRESSION_ZSTD:
+      (void) TIFFGetField(tiff,TIFFTAG_ZSTD_LEVEL,&encode_info->zstd_level);
+      break;
+#endif /* defined(COMPRESSION_ZSTD) */
+    default:
+      break;
+    }
+}
+
+/*
+  Compress one strip or tile by writing it as the only strip or tile of
+  a private in-memory TIFF which uses the same codec settings as the
+  output file.  Safe to invoke concurrently for different chunks.
+*/
+static MagickPassFail
+TIFFEncodeChunk(const Magick_TIFF_EncodeInfo *encode_info,
+                Magick_TIFF_Chunk *chunk)
+{
+  TIFF
+    *encoder;
 
   size_t
-    length;
+    start;
 
-  assert(tiff != (TIFF *) NULL);
-  assert(profile_tag != 0);
-  assert(profile_data != (const unsigned char *) NULL);
-
-  length = (uint32) profile_length;
-  if (length == 0)
-    return;
+  tsize_t
+    encoded;
 
-  if (profile_tag == TIFFTAG_RICHTIFFIPTC)
+  MagickPassFail
+    status=MagickPass;
+
+  chunk->sink.length=0;
+  chunk->sink.offset=0;
+  chunk->encoded_offset=0;
+  chunk->encoded_length=0;
+  encoder=TIFFClientOpen("chunk",encode_info->big_endian ? "wb" : "wl",
+                         (thandle_t) &chunk->sink,TIFFReadSink,TIFFWriteSink,
+                         TIFFSeekSink,TIFFCloseSink,TIFFGetSinkSize,
+                         TIFFMapSink,TIFFUnmapSink);
+  if (encoder == (TIFF *) NULL)
+    return MagickFail;
+  (void) TIFFSetField(encoder,TIFFTAG_IMAGEWIDTH,encode_info->columns);
+  (void) TIFFSetField(encoder,TIFFTAG_BITSPERSAMPLE,
+                      encode_info->bits_per_sample);
+  (void) TIFFSetField(encoder,TIFFTAG_SAMPLESPERPIXEL,
+                      encode_info->samples_per_pixel);
+  (void) TIFFSetField(encoder,TIFFTAG_SAMPLEFORMAT,encode_info->sample_format);
+  (void) TIFFSetField(encoder,TIFFTAG_PHOTOMETRIC,encode_info->photometric);
+  (void) TIFFSetField(encoder,TIFFTAG_PLANARCONFIG,encode_info->planar_config);
+  (void) TIFFSetField(encoder,TIFFTAG_FILLORDER,encode_info->fill_order);
+  if (encode_info->tiled)
+    {
+      (void) TIFFSetField(encoder,TIFFTAG_IMAGELENGTH,encode_info->tile_rows);
+      (void) TIFFSetField(encoder,TIFFTAG_TILEWIDTH,encode_info->columns);
+      (void) TIFFSetField(encoder,TIFFTAG_TILELENGTH,encode_info->tile_rows);
+    }
+  else
+    {
+      (void) TIFFSetField(encoder,TIFFTAG_IMAGELENGTH,chunk->rows);
+      (void) TIFFSetField(encoder,TIFFTAG_ROWSPERSTRIP,chunk->rows);
+    }
+  if (!TIFFSetField(encoder,TIFFTAG_COMPRESSION,encode_info->compress_tag))
+    status=MagickFail;
+  switch (encode_info->compress_tag)
     {
+    case COMPRESSION_ADOBE_DEFLATE:
+    case COMPRESSION_DEFLATE:
+      (void) TIFFSetField(encoder,TIFFTAG_ZIPQUALITY,encode_info->zip_quality);
+#if defined(TIFFTAG_DEFLATE_SUBCODEC)
       /*
-        Handle TIFFTAG_RICHTIFFIPTC tag.
+        libtiff only uses libdeflate when a whole strip is supplied at
+        once, so strips written by TIFFWriteScanline() are compressed by
+        zlib.  Use zlib here too so that strips do not change.
       */
-      length += (4-(length & 0x03)); /* Round up for long word alignment */
-      profile=MagickAllocateResourceLimitedClearedMemory(unsigned char *,length);
-      if (profile == (unsigned char *) NULL)
-        return;
-      (void) memcpy(profile,profile_data,profile_length);
+      if (!encode_info->tiled)
+        (void) TIFFSetField(encoder,TIFFTAG_DEFLATE_SUBCODEC,
+                            DEFLATE_SUBCODEC_ZLIB);
+#endif /* defined(TIFFTAG_DEFLATE_SUBCODEC) */
+      break;
+#if defined(COMPRESSION_LZMA)
+    case COMPRESSION_LZMA:
+      (void) TIFFSetField(encoder,TIFFTAG_LZMAPRESET,encode_info->lzma_preset);
+      break;
+#endif /* defined(COMPRESSION_LZMA) */
+#if defined(COMPRESSION_ZSTD)
+    case COMPRESSION_ZSTD:
+      (void) TIFFSetField(encoder,TIFFTAG_ZSTD_LEVEL,encode_info->zstd_level);
+      break;
+#endif /* defined(COMPRESSION_ZSTD) */
+    default:
+      break;
+    }
+  if (encode_info->predictor != PREDICTOR_NONE)
+    (void) TIFFSetField(encoder,TIFFTAG_PREDICTOR,encode_info->predictor);
+  if (status != MagickFail)
+    {
+      /*
+        Encoded data is appended to the end of the in-memory file.
+      */
+      start=chunk->sink.length;
+      if (encode_info->tiled)
+        encoded=TIFFWriteEncodedTile(encoder,0,chunk->pixels,
+                                     chunk->pixels_size);
+      else
+        encoded=TIFFWriteEncodedStrip(encoder,0,chunk->pixels,
+                                      chunk->pixels_size);
+      if (encoded == -1)
+        status=MagickFail;
+      else
+        {
+          chunk->encoded_offset=start;
+          chunk->encoded_length=chunk->sink.length-start;
+        }
+    }
+  /*
+    Release the encoder without closing the in-memory file.  Any
+    directory written here is ignored.
+  */
+  TIFFCleanup(encoder);
+  return status;
+}
 
-      if (TIFFIsByteSwapped(tiff))
-        TIFFSwabArrayOfLong((uint32 *) profile,length/4);
+/*
+  Compress chunks concurrently and then write them to the output file in
+  the order provided.
+*/
+static MagickPassFail
+TIFFWriteEncodedChunks(TIFF *tiff,const Magick_TIFF_EncodeInfo *encode_info,
+                       Magick_TIFF_Chunk *chunks,const unsigned int count,
+                       Image *image)
+{
+  long
+    i;
 
-      /* Tag is type TIFF_LONG so byte length is divided by four */
-      (void) LogMagickEvent(CoderEvent,GetMagickModule(),
-                            "TIFFSetField(tiff=0x%p,tag=%d,"
-                            "length=%"MAGICK_SIZE_T_F"u,data=0x%p)",
-                            tiff,profile_tag,(MAGICK_SIZE_T) length/4,profile);
-      (void) TIFFSetField(tiff,profile_tag,(uint32) length/4,(void *) profile);
-    }
-  else if (profile_tag == TIFFTAG_PHOTOSHOP)
+  MagickPassFail
+    status=MagickPass;
+
+#if defined(HAVE_OPENMP)
+#  if defined(TUNE_OPENMP)
+#    pragma omp parallel for schedule(runtime) shared(status)
+#  else
+#    pragma omp parallel for schedule(dynamic,1) shared(status)
+#  endif
+#endif
+  for (i=0; i < (long) count; i++)
     {
+      ExceptionInfo
+        chunk_exception;
+
+      void
+        *tsd_exception;
+
+      MagickPassFail
+        thread_status;
+
       /*
-        Handle TIFFTAG_PHOTOSHOP tag.
+        Route libtiff errors raised by this thread to a private
+        exception, merged into the image exception below.
       */
-      length += (length & 0x01); /* Round up for Photoshop */
-#if defined(GET_ONLY_IPTC_DATA)
-      length += 12;              /* Space for 8BIM header */
-      profile=MagickAllocateResourceLimitedClearedMemory(unsigned char *,length);
-      if (profile == (unsigned char *) NULL)
-        return;
-      (void) memcpy(profile,"8BIM\04\04\0\0",8);
-      profile[8]=(length >> 24) & 0xff;
-      profile[9]=(length >> 16) & 0xff;
-      profile[10]=(length >> 8) & 0xff;
-      profile[11]=length & 0xff;
-      (void) memcpy(profile+12,profile_data,profile_length);
-#else
-      profile=MagickAllocateResourceLimitedClearedMemory(unsigned char *,length);
-      if (profile == (unsigned char *) NULL)
-        return;
-      (void) memcpy(profile,profile_data,profile_length);
+      GetExceptionInfo(&chunk_exception);
+      tsd_exception=MagickTsdGetSpecific(tsd_key);
+      (void) MagickTsdSetSpecific(tsd_key,(void *) &chunk_exception);
+      thread_status=TIFFEncodeChunk(encode_info,&chunks[i]);
+      (void) MagickTsdSetSpecific(tsd_key,tsd_exception);
+      if ((thread_status == MagickFail) ||
+          (chunk_exception.severity != UndefinedException))
+        {
+#if defined(HAVE_OPENMP)
+#  pragma omp critical (GM_WriteTIFFImage)
 #endif
-      (void) LogMagickEvent(CoderEvent,GetMagickModule(),
-                            "TIFFSetField(tiff=0x%p,tag=%d,"
-                            "length=%"MAGICK_SIZE_T_F"u,data=0x%p)",
-                            tiff,profile_tag,(MAGICK_SIZE_T) length,profile);
-      (void) TIFFSetField(tiff,profile_tag,(uint32) length,(void *) profile);
+          {
+            if (chunk_exception.severity > image->exception.severity)
+              CopyException(&image->exception,&chunk_exception);
+            if (thread_status == MagickFail)
+              status=MagickFail;
+          }
+        }
+      DestroyExceptionInfo(&chunk_exception);
     }
+  for (i=0; (status != MagickFail) && (i < (long) count); i++)
+    {
+      tsize_t
+        written;
 
-  MagickFreeResourceLimitedMemory(profile);
+      if (encode_info->tiled)
+        written=TIFFWriteRawTile(tiff,chunks[i].index,
+                                 chunks[i].sink.data+chunks[i].encoded_offset,
+                                 (tsize_t) chunks[i].encoded_length);
+      else
+        written=TIFFWriteRawStrip(tiff,chunks[i].index,
+                                  chunks[i].sink.data+chunks[i].encoded_offset,
+                                  (tsize_t) chunks[i].encoded_length);
+      if (written == -1)
+        status=MagickFail;
+    }
+  return status;
+}
+
+static void
+DestroyTIFFChunks(Magick_TIFF_Chunk *chunks,const unsigned int count)
+{
+  unsigned int
+    i;
+
+  if (chunks == (Magick_TIFF_Chunk *) NULL)
+    return;
+  for (i=0; i < count; i++)
+    {
+      MagickFreeResourceLimitedMemory(chunks[i].pixels);
+      MagickFreeResourceLimitedMemory(chunks[i].sink.data);
+    }
+  MagickFreeResourceLimitedMemory(chunks);
+}
+
+/*
+  Allocate an array of chunks, each with an uncompressed buffer of
+  chunk_size bytes.
+*/
+static Magick_TIFF_Chunk *
+AllocateTIFFChunks(const unsigned int count,const size_t chunk_size)
+{
+  Magick_TIFF_Chunk
+    *chunks;
+
+  unsigned int
+    i;
+
+  chunks=MagickAllocateResourceLimitedClearedArray(Magick_TIFF_Chunk *,count,
+                                                   sizeof(Magick_TIFF_Chunk));
+  if (chunks == (Magick_TIFF_Chunk *) NULL)
+    return chunks;
+  for (i=0; i < count; i++)
+    {
+      chunks[i].pixels=MagickAllocateResourceLimitedClearedMemory(unsigned char *,
+                                                                  chunk_size);
+      if (chunks[i].pixels == (unsigned char *) NULL)
+        {
+          DestroyTIFFChunks(chunks,count);
+          return (Magick_TIFF_Chunk *) NULL;
+        }
+    }
+  return chunks;
 }
 
 #define ThrowTIFFWriterException(code_,reason_,image_) \
@@ -6536,6 +7986,14 @@ WriteTIFFImage(const ImageInfo *image_info,Image *image)
       if ((16 == bits_per_sample) || (32 == bits_per_sample) || (64 == bits_per_sample))
         export_options.endian=NativeEndian;
 
+      /*
+        Compress several strips at once on worker threads when the
+        codec permits it.
+      */
+      if ((method == ScanLineMethod) && (rows_per_strip < image->rows) &&
+          TIFFParallelEncodeSupported(tiff))
+        method=StrippedMethod;
+
       /*
         Export pixels to TIFF.
 
@@ -6666,6 +8124,170 @@ WriteTIFFImage(const ImageInfo *image_info,Image *image)
             MagickFreeResourceLimitedMemory(scanline);
             break;
           }
+        case StrippedMethod:
+          {
+            /*
+              Write TIFF image as strips, compressing a batch of strips
+              concurrently and writing them in order as raw strips.
+            */
+            Magick_TIFF_Chunk
+              *chunks;
+
+            Magick_TIFF_EncodeInfo
+              encode_info;
+
+            const PixelPacket
+              *p;
+
+            uint32
+              strip_rows;
+
+            unsigned int
+              batch,
+              chunk_count;
+
+            int
+              max_sample,
+              quantum_samples,
+              sample;
+
+            QuantumType
+              quantum_type;
+
+            scanline_size=TIFFScanlineSize(tiff);
+            strip_rows=rows_per_strip;
+            (void) TIFFGetFieldDefaulted(tiff,TIFFTAG_ROWSPERSTRIP,&strip_rows);
+            if (strip_rows > image->rows)
+              strip_rows=(uint32) image->rows;
+            batch=2*(unsigned int) omp_get_max_threads();
+            if (logging)
+              (void) LogMagickEvent(CoderEvent,GetMagickModule(),
+                                    "Using stripped %s write method with %u "
+                                    "bits per sample (%u rows/strip, %u "
+                                    "strips per batch)",
+                                    PhotometricTagToString(photometric),
+                                    bits_per_sample,(unsigned int) strip_rows,
+                                    batch);
+            TIFFGetEncodeInfo(tiff,&encode_info);
+            /*
+              Prepare for separate/contiguous retrieval.
+            */
+            max_sample=1;
+            if (planar_config == PLANARCONFIG_SEPARATE)
+              {
+                if (QuantumTransferMode(image,photometric,compress_tag,
+                                        sample_format,samples_per_pixel,
+                                        PLANARCONFIG_CONTIG,0,&quantum_type,
+                                        &quantum_samples,&image->exception)
+                    == MagickPass)
+                  max_sample=quantum_samples;
+              }
+
+            chunks=AllocateTIFFChunks(batch,(size_t) scanline_size*strip_rows);
+            if (chunks == (Magick_TIFF_Chunk *) NULL)
+              ThrowTIFFWriterException(ResourceLimitError,MemoryAllocationFailed,image);
+            /*
+              For each plane
+            */
+            for (sample=0; (status != MagickFail) && (sample < max_sample); sample++)
+              {
+                /*
+                  Determine quantum parse method.
+                */
+                if (QuantumTransferMode(image,photometric,compress_tag,
+                                        sample_format,samples_per_pixel,
+                                        planar_config,sample,&quantum_type,
+                                        &quantum_samples,&image->exception)
+                    == MagickFail)
+                  {
+                    status=MagickFail;
+                    break;
+                  }
+                y=0;
+                while ((status != MagickFail) && (y < image->rows))
+                  {
+                    /*
+                      Export a batch of strips.
+                    */
+                    for (chunk_count=0; (status != MagickFail) &&
+                           (chunk_count < batch) && (y < image->rows);
+                         chunk_count++)
+                      {
+                        Magick_TIFF_Chunk
+                          *chunk;
+
+                        unsigned char
+                          *q;
+
+                        uint32
+                          row;
+
+                        chunk=&chunks[chunk_count];
+                        chunk->index=TIFFComputeStrip(tiff,(uint32) y,
+                                                      (tsample_t) sample);
+                        chunk->rows=(uint32) Min(strip_rows,image->rows-y);
+                        chunk->pixels_size=(tsize_t) chunk->rows*scanline_size;
+                        q=chunk->pixels;
+                        for (row=0; row < chunk->rows; row++, y++)
+                          {
+                            if ((image->matte) && (alpha_type == AssociatedAlpha))
+                              p=GetImagePixels(image,0,y,image->columns,1);
+                            else
+                              p=AcquireImagePixels(image,0,y,image->columns,1,
+                                                   &image->exception);
+                            if (p == (const PixelPacket *) NULL)
+                              {
+                                status=MagickFail;
+                                break;
+                              }
+                            /*
+                              Convert to associated alpha if necessary.
+                            */
+                            if ((sample == 0) && (image->matte) &&
+                                (alpha_type == AssociatedAlpha))
+                              AssociateAlphaRegion(image);
+                            /*
+                              Export pixels to strip row.
+                            */
+                            if (ExportImagePixelArea(image,quantum_type,
+                                                     bits_per_sample,q,
+                                                     &export_options,
+                                                     &export_info)
+                                == MagickFail)
+                              {
+                                status=MagickFail;
+                                break;
+                              }
+#if !defined(WORDS_BIGENDIAN)
+                            if (24 == bits_per_sample)
+                              SwabDataToNativeEndian(bits_per_sample,q,
+                                                     scanline_size);
+#endif
+                            q += scanline_size;
+
+                            if (image->previous == (Image *) NULL)
+                              if (QuantumTick(y+(magick_int64_t)sample*image->rows, (magick_int64_t)image->rows*max_sample))
+                                if (!MagickMonitorFormatted(y+ (magick_int64_t)sample*image->rows,
+                                                            (magick_int64_t)image->rows*max_sample,&image->exception,
+                                                            SaveImageText,image->filename,
+                                                            image->columns,image->rows))
+                                  {
+                                    status=MagickFail;
+                                    break;
+                                  }
+                          }
+                      }
+                    /*
+                      Compress the batch and write it in strip order.
+                    */
+                    if (status != MagickFail)
+                      status=TIFFWriteEncodedChunks(tiff,&encode_info,chunks,
+                                                    chunk_count,image);
+                  }
+              }
+            DestroyTIFFChunks(chunks,batch);
+            break;
+          }
         case TiledMethod:
           {
             /*
@@ -6674,6 +8296,15 @@ WriteTIFFImage(const ImageInfo *image_info,Image *image)
             unsigned char
               *tile;
 
+            Magick_TIFF_Chunk
+              *chunks=(Magick_TIFF_Chunk *) NULL;
+
+            Magick_TIFF_EncodeInfo
+              encode_info;
+
+            unsigned int
+              tiles_across;
+
             uint32
               tile_columns,
               tile_rows;
@@ -6774,6 +8405,26 @@ WriteTIFFImage(const ImageInfo *image_info,Image *image)
             tile=MagickAllocateResourceLimitedMemory(unsigned char *, (size_t) tile_size_max);
             if (tile == (unsigned char *) NULL)
               ThrowTIFFWriterException(ResourceLimitError,MemoryAllocationFailed,image);
+            /*
+              Compress each row of tiles concurrently on worker threads
+              when the codec permits it.
+            */
+            tiles_across=(unsigned int) ((image->columns+tile_columns-1)/tile_columns);
+            if ((status != MagickFail) && (tiles_across > 1) &&
+                TIFFParallelEncodeSupported(tiff))
+              {
+                TIFFGetEncodeInfo(tiff,&encode_info);
+                chunks=AllocateTIFFChunks(tiles_across,(size_t) tile_size_max);
+                if (chunks == (Magick_TIFF_Chunk *) NULL)
+                  {
+                    MagickFreeResourceLimitedMemory(tile);
+                    ThrowTIFFWriterException(ResourceLimitError,MemoryAllocationFailed,image);
+                  }
+                if (logging)
+                  (void) LogMagickEvent(CoderEvent,GetMagickModule(),
+                                        "Compressing %u tiles per batch",
+                                        tiles_across);
+              }
             /*
               Prepare for separate/contiguous retrieval.
             */
@@ -6821,6 +8472,7 @@ WriteTIFFImage(const ImageInfo *image_info,Image *image)
                           tile_set_rows;
 
                         unsigned char
+                          *pixels,
                           *q;
 
                         register long
@@ -6838,7 +8490,17 @@ WriteTIFFImage(const ImageInfo *image_info,Image *image)
                         else
                           tile_set_rows=tile_rows;
 
-                        q=tile;
+                        pixels=tile;
+                        if (chunks != (Magick_TIFF_Chunk *) NULL)
+                          pixels=chunks[x/tile_columns].pixels;
+                        /*
+                          Clear the padding of edge tiles rather than
+                          leaving data from the tile last in the buffer.
+                        */
+                        if ((tile_set_columns < (long) tile_columns) ||
+                            (tile_set_rows < (long) tile_rows))
+                          (void) memset(pixels,0,(size_t) tile_size_max);
+                        q=pixels;
                         for (yy=y; (status != MagickFail) && (yy < (long) y+tile_set_rows); yy++)
                           {
                             /*
@@ -6884,15 +8546,28 @@ WriteTIFFImage(const ImageInfo *image_info,Image *image)
                         */
 #if !defined(WORDS_BIGENDIAN)
                         if (24 == bits_per_sample)
-                          SwabDataToNativeEndian(bits_per_sample,tile,tile_size_max);
+                          SwabDataToNativeEndian(bits_per_sample,pixels,tile_size_max);
 #endif
-                        if ((tile_size=TIFFWriteTile(tiff,tile,x,y,0,sample)) == -1)
+                        if (chunks != (Magick_TIFF_Chunk *) NULL)
+                          {
+                            chunks[x/tile_columns].index=
+                              TIFFComputeTile(tiff,x,y,0,(tsample_t) sample);
+                            chunks[x/tile_columns].pixels_size=tile_size_max;
+                          }
+                        else if ((tile_size=TIFFWriteTile(tiff,tile,x,y,0,sample)) == -1)
                           {
                             status=MagickFail;
                           }
                         if (status == MagickFail)
                           break;
                       } /* for x */
+                    /*
+                      Compress the row of tiles and write it in tile order.
+                    */
+                    if ((status != MagickFail) &&
+                        (chunks != (Magick_TIFF_Chunk *) NULL))
+                      status=TIFFWriteEncodedChunks(tiff,&encode_info,chunks,
+                                                    tiles_across,image);
                     /*
                       Progress indicator.
                     */
@@ -6910,6 +8585,7 @@ WriteTIFFImage(const ImageInfo *image_info,Image *image)
                       break;
                   } /* for y */
               } /* for sample */
+            DestroyTIFFChunks(chunks,tiles_across);
             MagickFreeResourceLimitedMemory(tile);
             break;
           }
@@ -6937,7 +8613,7 @@ WriteTIFFImage(const ImageInfo *image_info,Image *image)
          /*
           * Unfortunately it depends on the prehistory, what number TIFFCurrentDirectory() will get back.
           * Therefore, the current main IFD number has to be adapted. However, this is an inconsistency in LibTIFF which should be
-          * corrected. This means that the provided code to determne/handle current directory number here is just a current work around.
+          * corrected. This means that the provided code to determ�ne/handle current directory number here is just a current work around.
           */
             tdir_t current_mainifd = TIFFCurrentDirectory(tiff);
             if(TIFFCurrentDirOffset(tiff) > 0 && current_mainifd > 0) current_mainifd--;
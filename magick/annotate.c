@@ -49,6 +49,8 @@
 #include "magick/log.h"
 #include "magick/pixel_cache.h"
 #include "magick/render.h"
+#include "magick/resource.h"
+#include "magick/semaphore.h"
 #include "magick/tempfile.h"
 #include "magick/transform.h"
 #include "magick/utility.h"
@@ -94,6 +96,123 @@ static unsigned int
   RenderFreetype(Image *,const DrawInfo *,const char *,const PointInfo *,
     TypeMetric *),
   RenderX11(Image *,const DrawInfo *,const PointInfo *,TypeMetric *);
+
+#if defined(HasTTF)
+/*
+  Maximum memory (in bytes) retained by the glyph cache of one font face
+  before the glyph cache is flushed, and number of glyph cache hash
+  buckets.
+*/
+#define MaxGlyphCacheMemory (1024*1024)
+#define GlyphCacheBuckets 64
+
+/*
+  Rasterized glyph bitmap.  Outline glyphs are rasterized with their
+  origin at its sub-pixel (26.6) offset so that the bitmap may be
+  re-used at any whole-pixel position.
+*/
+typedef struct _GlyphBitmapInfo
+{
+  FT_Matrix
+    affine;            /* Transform applied to the glyph */
+
+  FT_Vector
+    offset;            /* Sub-pixel offset of the glyph origin */
+
+  int
+    left,              /* Bitmap position relative to the origin */
+    top,
+    pitch;             /* Bytes per bitmap row */
+
+  unsigned int
+    rows,
+    width;
+
+  unsigned char
+    pixel_mode,        /* FreeType pixel mode */
+    *buffer;           /* Bitmap pixels */
+
+  struct _GlyphBitmapInfo
+    *next;
+} GlyphBitmapInfo;
+
+/*
+  Loaded glyph, its metrics, and the bitmaps rasterized from it.
+*/
+typedef struct _GlyphCacheInfo
+{
+  FT_UInt
+    id;                /* Glyph index */
+
+  FT_Glyph
+    image;             /* Untransformed glyph as loaded */
+
+  FT_BBox
+    bounds;            /* Glyph bounding box (26.6) */
+
+  FT_Vector
+    advance;           /* Glyph advance (26.6) */
+
+  GlyphBitmapInfo
+    *bitmaps;
+
+  struct _GlyphCacheInfo
+    *next;
+} GlyphCacheInfo;
+
+/*
+  Cache of opened FreeType faces, keyed by font file path, face index,
+  and character size.  FreeType requires that FT_New_Face() and
+  FT_Done_Face() calls using the same FT_Library be serialized, and
+  that a face only be used by one thread at a time.  Faces are
+  therefore checked out of the cache for exclusive use while rendering
+  and returned to it when done.  The list is maintained in most
+  recently used order, and the number of retained faces is limited by
+  the "fonts" resource limit.  Each face carries a cache of loaded
+  glyphs and rasterized glyph bitmaps so that text which is rendered
+  or measured repeatedly is only rasterized once.
+*/
+typedef struct _FontFaceInfo
+{
+  char
+    *path;             /* Font file path */
+
+  long
+    index;             /* Face index within font file */
+
+  double
+    pointsize;         /* Character size in points */
+
+  PointInfo
+    resolution;        /* Character resolution in DPI */
+
+  FT_Face
+    face;              /* Opened face */
+
+  GlyphCacheInfo
+    *glyphs[GlyphCacheBuckets]; /* Glyph cache */
+
+  size_t
+    glyph_memory;      /* Memory retained by glyph cache */
+
+  MagickBool
+    in_use,            /* Face is checked out by a thread */
+    cached;            /* Face is retained in the cache list */
+
+  struct _FontFaceInfo
+    *previous,
+    *next;
+} FontFaceInfo;
+
+static FT_Library
+  font_library = (FT_Library) NULL;
+
+static FontFaceInfo
+  *font_face_list = (FontFaceInfo *) NULL;
+#endif /* defined(HasTTF) */
+
+static SemaphoreInfo
+  *annotate_semaphore = (SemaphoreInfo *) NULL;
 
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -397,6 +516,90 @@ MagickExport MagickPassFail AnnotateImage(Image *image,const DrawInfo *draw_info
   return(status);
 }
 
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   D e s t r o y A n n o t a t e I n f o                                     %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  DestroyAnnotateInfo() closes any font faces retained by the font cache
+%  and releases the FreeType library.
+%
+%  The format of the DestroyAnnotateInfo method is:
+%
+%      void DestroyAnnotateInfo(void)
+%
+%
+*/
+#if defined(HasTTF)
+static void DestroyGlyphCache(FontFaceInfo *font_face)
+{
+  GlyphBitmapInfo
+    *bitmap;
+
+  GlyphCacheInfo
+    *glyph;
+
+  unsigned int
+    i;
+
+  for (i=0; i < GlyphCacheBuckets; i++)
+    {
+      while (font_face->glyphs[i] != (GlyphCacheInfo *) NULL)
+        {
+          glyph=font_face->glyphs[i];
+          font_face->glyphs[i]=glyph->next;
+          while (glyph->bitmaps != (GlyphBitmapInfo *) NULL)
+            {
+              bitmap=glyph->bitmaps;
+              glyph->bitmaps=bitmap->next;
+              MagickFreeMemory(bitmap->buffer);
+              MagickFreeMemory(bitmap);
+            }
+          FT_Done_Glyph(glyph->image);
+          MagickFreeMemory(glyph);
+        }
+    }
+  font_face->glyph_memory=0;
+}
+
+static void DestroyFontFace(FontFaceInfo *font_face)
+{
+  DestroyGlyphCache(font_face);
+  if (font_face->face != (FT_Face) NULL)
+    (void) FT_Done_Face(font_face->face);
+  MagickFreeMemory(font_face->path);
+  MagickFreeMemory(font_face);
+}
+#endif /* defined(HasTTF) */
+
+void DestroyAnnotateInfo(void)
+{
+#if defined(HasTTF)
+  FontFaceInfo
+    *font_face;
+
+  while (font_face_list != (FontFaceInfo *) NULL)
+    {
+      font_face=font_face_list;
+      font_face_list=font_face_list->next;
+      DestroyFontFace(font_face);
+      LiberateMagickResource(FontsResource,1);
+    }
+  if (font_library != (FT_Library) NULL)
+    {
+      (void) FT_Done_FreeType(font_library);
+      font_library=(FT_Library) NULL;
+    }
+#endif /* defined(HasTTF) */
+  DestroySemaphoreInfo(&annotate_semaphore);
+}
+
 #if defined(HasTTF)
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -748,6 +951,34 @@ MagickExport MagickPassFail GetTypeMetrics(Image *image,const DrawInfo *draw_inf
   return(status);
 }
 
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   I n i t i a l i z e A n n o t a t e I n f o                               %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  InitializeAnnotateInfo() initializes the font cache used by the
+%  annotation facility.
+%
+%  The format of the InitializeAnnotateInfo method is:
+%
+%      MagickPassFail InitializeAnnotateInfo(void)
+%
+%
+*/
+MagickPassFail
+InitializeAnnotateInfo(void)
+{
+  assert(annotate_semaphore == (SemaphoreInfo *) NULL);
+  annotate_semaphore=AllocateSemaphoreInfo();
+  return MagickPass;
+}
+
 
 /*
   Find a single font family name in a comma-separated list; returns a pointer
@@ -1057,6 +1288,328 @@ static int TraceQuadraticBezier(FT_Vector *control,FT_Vector *to,
   return(0);
 }
 
+/*
+  Check out an opened face for the specified font from the font cache,
+  opening the font if no idle matching face is cached.  Least recently
+  used idle faces are closed as needed to stay within the "fonts"
+  resource limit.  If the cache is full of faces in use by other
+  threads, the new face is simply not retained.  Returns NULL and
+  updates the exception on failure.
+*/
+static FontFaceInfo *AcquireFontFace(const char *path,const long index,
+  const double pointsize,const PointInfo *resolution,ExceptionInfo *exception)
+{
+  FontFaceInfo
+    *font_face,
+    *p;
+
+  FT_Error
+    ft_status;
+
+  LockSemaphoreInfo(annotate_semaphore);
+  for (font_face=font_face_list; font_face != (FontFaceInfo *) NULL;
+       font_face=font_face->next)
+    if (!font_face->in_use &&
+        (font_face->index == index) &&
+        (font_face->pointsize == pointsize) &&
+        (font_face->resolution.x == resolution->x) &&
+        (font_face->resolution.y == resolution->y) &&
+        (strcmp(font_face->path,path) == 0))
+      break;
+  if (font_face != (FontFaceInfo *) NULL)
+    {
+      /*
+        Move to head of list.
+      */
+      if (font_face->previous != (FontFaceInfo *) NULL)
+        {
+          font_face->previous->next=font_face->next;
+          if (font_face->next != (FontFaceInfo *) NULL)
+            font_face->next->previous=font_face->previous;
+          font_face->previous=(FontFaceInfo *) NULL;
+          font_face->next=font_face_list;
+          font_face_list->previous=font_face;
+          font_face_list=font_face;
+        }
+      font_face->in_use=MagickTrue;
+      UnlockSemaphoreInfo(annotate_semaphore);
+      return(font_face);
+    }
+  /*
+    Initialize Truetype library.
+  */
+  if (font_library == (FT_Library) NULL)
+    {
+      ft_status=FT_Init_FreeType(&font_library);
+      if (ft_status)
+        {
+          font_library=(FT_Library) NULL;
+          UnlockSemaphoreInfo(annotate_semaphore);
+          ThrowException(exception,TypeError,UnableToInitializeFreetypeLibrary,
+                         path);
+          return((FontFaceInfo *) NULL);
+        }
+    }
+  font_face=MagickAllocateMemory(FontFaceInfo *,sizeof(FontFaceInfo));
+  if (font_face == (FontFaceInfo *) NULL)
+    {
+      UnlockSemaphoreInfo(annotate_semaphore);
+      ThrowException(exception,ResourceLimitError,MemoryAllocationFailed,path);
+      return((FontFaceInfo *) NULL);
+    }
+  (void) memset(font_face,0,sizeof(FontFaceInfo));
+  font_face->path=AcquireString(path);
+  font_face->index=index;
+  font_face->pointsize=pointsize;
+  font_face->resolution=(*resolution);
+  ft_status=FT_New_Face(font_library,path,index,&font_face->face);
+  if (ft_status != 0)
+    {
+      font_face->face=(FT_Face) NULL;
+      DestroyFontFace(font_face);
+      UnlockSemaphoreInfo(annotate_semaphore);
+      ThrowException(exception,TypeError,UnableToReadFont,path);
+      return((FontFaceInfo *) NULL);
+    }
+  font_face->in_use=MagickTrue;
+  /*
+    Retain the face in the cache, evicting least recently used idle
+    faces if the cache is full.
+  */
+  while (!(font_face->cached=AcquireMagickResource(FontsResource,1)))
+    {
+      FontFaceInfo
+        *lru;
+
+      lru=(FontFaceInfo *) NULL;
+      for (p=font_face_list; p != (FontFaceInfo *) NULL; p=p->next)
+        if (!p->in_use)
+          lru=p;
+      if (lru == (FontFaceInfo *) NULL)
+        break;
+      (void) LogMagickEvent(AnnotateEvent,GetMagickModule(),
+                            "Evicting font face \"%s\" (%g points) from cache",
+                            lru->path,lru->pointsize);
+      if (lru->previous != (FontFaceInfo *) NULL)
+        lru->previous->next=lru->next;
+      else
+        font_face_list=lru->next;
+      if (lru->next != (FontFaceInfo *) NULL)
+        lru->next->previous=lru->previous;
+      DestroyFontFace(lru);
+      LiberateMagickResource(FontsResource,1);
+    }
+  if (font_face->cached)
+    {
+      font_face->next=font_face_list;
+      if (font_face_list != (FontFaceInfo *) NULL)
+        font_face_list->previous=font_face;
+      font_face_list=font_face;
+    }
+  UnlockSemaphoreInfo(annotate_semaphore);
+  /*
+    Set text size.
+  */
+  (void) FT_Set_Char_Size(font_face->face,(FT_F26Dot6) (64.0*pointsize),
+    (FT_F26Dot6) (64.0*pointsize),(FT_UInt) resolution->x,
+    (FT_UInt) resolution->y);
+  (void) LogMagickEvent(AnnotateEvent,GetMagickModule(),
+                        "Opened font face \"%s\" (%g points)%s",path,
+                        pointsize,font_face->cached ? "" : " (not cached)");
+  return(font_face);
+}
+
+/*
+  Return a face checked out by AcquireFontFace() to the font cache.
+*/
+static void ReleaseFontFace(FontFaceInfo *font_face)
+{
+  LockSemaphoreInfo(annotate_semaphore);
+  if (font_face->cached)
+    font_face->in_use=MagickFalse;
+  else
+    DestroyFontFace(font_face);
+  UnlockSemaphoreInfo(annotate_semaphore);
+}
+
+/*
+  Return the glyph cache entry for the specified glyph index of a face
+  checked out by AcquireFontFace(), loading the glyph if it is not yet
+  cached.  Returns NULL if the glyph can not be loaded.  The returned
+  entry remains valid until the next call to GetCachedGlyph() for the
+  same face.
+*/
+static GlyphCacheInfo *GetCachedGlyph(FontFaceInfo *font_face,
+  const FT_UInt id)
+{
+  FT_Error
+    ft_status;
+
+  FT_Glyph
+    image;
+
+  GlyphCacheInfo
+    *glyph;
+
+  for (glyph=font_face->glyphs[id % GlyphCacheBuckets];
+       glyph != (GlyphCacheInfo *) NULL; glyph=glyph->next)
+    if (glyph->id == id)
+      return(glyph);
+  if (font_face->glyph_memory > MaxGlyphCacheMemory)
+    {
+      (void) LogMagickEvent(AnnotateEvent,GetMagickModule(),
+                            "Flushing glyph cache for font face \"%s\""
+                            " (%g points)",font_face->path,
+                            font_face->pointsize);
+      DestroyGlyphCache(font_face);
+    }
+  ft_status=FT_Load_Glyph(font_face->face,id,FT_LOAD_DEFAULT);
+  if (ft_status != False) /* 0 means success */
+    return((GlyphCacheInfo *) NULL);
+  ft_status=FT_Get_Glyph(font_face->face->glyph,&image);
+  if (ft_status != False) /* 0 means success */
+    return((GlyphCacheInfo *) NULL);
+  glyph=MagickAllocateMemory(GlyphCacheInfo *,sizeof(GlyphCacheInfo));
+  if (glyph == (GlyphCacheInfo *) NULL)
+    {
+      FT_Done_Glyph(image);
+      return((GlyphCacheInfo *) NULL);
+    }
+  glyph->id=id;
+  glyph->image=image;
+  glyph->advance=font_face->face->glyph->advance;
+  glyph->bitmaps=(GlyphBitmapInfo *) NULL;
+  font_face->glyph_memory+=sizeof(GlyphCacheInfo);
+  if (image->format == FT_GLYPH_FORMAT_OUTLINE)
+    {
+      FT_Outline
+        *outline;
+
+      /*
+        Compute exact bounding box for scaled outline. If necessary, the
+        outline Bezier arcs are walked over to extract their extrema.
+      */
+      outline=&((FT_OutlineGlyph) image)->outline;
+      (void) FT_Outline_Get_BBox(outline,&glyph->bounds);
+      font_face->glyph_memory+=(size_t) outline->n_points*
+        (sizeof(FT_Vector)+1)+(size_t) outline->n_contours*sizeof(short);
+    }
+  else
+    {
+      /*
+        Obtain glyph's control box.
+      */
+      FT_Glyph_Get_CBox(image,FT_GLYPH_BBOX_SUBPIXELS,&glyph->bounds);
+    }
+  glyph->next=font_face->glyphs[id % GlyphCacheBuckets];
+  font_face->glyphs[id % GlyphCacheBuckets]=glyph;
+  return(glyph);
+}
+
+/*
+  Obtain the bitmap for a cached glyph transformed by affine and
+  positioned at origin (26.6), rasterizing it if a bitmap for the same
+  transform and sub-pixel offset is not yet cached.  The returned bitmap
+  left and top members are adjusted for the whole-pixel origin, and the
+  buffer remains valid until the next call to GetCachedGlyph() for the
+  same face.
+*/
+static MagickPassFail GetCachedGlyphBitmap(FontFaceInfo *font_face,
+  GlyphCacheInfo *glyph,const FT_Matrix *affine,const FT_Vector *origin,
+  GlyphBitmapInfo *bitmap)
+{
+  FT_BitmapGlyph
+    bitmap_glyph;
+
+  FT_Error
+    ft_status;
+
+  FT_Glyph
+    image;
+
+  FT_Vector
+    offset,
+    position;
+
+  GlyphBitmapInfo
+    *p;
+
+  size_t
+    length;
+
+  /*
+    Only outline glyphs may be transformed and positioned, so bitmaps of
+    other glyph formats are independent of the origin.
+  */
+  offset.x=0;
+  offset.y=0;
+  position.x=0;
+  position.y=0;
+  if (glyph->image->format == FT_GLYPH_FORMAT_OUTLINE)
+    {
+      offset.x=origin->x & 63;
+      offset.y=origin->y & 63;
+      position.x=(origin->x-offset.x)/64;
+      position.y=(origin->y-offset.y)/64;
+    }
+  for (p=glyph->bitmaps; p != (GlyphBitmapInfo *) NULL; p=p->next)
+    if ((p->offset.x == offset.x) && (p->offset.y == offset.y) &&
+        (p->affine.xx == affine->xx) && (p->affine.xy == affine->xy) &&
+        (p->affine.yx == affine->yx) && (p->affine.yy == affine->yy))
+      break;
+  if (p == (GlyphBitmapInfo *) NULL)
+    {
+      /*
+        Rasterize the glyph.
+      */
+      ft_status=FT_Glyph_Copy(glyph->image,&image);
+      if (ft_status != False)
+        return(MagickFail);
+      (void) FT_Glyph_Transform(image,(FT_Matrix *) affine,&offset);
+      ft_status=FT_Glyph_To_Bitmap(&image,ft_render_mode_normal,
+        (FT_Vector *) NULL,True);
+      if (ft_status != False)
+        {
+          FT_Done_Glyph(image);
+          return(MagickFail);
+        }
+      bitmap_glyph=(FT_BitmapGlyph) image;
+      length=(size_t) bitmap_glyph->bitmap.rows*
+        (size_t) AbsoluteValue(bitmap_glyph->bitmap.pitch);
+      p=MagickAllocateMemory(GlyphBitmapInfo *,sizeof(GlyphBitmapInfo));
+      if (p != (GlyphBitmapInfo *) NULL)
+        {
+          p->buffer=MagickAllocateMemory(unsigned char *,Max(length,1));
+          if (p->buffer == (unsigned char *) NULL)
+            MagickFreeMemory(p);
+        }
+      if (p == (GlyphBitmapInfo *) NULL)
+        {
+          FT_Done_Glyph(image);
+          return(MagickFail);
+        }
+      p->affine=(*affine);
+      p->offset=offset;
+      p->left=bitmap_glyph->left;
+      p->top=bitmap_glyph->top;
+      p->pitch=bitmap_glyph->bitmap.pitch;
+      p->rows=bitmap_glyph->bitmap.rows;
+      p->width=bitmap_glyph->bitmap.width;
+      p->pixel_mode=bitmap_glyph->bitmap.pixel_mode;
+      if (length != 0)
+        (void) memcpy(p->buffer,bitmap_glyph->bitmap.buffer,length);
+      FT_Done_Glyph(image);
+      p->next=glyph->bitmaps;
+      glyph->bitmaps=p;
+      font_face->glyph_memory+=sizeof(GlyphBitmapInfo)+length;
+    }
+  *bitmap=(*p);
+  bitmap->left+=position.x;
+  bitmap->top+=position.y;
+  bitmap->next=(GlyphBitmapInfo *) NULL;
+  return(MagickPass);
+}
+
 static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
   const char *encoding,const PointInfo *offset,TypeMetric *metrics)
 {
@@ -1067,9 +1620,6 @@ static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
 
     FT_Vector
       origin;
-
-    FT_Glyph
-      image;
   } GlyphInfo;
 
   double
@@ -1081,9 +1631,6 @@ static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
   FT_BBox
     bounds;
 
-  FT_BitmapGlyph
-    bitmap;
-
   FT_Encoding
     encoding_type;
 
@@ -1093,15 +1640,21 @@ static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
   FT_Face
     face;
 
-  FT_Library
-    library;
-
   FT_Matrix
     affine;
 
+  FontFaceInfo
+    *font_face;
+
   FT_Vector
     origin;
 
+  GlyphBitmapInfo
+    bitmap;
+
+  GlyphCacheInfo
+    *cached_glyph;
+
   GlyphInfo
     glyph,
     last_glyph;
@@ -1154,25 +1707,23 @@ static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
   if (draw_info->font == (char *) NULL)
     ThrowBinaryException(TypeError,FontNotSpecified,image->filename);
 
-  glyph.image=(FT_Glyph) 0;
-  last_glyph.image=(FT_Glyph) 0;
-
-  /*
-    Initialize Truetype library.
-  */
-  ft_status=FT_Init_FreeType(&library);
-  if (ft_status)
-    ThrowBinaryException(TypeError,UnableToInitializeFreetypeLibrary,
-                         draw_info->font);
-  if (*draw_info->font != '@')
-    ft_status=FT_New_Face(library,draw_info->font,0,&face);
-  else
-    ft_status=FT_New_Face(library,draw_info->font+1,0,&face);
-  if (ft_status != 0)
+  resolution.x=72.0;
+  resolution.y=72.0;
+  if (draw_info->density != (char *) NULL)
     {
-      (void) FT_Done_FreeType(library);
-      ThrowBinaryException(TypeError,UnableToReadFont,draw_info->font)
+      i=GetMagickDimension(draw_info->density,&resolution.x,&resolution.y,NULL,NULL);
+      if (i != 2)
+        resolution.y=resolution.x;
     }
+  /*
+    Obtain a face sized for the text from the font cache.
+  */
+  font_face=AcquireFontFace(*draw_info->font != '@' ? draw_info->font :
+                            draw_info->font+1,0,draw_info->pointsize,
+                            &resolution,&image->exception);
+  if (font_face == (FontFaceInfo *) NULL)
+    return(MagickFail);
+  face=font_face->face;
   /*
     Select a charmap
   */
@@ -1223,22 +1774,11 @@ static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
         encoding_type=ft_encoding_wansung;
       ft_status=FT_Select_Charmap(face,encoding_type);
       if (ft_status != 0)
-        ThrowBinaryException(TypeError,UnrecognizedFontEncoding,encoding);
-    }
-  /*
-    Set text size.
-  */
-  resolution.x=72.0;
-  resolution.y=72.0;
-  if (draw_info->density != (char *) NULL)
-    {
-      i=GetMagickDimension(draw_info->density,&resolution.x,&resolution.y,NULL,NULL);
-      if (i != 2)
-        resolution.y=resolution.x;
+        {
+          ReleaseFontFace(font_face);
+          ThrowBinaryException(TypeError,UnrecognizedFontEncoding,encoding);
+        }
     }
-  (void) FT_Set_Char_Size(face,(FT_F26Dot6) (64.0*draw_info->pointsize),
-    (FT_F26Dot6) (64.0*draw_info->pointsize),(FT_UInt) resolution.x,
-    (FT_UInt) resolution.y);
   metrics->pixels_per_em.x=face->size->metrics.x_ppem;
   metrics->pixels_per_em.y=face->size->metrics.y_ppem;
   metrics->ascent=(double) face->size->metrics.ascender/64.0;
@@ -1259,8 +1799,7 @@ static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
   */
   if ((draw_info->text == NULL) || (draw_info->text[0] == '\0'))
     {
-      (void) FT_Done_Face(face);
-      (void) FT_Done_FreeType(library);
+      ReleaseFontFace(font_face);
       return status;
     }
 
@@ -1302,8 +1841,7 @@ static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
   }
   if (text == (magick_code_point_t *) NULL)
     {
-      (void) FT_Done_Face(face);
-      (void) FT_Done_FreeType(library);
+      ReleaseFontFace(font_face);
       (void) LogMagickEvent(AnnotateEvent,GetMagickModule(),
                             "Text encoding failed: encoding_type=%ld "
                             "draw_info->encoding=\"%s\" draw_info->text=\"%s\" length=%ld",
@@ -1348,27 +1886,13 @@ static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
         origin.x+=kerning.x;
       }
     glyph.origin=origin;
-    glyph.image=0;
-    ft_status=FT_Load_Glyph(face,glyph.id,FT_LOAD_DEFAULT);
-    if (ft_status != False) /* 0 means success */
-      continue;
-    ft_status=FT_Get_Glyph(face->glyph,&glyph.image);
-    if (ft_status != False) /* 0 means success */
-      continue;
-#if 0
-    /*
-      Obtain glyph's control box. Usually faster than computing the
-      exact bounding box but may be slightly larger in some
-      situations.
-    */
-    (void) FT_Glyph_Get_CBox(glyph.image,FT_GLYPH_BBOX_SUBPIXELS,&bounds);
-#else
     /*
-      Compute exact bounding box for scaled outline. If necessary, the
-      outline Bezier arcs are walked over to extract their extrema.
+      Obtain the loaded glyph and its bounds from the glyph cache.
     */
-    (void) FT_Outline_Get_BBox(&((FT_OutlineGlyph) glyph.image)->outline,&bounds);
-#endif
+    cached_glyph=GetCachedGlyph(font_face,glyph.id);
+    if (cached_glyph == (GlyphCacheInfo *) NULL)
+      continue;
+    bounds=cached_glyph->bounds;
     if ((i == 0) || (bounds.xMin < metrics->bounds.x1))
       metrics->bounds.x1=bounds.xMin;
     if ((i == 0) || (bounds.yMin < metrics->bounds.y1))
@@ -1386,11 +1910,12 @@ static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
           */
           clone_info->affine.tx=glyph.origin.x/64.0;
           clone_info->affine.ty=glyph.origin.y/64.0;
-          (void) FT_Outline_Decompose(&((FT_OutlineGlyph) glyph.image)->outline,
-            &OutlineMethods,clone_info);
+          if (cached_glyph->image->format == FT_GLYPH_FORMAT_OUTLINE)
+            (void) FT_Outline_Decompose(&((FT_OutlineGlyph)
+                                          cached_glyph->image)->outline,
+                                        &OutlineMethods,clone_info);
         }
     FT_Vector_Transform(&glyph.origin,&affine);
-    (void) FT_Glyph_Transform(glyph.image,&affine,&glyph.origin);
     if (draw_info->render)
       {
         status &= ModifyCache(image,&image->exception);
@@ -1398,28 +1923,26 @@ static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
             (pattern != (Image *) NULL))
           {
             /*
-              Rasterize the glyph.
+              Rasterize the glyph, or re-use its cached bitmap.
             */
-            ft_status=FT_Glyph_To_Bitmap(&glyph.image,ft_render_mode_normal,
-              (FT_Vector *) NULL,True);
-            if (ft_status != False)
+            if (GetCachedGlyphBitmap(font_face,cached_glyph,&affine,
+                                     &glyph.origin,&bitmap) == MagickFail)
               continue;
-            bitmap=(FT_BitmapGlyph) glyph.image;
             image->storage_class=DirectClass;
-            if (bitmap->bitmap.pixel_mode == ft_pixel_mode_mono)
+            if (bitmap.pixel_mode == ft_pixel_mode_mono)
               {
                 point.x=offset->x+(origin.x >> 6);
               }
             else
               {
-                point.x=offset->x+bitmap->left;
+                point.x=offset->x+bitmap.left;
               }
-            point.y=offset->y-bitmap->top;
-            p=bitmap->bitmap.buffer;
+            point.y=offset->y-bitmap.top;
+            p=bitmap.buffer;
             /* FIXME: OpenMP */
-            for (y=0; y < (long) bitmap->bitmap.rows; y++)
+            for (y=0; y < (long) bitmap.rows; y++)
             {
-              int pc = y * bitmap->bitmap.pitch;
+              int pc = y * bitmap.pitch;
               int pcr = pc;
               if ((ceil(point.y+y-0.5) < 0) ||
                   (ceil(point.y+y-0.5) >= image->rows))
@@ -1430,9 +1953,9 @@ static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
                 Try to get whole span.  May fail.
               */
               q=GetImagePixels(image,(long) ceil(point.x-0.5),
-                (long) ceil(point.y+y-0.5),bitmap->bitmap.width,1);
+                (long) ceil(point.y+y-0.5),bitmap.width,1);
               active=q != (PixelPacket *) NULL;
-              for (x=0; x < (long) bitmap->bitmap.width; x++, pc++)
+              for (x=0; x < (long) bitmap.width; x++, pc++)
                 {
                   if (((long) ceil(point.x+x-0.5) < 0) ||
                       ((unsigned long) ceil(point.x+x-0.5) >= image->columns))
@@ -1442,7 +1965,7 @@ static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
                       continue;
                     }
                   /* 8-bit gray-level pixmap */
-                  if (bitmap->bitmap.pixel_mode == ft_pixel_mode_grays)
+                  if (bitmap.pixel_mode == ft_pixel_mode_grays)
                     {
                       if (draw_info->text_antialias)
                         opacity=ScaleCharToQuantum((double) p[pc]);
@@ -1450,7 +1973,7 @@ static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
                         opacity=(p[pc] < 127 ? OpaqueOpacity : TransparentOpacity);
                     }
                   /* 1-bit monochrome bitmap */
-                  else if (bitmap->bitmap.pixel_mode == ft_pixel_mode_mono)
+                  else if (bitmap.pixel_mode == ft_pixel_mode_mono)
                     {
                       opacity=((p[(x >> 3) + pcr] & (1 << (~x & 0x07))) ?
                                TransparentOpacity : OpaqueOpacity);
@@ -1515,14 +2038,9 @@ static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
             }
           }
       }
-    origin.x+=face->glyph->advance.x;
+    origin.x+=cached_glyph->advance.x;
     if (origin.x > metrics->width)
       metrics->width=origin.x;
-    if (last_glyph.image != 0)
-      {
-        FT_Done_Glyph(last_glyph.image);
-        last_glyph.image=0;
-      }
     last_glyph=glyph;
   }
   metrics->width/=64.0;
@@ -1542,18 +2060,12 @@ static MagickPassFail RenderFreetype(Image *image,const DrawInfo *draw_info,
         (void) ConcatenateString(&clone_info->primitive,"'");
         (void) DrawImage(image,clone_info);
       }
-  if (glyph.image != 0)
-    {
-      FT_Done_Glyph(glyph.image);
-      glyph.image=0;
-    }
   /*
     Free resources.
   */
   MagickFreeMemory(text);
   DestroyDrawInfo(clone_info);
-  (void) FT_Done_Face(face);
-  (void) FT_Done_FreeType(library);
+  ReleaseFontFace(font_face);
   return(status);
 }
 #else
@@ -55,6 +55,7 @@
 #include "magick/delegate.h"
 #include "magick/describe.h"
 #include "magick/effect.h"
+#include "magick/effect-private.h"
 #include "magick/enhance.h"
 #include "magick/enum_strings.h"
 #include "magick/fx.h"
@@ -9112,6 +9113,347 @@ MagickInitializeCommandInfo(void)
   command_semaphore=AllocateSemaphoreInfo();
   return MagickPass;
 }
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
++     M o g r i f y I m a g e B a n d s                                       %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  Method MogrifyImageBands applies a run of consecutive command line
+%  options which only need a bounded neighborhood of source rows (point
+%  operators and small-kernel filters) to the image one horizontal band at
+%  a time.  Each band is extended by enough halo rows above and below that
+%  the rows it contributes are identical to processing the whole image, the
+%  complete option run is applied to the band, and the result is written
+%  back in place.  The source rows which the following band needs as its
+%  upper halo are saved before they are overwritten.  Intermediate images
+%  are therefore only as large as one band rather than the whole image,
+%  and the band being processed stays resident in the CPU cache while it
+%  passes through every option in the run.
+%
+%  Band pipelining is requested with "-define mogrify:pipeline=<rows>"
+%  (or "true" to use the default band height).
+%
+%  The format of the MogrifyImageBands method is:
+%
+%      MagickPassFail MogrifyImageBands(const ImageInfo *image_info,
+%        const int argc,char **argv,const unsigned long halo,
+%        const unsigned long band_rows,Image **image)
+%
+%  A description of each parameter follows:
+%
+%    o image_info: The image info.
+%
+%    o argc: The number of elements in the option run.
+%
+%    o argv: The option run.
+%
+%    o halo: Number of rows each band must be extended by above and below.
+%
+%    o band_rows: Minimum number of rows written back by each band.
+%
+%    o image: The image to update.
+%
+*/
+#define DefaultPipelineBandRows 256
+
+static unsigned long
+MogrifyPipelineHalo(const char *option,const char *value)
+{
+  double
+    radius,
+    sigma;
+
+  if ((LocaleCompare("blur",option+1) == 0) ||
+      (LocaleCompare("unsharp",option+1) == 0))
+    {
+      /*
+        BlurImage() grows its kernel until the tail weight rounds to
+        zero so allow a full kernel width rather than half of it.
+      */
+      radius=0.0;
+      sigma=1.0;
+      (void) GetMagickDimension(value,&radius,&sigma,NULL,NULL);
+      return((unsigned long) GetOptimalKernelWidth1D(radius,sigma));
+    }
+  if ((LocaleCompare("gaussian",option+1) == 0) ||
+      (LocaleCompare("gaussian-blur",option+1) == 0))
+    {
+      radius=0.0;
+      sigma=1.0;
+      (void) GetMagickDimension(value,&radius,&sigma,NULL,NULL);
+      return((unsigned long) GetOptimalKernelWidth2D(radius,sigma)/2);
+    }
+  if (LocaleCompare("sharpen",option+1) == 0)
+    {
+      radius=0.0;
+      sigma=1.0;
+      (void) GetMagickDimension(value,&radius,&sigma,NULL,NULL);
+      return((unsigned long) GetOptimalKernelWidth(radius,sigma)/2);
+    }
+  if ((LocaleCompare("edge",option+1) == 0) ||
+      (LocaleCompare("median",option+1) == 0))
+    return((unsigned long) GetOptimalKernelWidth(MagickAtoF(value),0.5)/2);
+  if (LocaleCompare("enhance",option+1) == 0)
+    return(2);
+  return(0);
+}
+
+static int
+MogrifyPipelineStage(const char *option,const char *value,
+                     const BlurMethod blur_method)
+{
+  static const char
+    *point_options[] =
+    {
+      "contrast",
+      "negate",
+      (char *) NULL
+    },
+    *point_value_options[] =
+    {
+      "level",
+      "modulate",
+      "solarize",
+      (char *) NULL
+    },
+    *filter_options[] =
+    {
+      "blur",
+      "edge",
+      "gaussian",
+      "gaussian-blur",
+      "median",
+      "sharpen",
+      "unsharp",
+      (char *) NULL
+    };
+
+  register unsigned int
+    i;
+
+  /*
+    Return the number of arguments consumed by a band-safe option, or
+    zero if the option must see the whole image.  Options which gather
+    image statistics (e.g. -emboss, which equalizes its result) are not
+    band-safe.
+  */
+  if ((strlen(option) <= 1) || ((option[0] != '-') && (option[0] != '+')))
+    return(0);
+  for (i=0; point_options[i] != (char *) NULL; i++)
+    if (LocaleCompare(point_options[i],option+1) == 0)
+      return(1);
+  if (LocaleCompare("enhance",option+1) == 0)
+    return(1);
+  if (value == (const char *) NULL)
+    return(0);
+  if ((LocaleCompare("gamma",option+1) == 0) && (*option == '-'))
+    return(2);
+  for (i=0; point_value_options[i] != (char *) NULL; i++)
+    if (LocaleCompare(point_value_options[i],option+1) == 0)
+      return(2);
+  if ((LocaleCompare("blur",option+1) == 0) ||
+      (LocaleCompare("gaussian",option+1) == 0) ||
+      (LocaleCompare("gaussian-blur",option+1) == 0) ||
+      (LocaleCompare("unsharp",option+1) == 0))
+    {
+      double
+        radius,
+        sigma;
+
+      /*
+        The recursive Gaussian selected by blur:method has unbounded
+        support, so no halo reproduces its result within a band.
+      */
+      radius=0.0;
+      sigma=1.0;
+      (void) GetMagickDimension(value,&radius,&sigma,NULL,NULL);
+      if (IsRecursiveBlur(radius,sigma,blur_method))
+        return(0);
+    }
+  for (i=0; filter_options[i] != (char *) NULL; i++)
+    if (LocaleCompare(filter_options[i],option+1) == 0)
+      return(2);
+  return(0);
+}
+
+static int
+MogrifyPipelineLength(const int argc,char **argv,
+                      const BlurMethod blur_method,unsigned long *halo,
+                      unsigned int *stages)
+{
+  int
+    consumed,
+    i;
+
+  *halo=0;
+  *stages=0;
+  for (i=0; i < argc; i+=consumed)
+    {
+      consumed=MogrifyPipelineStage(argv[i],i+1 < argc ? argv[i+1] :
+                                    (const char *) NULL,blur_method);
+      if (consumed == 0)
+        break;
+      if (consumed > 1)
+        *halo+=MogrifyPipelineHalo(argv[i],argv[i+1]);
+      else
+        *halo+=MogrifyPipelineHalo(argv[i],(const char *) NULL);
+      (*stages)++;
+    }
+  return(i);
+}
+
+static MagickPassFail
+CopyImageRows(Image *destination,const long destination_y,
+              const Image *source,const long source_y,
+              const unsigned long rows,ExceptionInfo *exception)
+{
+  const IndexPacket
+    *source_indexes;
+
+  const PixelPacket
+    *p;
+
+  IndexPacket
+    *destination_indexes;
+
+  PixelPacket
+    *q;
+
+  unsigned long
+    row;
+
+  for (row=0; row < rows; row++)
+    {
+      p=AcquireImagePixels(source,0,source_y+(long) row,source->columns,1,
+                           exception);
+      q=SetImagePixelsEx(destination,0,destination_y+(long) row,
+                         destination->columns,1,exception);
+      if ((p == (const PixelPacket *) NULL) || (q == (PixelPacket *) NULL))
+        return(MagickFail);
+      (void) memcpy(q,p,destination->columns*sizeof(PixelPacket));
+      source_indexes=AccessImmutableIndexes(source);
+      destination_indexes=AccessMutableIndexes(destination);
+      if ((source_indexes != (const IndexPacket *) NULL) &&
+          (destination_indexes != (IndexPacket *) NULL))
+        (void) memcpy(destination_indexes,source_indexes,
+                      destination->columns*sizeof(IndexPacket));
+      if (!SyncImagePixelsEx(destination,exception))
+        return(MagickFail);
+    }
+  return(MagickPass);
+}
+
+static MagickPassFail
+MogrifyImageBands(const ImageInfo *image_info,const int argc,char **argv,
+                  const unsigned long halo,const unsigned long band_rows,
+                  Image **image)
+{
+  Image
+    *band_image,
+    *carry_image,
+    *next_carry_image;
+
+  ImageInfo
+    *band_info;
+
+  MagickBool
+    is_grayscale;
+
+  MagickPassFail
+    status;
+
+  unsigned long
+    band,
+    bands,
+    bottom,
+    rows,
+    top,
+    y;
+
+  double
+    gamma;
+
+  /*
+    Spread the rows evenly so that no band (and in particular not the
+    last one) is shorter than band_rows, which the caller ensures is
+    larger than any kernel in the run.
+  */
+  bands=(*image)->rows/band_rows;
+  (void) LogMagickEvent(TransformEvent,GetMagickModule(),
+                        "Pipelining %d arguments through %lu bands of %lu"
+                        " rows (%lu halo rows)",argc,bands,
+                        (*image)->rows/bands,halo);
+  band_info=CloneImageInfo(image_info);
+  (void) RemoveDefinitions(band_info,"mogrify:pipeline");
+  carry_image=(Image *) NULL;
+  is_grayscale=(*image)->is_grayscale;
+  gamma=(*image)->gamma;
+  status=MagickPass;
+  for (band=0; (band < bands) && (status != MagickFail); band++)
+    {
+      y=(band*(*image)->rows)/bands;
+      rows=((band+1)*(*image)->rows)/bands-y;
+      top=Min(halo,y);
+      bottom=Min(halo,(*image)->rows-(y+rows));
+      band_image=CloneImage(*image,(*image)->columns,top+rows+bottom,
+                            MagickTrue,&(*image)->exception);
+      if (band_image == (Image *) NULL)
+        {
+          status=MagickFail;
+          break;
+        }
+      /*
+        Rows above y have already been replaced by results so the upper
+        halo comes from the source rows saved by the previous band.
+      */
+      if (top != 0)
+        status&=CopyImageRows(band_image,0,carry_image,
+                              (long) (carry_image->rows-top),top,
+                              &(*image)->exception);
+      if (status != MagickFail)
+        status&=CopyImageRows(band_image,(long) top,*image,(long) y,
+                              rows+bottom,&(*image)->exception);
+      next_carry_image=(Image *) NULL;
+      if ((status != MagickFail) && (halo != 0) && (band+1 < bands))
+        {
+          next_carry_image=CloneImage(band_image,band_image->columns,halo,
+                                      MagickTrue,&(*image)->exception);
+          if (next_carry_image == (Image *) NULL)
+            status=MagickFail;
+          else
+            status&=CopyImageRows(next_carry_image,0,band_image,
+                                  (long) (top+rows-halo),halo,
+                                  &(*image)->exception);
+        }
+      DestroyImage(carry_image);
+      carry_image=next_carry_image;
+      if (status != MagickFail)
+        status&=MogrifyImage(band_info,argc,argv,&band_image);
+      if (band_image->exception.severity > (*image)->exception.severity)
+        CopyException(&(*image)->exception,&band_image->exception);
+      if ((band_image->columns != (*image)->columns) ||
+          (band_image->rows != top+rows+bottom))
+        status=MagickFail;
+      if (status != MagickFail)
+        status&=CopyImageRows(*image,(long) y,band_image,(long) top,rows,
+                              &(*image)->exception);
+      is_grayscale=(is_grayscale && band_image->is_grayscale);
+      gamma=band_image->gamma;
+      DestroyImage(band_image);
+    }
+  DestroyImage(carry_image);
+  DestroyImageInfo(band_info);
+  (*image)->is_grayscale=is_grayscale;
+  (*image)->gamma=gamma;
+  return(status);
+}
+
 
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -9152,6 +9494,9 @@ MagickExport MagickPassFail MogrifyImage(const ImageInfo *image_info,
   char
     *option;
 
+  const char
+    *pipeline;
+
   DrawInfo
     *draw_info;
 
@@ -9164,6 +9509,9 @@ MagickExport MagickPassFail MogrifyImage(const ImageInfo *image_info,
   int
     count;
 
+  MagickPassFail
+    status;
+
   QuantizeInfo
     quantize_info;
 
@@ -9208,6 +9556,7 @@ MagickExport MagickPassFail MogrifyImage(const ImageInfo *image_info,
   quantize_info.dither=MagickTrue;
   SetGeometry(*image,&region_geometry);
   region_image=(Image *) NULL;
+  status=MagickPass;
   /*
     Transmogrify the image.
   */
@@ -9216,6 +9565,40 @@ MagickExport MagickPassFail MogrifyImage(const ImageInfo *image_info,
     option=argv[i];
     if ((strlen(option) <= 1) || ((option[0] != '-') && (option[0] != '+')))
       continue;
+    if ((region_image == (Image *) NULL) &&
+        ((*image)->storage_class == DirectClass) &&
+        ((pipeline=AccessDefinition(clone_info,"mogrify","pipeline")) !=
+         (const char *) NULL))
+      {
+        int
+          length;
+
+        unsigned int
+          stages;
+
+        unsigned long
+          band_rows,
+          halo;
+
+        /*
+          Stream a run of band-safe options through row bands.
+        */
+        length=MogrifyPipelineLength(argc-i,argv+i,GetBlurMethod(clone_info),
+                                     &halo,&stages);
+        band_rows=DefaultPipelineBandRows;
+        if (isdigit((int) *pipeline))
+          band_rows=(unsigned long) MagickAtoL(pipeline);
+        band_rows=Max(band_rows,2*halo+1);
+        if ((stages > 1) && ((*image)->rows >= 2*band_rows))
+          {
+            status=MogrifyImageBands(clone_info,length,argv+i,halo,band_rows,
+                                     image);
+            if (status == MagickFail)
+              break;
+            i+=length-1;
+            continue;
+          }
+      }
     switch (*(option+1))
     {
       case 'a':
@@ -9332,7 +9715,9 @@ MagickExport MagickPassFail MogrifyImage(const ImageInfo *image_info,
             radius=0.0;
             sigma=1.0;
             (void) GetMagickDimension(argv[++i],&radius,&sigma,NULL,NULL);
-            blur_image=BlurImage(*image,radius,sigma,&(*image)->exception);
+            blur_image=BlurImageMethod(*image,radius,sigma,
+                                       GetBlurMethod(clone_info),
+                                       &(*image)->exception);
             if (blur_image == (Image *) NULL)
               break;
             DestroyImage(*image);
@@ -9617,8 +10002,8 @@ MagickExport MagickPassFail MogrifyImage(const ImageInfo *image_info,
             }
             for ( ; x < (long) (order*order); x++)
               kernel[x]=0.0;
-            convolve_image=ConvolveImage(*image,order,kernel,
-              &(*image)->exception);
+            convolve_image=ConvolveImageMethod(*image,order,kernel,
+              GetConvolveMethod(clone_info),&(*image)->exception);
             MagickFreeMemory(kernel);
             if (convolve_image == (Image *) NULL)
               break;
@@ -10004,8 +10389,9 @@ MagickExport MagickPassFail MogrifyImage(const ImageInfo *image_info,
             radius=0.0;
             sigma=1.0;
             (void) GetMagickDimension(argv[++i],&radius,&sigma,NULL,NULL);
-            blur_image=
-              GaussianBlurImage(*image,radius,sigma,&(*image)->exception);
+            blur_image=GaussianBlurImageMethod(*image,radius,sigma,
+                                               GetBlurMethod(clone_info),
+                                               &(*image)->exception);
             if (blur_image == (Image *) NULL)
               break;
             DestroyImage(*image);
@@ -11411,8 +11797,8 @@ MagickExport MagickPassFail MogrifyImage(const ImageInfo *image_info,
             sigma=1.0;
             threshold=0.05;
             (void) GetMagickDimension(argv[++i],&radius,&sigma,&amount,&threshold);
-            unsharp_image=UnsharpMaskImage(*image,radius,sigma,amount,threshold,
-              &(*image)->exception);
+            unsharp_image=UnsharpMaskImageMethod(*image,radius,sigma,amount,
+              threshold,GetBlurMethod(clone_info),&(*image)->exception);
             if (unsharp_image == (Image *) NULL)
               break;
             DestroyImage(*image);
@@ -11589,6 +11975,8 @@ MagickExport MagickPassFail MogrifyImage(const ImageInfo *image_info,
   */
   DestroyDrawInfo(draw_info);
   DestroyImageInfo(clone_info);
+  if (status == MagickFail)
+    return(MagickFail);
   return((*image)->exception.severity == UndefinedException);
 }
 
@@ -0,0 +1,90 @@
+/*
+  Copyright (C) 2026 GraphicsMagick Group
+
+  This program is covered by multiple licenses, which are described in
+  Copyright.txt. You should have received a copy of Copyright.txt with this
+  package; otherwise see http://www.graphicsmagick.org/www/Copyright.html.
+
+  GraphicsMagick Image Effect Methods.
+*/
+
+/*
+  How BlurImage(), GaussianBlurImage(), and UnsharpMaskImage() filter:
+  KernelBlurMethod and RecursiveBlurMethod force either filter, while
+  AutoBlurMethod selects the recursive Gaussian for large sigmas.
+*/
+typedef enum
+{
+  KernelBlurMethod,
+  RecursiveBlurMethod,
+  AutoBlurMethod
+} BlurMethod;
+
+/*
+  Return the method requested by
+  "-define blur:method=kernel|recursive|auto", or KernelBlurMethod if it
+  is not defined.
+*/
+extern BlurMethod
+  GetBlurMethod(const ImageInfo *image_info);
+
+/*
+  Return MagickTrue if BlurImage(), GaussianBlurImage(), and
+  UnsharpMaskImage() filter with a recursive Gaussian, whose support is
+  not bounded by a kernel width, for the given radius, sigma, and
+  method.
+*/
+extern MagickBool
+  IsRecursiveBlur(const double radius,const double sigma,
+                  const BlurMethod method);
+
+/*
+  BlurImage(), GaussianBlurImage(), and UnsharpMaskImage() using the
+  given method.
+*/
+extern Image
+  *BlurImageMethod(const Image *image,const double radius,
+                   const double sigma,const BlurMethod method,
+                   ExceptionInfo *exception),
+  *GaussianBlurImageMethod(const Image *image,const double radius,
+                           const double sigma,const BlurMethod method,
+                           ExceptionInfo *exception),
+  *UnsharpMaskImageMethod(const Image *image,const double radius,
+                          const double sigma,const double amount,
+                          const double threshold,const BlurMethod method,
+                          ExceptionInfo *exception);
+
+/*
+  How ConvolveImage() convolves: AutoConvolveMethod applies separable
+  kernels as a row pass and a column pass, and large kernels using FFT
+  convolution when that is cheaper, while DirectConvolveMethod always
+  convolves directly.
+*/
+typedef enum
+{
+  AutoConvolveMethod,
+  DirectConvolveMethod
+} ConvolveMethod;
+
+/*
+  Return the method requested by "-define convolve:method=auto|direct",
+  or AutoConvolveMethod if it is not defined.
+*/
+extern ConvolveMethod
+  GetConvolveMethod(const ImageInfo *image_info);
+
+/*
+  ConvolveImage() using the given method.
+*/
+extern Image
+  *ConvolveImageMethod(const Image *image,const unsigned int order,
+                       const double *kernel,const ConvolveMethod method,
+                       ExceptionInfo *exception);
+
+/*
+ * Local Variables:
+ * mode: c
+ * c-basic-offset: 2
+ * fill-column: 78
+ * End:
+ */
@@ -41,6 +41,7 @@
 #include "magick/color.h"
 #include "magick/colormap.h"
 #include "magick/effect.h"
+#include "magick/effect-private.h"
 #include "magick/enhance.h"
 #include "magick/enum_strings.h"
 #include "magick/gem.h"
@@ -640,12 +641,97 @@ MagickExport MagickPassFail BlackThresholdImage(Image *image,const char *thresho
 %
 %
 */
+/*
+  BlurImage() filters with a kernel unless a recursive Gaussian is
+  requested with "-define blur:method=recursive", or with
+  "-define blur:method=auto" when sigma is at least BlurRecursiveSigma
+  and the radius is zero or at least three times sigma.  Define
+  BlurRecursiveSigma as 0 to never select the recursive filter
+  automatically.
+
+  From sigma 16 the recursive filter is within 3/255 of a kernel of
+  radius three sigma, with a mean error below 0.5/255.  The error grows
+  for smaller sigmas (5/255 at sigma 8).  With a radius of zero, the
+  kernel is cut off where its coefficients fall below 1/MaxRGB, which
+  for Q8 and sigma 16 or more is less than two sigmas, so results differ
+  from the kernel path by more than this, in favor of a true Gaussian.
+*/
+#if !defined(BlurRecursiveSigma)
+#  define BlurRecursiveSigma 16.0
+#endif
+/*
+  The vertical pass of BlurImage() reads strips of columns, each about
+  BlurStripBytes in size so that the strip stays in the L2 cache while
+  its columns are filtered one after another.
+*/
+#if !defined(BlurStripBytes)
+#  define BlurStripBytes 262144
+#endif
+#define BlurStripMaxColumns 64
 #define BlurImageColumnsText "[%s] Blur columns: order %lu..."
 #define BlurImageRowsText "[%s] Blur rows: order %lu...  "
+/*
+  UnsharpMaskImage() applies the mask while BlurImage() blurs the rows of
+  the image, so that each blurred row is combined with the original row
+  as soon as it is ready.
+*/
+typedef struct _UnsharpMaskOptions_t
+{
+  const Image *image; /* Original image */
+  double amount;    /* Difference multiplier */
+  double threshold; /* Scaled to MaxRGB/2 */
+} UnsharpMaskOptions_t;
+
+static inline Quantum UnsharpQuantum(const Quantum original, const Quantum sharpened,
+                                     const UnsharpMaskOptions_t* options)
+{
+  double
+    value;
+
+  Quantum
+    quantum;
+
+  quantum=original;
+  value=original-(double) sharpened;
+  if (AbsoluteValue(value) >= options->threshold)
+    {
+      value=original+(value*options->amount);
+      quantum=RoundDoubleToQuantum(value);
+    }
+
+  return quantum;
+}
+
+static void
+UnsharpMaskScanline(const PixelPacket * restrict original,
+                    PixelPacket * restrict pixels,const unsigned long length,
+                    const UnsharpMaskOptions_t *options)
+{
+  register long
+    i;
+
+  for (i=0; i < (long) length; i++)
+    {
+      pixels[i].red=UnsharpQuantum(original[i].red,pixels[i].red,options);
+      pixels[i].green=UnsharpQuantum(original[i].green,pixels[i].green,
+                                     options);
+      pixels[i].blue=UnsharpQuantum(original[i].blue,pixels[i].blue,options);
+      pixels[i].opacity=UnsharpQuantum(original[i].opacity,pixels[i].opacity,
+                                       options);
+    }
+}
+
+/*
+  Blur a scanline, read from a copy converted to double so that each
+  sample is converted once rather than once per kernel coefficient.
+  The destination pixels are stride pixels apart.  Pixels outside of
+  the scanline are ignored and the result renormalized near its ends.
+*/
 static void
 BlurScanline(const double * restrict kernel,const unsigned long width,
-             const PixelPacket * restrict source,PixelPacket * restrict destination,
-             const unsigned long columns, const MagickBool matte)
+             const DoublePixelPacket * restrict source,
+             PixelPacket * restrict destination,const size_t stride,
+             const unsigned long length,const MagickBool matte)
 {
   double
     scale;
@@ -659,101 +745,60 @@ BlurScanline(const double * restrict kernel,const unsigned long width,
   register const double
     *p;
 
-  register const PixelPacket
+  register const DoublePixelPacket
     *q;
 
   register long
-    i,
+    i;
+
+  long
+    first,
+    last,
     x;
 
-  if (width > columns)
-    {
-      for (x=0; x < (long) columns; x++)
+  for (x=0; x < (long) length; x++)
+  {
+    first=x-(long) (width/2);
+    if ((first >= 0) && (x < (long) length-(long) (width/2)))
       {
+        /*
+          Interior of the scanline.
+        */
         aggregate=zero;
-        scale=0.0;
         p=kernel;
-        q=source;
-        for (i=0; i < (long) columns; i++)
+        q=source+first;
+        for (i=0; i < (long) width; i++)
         {
-          if ((i >= (x-(long) width/2)) && (i <= (x+(long) width/2)))
-            {
-              /* This region is the big CPU burner for the whole function */
-              aggregate.red+=(*p)*q->red;
-              aggregate.green+=(*p)*q->green;
-              aggregate.blue+=(*p)*q->blue;
-              if (matte)
-                aggregate.opacity+=(*p)*q->opacity;
-            }
-          if (((i+(long)(width/2)-x) >= 0) && ((i+width/2-x) < width))
-            scale+=kernel[i+width/2-x];
+          aggregate.red+=(*p)*q->red;
+          aggregate.green+=(*p)*q->green;
+          aggregate.blue+=(*p)*q->blue;
+          if (matte)
+            aggregate.opacity+=(*p)*q->opacity;
           p++;
           q++;
         }
-        scale=1.0/scale;
-        destination[x].red=(Quantum) (scale*(aggregate.red+0.5));
-        destination[x].green=(Quantum) (scale*(aggregate.green+0.5));
-        destination[x].blue=(Quantum) (scale*(aggregate.blue+0.5));
+        destination->red=(Quantum) (aggregate.red+0.5);
+        destination->green=(Quantum) (aggregate.green+0.5);
+        destination->blue=(Quantum) (aggregate.blue+0.5);
         if (matte)
-          destination[x].opacity=(Quantum) (scale*(aggregate.opacity+0.5));
+          destination->opacity=(Quantum) (aggregate.opacity+0.5);
+        destination+=stride;
+        continue;
       }
-      return;
-    }
-  /*
-    Blur scanline.
-  */
-  for (x=0; x < (long) (width/2); x++)
-  {
-    aggregate=zero;
-    scale=0.0;
-    p=kernel+width/2-x;
-    q=source;
-    for (i=width/2-x; i < (long) width; i++)
-    {
-      aggregate.red+=(*p)*q->red;
-      aggregate.green+=(*p)*q->green;
-      aggregate.blue+=(*p)*q->blue;
-      if (matte)
-        aggregate.opacity+=(*p)*q->opacity;
-      scale+=(*p);
-      p++;
-      q++;
-    }
-    scale=1.0/scale;
-    destination[x].red=(Quantum) (scale*(aggregate.red+0.5));
-    destination[x].green=(Quantum) (scale*(aggregate.green+0.5));
-    destination[x].blue=(Quantum) (scale*(aggregate.blue+0.5));
-    if (matte)
-      destination[x].opacity=(Quantum) (scale*(aggregate.opacity+0.5));
-  }
-  for ( ; x < (long) (columns-width/2); x++)
-  {
-    aggregate=zero;
+    /*
+      Ends of the scanline.
+    */
+    last=Min(first+(long) width,(long) length);
     p=kernel;
-    q=source+((size_t) x-width/2);
-    for (i=0; i < (long) width; i++)
-    {
-      aggregate.red+=(*p)*q->red;
-      aggregate.green+=(*p)*q->green;
-      aggregate.blue+=(*p)*q->blue;
-      if (matte)
-        aggregate.opacity+=(*p)*q->opacity;
-      p++;
-      q++;
-    }
-    destination[x].red=(Quantum) (aggregate.red+0.5);
-    destination[x].green=(Quantum) (aggregate.green+0.5);
-    destination[x].blue=(Quantum) (aggregate.blue+0.5);
-    if (matte)
-      destination[x].opacity=(Quantum) (aggregate.opacity+0.5);
-  }
-  for ( ; x < (long) columns; x++)
-  {
+    if (first < 0)
+      {
+        p-=first;
+        first=0;
+      }
     aggregate=zero;
-    scale=0;
-    p=kernel;
-    q=source+((size_t) x-width/2);
-    for (i=0; i < (long) (columns-x+width/2); i++)
+    scale=0.0;
+    q=source+first;
+    for (i=first; i < last; i++)
     {
       aggregate.red+=(*p)*q->red;
       aggregate.green+=(*p)*q->green;
@@ -765,11 +810,12 @@ BlurScanline(const double * restrict kernel,const unsigned long width,
       q++;
     }
     scale=1.0/scale;
-    destination[x].red=(Quantum) (scale*(aggregate.red+0.5));
-    destination[x].green=(Quantum) (scale*(aggregate.green+0.5));
-    destination[x].blue=(Quantum) (scale*(aggregate.blue+0.5));
+    destination->red=(Quantum) (scale*(aggregate.red+0.5));
+    destination->green=(Quantum) (scale*(aggregate.green+0.5));
+    destination->blue=(Quantum) (scale*(aggregate.blue+0.5));
     if (matte)
-      destination[x].opacity=(Quantum) (scale*(aggregate.opacity+0.5));
+      destination->opacity=(Quantum) (scale*(aggregate.opacity+0.5));
+    destination+=stride;
   }
 }
 
@@ -813,8 +859,38 @@ static int GetBlurKernel(unsigned long width,const double sigma,double **kernel)
   return(width);
 }
 
+/*
+  Return the number of columns in each strip of the vertical blur pass.
+  A strip is at least a cache line wide, and at most BlurStripMaxColumns
+  pixels wide so that there are enough strips to share between threads.
+*/
+static unsigned long GetBlurStripColumns(const Image *image)
+{
+  unsigned long
+    columns,
+    minimum;
+
+  minimum=MAGICK_CACHE_LINE_SIZE/sizeof(PixelPacket);
+  columns=BlurStripBytes/(Max(image->rows,1)*sizeof(PixelPacket));
+  columns=Min(Max(columns,minimum),BlurStripMaxColumns);
+  return Min(columns,image->columns);
+}
+
+/*
+  Blur the rows of the image, or its columns if vertical is set.  Both
+  passes work on strips: a strip is a single row for the horizontal
+  pass, or a region of full height columns for the vertical pass, which
+  is read and written as a whole.  Each column of the strip is copied
+  out as a contiguous scanline, so the vertical pass does not need to
+  rotate the image, and neither pass filters with a stride.
+
+  For the horizontal pass, unsharp may specify an unsharp mask to apply
+  to each row once it is blurred.
+*/
 static MagickPassFail BlurImageScanlines(Image *image,const double *kernel,
                                          const unsigned long width,
+                                         const MagickBool vertical,
+                                         const UnsharpMaskOptions_t *unsharp,
                                          const char *format,
                                          ExceptionInfo *exception)
 {
@@ -827,12 +903,30 @@ static MagickPassFail BlurImageScanlines(Image *image,const double *kernel,
   MagickPassFail
     status=MagickPass;
 
+  unsigned long
+    length,
+    strip_columns,
+    strips;
+
   const MagickBool
     matte=((image->matte) || (image->colorspace == CMYKColorspace));
 
   is_grayscale=image->is_grayscale;
+  if (vertical)
+    {
+      length=image->rows;
+      strip_columns=GetBlurStripColumns(image);
+      strips=(image->columns+strip_columns-1)/strip_columns;
+    }
+  else
+    {
+      length=image->columns;
+      strip_columns=1;
+      strips=image->rows;
+    }
 
-  data_set=AllocateThreadViewDataArray(image,exception,image->columns,sizeof(PixelPacket));
+  data_set=AllocateThreadViewDataArray(image,exception,length,
+                                       sizeof(DoublePixelPacket));
   if (data_set == (ThreadViewDataSet *) NULL)
     status=MagickFail;
 
@@ -845,7 +939,7 @@ static MagickPassFail BlurImageScanlines(Image *image,const double *kernel,
         monitor_active;
 
       long
-        y;
+        strip;
 
       monitor_active=MagickMonitorActive();
 
@@ -856,14 +950,17 @@ static MagickPassFail BlurImageScanlines(Image *image,const double *kernel,
 #    pragma omp parallel for schedule(guided) shared(row_count, status)
 #  endif
 #endif
-      for (y=0; y < (long) image->rows; y++)
+      for (strip=0; strip < (long) strips; strip++)
         {
           register PixelPacket
             *q;
 
-          PixelPacket
+          DoublePixelPacket
             *scanline;
 
+          unsigned long
+            columns;
+
           MagickBool
             thread_status;
 
@@ -872,31 +969,73 @@ static MagickPassFail BlurImageScanlines(Image *image,const double *kernel,
             continue;
 
           scanline=AccessThreadViewData(data_set);
-          q=GetImagePixelsEx(image,0,y,image->columns,1,exception);
+          if (vertical)
+            {
+              columns=Min(strip_columns,image->columns-strip*strip_columns);
+              q=GetImagePixelsEx(image,strip*strip_columns,0,columns,
+                                 image->rows,exception);
+            }
+          else
+            {
+              columns=1;
+              q=GetImagePixelsEx(image,0,strip,image->columns,1,exception);
+            }
           if (q == (PixelPacket *) NULL)
             thread_status=MagickFail;
 
           if (thread_status != MagickFail)
             {
+              MagickBool
+                modified=MagickFalse;
+
               unsigned long
-                i=0;
+                i,
+                x;
 
-              scanline[i]=q[i];
-              i++;
-              for ( ; i < image->columns; i++)
+              for (x=0; x < columns; x++)
                 {
-                  if (NotPixelMatch(&scanline[i-1],&q[i],matte))
-                    break;
-                  scanline[i]=q[i];
+                  register const PixelPacket
+                    *p;
+
+                  MagickBool
+                    constant=MagickTrue;
+
+                  /*
+                    Scanline x of the strip is every columns'th pixel of
+                    the region, starting at x.
+                  */
+                  p=q+x;
+                  for (i=0; i < length; i++)
+                    {
+                      if (constant && NotPixelMatch(&q[x],p,matte))
+                        constant=MagickFalse;
+                      scanline[i].red=p->red;
+                      scanline[i].green=p->green;
+                      scanline[i].blue=p->blue;
+                      scanline[i].opacity=p->opacity;
+                      p+=columns;
+                    }
+                  if (constant)
+                    continue;
+                  BlurScanline(kernel,width,scanline,q+x,columns,length,matte);
+                  modified=MagickTrue;
                 }
-              if (i != image->columns)
+              if (unsharp != (const UnsharpMaskOptions_t *) NULL)
                 {
-                  (void) memcpy(&scanline[i],&q[i],
-                                (image->columns-i)*sizeof(PixelPacket));
-                  BlurScanline(kernel,width,scanline,q,image->columns,matte);
-                  if (!SyncImagePixelsEx(image,exception))
+                  const PixelPacket
+                    *p;
+
+                  p=AcquireImagePixels(unsharp->image,0,strip,length,1,
+                                       exception);
+                  if (p == (const PixelPacket *) NULL)
                     thread_status=MagickFail;
+                  else
+                    UnsharpMaskScanline(p,q,length,unsharp);
+                  modified=MagickTrue;
                 }
+              if (modified && (thread_status != MagickFail) &&
+                  !SyncImagePixelsEx(image,exception))
+                thread_status=MagickFail;
             }
 
           if (monitor_active)
@@ -912,8 +1051,8 @@ static MagickPassFail BlurImageScanlines(Image *image,const double *kernel,
 #  pragma omp flush (row_count)
 #endif
               thread_row_count=row_count;
-              if (QuantumTick(thread_row_count,image->rows))
-                if (!MagickMonitorFormatted(thread_row_count,image->rows,exception,
+              if (QuantumTick(thread_row_count,strips))
+                if (!MagickMonitorFormatted(thread_row_count,strips,exception,
                                             format,image->filename,width))
                   thread_status=MagickFail;
             }
@@ -934,100 +1073,499 @@ static MagickPassFail BlurImageScanlines(Image *image,const double *kernel,
   return status;
 }
 
-MagickExport Image *
-BlurImage(const Image *original_image,const double radius,
-          const double sigma,ExceptionInfo *exception)
+/*
+  Recursive Gaussian filter (I. T. Young and L. J. van Vliet, "Recursive
+  implementation of the Gaussian filter", Signal Processing 44, 1995).
+  A causal and an anti-causal third order recursion together approximate
+  convolution with a Gaussian at a fixed cost per pixel, whatever the
+  sigma.
+
+  Like BlurScanline(), pixels outside of the scanline are ignored and
+  the result is renormalized near the ends of the scanline.  This is
+  done by filtering the scanline padded with zeros, and dividing by the
+  filtered indicator of the scanline, which is the same for every
+  scanline of the same length.
+*/
+typedef struct _RecursiveGaussianInfo
 {
+  double
+    b,
+    a1,
+    a2,
+    a3;
+
+  unsigned long
+    tail;
+} RecursiveGaussianInfo;
 
+static void
+GetRecursiveGaussian(const double sigma,RecursiveGaussianInfo *info)
+{
   double
-    *kernel;
+    b0,
+    q;
 
-  Image
-    *blur_image;
+  if (sigma >= 2.5)
+    q=0.98711*sigma-0.96330;
+  else
+    q=3.97156-4.14554*sqrt(1.0-0.26891*sigma);
+  b0=1.57825+2.44413*q+1.4281*q*q+0.422205*q*q*q;
+  info->a1=(2.44413*q+2.85619*q*q+1.26661*q*q*q)/b0;
+  info->a2=(-1.4281*q*q-1.26661*q*q*q)/b0;
+  info->a3=(0.422205*q*q*q)/b0;
+  info->b=1.0-(info->a1+info->a2+info->a3);
+  /*
+    Zero padding after the scanline, long enough for the causal response
+    to decay before the anti-causal recursion starts.
+  */
+  info->tail=(unsigned long) ceil(8.0*sigma)+8;
+}
 
-  int
-    width;
+/*
+  Filter length values followed by info->tail zeros, in place.
+*/
+static void
+RecursiveGaussianScanline(const RecursiveGaussianInfo *info,
+                          double * restrict values,const unsigned long length)
+{
+  double
+    w1,
+    w2,
+    w3;
+
+  long
+    i;
+
+  const long
+    total = (long) (length+info->tail);
+
+  w1=w2=w3=0.0;
+  for (i=0; i < total; i++)
+    {
+      double
+        w;
+
+      w=info->b*(i < (long) length ? values[i] : 0.0)+
+        info->a1*w1+info->a2*w2+info->a3*w3;
+      values[i]=w;
+      w3=w2;
+      w2=w1;
+      w1=w;
+    }
+  w1=w2=w3=0.0;
+  for (i=total-1; i >= 0; i--)
+    {
+      double
+        w;
+
+      w=info->b*values[i]+info->a1*w1+info->a2*w2+info->a3*w3;
+      values[i]=w;
+      w3=w2;
+      w2=w1;
+      w1=w;
+    }
+}
+
+static MagickPassFail BlurImageScanlinesRecursive(Image *image,
+                                                  const double sigma,
+                                                  const unsigned long width,
+                                                  const MagickBool vertical,
+                                                  const UnsharpMaskOptions_t *unsharp,
+                                                  const char *format,
+                                                  ExceptionInfo *exception)
+{
+  double
+    *weights;
+
+  RecursiveGaussianInfo
+    info;
+
+  ThreadViewDataSet
+    *data_set;
+
+  MagickBool
+    is_grayscale;
 
   MagickPassFail
     status=MagickPass;
 
-  /*
-    Get convolution matrix for the specified standard-deviation.
-  */
-  assert(original_image != (Image *) NULL);
-  assert(original_image->signature == MagickSignature);
-  assert(exception != (ExceptionInfo *) NULL);
-  assert(exception->signature == MagickSignature);
-  kernel=(double *) NULL;
-  if (radius > 0)
-    width=GetBlurKernel((int) (2*ceil(radius)+1),sigma,&kernel);
+  unsigned long
+    length,
+    strip_columns,
+    strips;
+
+  const MagickBool
+    matte=((image->matte) || (image->colorspace == CMYKColorspace));
+
+  is_grayscale=image->is_grayscale;
+  if (vertical)
+    {
+      length=image->rows;
+      strip_columns=GetBlurStripColumns(image);
+      strips=(image->columns+strip_columns-1)/strip_columns;
+    }
   else
     {
-      double
-        *last_kernel;
-
-      last_kernel=(double *) NULL;
-      width=GetBlurKernel(3,sigma,&kernel);
-      while ((long) (MaxRGB*kernel[0]) > 0)
-        {
-          if (last_kernel != (double *)NULL)
-            MagickFreeResourceLimitedMemory(last_kernel);
-          last_kernel=kernel;
-          kernel=(double *) NULL;
-          width=GetBlurKernel(width+2,sigma,&kernel);
-        }
-      if (last_kernel != (double *) NULL)
-        {
-          MagickFreeResourceLimitedMemory(kernel);
-          width-=2;
-          kernel=last_kernel;
-        }
+      length=image->columns;
+      strip_columns=1;
+      strips=image->rows;
     }
-  if (width < 3)
+  GetRecursiveGaussian(sigma,&info);
+  weights=MagickAllocateResourceLimitedArray(double *,(size_t) length+info.tail,
+                                             sizeof(double));
+  data_set=AllocateThreadViewDataArray(image,exception,
+                                       4*((size_t) length+info.tail),
+                                       sizeof(double));
+  if ((weights == (double *) NULL) || (data_set == (ThreadViewDataSet *) NULL))
     {
-      MagickFreeResourceLimitedMemory(kernel);
-      ThrowImageException3(OptionError,UnableToBlurImage,
-                           KernelRadiusIsTooSmall);
+      ThrowException(exception,ResourceLimitError,MemoryAllocationFailed,
+                     MagickMsg(OptionError,UnableToBlurImage));
+      status=MagickFail;
     }
 
-  blur_image=RotateImage(original_image,90,exception);
-  if (blur_image == (Image *) NULL)
-    status=MagickFail;
-
   if (status != MagickFail)
-    blur_image->storage_class=DirectClass;
+    {
+      unsigned long
+        row_count=0;
 
-  if (status != MagickFail)
-    status&=BlurImageScanlines(blur_image,kernel,width,BlurImageColumnsText,
-                               exception);
+      MagickBool
+        monitor_active;
 
-  if (status != MagickFail)
-  {
-    Image
-      *rotate_image;
+      long
+        strip;
 
-    rotate_image=RotateImage(blur_image,-90,exception);
-    if (rotate_image == (Image *) NULL)
-      status=MagickFail;
+      unsigned long
+        i;
 
-    if (status != MagickFail)
-      {
-        DestroyImage(blur_image);
-        blur_image=rotate_image;
-      }
-  }
+      /*
+        Compute the renormalization weights.
+      */
+      for (i=0; i < length; i++)
+        weights[i]=1.0;
+      RecursiveGaussianScanline(&info,weights,length);
+      for (i=0; i < length; i++)
+        weights[i]=1.0/weights[i];
 
-  if (status != MagickFail)
-    status&=BlurImageScanlines(blur_image,kernel,width,BlurImageRowsText,
-                               exception);
+      monitor_active=MagickMonitorActive();
 
-  MagickFreeResourceLimitedMemory(kernel);
+#if defined(HAVE_OPENMP)
+#  if defined(TUNE_OPENMP)
+#    pragma omp parallel for schedule(runtime) shared(row_count, status)
+#  else
+#    pragma omp parallel for schedule(guided) shared(row_count, status)
+#  endif
+#endif
+      for (strip=0; strip < (long) strips; strip++)
+        {
+          register PixelPacket
+            *q;
 
-  if (blur_image != (Image *) NULL)
-    blur_image->is_grayscale=original_image->is_grayscale;
+          double
+            *values;
+
+          unsigned long
+            columns;
+
+          MagickBool
+            thread_status;
+
+          thread_status=status;
+          if (thread_status == MagickFail)
+            continue;
+
+          values=AccessThreadViewData(data_set);
+          if (vertical)
+            {
+              columns=Min(strip_columns,image->columns-strip*strip_columns);
+              q=GetImagePixelsEx(image,strip*strip_columns,0,columns,
+                                 image->rows,exception);
+            }
+          else
+            {
+              columns=1;
+              q=GetImagePixelsEx(image,0,strip,image->columns,1,exception);
+            }
+          if (q == (PixelPacket *) NULL)
+            thread_status=MagickFail;
+
+          if (thread_status != MagickFail)
+            {
+              double
+                *red,
+                *green,
+                *blue,
+                *opacity;
+
+              MagickBool
+                modified=MagickFalse;
+
+              unsigned long
+                j,
+                x;
+
+              red=values;
+              green=red+length+info.tail;
+              blue=green+length+info.tail;
+              opacity=blue+length+info.tail;
+              for (x=0; x < columns; x++)
+                {
+                  register PixelPacket
+                    *p;
+
+                  p=q+x;
+                  for (j=1; j < length; j++)
+                    if (NotPixelMatch(p,&p[j*columns],matte))
+                      break;
+                  if (j == length)
+                    continue;
+                  for (j=0; j < length; j++)
+                    {
+                      red[j]=p->red;
+                      green[j]=p->green;
+                      blue[j]=p->blue;
+                      if (matte)
+                        opacity[j]=p->opacity;
+                      p+=columns;
+                    }
+                  RecursiveGaussianScanline(&info,red,length);
+                  RecursiveGaussianScanline(&info,green,length);
+                  RecursiveGaussianScanline(&info,blue,length);
+                  if (matte)
+                    RecursiveGaussianScanline(&info,opacity,length);
+                  p=q+x;
+                  for (j=0; j < length; j++)
+                    {
+                      double
+                        value;
+
+                      value=weights[j]*red[j];
+                      p->red=RoundDoubleToQuantum(value);
+                      value=weights[j]*green[j];
+                      p->green=RoundDoubleToQuantum(value);
+                      value=weights[j]*blue[j];
+                      p->blue=RoundDoubleToQuantum(value);
+                      if (matte)
+                        {
+                          value=weights[j]*opacity[j];
+                          p->opacity=RoundDoubleToQuantum(value);
+                        }
+                      p+=columns;
+                    }
+                  modified=MagickTrue;
+                }
+              if (unsharp != (const UnsharpMaskOptions_t *) NULL)
+                {
+                  const PixelPacket
+                    *p;
+
+                  p=AcquireImagePixels(unsharp->image,0,strip,length,1,
+                                       exception);
+                  if (p == (const PixelPacket *) NULL)
+                    thread_status=MagickFail;
+                  else
+                    UnsharpMaskScanline(p,q,length,unsharp);
+                  modified=MagickTrue;
+                }
+              if (modified && (thread_status != MagickFail) &&
+                  !SyncImagePixelsEx(image,exception))
+                thread_status=MagickFail;
+            }
+
+          if (monitor_active)
+            {
+              unsigned long
+                thread_row_count;
+
+#if defined(HAVE_OPENMP)
+#  pragma omp atomic
+#endif
+              row_count++;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (row_count)
+#endif
+              thread_row_count=row_count;
+              if (QuantumTick(thread_row_count,strips))
+                if (!MagickMonitorFormatted(thread_row_count,strips,exception,
+                                            format,image->filename,width))
+                  thread_status=MagickFail;
+            }
+
+          if (thread_status == MagickFail)
+            {
+              status=MagickFail;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (status)
+#endif
+            }
+        }
+    }
+
+  DestroyThreadViewDataSet(data_set);
+  MagickFreeResourceLimitedMemory(weights);
+  image->is_grayscale=is_grayscale;
+
+  return status;
+}
+
+BlurMethod
+GetBlurMethod(const ImageInfo *image_info)
+{
+  const char
+    *value;
+
+  BlurMethod
+    method=KernelBlurMethod;
+
+  if ((value=AccessDefinition(image_info,"blur","method")) != (const char *) NULL)
+    {
+      if (LocaleCompare(value,"recursive") == 0)
+        method=RecursiveBlurMethod;
+      else if (LocaleCompare(value,"auto") == 0)
+        method=AutoBlurMethod;
+    }
+  return(method);
+}
+
+MagickBool
+IsRecursiveBlur(const double radius,const double sigma,
+                const BlurMethod method)
+{
+  if (method == KernelBlurMethod)
+    return(MagickFalse);
+  if (method == RecursiveBlurMethod)
+    return(MagickTrue);
+  return((BlurRecursiveSigma > 0.0) && (sigma >= BlurRecursiveSigma) &&
+         ((radius <= 0.0) || (radius >= 3.0*sigma)));
+}
+
+/*
+  Blur the image, and apply an unsharp mask while blurring its rows if
+  unsharp is not NULL.
+*/
+static Image *
+BlurImageUnsharpMask(const Image *original_image,const double radius,
+                     const double sigma,const UnsharpMaskOptions_t *unsharp,
+                     const BlurMethod method,ExceptionInfo *exception)
+{
+
+  double
+    *kernel;
+
+  Image
+    *blur_image;
+
+  int
+    width;
+
+  MagickBool
+    recursive;
+
+  MagickPassFail
+    status=MagickPass;
+
+  /*
+    Get convolution matrix for the specified standard-deviation.
+  */
+  assert(original_image != (Image *) NULL);
+  assert(original_image->signature == MagickSignature);
+  assert(exception != (ExceptionInfo *) NULL);
+  assert(exception->signature == MagickSignature);
+  kernel=(double *) NULL;
+  recursive=IsRecursiveBlur(radius,sigma,method);
+  if (recursive)
+    width=(int) (2*ceil(3.0*sigma)+1);
+  else if (radius > 0)
+    width=GetBlurKernel((int) (2*ceil(radius)+1),sigma,&kernel);
+  else
+    {
+      double
+        *last_kernel;
+
+      last_kernel=(double *) NULL;
+      width=GetBlurKernel(3,sigma,&kernel);
+      while ((long) (MaxRGB*kernel[0]) > 0)
+        {
+          if (last_kernel != (double *)NULL)
+            MagickFreeResourceLimitedMemory(last_kernel);
+          last_kernel=kernel;
+          kernel=(double *) NULL;
+          width=GetBlurKernel(width+2,sigma,&kernel);
+        }
+      if (last_kernel != (double *) NULL)
+        {
+          MagickFreeResourceLimitedMemory(kernel);
+          width-=2;
+          kernel=last_kernel;
+        }
+    }
+  if (width < 3)
+    {
+      MagickFreeResourceLimitedMemory(kernel);
+      ThrowImageException3(OptionError,UnableToBlurImage,
+                           KernelRadiusIsTooSmall);
+    }
+
+  blur_image=CloneImage(original_image,0,0,MagickTrue,exception);
+  if (blur_image == (Image *) NULL)
+    status=MagickFail;
+
+  if (status != MagickFail)
+    blur_image->storage_class=DirectClass;
+
+  if (status != MagickFail)
+    {
+      if (recursive)
+        status&=BlurImageScanlinesRecursive(blur_image,sigma,width,MagickTrue,
+                                            (const UnsharpMaskOptions_t *) NULL,
+                                            BlurImageColumnsText,exception);
+      else
+        status&=BlurImageScanlines(blur_image,kernel,width,MagickTrue,
+                                   (const UnsharpMaskOptions_t *) NULL,
+                                   BlurImageColumnsText,exception);
+    }
+
+  if (status != MagickFail)
+    {
+      if (recursive)
+        status&=BlurImageScanlinesRecursive(blur_image,sigma,width,MagickFalse,
+                                            unsharp,BlurImageRowsText,
+                                            exception);
+      else
+        status&=BlurImageScanlines(blur_image,kernel,width,MagickFalse,
+                                   unsharp,BlurImageRowsText,exception);
+    }
+
+  MagickFreeResourceLimitedMemory(kernel);
+
+  if ((status == MagickFail) && (blur_image != (Image *) NULL))
+    {
+      DestroyImage(blur_image);
+      blur_image=(Image *) NULL;
+    }
+
+  if (blur_image != (Image *) NULL)
+    blur_image->is_grayscale=original_image->is_grayscale;
 
   return(blur_image);
 }
+
+MagickExport Image *
+BlurImage(const Image *original_image,const double radius,
+          const double sigma,ExceptionInfo *exception)
+{
+  return BlurImageMethod(original_image,radius,sigma,KernelBlurMethod,
+                         exception);
+}
+
+Image *
+BlurImageMethod(const Image *original_image,const double radius,
+                const double sigma,const BlurMethod method,
+                ExceptionInfo *exception)
+{
+  return BlurImageUnsharpMask(original_image,radius,sigma,
+                              (const UnsharpMaskOptions_t *) NULL,method,
+                              exception);
+}
 
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -1259,9 +1797,859 @@ MagickExport MagickPassFail ChannelThresholdImage(Image *image,
       image->is_monochrome=True;
       image->is_grayscale=True;
     }
-  return status;
+  return status;
+}
+
+#define ConvolveImageText "[%s] Convolve: order %u..."
+
+/*
+  Accumulator types used by ConvolveImage().
+*/
+#if QuantumDepth < 32
+typedef float float_quantum_t;
+typedef FloatPixelPacket float_packet_t;
+#  define RoundFloatQuantumToIntQuantum(value) RoundFloatToQuantum(value)
+#else
+typedef double float_quantum_t;
+typedef DoublePixelPacket float_packet_t;
+#  define RoundFloatQuantumToIntQuantum(value) RoundDoubleToQuantum(value)
+#endif
+
+/*
+  Relative cost of one FFT butterfly compared with one multiply-add of
+  the direct convolution.  Used to decide when a kernel is large enough
+  for FFT convolution to be worthwhile.
+*/
+#define ConvolveFFTButterflyCost 8.0
+
+/*
+  The separable convolution keeps its floating point intermediate rows
+  for bands of output rows, each about ConvolveBandBytes in size, so that
+  its memory use does not grow with the image height and a band is still
+  cached when its columns are convolved.  Bands are at least
+  ConvolveBandMinKernels kernel widths high so that the rows convolved
+  twice at band edges add little work.
+*/
+#if !defined(ConvolveBandBytes)
+#  define ConvolveBandBytes 1048576
+#endif
+#define ConvolveBandMinKernels 4
+
+/*
+  Factor a square kernel into a column kernel and a row kernel whose
+  outer product is the kernel.  Returns MagickFalse if the kernel is not
+  separable (rank one).
+*/
+static MagickBool
+FactorConvolveKernel(const double *kernel,const long width,
+                     double *column_kernel,double *row_kernel)
+{
+  double
+    pivot,
+    tolerance;
+
+  long
+    i,
+    pivot_column,
+    pivot_row,
+    u,
+    v;
+
+  /*
+    Factor around the largest coefficient, and then verify the
+    factorization.
+  */
+  i=0;
+  for (u=1; u < (width*width); u++)
+    if (AbsoluteValue(kernel[u]) > AbsoluteValue(kernel[i]))
+      i=u;
+  pivot=kernel[i];
+  if (AbsoluteValue(pivot) <= MagickEpsilon)
+    return(MagickFalse);
+  pivot_row=i/width;
+  pivot_column=i%width;
+  for (v=0; v < width; v++)
+    column_kernel[v]=kernel[v*width+pivot_column];
+  for (u=0; u < width; u++)
+    row_kernel[u]=kernel[pivot_row*width+u]/pivot;
+  tolerance=1.0e-9*AbsoluteValue(pivot);
+  for (v=0; v < width; v++)
+    for (u=0; u < width; u++)
+      if (AbsoluteValue(kernel[v*width+u]-column_kernel[v]*row_kernel[u]) >
+          tolerance)
+        return(MagickFalse);
+  return(MagickTrue);
+}
+
+/*
+  Return the number of output rows in each band of the separable
+  convolution.
+*/
+static unsigned long
+GetConvolveBandRows(const Image *image,const long width,
+                    const unsigned int channels)
+{
+  unsigned long
+    minimum,
+    rows;
+
+  minimum=(unsigned long) width*ConvolveBandMinKernels;
+  rows=ConvolveBandBytes/(Max(image->columns,1)*channels*
+                          sizeof(float_quantum_t));
+  rows=(rows > (unsigned long) width-1) ? rows-((unsigned long) width-1) : 0;
+  rows=Max(rows,minimum);
+  return Min(rows,image->rows);
+}
+
+/*
+  Convolve an image with a separable kernel, as a pass along the rows
+  followed by a pass along the columns, for one band of band_rows output
+  rows at a time.  The intermediate result of a band is kept in floating
+  point in 'buffer', which holds band_rows+width-1 rows, including
+  width/2 rows of virtual pixels above and below the image, so the
+  result matches a direct convolution.
+*/
+static MagickPassFail
+ConvolveImageSeparable(const Image *image,Image *convolve_image,
+                       const long width,const double *column_kernel,
+                       const double *row_kernel,const unsigned int channels,
+                       float_quantum_t * restrict buffer,
+                       const unsigned long band_rows,
+                       const unsigned int order,ExceptionInfo *exception)
+{
+  float_quantum_t
+    * restrict column_k,
+    * restrict row_k;
+
+  long
+    band,
+    buffer_rows,
+    rows,
+    y;
+
+  size_t
+    stride;
+
+  ThreadViewDataSet
+    *accumulators;
+
+  unsigned long
+    row_count=0,
+    total_rows;
+
+  MagickBool
+    monitor_active;
+
+  MagickPassFail
+    status=MagickPass;
+
+  stride=(size_t) image->columns*channels;
+  total_rows=2*image->rows+(image->rows+band_rows-1)/band_rows*
+    ((unsigned long) width-1);
+  column_k=MagickAllocateArray(float_quantum_t *,width,sizeof(float_quantum_t));
+  row_k=MagickAllocateArray(float_quantum_t *,width,sizeof(float_quantum_t));
+  accumulators=AllocateThreadViewDataArray(image,exception,stride,
+                                           sizeof(float_quantum_t));
+  if ((column_k == (float_quantum_t *) NULL) ||
+      (row_k == (float_quantum_t *) NULL) ||
+      (accumulators == (ThreadViewDataSet *) NULL))
+    {
+      MagickFreeMemory(column_k);
+      MagickFreeMemory(row_k);
+      DestroyThreadViewDataSet(accumulators);
+      ThrowException(exception,ResourceLimitError,MemoryAllocationFailed,
+                     MagickMsg(OptionError,UnableToConvolveImage));
+      return(MagickFail);
+    }
+  for (y=0; y < width; y++)
+    {
+      column_k[y]=(float_quantum_t) column_kernel[y];
+      row_k[y]=(float_quantum_t) row_kernel[y];
+    }
+
+  monitor_active=MagickMonitorActive();
+
+  for (band=0; (status != MagickFail) && (band < (long) image->rows);
+       band+=(long) band_rows)
+    {
+      rows=Min((long) band_rows,(long) image->rows-band);
+      buffer_rows=rows+width-1;
+
+      /*
+        Convolve the rows of the band into the intermediate buffer.
+      */
+#if defined(HAVE_OPENMP)
+#  if defined(TUNE_OPENMP)
+#    pragma omp parallel for schedule(runtime) shared(row_count, status)
+#  else
+#    pragma omp parallel for schedule(guided) shared(row_count, status)
+#  endif
+#endif
+      for (y=0; y < buffer_rows; y++)
+        {
+          const PixelPacket
+            * restrict p;
+
+          float_quantum_t
+            * restrict b;
+
+          long
+            u,
+            x;
+
+          MagickPassFail
+            thread_status;
+
+          thread_status=status;
+          if (thread_status == MagickFail)
+            continue;
+
+          p=AcquireImagePixels(image,-width/2,band+y-width/2,
+                               image->columns+width-1,1,exception);
+          if (p == (const PixelPacket *) NULL)
+            thread_status=MagickFail;
+
+          if (thread_status != MagickFail)
+            {
+              b=buffer+(size_t) y*stride;
+              for (x=0; x < (long) image->columns; x++)
+                {
+                  float_packet_t
+                    pixel;
+
+                  const PixelPacket
+                    * restrict r;
+
+                  r=p+x;
+                  pixel.red=pixel.green=pixel.blue=pixel.opacity=0.0;
+                  if (channels == 1)
+                    {
+                      for (u=0; u < width; u++)
+                        pixel.red+=row_k[u]*r[u].red;
+                      *b++=pixel.red;
+                    }
+                  else if (channels == 3)
+                    {
+                      for (u=0; u < width; u++)
+                        {
+                          pixel.red+=row_k[u]*r[u].red;
+                          pixel.green+=row_k[u]*r[u].green;
+                          pixel.blue+=row_k[u]*r[u].blue;
+                        }
+                      *b++=pixel.red;
+                      *b++=pixel.green;
+                      *b++=pixel.blue;
+                    }
+                  else
+                    {
+                      for (u=0; u < width; u++)
+                        {
+                          pixel.red+=row_k[u]*r[u].red;
+                          pixel.green+=row_k[u]*r[u].green;
+                          pixel.blue+=row_k[u]*r[u].blue;
+                          pixel.opacity+=row_k[u]*r[u].opacity;
+                        }
+                      *b++=pixel.red;
+                      *b++=pixel.green;
+                      *b++=pixel.blue;
+                      *b++=pixel.opacity;
+                    }
+                }
+            }
+
+          if (monitor_active)
+            {
+              unsigned long
+                thread_row_count;
+
+#if defined(HAVE_OPENMP)
+#  pragma omp atomic
+#endif
+              row_count++;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (row_count)
+#endif
+              thread_row_count=row_count;
+              if (QuantumTick(thread_row_count,total_rows))
+                if (!MagickMonitorFormatted(thread_row_count,total_rows,
+                                            exception,ConvolveImageText,
+                                            convolve_image->filename,order))
+                  thread_status=MagickFail;
+            }
+
+          if (thread_status == MagickFail)
+            {
+              status=MagickFail;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (status)
+#endif
+            }
+        }
+      if (status == MagickFail)
+        break;
+
+      /*
+        Convolve the columns of the intermediate buffer into the image.
+      */
+#if defined(HAVE_OPENMP)
+#  if defined(TUNE_OPENMP)
+#    pragma omp parallel for schedule(runtime) shared(row_count, status)
+#  else
+#    pragma omp parallel for schedule(guided) shared(row_count, status)
+#  endif
+#endif
+      for (y=0; y < rows; y++)
+        {
+          const float_quantum_t
+            * restrict a;
+
+          float_quantum_t
+            * restrict accumulator;
+
+          PixelPacket
+            * restrict q;
+
+          size_t
+            i;
+
+          long
+            v,
+            x;
+
+          MagickPassFail
+            thread_status;
+
+          thread_status=status;
+          if (thread_status == MagickFail)
+            continue;
+
+          accumulator=AccessThreadViewData(accumulators);
+          q=SetImagePixelsEx(convolve_image,0,band+y,convolve_image->columns,
+                             1,exception);
+          if (q == (PixelPacket *) NULL)
+            thread_status=MagickFail;
+
+          if (thread_status != MagickFail)
+            {
+              for (v=0; v < width; v++)
+                {
+                  const float_quantum_t
+                    * restrict b;
+
+                  const float_quantum_t
+                    k=column_k[v];
+
+                  b=buffer+((size_t) y+v)*stride;
+                  if (v == 0)
+                    for (i=0; i < stride; i++)
+                      accumulator[i]=k*b[i];
+                  else
+                    for (i=0; i < stride; i++)
+                      accumulator[i]+=k*b[i];
+                }
+              a=accumulator;
+              for (x=0; x < (long) convolve_image->columns; x++)
+                {
+                  if (channels == 1)
+                    {
+                      q->red=q->green=q->blue=
+                        RoundFloatQuantumToIntQuantum(a[0]);
+                      q->opacity=OpaqueOpacity;
+                    }
+                  else
+                    {
+                      q->red=RoundFloatQuantumToIntQuantum(a[0]);
+                      q->green=RoundFloatQuantumToIntQuantum(a[1]);
+                      q->blue=RoundFloatQuantumToIntQuantum(a[2]);
+                      if (channels == 4)
+                        q->opacity=RoundFloatQuantumToIntQuantum(a[3]);
+                      else
+                        q->opacity=OpaqueOpacity;
+                    }
+                  a+=channels;
+                  q++;
+                }
+              if (!SyncImagePixelsEx(convolve_image,exception))
+                thread_status=MagickFail;
+            }
+
+          if (monitor_active)
+            {
+              unsigned long
+                thread_row_count;
+
+#if defined(HAVE_OPENMP)
+#  pragma omp atomic
+#endif
+              row_count++;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (row_count)
+#endif
+              thread_row_count=row_count;
+              if (QuantumTick(thread_row_count,total_rows))
+                if (!MagickMonitorFormatted(thread_row_count,total_rows,
+                                            exception,ConvolveImageText,
+                                            convolve_image->filename,order))
+                  thread_status=MagickFail;
+            }
+
+          if (thread_status == MagickFail)
+            {
+              status=MagickFail;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (status)
+#endif
+            }
+        }
+    }
+  DestroyThreadViewDataSet(accumulators);
+  MagickFreeMemory(row_k);
+  MagickFreeMemory(column_k);
+  return(status);
+}
+
+/*
+  Tables for a square power-of-two fast Fourier transform, and the
+  transform of the convolution kernel.
+*/
+typedef struct _ConvolveFFTInfo
+{
+  unsigned long
+    size;
+
+  unsigned long
+    *bit_reverse;
+
+  double
+    *cosine,
+    *sine,
+    *kernel_real,
+    *kernel_imaginary;
+} ConvolveFFTInfo;
+
+/*
+  In-place radix-2 transform of one row of fft->size complex values.
+*/
+static void
+ConvolveFFT(const ConvolveFFTInfo *fft,double * restrict real,
+            double * restrict imaginary,const MagickBool inverse)
+{
+  unsigned long
+    i,
+    j,
+    k,
+    length,
+    n;
+
+  n=fft->size;
+  for (i=0; i < n; i++)
+    {
+      j=fft->bit_reverse[i];
+      if (j > i)
+        {
+          double
+            swap;
+
+          swap=real[i];
+          real[i]=real[j];
+          real[j]=swap;
+          swap=imaginary[i];
+          imaginary[i]=imaginary[j];
+          imaginary[j]=swap;
+        }
+    }
+  for (length=2; length <= n; length<<=1)
+    {
+      unsigned long
+        half,
+        step;
+
+      half=length >> 1;
+      step=n/length;
+      for (i=0; i < n; i+=length)
+        for (k=0; k < half; k++)
+          {
+            double
+              ti,
+              tr,
+              wi,
+              wr;
+
+            unsigned long
+              a,
+              b;
+
+            wr=fft->cosine[k*step];
+            wi=inverse ? fft->sine[k*step] : -fft->sine[k*step];
+            a=i+k;
+            b=a+half;
+            tr=wr*real[b]-wi*imaginary[b];
+            ti=wr*imaginary[b]+wi*real[b];
+            real[b]=real[a]-tr;
+            imaginary[b]=imaginary[a]-ti;
+            real[a]+=tr;
+            imaginary[a]+=ti;
+          }
+    }
+}
+
+/*
+  Two dimensional transform, as row transforms on either side of a
+  transpose.  A forward transform leaves the result transposed, and an
+  inverse transform of transposed data restores the original layout.
+  The inverse transform is not scaled.
+*/
+static void
+ConvolveFFT2D(const ConvolveFFTInfo *fft,double * restrict real,
+              double * restrict imaginary,const MagickBool inverse)
+{
+  unsigned long
+    i,
+    j,
+    n,
+    pass;
+
+  n=fft->size;
+  for (pass=0; pass < 2; pass++)
+    {
+      for (i=0; i < n; i++)
+        ConvolveFFT(fft,real+i*n,imaginary+i*n,inverse);
+      if (pass != 0)
+        break;
+      for (i=0; i < n; i++)
+        for (j=i+1; j < n; j++)
+          {
+            double
+              swap;
+
+            swap=real[i*n+j];
+            real[i*n+j]=real[j*n+i];
+            real[j*n+i]=swap;
+            swap=imaginary[i*n+j];
+            imaginary[i*n+j]=imaginary[j*n+i];
+            imaginary[j*n+i]=swap;
+          }
+    }
+}
+
+static void
+DestroyConvolveFFTInfo(ConvolveFFTInfo *fft)
+{
+  MagickFreeMemory(fft->bit_reverse);
+  MagickFreeMemory(fft->cosine);
+  MagickFreeMemory(fft->sine);
+  MagickFreeMemory(fft->kernel_real);
+  MagickFreeMemory(fft->kernel_imaginary);
+}
+
+/*
+  Select the FFT tile size with the lowest estimated cost for convolving
+  an image of the given dimensions, and return the estimated cost in
+  multiply-adds per channel and pixel.
+*/
+static unsigned long
+GetConvolveFFTSize(const long width,const unsigned long columns,
+                   const unsigned long rows,double *cost)
+{
+  unsigned long
+    best_size,
+    log2_size,
+    size;
+
+  best_size=0;
+  *cost=0.0;
+  for (size=16, log2_size=4; size <= 512; size<<=1, log2_size++)
+    {
+      double
+        tile_cost;
+
+      unsigned long
+        step,
+        tiles;
+
+      if (size < (unsigned long) 2*width)
+        continue;
+      step=size-width+1;
+      tiles=((columns+step-1)/step)*((rows+step-1)/step);
+      /*
+        A forward and an inverse transform per pair of channels.
+      */
+      tile_cost=((double) tiles*size*size*(2.0*log2_size+1.0)*
+                 ConvolveFFTButterflyCost)/(2.0*columns*rows);
+      if ((best_size == 0) || (tile_cost < *cost))
+        {
+          best_size=size;
+          *cost=tile_cost;
+        }
+      if (size >= 2*Max(columns,rows))
+        break;
+    }
+  return(best_size);
+}
+
+/*
+  Convolve an image using overlap-save FFT convolution on square tiles.
+  Each tile reads the tile plus the kernel apron, is transformed with
+  pairs of channels packed into the real and imaginary parts, multiplied
+  by the kernel transform, and transformed back.  Only the part of the
+  result which is not affected by wrap-around is stored.
+*/
+static MagickPassFail
+ConvolveImageFFT(const Image *image,Image *convolve_image,const long width,
+                 const double *kernel,const double normalize,
+                 const unsigned long size,const unsigned int channels,
+                 const unsigned int order,ExceptionInfo *exception)
+{
+  ConvolveFFTInfo
+    fft;
+
+  long
+    tile;
+
+  size_t
+    plane;
+
+  ThreadViewDataSet
+    *scratch;
+
+  unsigned long
+    i,
+    j,
+    log2_size,
+    row_count=0,
+    step,
+    tiles,
+    tiles_x;
+
+  MagickBool
+    monitor_active;
+
+  MagickPassFail
+    status=MagickPass;
+
+  (void) memset(&fft,0,sizeof(fft));
+  fft.size=size;
+  plane=(size_t) size*size;
+  fft.bit_reverse=MagickAllocateArray(unsigned long *,size,
+                                      sizeof(unsigned long));
+  fft.cosine=MagickAllocateArray(double *,size/2,sizeof(double));
+  fft.sine=MagickAllocateArray(double *,size/2,sizeof(double));
+  fft.kernel_real=MagickAllocateArray(double *,plane,sizeof(double));
+  fft.kernel_imaginary=MagickAllocateArray(double *,plane,sizeof(double));
+  scratch=AllocateThreadViewDataArray(image,exception,4*plane,sizeof(double));
+  if ((fft.bit_reverse == (unsigned long *) NULL) ||
+      (fft.cosine == (double *) NULL) || (fft.sine == (double *) NULL) ||
+      (fft.kernel_real == (double *) NULL) ||
+      (fft.kernel_imaginary == (double *) NULL) ||
+      (scratch == (ThreadViewDataSet *) NULL))
+    {
+      DestroyConvolveFFTInfo(&fft);
+      DestroyThreadViewDataSet(scratch);
+      ThrowException(exception,ResourceLimitError,MemoryAllocationFailed,
+                     MagickMsg(OptionError,UnableToConvolveImage));
+      return(MagickFail);
+    }
+  for (log2_size=0; (1UL << log2_size) < size; log2_size++);
+  for (i=0; i < size; i++)
+    {
+      unsigned long
+        reverse;
+
+      reverse=0;
+      for (j=0; j < log2_size; j++)
+        if (i & (1UL << j))
+          reverse|=1UL << (log2_size-1-j);
+      fft.bit_reverse[i]=reverse;
+    }
+  for (i=0; i < size/2; i++)
+    {
+      fft.cosine[i]=cos(2.0*MagickPI*i/size);
+      fft.sine[i]=sin(2.0*MagickPI*i/size);
+    }
+
+  /*
+    Transform the kernel, rotated by 180 degrees so that the circular
+    convolution computes the same sums as the direct convolution, and
+    scaled to normalize the kernel and the inverse transform.
+  */
+  (void) memset(fft.kernel_real,0,plane*sizeof(double));
+  (void) memset(fft.kernel_imaginary,0,plane*sizeof(double));
+  for (i=0; i < (unsigned long) width; i++)
+    for (j=0; j < (unsigned long) width; j++)
+      fft.kernel_real[i*size+j]=normalize*
+        kernel[(width-1-i)*width+(width-1-j)]/((double) plane);
+  ConvolveFFT2D(&fft,fft.kernel_real,fft.kernel_imaginary,MagickFalse);
+
+  step=size-width+1;
+  tiles_x=(image->columns+step-1)/step;
+  tiles=tiles_x*((image->rows+step-1)/step);
+  monitor_active=MagickMonitorActive();
+
+#if defined(HAVE_OPENMP)
+#  if defined(TUNE_OPENMP)
+#    pragma omp parallel for schedule(runtime) shared(row_count, status)
+#  else
+#    pragma omp parallel for schedule(dynamic) shared(row_count, status)
+#  endif
+#endif
+  for (tile=0; tile < (long) tiles; tile++)
+    {
+      const PixelPacket
+        * restrict p;
+
+      double
+        * restrict real[2],
+        * restrict imaginary[2];
+
+      PixelPacket
+        * restrict q;
+
+      long
+        x_offset,
+        y_offset;
+
+      unsigned long
+        k,
+        planes,
+        region_columns,
+        region_rows,
+        tile_columns,
+        tile_rows,
+        u,
+        v;
+
+      MagickPassFail
+        thread_status;
+
+      thread_status=status;
+      if (thread_status == MagickFail)
+        continue;
+
+      real[0]=AccessThreadViewData(scratch);
+      imaginary[0]=real[0]+plane;
+      real[1]=imaginary[0]+plane;
+      imaginary[1]=real[1]+plane;
+      planes=(channels == 1) ? 1 : 2;
+      x_offset=(long) ((tile % tiles_x)*step);
+      y_offset=(long) ((tile / tiles_x)*step);
+      tile_columns=Min(step,image->columns-x_offset);
+      tile_rows=Min(step,image->rows-y_offset);
+      region_columns=tile_columns+width-1;
+      region_rows=tile_rows+width-1;
+      p=AcquireImagePixels(image,x_offset-width/2,y_offset-width/2,
+                           region_columns,region_rows,exception);
+      if (p == (const PixelPacket *) NULL)
+        thread_status=MagickFail;
+
+      if (thread_status != MagickFail)
+        {
+          /*
+            Load the tile, with red and green in the first complex
+            plane, and blue and opacity in the second.
+          */
+          (void) memset(real[0],0,planes*2*plane*sizeof(double));
+          for (v=0; v < region_rows; v++)
+            for (u=0; u < region_columns; u++)
+              {
+                k=v*size+u;
+                real[0][k]=p->red;
+                if (channels > 1)
+                  {
+                    imaginary[0][k]=p->green;
+                    real[1][k]=p->blue;
+                    if (channels == 4)
+                      imaginary[1][k]=p->opacity;
+                  }
+                p++;
+              }
+          for (k=0; k < planes; k++)
+            {
+              double
+                * restrict re,
+                * restrict im;
+
+              size_t
+                n;
+
+              re=real[k];
+              im=imaginary[k];
+              ConvolveFFT2D(&fft,re,im,MagickFalse);
+              for (n=0; n < plane; n++)
+                {
+                  double
+                    t;
+
+                  t=re[n]*fft.kernel_real[n]-im[n]*fft.kernel_imaginary[n];
+                  im[n]=re[n]*fft.kernel_imaginary[n]+im[n]*fft.kernel_real[n];
+                  re[n]=t;
+                }
+              ConvolveFFT2D(&fft,re,im,MagickTrue);
+            }
+          q=SetImagePixelsEx(convolve_image,x_offset,y_offset,tile_columns,
+                             tile_rows,exception);
+          if (q == (PixelPacket *) NULL)
+            thread_status=MagickFail;
+          if (thread_status != MagickFail)
+            {
+              for (v=0; v < tile_rows; v++)
+                for (u=0; u < tile_columns; u++)
+                  {
+                    k=(v+width-1)*size+(u+width-1);
+                    q->red=RoundDoubleToQuantum(real[0][k]);
+                    if (channels == 1)
+                      {
+                        q->green=q->blue=q->red;
+                        q->opacity=OpaqueOpacity;
+                      }
+                    else
+                      {
+                        q->green=RoundDoubleToQuantum(imaginary[0][k]);
+                        q->blue=RoundDoubleToQuantum(real[1][k]);
+                        if (channels == 4)
+                          q->opacity=RoundDoubleToQuantum(imaginary[1][k]);
+                        else
+                          q->opacity=OpaqueOpacity;
+                      }
+                    q++;
+                  }
+              if (!SyncImagePixelsEx(convolve_image,exception))
+                thread_status=MagickFail;
+            }
+        }
+
+      if (monitor_active)
+        {
+          unsigned long
+            thread_row_count;
+
+#if defined(HAVE_OPENMP)
+#  pragma omp atomic
+#endif
+          row_count++;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (row_count)
+#endif
+          thread_row_count=row_count;
+          if (QuantumTick(thread_row_count,tiles))
+            if (!MagickMonitorFormatted(thread_row_count,tiles,exception,
+                                        ConvolveImageText,
+                                        convolve_image->filename,order))
+              thread_status=MagickFail;
+        }
+
+      if (thread_status == MagickFail)
+        {
+          status=MagickFail;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (status)
+#endif
+        }
+    }
+  DestroyThreadViewDataSet(scratch);
+  DestroyConvolveFFTInfo(&fft);
+  return(status);
 }
-
+
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
@@ -1291,22 +2679,43 @@ MagickExport MagickPassFail ChannelThresholdImage(Image *image,
 %
 %
 */
-#define ConvolveImageText "[%s] Convolve: order %u..."
 MagickExport Image *ConvolveImage(const Image * restrict image,const unsigned int order,
                                   const double * restrict kernel,ExceptionInfo *exception)
 {
-#if QuantumDepth < 32
-  typedef float float_quantum_t;
-  typedef FloatPixelPacket float_packet_t;
-#  define RoundFloatQuantumToIntQuantum(value) RoundFloatToQuantum(value)
-#else
-  typedef double float_quantum_t;
-  typedef DoublePixelPacket float_packet_t;
-#  define RoundFloatQuantumToIntQuantum(value) RoundDoubleToQuantum(value)
-#endif
+  return ConvolveImageMethod(image,order,kernel,AutoConvolveMethod,exception);
+}
+
+ConvolveMethod
+GetConvolveMethod(const ImageInfo *image_info)
+{
+  const char
+    *value;
+
+  ConvolveMethod
+    method=AutoConvolveMethod;
+
+  if ((value=AccessDefinition(image_info,"convolve","method")) != (const char *) NULL)
+    {
+      if (LocaleCompare(value,"direct") == 0)
+        method=DirectConvolveMethod;
+    }
+  return(method);
+}
+
+Image *
+ConvolveImageMethod(const Image * restrict image,const unsigned int order,
+                    const double * restrict kernel,const ConvolveMethod method,
+                    ExceptionInfo *exception)
+{
+  double
+    *column_kernel,
+    fft_cost,
+    normalize,
+    *row_kernel;
 
   float_quantum_t
-    * restrict normal_kernel;
+    * restrict normal_kernel,
+    * restrict separable_buffer;
 
   Image
     *convolve_image;
@@ -1315,6 +2724,16 @@ MagickExport Image *ConvolveImage(const Image * restrict image,const unsigned in
     width,
     y;
 
+  unsigned int
+    channels;
+
+  unsigned long
+    band_rows,
+    fft_size;
+
+  MagickBool
+    separable;
+
   MagickPassFail
     status;
 
@@ -1355,9 +2774,6 @@ MagickExport Image *ConvolveImage(const Image * restrict image,const unsigned in
       0x5    --> 41x41
       0x6    --> 49x49
     */
-    double
-      normalize;
-
     register long
       i;
 
@@ -1424,9 +2840,70 @@ MagickExport Image *ConvolveImage(const Image * restrict image,const unsigned in
 
   status=MagickPass;
   /*
-    Convolve image.
+    Select the convolution method.  Separable kernels are applied as a
+    row pass followed by a column pass, and other large kernels using FFT
+    convolution when that is estimated to be cheaper.  A separable kernel
+    is applied directly if its band buffer can not be allocated.
   */
+  channels=(is_grayscale && !matte) ? 1 : (matte ? 4 : 3);
+  column_kernel=(double *) NULL;
+  row_kernel=(double *) NULL;
+  separable_buffer=(float_quantum_t *) NULL;
+  band_rows=0;
+  fft_size=0;
+  separable=MagickFalse;
+  if ((width >= 5) && (method == AutoConvolveMethod))
+    {
+      column_kernel=MagickAllocateArray(double *,width,sizeof(double));
+      row_kernel=MagickAllocateArray(double *,width,sizeof(double));
+      if ((column_kernel != (double *) NULL) &&
+          (row_kernel != (double *) NULL) &&
+          FactorConvolveKernel(kernel,width,column_kernel,row_kernel))
+        {
+          for (y=0; y < width; y++)
+            column_kernel[y]*=normalize;
+          band_rows=GetConvolveBandRows(image,width,channels);
+          separable_buffer=MagickAllocateResourceLimitedArray(float_quantum_t *,
+            MagickArraySize((size_t) band_rows+width-1,
+                            (size_t) image->columns*channels),
+            sizeof(float_quantum_t));
+          if (separable_buffer != (float_quantum_t *) NULL)
+            separable=MagickTrue;
+          else
+            (void) LogMagickEvent(TransformEvent,GetMagickModule(),
+                                  "  Unable to allocate separable"
+                                  " convolution buffer");
+        }
+      else
+        {
+          fft_size=GetConvolveFFTSize(width,image->columns,image->rows,
+                                      &fft_cost);
+          if ((fft_size != 0) && (fft_cost >= (double) width*width))
+            fft_size=0;
+        }
+    }
+  if (separable)
+    {
+      (void) LogMagickEvent(TransformEvent,GetMagickModule(),
+                            "  Convolving with separable kernel in bands"
+                            " of %lu rows",band_rows);
+      status=ConvolveImageSeparable(image,convolve_image,width,column_kernel,
+                                    row_kernel,channels,separable_buffer,
+                                    band_rows,order,exception);
+    }
+  else if (fft_size != 0)
+    {
+      (void) LogMagickEvent(TransformEvent,GetMagickModule(),
+                            "  Convolving using %lux%lu FFT tiles",
+                            fft_size,fft_size);
+      status=ConvolveImageFFT(image,convolve_image,width,kernel,normalize,
+                              fft_size,channels,order,exception);
+    }
+  else
   {
+    /*
+      Convolve image directly.
+    */
     unsigned long
       row_count=0;
 
@@ -1591,6 +3068,9 @@ MagickExport Image *ConvolveImage(const Image * restrict image,const unsigned in
           }
       }
   }
+  MagickFreeMemory(column_kernel);
+  MagickFreeMemory(row_kernel);
+  MagickFreeResourceLimitedMemory(separable_buffer);
   MagickFreeAlignedMemory(normal_kernel);
   if (MagickFail == status)
     {
@@ -2345,6 +3825,19 @@ MagickExport Image *GaussianBlurImage(const Image *image,const double radius,
     blur_image->is_grayscale=image->is_grayscale;
   return(blur_image);
 }
+
+/*
+  The two dimensional Gaussian is separable, so the recursive filter of
+  BlurImage() applies to GaussianBlurImage() as well.
+*/
+Image *GaussianBlurImageMethod(const Image *image,const double radius,
+  const double sigma,const BlurMethod method,ExceptionInfo *exception)
+{
+  if (IsRecursiveBlur(radius,sigma,method))
+    return(BlurImageMethod(image,radius,sigma,RecursiveBlurMethod,
+                           exception));
+  return(GaussianBlurImage(image,radius,sigma,exception));
+}
 
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -2436,253 +3929,386 @@ MagickExport Image *GaussianBlurImageChannel(const Image *image,
 %
 */
 
-typedef struct _MedianListNode
-{
-  unsigned int
-    next[9],
-    count,
-    signature;
-} MedianListNode;
-
-typedef struct _MedianSkipList
-{
-  MedianListNode
-    *nodes;
-
-  int
-    level;
-} MedianSkipList;
+/*
+  Neighborhood medians are computed from histograms of the pixel
+  neighborhood, split into coarse bins of fine bins so that the median
+  is located by scanning a few coarse bins and then one coarse bin's fine
+  bins.  Values are ranked at 8 bit resolution for Q8 and at 16 bit
+  resolution otherwise, as the skip-lists previously used here did.
+
+  For Q8 the histogram of each image column over the rows of the
+  neighborhood is maintained, as described by Perreault and Hebert
+  ("Median Filtering in Constant Time").  The neighborhood histogram
+  moves along a row by adding one column histogram and subtracting
+  another, and its fine bins are only brought up to date when the median
+  search enters them, so the cost per pixel does not depend on the
+  radius.  Column histograms of 65536 fine bins would be too large, so
+  for other quantum depths the neighborhood histogram moves along the row
+  by adding and subtracting the pixels of the columns entering and
+  leaving it.
+*/
+#if QuantumDepth == 8
+#  define MedianHistogramBits 4
+#  define MedianValue(quantum) ((unsigned int) (quantum))
+#  define MedianQuantum(value) ((Quantum) (value))
+#else
+#  define MedianHistogramBits 8
+#  define MedianValue(quantum) ((unsigned int) ScaleQuantumToShort(quantum))
+#  define MedianQuantum(value) ScaleShortToQuantum(value)
+#endif
+#define MedianCoarseBins (1U << MedianHistogramBits)
+#define MedianFineBins (1U << MedianHistogramBits)
+#define MedianBins (MedianCoarseBins*MedianFineBins)
 
-typedef struct _MedianPixelList
+typedef struct _MedianHistogram
 {
-  MedianSkipList
-    lists[4];
+  unsigned int
+    coarse[4][MedianCoarseBins],
+    *fine;
 
   unsigned int
     center,
-    seed,
-    signature;
-} MedianPixelList;
+    total;
 
-static void AddNodeMedianList(MedianPixelList *pixel_list,
-                              const unsigned int channel,
-                              const unsigned int color)
-{
-  register MedianSkipList
-    *list;
+  long
+    columns,
+    width;
 
-  register int
-    level;
+#if QuantumDepth == 8
+  long
+    fine_x[4][MedianCoarseBins];
 
-  unsigned int
-    search,
-    update[9];
+  magick_uint16_t
+    *column_coarse,
+    *column_fine;
+#endif
+} MedianHistogram;
 
-  /*
-    Initialize the node.
-  */
-  list=pixel_list->lists+channel;
-  list->nodes[color].signature=pixel_list->signature;
-  list->nodes[color].count=1;
-  /*
-    Determine where it belongs in the list.
-    This loop consumes most of the time.
-  */
-  search=65536UL;
-  (void) memset(update, 0, sizeof(update));
-  for (level=list->level; level >= 0; level--)
+static void DestroyMedianHistogram(void *histogram_info)
+{
+  MedianHistogram
+    *histogram;
+
+  histogram=(MedianHistogram *) histogram_info;
+  if (histogram != (MedianHistogram *) NULL)
     {
-      while (list->nodes[search].next[level] < color)
-        search=list->nodes[search].next[level];
-      update[level]=search;
+      MagickFreeAlignedMemory(histogram->fine);
+#if QuantumDepth == 8
+      MagickFreeAlignedMemory(histogram->column_coarse);
+      MagickFreeAlignedMemory(histogram->column_fine);
+#endif
     }
-  /*
-    Generate a pseudo-random level for this node.
-  */
-  for (level=0; ; level++)
+  MagickFreeAlignedMemory(histogram);
+}
+
+static MedianHistogram *AllocateMedianHistogram(const unsigned long columns,
+                                                const long width)
+{
+  MedianHistogram
+    *histogram;
+
+  histogram=MagickAllocateAlignedMemory(MedianHistogram *,
+                                        MAGICK_CACHE_LINE_SIZE,
+                                        sizeof(MedianHistogram));
+  if (histogram == (MedianHistogram *) NULL)
+    return((MedianHistogram *) NULL);
+  (void) memset(histogram,0,sizeof(MedianHistogram));
+  histogram->columns=(long) columns+width-1;
+  histogram->width=width;
+  histogram->total=(unsigned int) (width*width);
+  histogram->center=histogram->total/2;
+  histogram->fine=MagickAllocateAlignedMemory(unsigned int *,
+                                              MAGICK_CACHE_LINE_SIZE,
+                                              MagickArraySize(4U*MedianBins,
+                                                              sizeof(unsigned int)));
+  if (histogram->fine == (unsigned int *) NULL)
     {
-      pixel_list->seed=(pixel_list->seed*42893621U)+1U;
-      if ((pixel_list->seed & 0x300) != 0x300)
-        break;
+      DestroyMedianHistogram(histogram);
+      return((MedianHistogram *) NULL);
     }
-  if (level > 8)
-    level=8;
-  if (level > (list->level+2))
-    level=list->level+2;
-  /*
-    If we're raising the list's level, link back to the root node.
-  */
-  while (level > list->level)
+  (void) memset(histogram->fine,0,4U*MedianBins*sizeof(unsigned int));
+#if QuantumDepth == 8
+  histogram->column_coarse=
+    MagickAllocateAlignedMemory(magick_uint16_t *,MAGICK_CACHE_LINE_SIZE,
+                                MagickArraySize((size_t) histogram->columns,
+                                                4U*MedianCoarseBins*
+                                                sizeof(magick_uint16_t)));
+  histogram->column_fine=
+    MagickAllocateAlignedMemory(magick_uint16_t *,MAGICK_CACHE_LINE_SIZE,
+                                MagickArraySize((size_t) histogram->columns,
+                                                4U*MedianBins*
+                                                sizeof(magick_uint16_t)));
+  if ((histogram->column_coarse == (magick_uint16_t *) NULL) ||
+      (histogram->column_fine == (magick_uint16_t *) NULL))
     {
-      list->level++;
-      update[list->level]=65536U;
+      DestroyMedianHistogram(histogram);
+      return((MedianHistogram *) NULL);
     }
-  /*
-    Link the node into the skip-list.
-  */
-  do
+#endif
+  return(histogram);
+}
+
+#if QuantumDepth == 8
+/*
+  Add (increment=1) or remove (increment=-1) a row of pixels to or from
+  the column histograms.
+*/
+static void UpdateMedianHistogramColumns(MedianHistogram *histogram,
+                                         const PixelPacket *pixels,
+                                         const int increment)
+{
+  long
+    x;
+
+  for (x=0; x < histogram->columns; x++)
     {
-      list->nodes[color].next[level]=list->nodes[update[level]].next[level];
-      list->nodes[update[level]].next[level]=color;
+      magick_uint16_t
+        *coarse,
+        *fine;
+
+      unsigned int
+        channel,
+        value[4];
+
+      value[0]=MedianValue(pixels[x].red);
+      value[1]=MedianValue(pixels[x].green);
+      value[2]=MedianValue(pixels[x].blue);
+      value[3]=MedianValue(pixels[x].opacity);
+      coarse=histogram->column_coarse+(size_t) x*4U*MedianCoarseBins;
+      fine=histogram->column_fine+(size_t) x*4U*MedianBins;
+      for (channel=0; channel < 4U; channel++)
+        {
+          coarse[channel*MedianCoarseBins+(value[channel] >> MedianHistogramBits)]+=
+            increment;
+          fine[channel*MedianBins+value[channel]]+=increment;
+        }
     }
-  while (level-- > 0);
 }
 
-static void GetMedianList(MedianPixelList * restrict pixel_list,PixelPacket *median_pixel)
+/*
+  Bring one coarse bin's fine bins of the neighborhood histogram up to
+  date for the neighborhood starting at column x.
+*/
+static void SyncMedianHistogram(MedianHistogram *histogram,
+                                const unsigned int channel,
+                                const unsigned int bin,const long x)
 {
-  register MedianSkipList
-    *list;
-
-  register unsigned int
-    channel;
+  const magick_uint16_t
+    *column;
 
   unsigned int
-    center,
-    color,
-    count;
+    *fine,
+    i;
+
+  long
+    c;
 
-  unsigned short
-    channels[4];
+  const size_t
+    offset = (size_t) channel*MedianBins+(size_t) bin*MedianFineBins,
+    stride = 4U*MedianBins;
 
-  /*
-    Find the median value for each of the colors.
-  */
-  center=pixel_list->center;
-  for (channel=0; channel < 4U; channel++)
+  if (histogram->fine_x[channel][bin] == x)
+    return;
+  fine=histogram->fine+offset;
+  if ((x < histogram->fine_x[channel][bin]) ||
+      ((x-histogram->fine_x[channel][bin]) >= histogram->width))
     {
-      list=pixel_list->lists+channel;
-      color=65536L;
-      count=0;
-      do
+      (void) memset(fine,0,MedianFineBins*sizeof(unsigned int));
+      column=histogram->column_fine+(size_t) x*stride+offset;
+      for (c=0; c < histogram->width; c++)
         {
-          color=list->nodes[color].next[0];
-          count+=list->nodes[color].count;
+          for (i=0; i < MedianFineBins; i++)
+            fine[i]+=column[i];
+          column+=stride;
         }
-      while (count <= center); /* IM now uses count <= (center >> 1) */
-      channels[channel]=color;
     }
-  median_pixel->red=ScaleShortToQuantum(channels[0]);
-  median_pixel->green=ScaleShortToQuantum(channels[1]);
-  median_pixel->blue=ScaleShortToQuantum(channels[2]);
-  median_pixel->opacity=ScaleShortToQuantum(channels[3]);
-}
-
-static inline void InsertMedianListChannel(MedianPixelList *pixel_list,
-                                           const unsigned int channel,
-                                           const Quantum quantum)
-{
-  register unsigned int
-    index;
-
-  index=ScaleQuantumToShort(quantum);
-  if (pixel_list->lists[channel].nodes[index].signature == pixel_list->signature)
-    pixel_list->lists[channel].nodes[index].count++;
   else
-    AddNodeMedianList(pixel_list,channel,index);
-}
-
-static inline void InsertMedianList(MedianPixelList *pixel_list,
-                                    const PixelPacket *pixel)
-{
-  InsertMedianListChannel(pixel_list,0,pixel->red);
-  InsertMedianListChannel(pixel_list,1,pixel->green);
-  InsertMedianListChannel(pixel_list,2,pixel->blue);
-  InsertMedianListChannel(pixel_list,3,pixel->opacity);
+    {
+      for (c=histogram->fine_x[channel][bin]+1; c <= x; c++)
+        {
+          const magick_uint16_t
+            *leaving;
+
+          leaving=histogram->column_fine+(size_t) (c-1)*stride+offset;
+          column=histogram->column_fine+(size_t) (c+histogram->width-1)*
+            stride+offset;
+          for (i=0; i < MedianFineBins; i++)
+            fine[i]+=(unsigned int) column[i]-leaving[i];
+        }
+    }
+  histogram->fine_x[channel][bin]=x;
 }
-
-static void ResetMedianList(MedianPixelList *pixel_list)
+#else
+/*
+  Add (increment=1) or remove (increment=-1) the pixels of one column of
+  the neighborhood to or from the histogram.
+*/
+static void UpdateMedianHistogramPixels(MedianHistogram *histogram,
+                                        const PixelPacket *pixels,
+                                        const size_t stride,
+                                        const int increment)
 {
-  register MedianListNode
-    *root;
-
-  register MedianSkipList
-    *list;
-
-  register long
-    channel;
-
-  int
-    level;
+  long
+    y;
 
-  /*
-    Reset the skip-list.
-  */
-  for (channel=0; channel < 4; channel++)
+  for (y=0; y < histogram->width; y++)
     {
-      list=pixel_list->lists+channel;
-      root=list->nodes+65536UL;
-      list->level=0;
-      for (level=0; level < 9; level++)
-        root->next[level]=65536UL;
+      unsigned int
+        value;
+
+      value=MedianValue(pixels->red);
+      histogram->coarse[0][value >> MedianHistogramBits]+=increment;
+      histogram->fine[value]+=increment;
+      value=MedianValue(pixels->green);
+      histogram->coarse[1][value >> MedianHistogramBits]+=increment;
+      histogram->fine[MedianBins+value]+=increment;
+      value=MedianValue(pixels->blue);
+      histogram->coarse[2][value >> MedianHistogramBits]+=increment;
+      histogram->fine[2U*MedianBins+value]+=increment;
+      value=MedianValue(pixels->opacity);
+      histogram->coarse[3][value >> MedianHistogramBits]+=increment;
+      histogram->fine[3U*MedianBins+value]+=increment;
+      pixels+=stride;
     }
-  pixel_list->seed=pixel_list->signature++;
 }
 
-static void DestroyMedianList(void *pixel_list)
+#  define SyncMedianHistogram(histogram,channel,bin,x)
+#endif
+
+/*
+  Return the median of one channel of the neighborhood starting at
+  column x.  If nonpeak is set, and the median is the smallest or largest
+  value in the neighborhood, the adjacent value present in the
+  neighborhood is returned instead (used by ReduceNoiseImage()).
+*/
+static unsigned int GetMedianHistogramValue(MedianHistogram *histogram,
+                                            const unsigned int channel,
+                                            const long x,
+                                            const MagickBool nonpeak)
 {
-  MedianPixelList
-    *skiplist;
+  const unsigned int
+    *coarse;
 
-  skiplist=(MedianPixelList *) pixel_list;
+  unsigned int
+    below,
+    bin,
+    count,
+    *fine,
+    i;
 
-  if (skiplist != (void *) NULL)
+  ARG_NOT_USED(x);
+  coarse=histogram->coarse[channel];
+  count=0;
+  for (bin=0; (count+coarse[bin]) <= histogram->center; bin++)
+    count+=coarse[bin];
+  SyncMedianHistogram(histogram,channel,bin,x);
+  fine=histogram->fine+(size_t) channel*MedianBins+(size_t) bin*MedianFineBins;
+  for (i=0; (count+fine[i]) <= histogram->center; i++)
+    count+=fine[i];
+  if (!nonpeak)
+    return(bin*MedianFineBins+i);
+  below=count;
+  if ((below == 0) && ((count+fine[i]) < histogram->total))
+    {
+      /*
+        The median is the smallest value; use the next larger value.
+      */
+      unsigned int
+        j;
+
+      for (j=i+1; j < MedianFineBins; j++)
+        if (fine[j] != 0)
+          return(bin*MedianFineBins+j);
+      for (bin++; coarse[bin] == 0; bin++);
+      SyncMedianHistogram(histogram,channel,bin,x);
+      fine=histogram->fine+(size_t) channel*MedianBins+(size_t) bin*MedianFineBins;
+      for (j=0; fine[j] == 0; j++);
+      return(bin*MedianFineBins+j);
+    }
+  if ((below != 0) && ((count+fine[i]) == histogram->total))
     {
+      /*
+        The median is the largest value; use the next smaller value.
+      */
       unsigned int
-        i;
-
-      for (i=0; i < 4U; i++)
-        MagickFreeAlignedMemory(skiplist->lists[i].nodes);
+        j;
+
+      for (j=i; j > 0; j--)
+        if (fine[j-1] != 0)
+          return(bin*MedianFineBins+j-1);
+      for (bin--; coarse[bin] == 0; bin--);
+      SyncMedianHistogram(histogram,channel,bin,x);
+      fine=histogram->fine+(size_t) channel*MedianBins+(size_t) bin*MedianFineBins;
+      for (j=MedianFineBins-1; fine[j] == 0; j--);
+      return(bin*MedianFineBins+j);
     }
-  MagickFreeAlignedMemory(skiplist);
+  return(bin*MedianFineBins+i);
 }
 
-static MedianPixelList *AllocateMedianList(const long width)
+/*
+  Filter one row given the neighborhood histogram set up for column 0.
+*/
+static void FilterMedianHistogramRow(MedianHistogram *histogram,
+                                     const PixelPacket *pixels,
+                                     const size_t stride,
+                                     PixelPacket *q,const unsigned long columns,
+                                     const MagickBool nonpeak)
 {
-  MedianPixelList
-    *skiplist;
+  long
+    x;
 
-  skiplist=MagickAllocateAlignedMemory(MedianPixelList *,
-                                       MAGICK_CACHE_LINE_SIZE,
-                                       sizeof(MedianPixelList));
-  if (skiplist != (MedianPixelList *) NULL)
+  ARG_NOT_USED(pixels);
+  ARG_NOT_USED(stride);
+  for (x=0; x < (long) columns; x++)
     {
-      unsigned int
-        i;
-
-      const size_t
-        node_list_size = 65537U*sizeof(MedianListNode);
-
-      (void) memset(skiplist,0,sizeof(MedianPixelList));
-      skiplist->center=width*width/2;
-      skiplist->signature=MagickSignature;
-      for (i=0; i < 4U; i++)
+      if (x > 0)
         {
-          skiplist->lists[i].nodes =
-            MagickAllocateAlignedMemory(MedianListNode *,MAGICK_CACHE_LINE_SIZE,
-                                        node_list_size);
-          if (skiplist->lists[i].nodes == (MedianListNode *) NULL)
-            {
-              DestroyMedianList(skiplist);
-              skiplist=(MedianPixelList *) NULL;
-              break;
-            }
-          (void) memset(skiplist->lists[i].nodes,0,node_list_size);
+#if QuantumDepth == 8
+          const magick_uint16_t
+            *entering,
+            *leaving;
+
+          unsigned int
+            channel,
+            i;
+
+          entering=histogram->column_coarse+
+            (size_t) (x+histogram->width-1)*4U*MedianCoarseBins;
+          leaving=histogram->column_coarse+(size_t) (x-1)*4U*MedianCoarseBins;
+          for (channel=0; channel < 4U; channel++)
+            for (i=0; i < MedianCoarseBins; i++)
+              histogram->coarse[channel][i]+=(unsigned int)
+                entering[channel*MedianCoarseBins+i]-
+                leaving[channel*MedianCoarseBins+i];
+#else
+          UpdateMedianHistogramPixels(histogram,pixels+x-1,stride,-1);
+          UpdateMedianHistogramPixels(histogram,pixels+x+histogram->width-1,
+                                      stride,1);
+#endif
         }
+      q->red=MedianQuantum(GetMedianHistogramValue(histogram,0,x,nonpeak));
+      q->green=MedianQuantum(GetMedianHistogramValue(histogram,1,x,nonpeak));
+      q->blue=MedianQuantum(GetMedianHistogramValue(histogram,2,x,nonpeak));
+      q->opacity=MedianQuantum(GetMedianHistogramValue(histogram,3,x,nonpeak));
+      q++;
     }
-  return skiplist;
 }
 
-MagickExport Image *MedianFilterImage(const Image *image,const double radius,
-                                      ExceptionInfo *exception)
+/*
+  Replace each pixel of filtered_image with the median (or non-peak
+  median) of the width x width neighborhood of the pixel in image.
+*/
+static MagickPassFail MedianFilterHistogram(const Image *image,
+                                            Image *filtered_image,
+                                            const long width,
+                                            const MagickBool nonpeak,
+                                            const char *monitor_text,
+                                            ExceptionInfo *exception)
 {
-#define MedianFilterImageText "[%s] Filter with neighborhood ranking..."
-
-  Image
-    *median_image;
-
   long
-    width,
-    y;
+    band,
+    number_bands,
+    band_rows;
 
   ThreadViewDataSet
     *data_set;
@@ -2696,26 +4322,7 @@ MagickExport Image *MedianFilterImage(const Image *image,const double radius,
   MagickPassFail
     status=MagickPass;
 
-  /*
-    Initialize median image attributes.
-  */
-  assert(image != (Image *) NULL);
-  assert(image->signature == MagickSignature);
-  assert(exception != (ExceptionInfo *) NULL);
-  assert(exception->signature == MagickSignature);
-  width=GetOptimalKernelWidth2D(radius,0.5);
-  if (((long) image->columns < width) || ((long) image->rows < width))
-    ThrowImageException3(OptionError,UnableToFilterImage,
-                         ImageSmallerThanRadius);
-  median_image=CloneImage(image,image->columns,image->rows,MagickTrue,exception);
-  if (median_image == (Image *) NULL)
-    return ((Image *) NULL);
-
-  median_image->storage_class=DirectClass;
-  /*
-    Allocate skip-lists.
-  */
-  data_set=AllocateThreadViewDataSet(DestroyMedianList,image,exception);
+  data_set=AllocateThreadViewDataSet(DestroyMedianHistogram,image,exception);
   if (data_set != (ThreadViewDataSet *) NULL)
     {
       unsigned int
@@ -2725,13 +4332,13 @@ MagickExport Image *MedianFilterImage(const Image *image,const double radius,
       views=GetThreadViewDataSetAllocatedViews(data_set);
       for (i=0; i < views; i++)
         {
-          MedianPixelList
-            *skiplist;
+          MedianHistogram
+            *histogram;
 
-          skiplist=AllocateMedianList(width);
-          if (skiplist != (MedianPixelList *) NULL)
+          histogram=AllocateMedianHistogram(image->columns,width);
+          if (histogram != (MedianHistogram *) NULL)
             {
-              AssignThreadViewData(data_set,i,skiplist);
+              AssignThreadViewData(data_set,i,histogram);
               continue;
             }
 
@@ -2742,104 +4349,230 @@ MagickExport Image *MedianFilterImage(const Image *image,const double radius,
     }
   if (data_set == (ThreadViewDataSet *) NULL)
     {
-      DestroyImage(median_image);
-      return ((Image *) NULL);
+      ThrowException(exception,ResourceLimitError,MemoryAllocationFailed,
+                     MagickMsg(OptionError,UnableToFilterImage));
+      return(MagickFail);
     }
+
+  /*
+    For Q8, bands of rows share column histograms, which are set up
+    once per band.  Use bands several times taller than the
+    neighborhood, but enough of them to keep the threads busy.
+  */
+#if QuantumDepth == 8
+  band_rows=Max(8*width,64);
+  band_rows=Min(band_rows,((long) image->rows+omp_get_max_threads()-1)/
+                omp_get_max_threads());
+  band_rows=Max(band_rows,1);
+#else
+  band_rows=1;
+#endif
+  number_bands=((long) image->rows+band_rows-1)/band_rows;
   monitor_active=MagickMonitorActive();
-  {
+
 #if defined(HAVE_OPENMP)
 #  if defined(TUNE_OPENMP)
 #    pragma omp parallel for schedule(runtime) shared(row_count, status)
 #  else
-#    pragma omp parallel for schedule(guided) shared(row_count, status)
+#    pragma omp parallel for schedule(dynamic) shared(row_count, status)
 #  endif
 #endif
-    for (y=0; y < (long) median_image->rows; y++)
-      {
-        register MedianPixelList
-          *skiplist;
+  for (band=0; band < number_bands; band++)
+    {
+      MedianHistogram
+        *histogram;
 
-        const PixelPacket
-          *p;
+      long
+        y,
+        y_start,
+        y_stop;
 
-        PixelPacket
-          *q;
+      MagickPassFail
+        thread_status;
 
-        long
-          x;
+      thread_status=status;
+      if (thread_status == MagickFail)
+        continue;
 
-        MagickBool
-          thread_status;
+      histogram=AccessThreadViewData(data_set);
+      y_start=band*band_rows;
+      y_stop=Min(y_start+band_rows,(long) image->rows);
+#if QuantumDepth == 8
+      (void) memset(histogram->column_coarse,0,(size_t) histogram->columns*
+                    4U*MedianCoarseBins*sizeof(magick_uint16_t));
+      (void) memset(histogram->column_fine,0,(size_t) histogram->columns*
+                    4U*MedianBins*sizeof(magick_uint16_t));
+      for (y=y_start-width/2; y < (y_start+width/2); y++)
+        {
+          const PixelPacket
+            *p;
 
-        thread_status=status;
-        if (thread_status == MagickFail)
-          continue;
+          p=AcquireImagePixels(image,-width/2,y,histogram->columns,1,exception);
+          if (p == (const PixelPacket *) NULL)
+            {
+              thread_status=MagickFail;
+              break;
+            }
+          UpdateMedianHistogramColumns(histogram,p,1);
+        }
+#endif
+      for (y=y_start; (thread_status != MagickFail) && (y < y_stop); y++)
+        {
+          const PixelPacket
+            *p;
 
-        skiplist=AccessThreadViewData(data_set);
-        p=AcquireImagePixels(image,-width/2,y-width/2,
-                             image->columns+width,width,exception);
-        q=SetImagePixelsEx(median_image,0,y,median_image->columns,1,exception);
-        if ((p == (const PixelPacket *) NULL) || (q == (PixelPacket *) NULL))
-          thread_status=MagickFail;
-        if (thread_status != MagickFail)
-          {
-            for (x=0; x < (long) median_image->columns; x++)
-              {
-                register const PixelPacket
-                  *r;
+          PixelPacket
+            *q;
 
-                register long
-                  u,
-                  v;
+#if QuantumDepth == 8
+          unsigned int
+            channel,
+            i;
+
+          long
+            x;
+
+          /*
+            Move the column histograms down to rows y-width/2 to
+            y+width/2.
+          */
+          if (y > y_start)
+            {
+              p=AcquireImagePixels(image,-width/2,y-width/2-1,
+                                   histogram->columns,1,exception);
+              if (p == (const PixelPacket *) NULL)
+                {
+                  thread_status=MagickFail;
+                  break;
+                }
+              UpdateMedianHistogramColumns(histogram,p,-1);
+            }
+          p=AcquireImagePixels(image,-width/2,y+width/2,histogram->columns,1,
+                               exception);
+          if (p == (const PixelPacket *) NULL)
+            {
+              thread_status=MagickFail;
+              break;
+            }
+          UpdateMedianHistogramColumns(histogram,p,1);
+          for (channel=0; channel < 4U; channel++)
+            {
+              for (i=0; i < MedianCoarseBins; i++)
+                {
+                  histogram->coarse[channel][i]=0;
+                  histogram->fine_x[channel][i]=(-width-1);
+                }
+              for (x=0; x < width; x++)
+                for (i=0; i < MedianCoarseBins; i++)
+                  histogram->coarse[channel][i]+=
+                    histogram->column_coarse[((size_t) x*4U+channel)*
+                                             MedianCoarseBins+i];
+            }
+          p=(const PixelPacket *) NULL;
+#else
+          long
+            x;
 
-                ResetMedianList(skiplist);
-                r=&p[x];
-                for (v=0; v < width; v++)
-                  {
-                    for (u=0; u < width; u++)
-                      InsertMedianList(skiplist,&r[u]);
-                    r+=(size_t) image->columns+width;
-                  }
-                GetMedianList(skiplist,&q[x]);
-              }
-            if (!SyncImagePixelsEx(median_image,exception))
+          p=AcquireImagePixels(image,-width/2,y-width/2,histogram->columns,
+                               width,exception);
+          if (p == (const PixelPacket *) NULL)
+            {
               thread_status=MagickFail;
-          }
-        if (monitor_active)
-          {
-            unsigned long
-              thread_row_count;
+              break;
+            }
+          for (x=0; x < width; x++)
+            UpdateMedianHistogramPixels(histogram,p+x,histogram->columns,1);
+#endif
+          q=SetImagePixelsEx(filtered_image,0,y,filtered_image->columns,1,
+                             exception);
+          if (q == (PixelPacket *) NULL)
+            thread_status=MagickFail;
+          else
+            {
+              FilterMedianHistogramRow(histogram,p,histogram->columns,q,
+                                       filtered_image->columns,nonpeak);
+              if (!SyncImagePixelsEx(filtered_image,exception))
+                thread_status=MagickFail;
+            }
+#if QuantumDepth != 8
+          /*
+            Empty the histogram by removing the last neighborhood.
+          */
+          for (x=(long) filtered_image->columns-1; x < histogram->columns; x++)
+            UpdateMedianHistogramPixels(histogram,p+x,histogram->columns,-1);
+#endif
+
+          if (monitor_active)
+            {
+              unsigned long
+                thread_row_count;
 
 #if defined(HAVE_OPENMP)
 #  pragma omp atomic
 #endif
-            row_count++;
+              row_count++;
 #if defined(HAVE_OPENMP)
 #  pragma omp flush (row_count)
 #endif
-            thread_row_count=row_count;
-            if (QuantumTick(thread_row_count,median_image->rows))
-              if (!MagickMonitorFormatted(thread_row_count,median_image->rows,exception,
-                                          MedianFilterImageText,
-                                          median_image->filename))
-                thread_status=MagickFail;
-          }
+              thread_row_count=row_count;
+              if (QuantumTick(thread_row_count,filtered_image->rows))
+                if (!MagickMonitorFormatted(thread_row_count,
+                                            filtered_image->rows,exception,
+                                            monitor_text,
+                                            filtered_image->filename))
+                  thread_status=MagickFail;
+            }
+        }
 
-        if (thread_status == MagickFail)
-          {
-            status=MagickFail;
+      if (thread_status == MagickFail)
+        {
+          status=MagickFail;
 #if defined(HAVE_OPENMP)
 #  pragma omp flush (status)
 #endif
-          }
-      }
-  }
+        }
+    }
   DestroyThreadViewDataSet(data_set);
-  if (median_image != (Image *) NULL)
-    median_image->is_grayscale=image->is_grayscale;
+  return(status);
+}
+
+MagickExport Image *MedianFilterImage(const Image *image,const double radius,
+                                      ExceptionInfo *exception)
+{
+#define MedianFilterImageText "[%s] Filter with neighborhood ranking..."
+
+  Image
+    *median_image;
+
+  long
+    width;
+
+  /*
+    Initialize median image attributes.
+  */
+  assert(image != (Image *) NULL);
+  assert(image->signature == MagickSignature);
+  assert(exception != (ExceptionInfo *) NULL);
+  assert(exception->signature == MagickSignature);
+  width=GetOptimalKernelWidth2D(radius,0.5);
+  if (((long) image->columns < width) || ((long) image->rows < width))
+    ThrowImageException3(OptionError,UnableToFilterImage,
+                         ImageSmallerThanRadius);
+  median_image=CloneImage(image,image->columns,image->rows,MagickTrue,exception);
+  if (median_image == (Image *) NULL)
+    return ((Image *) NULL);
+
+  median_image->storage_class=DirectClass;
+  if (MedianFilterHistogram(image,median_image,width,MagickFalse,
+                            MedianFilterImageText,exception) == MagickFail)
+    {
+      DestroyImage(median_image);
+      return ((Image *) NULL);
+    }
+  median_image->is_grayscale=image->is_grayscale;
   return(median_image);
 }
-
+
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
@@ -3656,59 +5389,6 @@ RandomChannelThresholdImage(Image *image,const char *channel,
 %
 */
 
-static PixelPacket GetNonpeakMedianList(MedianPixelList *pixel_list) MAGICK_FUNC_PURE;
-
-static PixelPacket GetNonpeakMedianList(MedianPixelList *pixel_list)
-{
-  PixelPacket
-    pixel;
-
-  register MedianSkipList
-    *list;
-
-  register long
-    channel;
-
-  unsigned long
-    channels[4],
-    center,
-    color,
-    count,
-    previous,
-    next;
-
-  /*
-    Finds the median value for each of the color.
-  */
-  center=pixel_list->center;
-  for (channel=0; channel < 4; channel++)
-  {
-    list=pixel_list->lists+channel;
-    color=65536L;
-    next=list->nodes[color].next[0];
-    count=0;
-    do
-    {
-      previous=color;
-      color=next;
-      next=list->nodes[color].next[0];
-      count+=list->nodes[color].count;
-    }
-    while (count <= center);
-    if ((previous == 65536L) && (next != 65536L))
-      color=next;
-    else
-      if ((previous != 65536L) && (next == 65536L))
-        color=previous;
-    channels[channel]=color;
-  }
-  pixel.red=ScaleShortToQuantum(channels[0]);
-  pixel.green=ScaleShortToQuantum(channels[1]);
-  pixel.blue=ScaleShortToQuantum(channels[2]);
-  pixel.opacity=ScaleShortToQuantum(channels[3]);
-  return(pixel);
-}
-
 MagickExport Image *ReduceNoiseImage(const Image *image,const double radius,
                                      ExceptionInfo *exception)
 {
@@ -3718,20 +5398,7 @@ MagickExport Image *ReduceNoiseImage(const Image *image,const double radius,
     *noise_image;
 
   long
-    width,
-    y;
-
-  ThreadViewDataSet
-    *data_set;
-
-  unsigned long
-    row_count=0;
-
-  MagickBool
-    monitor_active;
-
-  MagickPassFail
-    status=MagickPass;
+    width;
 
   /*
     Initialize noise image attributes.
@@ -3749,136 +5416,16 @@ MagickExport Image *ReduceNoiseImage(const Image *image,const double radius,
     return ((Image *) NULL);
 
   noise_image->storage_class=DirectClass;
-  /*
-    Allocate and initialize skip-lists.
-  */
-  data_set=AllocateThreadViewDataSet(DestroyMedianList,image,exception);
-  if (data_set != (ThreadViewDataSet *) NULL)
-    {
-      unsigned int
-        i,
-        views;
-
-      views=GetThreadViewDataSetAllocatedViews(data_set);
-      for (i=0; i < views; i++)
-        {
-          MedianPixelList
-            *skiplist;
-
-          skiplist=AllocateMedianList(width);
-          if (skiplist != (MedianPixelList *) NULL)
-            {
-              AssignThreadViewData(data_set,i,skiplist);
-              continue;
-            }
-
-          DestroyThreadViewDataSet(data_set);
-          data_set=(ThreadViewDataSet *) NULL;
-          break;
-        }
-    }
-  if (data_set == (ThreadViewDataSet *) NULL)
+  if (MedianFilterHistogram(image,noise_image,width,MagickTrue,
+                            ReduceNoiseImageText,exception) == MagickFail)
     {
       DestroyImage(noise_image);
       return ((Image *) NULL);
     }
-
-  monitor_active=MagickMonitorActive();
-
-#if defined(HAVE_OPENMP)
-#  if defined(TUNE_OPENMP)
-#    pragma omp parallel for schedule(runtime) shared(row_count, status)
-#  else
-#    pragma omp parallel for schedule(guided) shared(row_count, status)
-#  endif
-#endif
-  for (y=0; y < (long) noise_image->rows; y++)
-    {
-      const PixelPacket
-        *p;
-
-      PixelPacket
-        *q;
-
-      long
-        x;
-
-      MedianPixelList
-        *skiplist;
-
-      MagickBool
-        thread_status;
-
-      thread_status=status;
-      if (thread_status == MagickFail)
-        continue;
-
-      skiplist=AccessThreadViewData(data_set);
-      p=AcquireImagePixels(image,-width/2,y-width/2,
-                           image->columns+width,width,exception);
-      q=SetImagePixelsEx(noise_image,0,y,noise_image->columns,1,exception);
-      if ((p == (const PixelPacket *) NULL) || (q == (PixelPacket *) NULL))
-        thread_status=MagickFail;
-      if (thread_status != MagickFail)
-        {
-          for (x=0; x < (long) noise_image->columns; x++)
-            {
-              register const PixelPacket
-                *r;
-
-              register long
-                u,
-                v;
-
-              r=p;
-              ResetMedianList(skiplist);
-              for (v=width; v > 0; v--)
-                {
-                  for (u=0; u < width; u++)
-                    InsertMedianList(skiplist,&r[u]);
-                  r+=(size_t) image->columns+width;
-                }
-              q[x]=GetNonpeakMedianList(skiplist);
-              p++;
-            }
-          if (!SyncImagePixelsEx(noise_image,exception))
-            thread_status=MagickFail;
-        }
-
-      if (monitor_active)
-        {
-          unsigned long
-            thread_row_count;
-
-#if defined(HAVE_OPENMP)
-#  pragma omp atomic
-#endif
-          row_count++;
-#if defined(HAVE_OPENMP)
-#  pragma omp flush (row_count)
-#endif
-          thread_row_count=row_count;
-          if (QuantumTick(thread_row_count,noise_image->rows))
-            if (!MagickMonitorFormatted(thread_row_count,noise_image->rows,exception,
-                                        ReduceNoiseImageText,
-                                        noise_image->filename))
-              thread_status=MagickFail;
-        }
-
-      if (thread_status == MagickFail)
-        {
-          status=MagickFail;
-#if defined(HAVE_OPENMP)
-#  pragma omp flush (status)
-#endif
-        }
-    }
-  DestroyThreadViewDataSet(data_set);
-  if (noise_image != (Image *) NULL)
-    noise_image->is_grayscale=image->is_grayscale;
+  noise_image->is_grayscale=image->is_grayscale;
   return(noise_image);
 }
-
+
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
@@ -4690,78 +6237,17 @@ MagickExport MagickPassFail ThresholdImage(Image *image,const double threshold)
 %
 */
 
-typedef struct _UnsharpMaskOptions_t
-{
-  double amount;    /* Difference multiplier */
-  double threshold; /* Scaled to MaxRGB/2 */
-} UnsharpMaskOptions_t;
-
-static inline Quantum UnsharpQuantum(const Quantum original, const Quantum sharpened,
-                                     const UnsharpMaskOptions_t* options)
-{
-  double
-    value;
-
-  Quantum
-    quantum;
-
-  quantum=original;
-  value=original-(double) sharpened;
-  if (AbsoluteValue(value) >= options->threshold)
-    {
-      value=original+(value*options->amount);
-      quantum=RoundDoubleToQuantum(value);
-    }
-
-  return quantum;
-}
-
-static MagickPassFail
-UnsharpMaskPixels(void *mutable_data,                /* User provided mutable data */
-                  const void *immutable_data,        /* User provided immutable data */
-                  const Image *source_image,         /* Source image */
-                  const PixelPacket *source_pixels,  /* Pixel row in source image */
-                  const IndexPacket *source_indexes, /* Pixel row indexes in source image */
-                  Image *update_image,               /* Update image */
-                  PixelPacket *update_pixels,        /* Pixel row in update image */
-                  IndexPacket *update_indexes,       /* Pixel row indexes in update image */
-                  const long npixels,                /* Number of pixels in row */
-                  ExceptionInfo *exception           /* Exception report */
-                  )
+MagickExport Image *UnsharpMaskImage(const Image *image,const double radius,
+  const double sigma,const double amount,const double threshold,
+  ExceptionInfo *exception)
 {
-  const UnsharpMaskOptions_t
-    *options = (const UnsharpMaskOptions_t *) immutable_data;
-
-  register long
-    i;
-
-  ARG_NOT_USED(mutable_data);
-  ARG_NOT_USED(source_image);
-  ARG_NOT_USED(source_indexes);
-  ARG_NOT_USED(update_image);
-  ARG_NOT_USED(update_indexes);
-  ARG_NOT_USED(exception);
-  for (i=0; i < npixels; i++)
-    {
-      update_pixels[i].red=UnsharpQuantum(source_pixels[i].red,
-                                          update_pixels[i].red,
-                                          options);
-      update_pixels[i].green=UnsharpQuantum(source_pixels[i].green,
-                                            update_pixels[i].green,
-                                            options);
-      update_pixels[i].blue=UnsharpQuantum(source_pixels[i].blue,
-                                           update_pixels[i].blue,
-                                           options);
-      update_pixels[i].opacity=UnsharpQuantum(source_pixels[i].opacity,
-                                              update_pixels[i].opacity,
-                                              options);
-    }
-  return MagickPass;
+  return UnsharpMaskImageMethod(image,radius,sigma,amount,threshold,
+                                KernelBlurMethod,exception);
 }
 
-MagickExport Image *UnsharpMaskImage(const Image *image,const double radius,
+Image *UnsharpMaskImageMethod(const Image *image,const double radius,
   const double sigma,const double amount,const double threshold,
-  ExceptionInfo *exception)
+  const BlurMethod method,ExceptionInfo *exception)
 {
   UnsharpMaskOptions_t
     options;
@@ -4769,24 +6255,16 @@ MagickExport Image *UnsharpMaskImage(const Image *image,const double radius,
   Image
     *sharp_image;
 
-  char
-    message[MaxTextExtent];
-
   assert(image != (const Image *) NULL);
   assert(image->signature == MagickSignature);
   assert(exception != (ExceptionInfo *) NULL);
-  sharp_image=BlurImage(image,radius,sigma,exception);
-  if (sharp_image == (Image *) NULL)
-    return((Image *) NULL);
+  options.image=image;
   options.amount=amount;
   options.threshold=(MaxRGBFloat*threshold)/2.0;
-  FormatString(message,"[%%s] Unsharp mask: amount %g, threshold %g...",
-               amount,threshold);
-  (void) PixelIterateDualModify(UnsharpMaskPixels,NULL,
-                                message,NULL,&options,
-                                image->columns,image->rows,image,0,0,
-                                sharp_image,
-                                0,0,exception);
+  sharp_image=BlurImageUnsharpMask(image,radius,sigma,&options,method,
+                                   exception);
+  if (sharp_image == (Image *) NULL)
+    return((Image *) NULL);
   sharp_image->is_grayscale=image->is_grayscale;
   return(sharp_image);
 }
@@ -1666,6 +1666,8 @@ MagickExport ResourceType StringToResourceType(const char *option)
     resource_type=ReadResource;
   else if (LocaleCompare("Write",option) == 0)
     resource_type=WriteResource;
+  else if (LocaleCompare("Fonts",option) == 0)
+    resource_type=FontsResource;
   return resource_type;
 }
 
@@ -451,6 +451,33 @@ MagickExport Image *AllocateImage(const ImageInfo *image_info)
   allocate_image->matte_color=image_info->matte_color;
   allocate_image->client_data=image_info->client_data;
   allocate_image->ping=image_info->ping;
+  {
+    const char
+      *value;
+
+    unsigned long
+      tile_columns,
+      tile_rows;
+
+    /*
+      Optional tiled pixel cache layout.
+    */
+    if ((value=AccessDefinition(image_info,"cache","tile-size")) !=
+        (const char *) NULL)
+      {
+        tile_columns=tile_rows=0;
+        if (sscanf(value,"%lux%lu",&tile_columns,&tile_rows) == 1)
+          tile_rows=tile_columns;
+        SetCacheTileSize(allocate_image->cache,tile_columns,tile_rows);
+      }
+    /*
+      Optional compressed in-memory pixel cache.
+    */
+    if ((value=AccessDefinition(image_info,"cache","compress")) !=
+        (const char *) NULL)
+      SetCacheCompression(allocate_image->cache,
+                          LocaleCompare(value,"TRUE") == 0);
+  }
 
   if (image_info->attributes != (Image *) NULL)
     {
@@ -1284,6 +1311,16 @@ MagickExport Image *CloneImage(const Image *image,const unsigned long columns,
   clone_image->rows=rows;
   clone_image->ping=image->ping;
   GetCacheInfo(&clone_image->cache);
+  {
+    unsigned long
+      tile_columns,
+      tile_rows;
+
+    GetCacheTileSize(image->cache,&tile_columns,&tile_rows);
+    SetCacheTileSize(clone_image->cache,tile_columns,tile_rows);
+    SetCacheCompression(clone_image->cache,
+                        GetCacheCompression(image->cache));
+  }
   clone_image->default_views=AllocateThreadViewSet(clone_image,exception);
   if ((clone_image->cache == (_CacheInfoPtr_) NULL) ||
       (clone_image->default_views == (_ThreadViewSetPtr_) NULL))
@@ -58,6 +58,7 @@
 #include "magick/registry.h"
 #include "magick/resource.h"
 #include "magick/render.h"
+#include "magick/resize.h"
 #include "magick/semaphore.h"
 #include "magick/tempfile.h"
 #include "magick/utility.h"
@@ -188,11 +189,13 @@ DestroyMagick(void)
 #endif
   DestroyColorInfo();           /* Color database */
   DestroyDelegateInfo();        /* External delegate information */
+  DestroyAnnotateInfo();        /* Font cache */
   DestroyTypeInfo();            /* Font information */
   /*DestroyMagicInfo();*/       /* File format detection */
   DestroyMagickInfoList();      /* Coder registrations + modules */
   DestroyConstitute();          /* Constitute semaphore */
   DestroyMagickRegistry();      /* Registered images */
+  DestroyResizeInfo();          /* Resize filter contributions */
   DestroyMagickResources();     /* Resource semaphore */
   DestroyMagickRandomGenerator(); /* Random number generator */
   DestroyTemporaryFiles();      /* Temporary files */
@@ -1306,11 +1309,14 @@ InitializeMagickEx(const char *path, unsigned int options,
     InitializeMagickSignalHandlers(); /* Signal handlers */
   InitializeTemporaryFiles();       /* Temporary files */
   InitializeMagickResources();      /* Resources */
+  InitializePixelCache();           /* Pixel cache defaults */
   InitializeMagickRegistry();       /* Image/blob registry */
   InitializeConstitute();           /* Constitute semaphore */
+  InitializeResizeInfo();           /* Resize filter contributions */
   InitializeMagickInfoList();       /* Coder registrations + modules */
   /*InitializeMagicInfo();*/        /* File format detection */
   InitializeTypeInfo();             /* Font information */
+  InitializeAnnotateInfo();         /* Font cache */
   InitializeDelegateInfo();         /* External delegate information */
   InitializeColorInfo();            /* Color database */
   InitializeMagickMonitor();        /* Progress monitor */
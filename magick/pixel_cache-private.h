@@ -60,6 +60,15 @@
   extern void
   DestroyCacheInfo(Cache cache);
 
+  /*
+    GetCacheCompression() returns MagickTrue if a compressed in-memory
+    pixel cache is used when the pixel cache does not fit in memory.
+
+    Used only by CloneImage().
+  */
+  extern MagickBool
+  GetCacheCompression(const Cache cache);
+
   /*
     GetCacheInfo() initializes the Cache structure.
 
@@ -68,6 +77,25 @@
   extern void
   GetCacheInfo(Cache *cache);
 
+  /*
+    GetCacheTileSize() returns the tile dimensions of a pixel cache
+    which uses a tiled storage layout (zero if stored in row order).
+
+    Used only by CloneImage().
+  */
+  extern void
+  GetCacheTileSize(const Cache cache,unsigned long *columns,
+                   unsigned long *rows);
+
+  /*
+    InitializePixelCache() reads the environment variables which select
+    the defaults of new pixel caches.
+
+    Used only by InitializeMagickEx().
+  */
+  extern MagickPassFail
+  InitializePixelCache(void);
+
   /*
     GetPixelCacheInCore() tests to see the pixel cache is based on
     allocated memory and therefore supports efficient random access.
@@ -120,6 +148,26 @@
   extern Cache
   ReferenceCache(Cache cache);
 
+  /*
+    SetCacheCompression() selects whether a pixel cache which has not
+    been opened yet is kept compressed in memory rather than on disk
+    when it does not fit in memory.
+
+    Used only by AllocateImage() and CloneImage().
+  */
+  extern void
+  SetCacheCompression(Cache cache,const MagickBool compress);
+
+  /*
+    SetCacheTileSize() selects a tiled storage layout for a pixel cache
+    which has not been opened yet (zero dimensions select row order).
+
+    Used only by AllocateImage() and CloneImage().
+  */
+  extern void
+  SetCacheTileSize(Cache cache,const unsigned long columns,
+                   const unsigned long rows);
+
   /*
     Check image dimensions to see if they exceed current limits.
   */
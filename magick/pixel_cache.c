@@ -141,9 +141,91 @@ typedef enum
   PingCache,      /* Cache is ignored */
   MemoryCache,    /* Cache is a heap memory allocation */
   DiskCache,      /* Cache is a file accessed via read/write */
-  MapCache        /* Cache is a file accessed via memory map */
+  MapCache,       /* Cache is a file accessed via memory map */
+  CompressedCache /* Cache is compressed blocks in heap memory */
 } CacheType;
 
+/*
+  Amount of disk cache data requested for read-ahead, or accumulated
+  before write-behind is started, once sequential access is detected.
+*/
+#define DiskCacheIOWindow ((magick_off_t) 8*1024*1024)
+
+/*
+  DiskCacheStream tracks one access pattern (pixel or index reads or
+  writes) to a disk cache file so that sequential transfers may be
+  overlapped with computation by the operating system.
+*/
+typedef struct _DiskCacheStream
+{
+  /* File offset following the previous transfer */
+  magick_off_t next;
+
+  /* End of requested read-ahead, or start of pending write-behind */
+  magick_off_t extent;
+
+  /* Start of the write-behind range which may still be in progress */
+  magick_off_t flushing;
+
+  /* Number of consecutive sequential transfers */
+  unsigned int sequential;
+} DiskCacheStream;
+
+/*
+  Width and height of the individually compressed blocks of a compressed
+  cache, and the number of uncompressed blocks kept in addition to one
+  row or column of blocks.
+*/
+#define CompressedCacheBlockSize 64
+#define CompressedCacheSlots 8
+
+/*
+  Compressed cache blocks are written to the cache file rather than kept
+  in memory, and no more slots are allocated, once they would leave less
+  than 1/CompressedCacheReserve of the memory resource limit for other
+  allocations, such as nexus staging.
+*/
+#define CompressedCacheReserve 4
+
+/*
+  CompressedBlock is one block of a compressed cache.  Block pixels are
+  followed by block indexes.  Blocks which have never been written have
+  no data and read as zero.  A block which is not kept in memory is
+  stored in the cache file instead, at offset block*block_length.
+*/
+typedef struct _CompressedBlock
+{
+  /* Compressed block, or the block itself if it does not compress */
+  unsigned char *data;
+
+  /* Length of block data */
+  size_t length;
+
+  /* Slot holding the uncompressed block, or -1 */
+  long slot;
+
+  /* MagickTrue if the block is stored in the cache file */
+  MagickBool on_disk;
+} CompressedBlock;
+
+/*
+  CompressedSlot holds one uncompressed block of a compressed cache.
+*/
+typedef struct _CompressedSlot
+{
+  /* Block held in this slot, or -1 */
+  long block;
+
+  /* Uncompressed block pixels, followed by block indexes */
+  PixelPacket *pixels;
+
+  /* MagickTrue if the block has been modified since it was uncompressed */
+  MagickBool dirty;
+
+  /* Time of last access, for least recently used replacement */
+  unsigned long stamp;
+} CompressedSlot;
+
 /*
   CacheInfo represents the underlying raster image.
 */
@@ -173,6 +255,18 @@ typedef struct _CacheInfo
   /* Image indexes are valid */
   MagickBool indexes_valid;
 
+  /* Tile width if pixels are stored as tiles (zero if stored by rows) */
+  unsigned long tile_columns;
+
+  /* Tile height if pixels are stored as tiles */
+  unsigned long tile_rows;
+
+  /* Number of tiles across the raster if pixels are stored as tiles */
+  unsigned long tiles_across;
+
+  /* Number of pixels in pixel storage (includes partial tile padding) */
+  magick_uint64_t storage_pixels;
+
   /* Total pixels limit */
   magick_uint64_t limit_pixels;
 
@@ -210,6 +304,49 @@ typedef struct _CacheInfo
   /* Open file handle for disk cache */
   int file;
 
+  /* Disk cache pixel and index read patterns */
+  DiskCacheStream read_stream[2];
+
+  /* Disk cache pixel and index write patterns */
+  DiskCacheStream write_stream[2];
+
+  /* MagickTrue if disk cache writes should be written back early */
+  MagickBool write_behind;
+
+  /* MagickTrue if a compressed cache may be used if memory is exhausted */
+  MagickBool compress;
+
+  /* Compressed cache blocks */
+  CompressedBlock *blocks;
+
+  /* Number of compressed cache blocks */
+  unsigned long number_blocks;
+
+  /* Number of compressed cache blocks across the image */
+  unsigned long blocks_across;
+
+  /* Length of an uncompressed block */
+  size_t block_length;
+
+  /* Image dimensions the compressed cache blocks were allocated for */
+  unsigned long compressed_columns;
+  unsigned long compressed_rows;
+
+  /* Uncompressed compressed cache blocks */
+  CompressedSlot *slots;
+
+  /* Number of compressed cache slots */
+  unsigned long number_slots;
+
+  /* Access counter for compressed cache slots */
+  unsigned long slot_clock;
+
+  /* Buffer for compressing compressed cache blocks */
+  unsigned char *compress_buffer;
+
+  /* Length of compress_buffer */
+  size_t compress_buffer_length;
+
   /* Image file name in form "filename[index]" (for use in logging) */
   char filename[MaxTextExtent];
 
@@ -429,6 +566,113 @@ FilePositionWrite(int file, const void *buffer,size_t length,magick_off_t offset
   return (ssize_t) total_count;
 }
 
+/*
+
+  Return the amount of physical memory in bytes, or zero if it is not
+  known.
+
+*/
+static magick_uint64_t
+DiskCachePhysicalMemory(void)
+{
+#if defined(HAVE_SYSCONF) && defined(_SC_PHYS_PAGES)
+  long
+    pages;
+
+  pages=sysconf(_SC_PHYS_PAGES);
+  if (pages > 0)
+    return (magick_uint64_t) pages*MagickGetMMUPageSize();
+#endif
+  return 0;
+}
+/*
+
+  Update the access pattern of 'stream' for a transfer of the file
+  range 'offset' to 'end'.  A transfer which starts at, or shortly
+  after, the end of the previous transfer (such as the next rows of a
+  region narrower than the image) is considered to be sequential.
+  Returns the number of consecutive sequential transfers.
+
+*/
+static unsigned int
+DiskCacheStreamUpdate(DiskCacheStream *stream,const magick_off_t offset,
+                      const magick_off_t end)
+{
+  if ((offset >= stream->next) && (offset-stream->next <= DiskCacheIOWindow))
+    stream->sequential++;
+  else
+    stream->sequential=0;
+  stream->next=end;
+  return stream->sequential;
+}
+/*
+
+  Ask the operating system to read ahead the disk cache data which
+  will be needed next while reads of 'stream' remain sequential, so
+  that disk reads overlap with the processing of the current rows.
+
+*/
+static void
+DiskCacheReadAhead(int file,DiskCacheStream *stream,const magick_off_t offset,
+                   const magick_off_t end)
+{
+  if (DiskCacheStreamUpdate(stream,offset,end) < 2)
+    {
+      stream->extent=end;
+      return;
+    }
+#if defined(HAVE_POSIX_FADVISE) && defined(POSIX_FADV_WILLNEED)
+  if (stream->extent < end)
+    stream->extent=end;
+  if (stream->extent-end < DiskCacheIOWindow/2)
+    {
+      (void) posix_fadvise(file,stream->extent,DiskCacheIOWindow,
+                           POSIX_FADV_WILLNEED);
+      stream->extent+=DiskCacheIOWindow;
+    }
+#else
+  ARG_NOT_USED(file);
+#endif
+}
+/*
+
+  While writes of 'stream' remain sequential, start writing each
+  accumulated window of dirty disk cache data back to disk and wait
+  for the previous window to complete.  This overlaps disk writes with
+  the processing of the following rows, while limiting the dirty data
+  of each stream to about two windows rather than allowing it to grow
+  until the whole system stalls on the kernel dirty page limit.
+
+*/
+static void
+DiskCacheWriteBehind(int file,DiskCacheStream *stream,const magick_off_t offset,
+                     const magick_off_t end)
+{
+  if (DiskCacheStreamUpdate(stream,offset,end) == 0)
+    {
+      stream->extent=offset;
+      stream->flushing=offset;
+      return;
+    }
+#if defined(SYNC_FILE_RANGE_WRITE)
+  if (end-stream->extent >= DiskCacheIOWindow)
+    {
+      (void) sync_file_range(file,stream->extent,end-stream->extent,
+                             SYNC_FILE_RANGE_WRITE);
+      if (stream->flushing < stream->extent)
+        (void) sync_file_range(file,stream->flushing,
+                               stream->extent-stream->flushing,
+                               SYNC_FILE_RANGE_WAIT_BEFORE |
+                               SYNC_FILE_RANGE_WRITE |
+                               SYNC_FILE_RANGE_WAIT_AFTER);
+      stream->flushing=stream->extent;
+      stream->extent=end;
+    }
+#else
+  ARG_NOT_USED(file);
+#endif
+}
+
 static NexusInfo *InitializeCacheNexus(NexusInfo * restrict nexus_info)
 {
   if (nexus_info != ((NexusInfo *) NULL))
@@ -574,6 +818,25 @@ static inline ViewInfo
 #if !defined(AccessDefaultCacheView)
 #  define AccessDefaultCacheView(image) AccessDefaultCacheViewInlined(image)
 #endif
+
+/*
+  Return the offset (in pixels) of pixel x,y within pixel storage.  When
+  the cache uses a tiled layout, pixels are stored tile by tile (each
+  tile in row order) so that vertically adjacent pixels are close
+  together.
+*/
+static inline magick_off_t
+CachePixelOffset(const CacheInfo * restrict cache_info,const long x,
+                 const long y)
+{
+  if (cache_info->tile_columns == 0)
+    return y*(magick_off_t) cache_info->columns+x;
+  return ((((magick_off_t) (y/cache_info->tile_rows))*cache_info->tiles_across+
+           x/cache_info->tile_columns)*cache_info->tile_columns*
+          cache_info->tile_rows+
+          (magick_off_t) (y % cache_info->tile_rows)*cache_info->tile_columns+
+          x % cache_info->tile_columns);
+}
 
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -647,15 +910,22 @@ SetNexus(const Image * restrict image,const long x,const long y,
 
   if ((cache_info->type != PingCache) &&
       (cache_info->type != DiskCache) &&
+      (cache_info->type != CompressedCache) &&
       (/* Region must entirely be in bounds of image raster */
        (x >= 0) && (y >= 0) && ((y+rows) <= cache_info->rows)
        ) &&
-      ((/* All/part of one row */
-        (rows == 1) && ((x+columns) <= cache_info->columns)
-        )
-       ||
-       (/* One or more full rows */
-        (x == 0) && (columns == cache_info->columns)
+      ((cache_info->tile_columns == 0) ?
+       ((/* All/part of one row */
+         (rows == 1) && ((x+columns) <= cache_info->columns)
+         )
+        ||
+        (/* One or more full rows */
+         (x == 0) && (columns == cache_info->columns)
+         )) :
+       (/* All/part of one row of one tile */
+        (rows == 1) && ((x+columns) <= cache_info->columns) &&
+        ((x/cache_info->tile_columns) ==
+         ((x+(long) columns-1)/cache_info->tile_columns))
         )) &&
       (*ImageGetClipMaskInlined(image) == (const Image *) NULL) &&
       (*ImageGetCompositeMaskInlined(image) == (const Image *) NULL))
@@ -666,7 +936,7 @@ SetNexus(const Image * restrict image,const long x,const long y,
       size_t
         offset;
 
-      offset=((size_t) y)*cache_info->columns+((size_t) x);
+      offset=(size_t) CachePixelOffset(cache_info,x,y);
 
       nexus_info->pixels=cache_info->pixels+offset;
       nexus_info->indexes=(IndexPacket *) NULL;
@@ -859,9 +1129,12 @@ SetNexus(const Image * restrict image,const long x,const long y,
           magick_off_t
             offset;
 
-          offset=y*(magick_off_t) cache_info->columns+x;
-          if (nexus_info->pixels == (cache_info->pixels+offset))
-            nexus_info->in_core=MagickTrue;
+          if ((x >= 0) && (y >= 0))
+            {
+              offset=CachePixelOffset(cache_info,x,y);
+              if (nexus_info->pixels == (cache_info->pixels+offset))
+                nexus_info->in_core=MagickTrue;
+            }
         }
     }
 
@@ -897,69 +1170,745 @@ SetNexus(const Image * restrict image,const long x,const long y,
 %    o pixels: SetCacheNexus() returns a pointer to the pixels if they are
 %      transferred, otherwise a NULL is returned.
 %
-%    o image: The image.
+%    o image: The image.
+%
+%    o x,y,columns,rows:  These values define the perimeter of a region of
+%      pixels.
+%
+%    o nexus_info: specifies which cache nexus to set.
+%
+%    o exception: any error is reported here.
+%
+*/
+static PixelPacket *
+SetCacheNexus(Image *image,const long x,const long y,
+              const unsigned long columns,const unsigned long rows,
+              NexusInfo *nexus_info,ExceptionInfo *exception)
+{
+  PixelPacket
+    *pixels;
+
+  assert(image != (Image *) NULL);
+  assert(image->signature == MagickSignature);
+  pixels=(PixelPacket *) NULL;
+#if 0
+  {
+    const CacheInfo
+      * restrict cache_info = (const CacheInfo * restrict) image->cache;
+
+    if ((cache_info->reference_count != 1) || (cache_info->read_only))
+      fprintf(stderr,"SetCacheNexus: Thread %d enters (cache_info = %p, reference_count=%lu, read_only=%u)\n",
+              omp_get_thread_num(),image->cache, cache_info->reference_count, cache_info->read_only);
+#if 0
+    if (cache_info->type == UndefinedCache)
+      fprintf(stderr,"SetCacheNexus: Pixel cache is not open!\n");
+#endif
+    if ((cache_info->storage_class != UndefinedClass) &&
+        (image->storage_class != cache_info->storage_class))
+      fprintf(stderr,"SetCacheNexus: Pixel cache storage class mismatch! (image: %s, cache: %s)\n",
+              ClassTypeToString(image->storage_class),ClassTypeToString(cache_info->storage_class));
+#if 0
+    if ((cache_info->colorspace != UndefinedColorspace) &&
+        (image->colorspace != cache_info->colorspace))
+      fprintf(stderr,"SetCacheNexus: Pixel cache colorspace mismatch! (image: %s, cache: %s)\n",
+              ColorspaceTypeToString(image->colorspace), ColorspaceTypeToString(cache_info->colorspace));
+#endif
+  }
+#endif
+
+
+  if (ModifyCache(image,exception) != MagickFail)
+    {
+      /*
+        Return pixel cache.
+      */
+      pixels=SetNexus(image,x,y,columns,rows,nexus_info,MagickTrue,exception);
+#if 0
+      if (!pixels)
+        fprintf(stderr,"%s: SetNexus returns null (%lux%lu%+ld%+ld)\n",
+                __func__,columns,rows,x,y);
+#endif
+    }
+
+  return pixels;
+}
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   T r a n s f e r T i l e d C a c h e R e g i o n                           %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  TransferTiledCacheRegion() copies the pixels or indexes of a nexus
+%  region between the nexus staging area and a pixel cache which uses a
+%  tiled storage layout.  Each row of the region is split into runs which
+%  lie within one tile, and each run is transferred with one memory copy
+%  or one file read/write.
+%
+%  The format of the TransferTiledCacheRegion() method is:
+%
+%      MagickPassFail TransferTiledCacheRegion(CacheInfo *cache_info,
+%        const NexusInfo *nexus_info,const MagickBool write_cache,
+%        const MagickBool indexes)
+%
+%  A description of each parameter follows:
+%
+%    o cache_info: The pixel cache.
+%
+%    o nexus_info: The cache nexus.
+%
+%    o write_cache: MagickTrue to write the nexus to the cache, MagickFalse
+%      to read the nexus from the cache.
+%
+%    o indexes: MagickTrue to transfer indexes rather than pixels.
+%
+*/
+static MagickPassFail
+TransferTiledCacheRegion(CacheInfo *cache_info,const NexusInfo *nexus_info,
+                         const MagickBool write_cache,const MagickBool indexes)
+{
+  char
+    *buffer,
+    *cache_buffer;
+
+  int
+    file;
+
+  long
+    run,
+    x,
+    x_end,
+    y,
+    y_end;
+
+  magick_off_t
+    base;
+
+  size_t
+    length,
+    packet_size;
+
+  packet_size=indexes ? sizeof(IndexPacket) : sizeof(PixelPacket);
+  buffer=indexes ? (char *) nexus_info->indexes : (char *) nexus_info->pixels;
+  x_end=nexus_info->region.x+(long) nexus_info->region.width;
+  y_end=nexus_info->region.y+(long) nexus_info->region.height;
+  if (cache_info->type != DiskCache)
+    {
+      /*
+        Transfer runs in memory.
+      */
+      cache_buffer=indexes ? (char *) cache_info->indexes :
+        (char *) cache_info->pixels;
+      for (y=nexus_info->region.y; y < y_end; y++)
+        for (x=nexus_info->region.x; x < x_end; x+=run)
+          {
+            run=Min((long) cache_info->tile_columns-
+                    (long) (x % cache_info->tile_columns),x_end-x);
+            length=(size_t) run*packet_size;
+            if (write_cache)
+              (void) memcpy(cache_buffer+
+                            CachePixelOffset(cache_info,x,y)*packet_size,
+                            buffer,length);
+            else
+              (void) memcpy(buffer,cache_buffer+
+                            CachePixelOffset(cache_info,x,y)*packet_size,
+                            length);
+            buffer+=length;
+          }
+      return(MagickPass);
+    }
+  /*
+    Transfer runs to or from disk.
+  */
+  base=(magick_off_t) cache_info->offset;
+  if (indexes)
+    base+=(magick_off_t) (cache_info->storage_pixels*sizeof(PixelPacket));
+  y=nexus_info->region.y;
+  LockSemaphoreInfo(cache_info->file_semaphore);
+  {
+    file=cache_info->file;
+    if (cache_info->file == -1)
+      {
+        if (write_cache)
+          file=open(cache_info->cache_filename,O_WRONLY | O_BINARY,S_MODE);
+        else
+          file=open(cache_info->cache_filename,O_RDONLY | O_BINARY);
+      }
+    if (file != -1)
+      {
+        for ( ; y < y_end; y++)
+          {
+            for (x=nexus_info->region.x; x < x_end; x+=run)
+              {
+                magick_off_t
+                  offset;
+
+                run=Min((long) cache_info->tile_columns-
+                        (long) (x % cache_info->tile_columns),x_end-x);
+                length=(size_t) run*packet_size;
+                offset=base+CachePixelOffset(cache_info,x,y)*
+                  (magick_off_t) packet_size;
+                if ((write_cache ?
+                     FilePositionWrite(file,buffer,length,offset) :
+                     FilePositionRead(file,buffer,length,offset)) <
+                    (ssize_t) length)
+                  break;
+                buffer+=length;
+              }
+            if (x < x_end)
+              break;
+          }
+        if (cache_info->file == -1)
+          (void) close(file);
+        if (QuantumTick(nexus_info->region.y,cache_info->rows))
+          (void) LogMagickEvent(CacheEvent,GetMagickModule(),"%lux%lu%+ld%+ld",
+                                nexus_info->region.width,nexus_info->region.height,
+                                nexus_info->region.x,nexus_info->region.y);
+      }
+  }
+  UnlockSemaphoreInfo(cache_info->file_semaphore);
+  if (file == -1)
+    return(MagickFail);
+  return(y == y_end);
+}
+
+
+/*
+
+  Return MagickTrue if 'length' more bytes of memory may be used by a
+  compressed cache without intruding on the reserve which it leaves
+  for other allocations.
+
+*/
+static MagickBool
+CompressedCacheMemoryAvailable(const size_t length)
+{
+  magick_int64_t
+    limit;
+
+  limit=GetMagickResourceLimit(MemoryResource);
+  if (limit == MagickResourceInfinity)
+    return MagickTrue;
+  return (GetMagickResource(MemoryResource)+(magick_int64_t) length <=
+          limit-limit/CompressedCacheReserve);
+}
+/*
+
+  Write 'length' bytes of data for block 'block_number' of a compressed
+  cache to the cache file, which is created when it is first needed.
+
+*/
+static MagickPassFail
+WriteCompressedCacheBlock(CacheInfo *cache_info,const long block_number,
+                          const unsigned char *data,const size_t length)
+{
+  CompressedBlock
+    *block;
+
+  block=&cache_info->blocks[block_number];
+  if (cache_info->file == -1)
+    {
+      if (!AcquireMagickResource(FileResource,1))
+        return MagickFail;
+      cache_info->file=AcquireTemporaryFileDescriptor(cache_info->cache_filename);
+      if (cache_info->file == -1)
+        {
+          LiberateMagickResource(FileResource,1);
+          return MagickFail;
+        }
+      (void) LogMagickEvent(CacheEvent,GetMagickModule(),
+                            "open %.1024s (%.1024s) for compressed blocks",
+                            cache_info->filename,cache_info->cache_filename);
+    }
+  if (!block->on_disk &&
+      !AcquireMagickResource(DiskResource,cache_info->block_length))
+    return MagickFail;
+  if (FilePositionWrite(cache_info->file,data,length,(magick_off_t)
+                        block_number*cache_info->block_length) <
+      (ssize_t) length)
+    {
+      if (!block->on_disk)
+        LiberateMagickResource(DiskResource,cache_info->block_length);
+      return MagickFail;
+    }
+  MagickFreeResourceLimitedMemory(block->data);
+  block->length=length;
+  block->on_disk=MagickTrue;
+  return MagickPass;
+}
+/*
+
+  Store 'length' bytes of data for block 'block_number' of a compressed
+  cache.  The data is kept in memory if that leaves the reserve for
+  other allocations, and is otherwise written to the cache file.  If
+  the disk resource is exhausted too, whatever memory remains is used.
+
+*/
+static MagickPassFail
+StoreCompressedCacheBlock(CacheInfo *cache_info,const long block_number,
+                          const unsigned char *data,const size_t length)
+{
+  CompressedBlock
+    *block;
+
+  unsigned char
+    *blob=(unsigned char *) NULL;
+
+  block=&cache_info->blocks[block_number];
+  if (CompressedCacheMemoryAvailable(length))
+    blob=MagickAllocateResourceLimitedMemory(unsigned char *,length);
+  if (blob == (unsigned char *) NULL)
+    {
+      if (WriteCompressedCacheBlock(cache_info,block_number,data,length) ==
+          MagickPass)
+        return MagickPass;
+      blob=MagickAllocateResourceLimitedMemory(unsigned char *,length);
+      if (blob == (unsigned char *) NULL)
+        return MagickFail;
+    }
+  (void) memcpy(blob,data,length);
+  MagickFreeResourceLimitedMemory(block->data);
+  block->data=blob;
+  block->length=length;
+  if (block->on_disk)
+    {
+      LiberateMagickResource(DiskResource,cache_info->block_length);
+      block->on_disk=MagickFalse;
+    }
+  return MagickPass;
+}
+/*
+
+  Compress the block held by a compressed cache slot if it has been
+  modified.  The block is stored uncompressed if it does not compress.
+
+*/
+static MagickPassFail
+FlushCompressedCacheSlot(CacheInfo *cache_info,CompressedSlot *slot)
+{
+  const unsigned char
+    *data;
+
+  uLongf
+    compressed_length;
+
+  size_t
+    length;
+
+  if (!slot->dirty)
+    return MagickPass;
+  length=cache_info->block_length;
+  compressed_length=(uLongf) cache_info->compress_buffer_length;
+  data=(const unsigned char *) slot->pixels;
+  if ((compress2(cache_info->compress_buffer,&compressed_length,
+                 (const Bytef *) slot->pixels,(uLong) length,1) == Z_OK) &&
+      (compressed_length < length))
+    {
+      data=cache_info->compress_buffer;
+      length=(size_t) compressed_length;
+    }
+  if (StoreCompressedCacheBlock(cache_info,slot->block,data,length) ==
+      MagickFail)
+    return MagickFail;
+  slot->dirty=MagickFalse;
+  return MagickPass;
+}
+/*
+
+  Return the slot holding the uncompressed pixels (followed by the
+  indexes) of block 'block' of a compressed cache, replacing the least
+  recently used slot if the block is not already uncompressed.
+
+*/
+static CompressedSlot *
+AccessCompressedCacheBlock(CacheInfo *cache_info,const long block)
+{
+  CompressedBlock
+    *compressed_block;
+
+  CompressedSlot
+    *slot;
+
+  unsigned char
+    *data;
+
+  unsigned long
+    i;
+
+  compressed_block=&cache_info->blocks[block];
+  if (compressed_block->slot >= 0)
+    {
+      slot=&cache_info->slots[compressed_block->slot];
+      slot->stamp=++cache_info->slot_clock;
+      return slot;
+    }
+  slot=&cache_info->slots[0];
+  for (i=1; (slot->stamp != 0) && (i < cache_info->number_slots); i++)
+    if (cache_info->slots[i].stamp < slot->stamp)
+      slot=&cache_info->slots[i];
+  if (slot->pixels == (PixelPacket *) NULL)
+    {
+      if (CompressedCacheMemoryAvailable(cache_info->block_length))
+        slot->pixels=MagickAllocateResourceLimitedMemory(PixelPacket *,
+          cache_info->block_length);
+      if (slot->pixels == (PixelPacket *) NULL)
+        {
+          CompressedSlot
+            *free_slot=slot;
+
+          /*
+            Make do with the least recently used of the slots already
+            allocated.
+          */
+          slot=(CompressedSlot *) NULL;
+          for (i=0; i < cache_info->number_slots; i++)
+            if ((cache_info->slots[i].pixels != (PixelPacket *) NULL) &&
+                ((slot == (CompressedSlot *) NULL) ||
+                 (cache_info->slots[i].stamp < slot->stamp)))
+              slot=&cache_info->slots[i];
+          if (slot == (CompressedSlot *) NULL)
+            {
+              slot=free_slot;
+              slot->pixels=MagickAllocateResourceLimitedMemory(PixelPacket *,
+                cache_info->block_length);
+              if (slot->pixels == (PixelPacket *) NULL)
+                return (CompressedSlot *) NULL;
+            }
+        }
+    }
+  if (slot->block >= 0)
+    {
+      if (FlushCompressedCacheSlot(cache_info,slot) == MagickFail)
+        return (CompressedSlot *) NULL;
+      cache_info->blocks[slot->block].slot=(-1);
+      slot->block=(-1);
+    }
+  data=compressed_block->data;
+  if (compressed_block->on_disk)
+    {
+      data=cache_info->compress_buffer;
+      if (compressed_block->length == cache_info->block_length)
+        data=(unsigned char *) slot->pixels;
+      if (FilePositionRead(cache_info->file,data,compressed_block->length,
+                           (magick_off_t) block*cache_info->block_length) <
+          (ssize_t) compressed_block->length)
+        return (CompressedSlot *) NULL;
+    }
+  if (data == (unsigned char *) NULL)
+    (void) memset(slot->pixels,0,cache_info->block_length);
+  else if (compressed_block->length == cache_info->block_length)
+    {
+      if (data != (unsigned char *) slot->pixels)
+        (void) memcpy(slot->pixels,data,cache_info->block_length);
+    }
+  else
+    {
+      uLongf
+        length=(uLongf) cache_info->block_length;
+
+      if ((uncompress((Bytef *) slot->pixels,&length,data,
+                      (uLong) compressed_block->length) != Z_OK) ||
+          (length != (uLongf) cache_info->block_length))
+        return (CompressedSlot *) NULL;
+    }
+  slot->block=block;
+  slot->stamp=++cache_info->slot_clock;
+  compressed_block->slot=(long) (slot-cache_info->slots);
+  return slot;
+}
+/*
+
+  Release all memory used by a compressed cache.
+
+*/
+static void
+DestroyCompressedCache(CacheInfo *cache_info)
+{
+  unsigned long
+    i;
+
+  if (cache_info->blocks != (CompressedBlock *) NULL)
+    {
+      for (i=0; i < cache_info->number_blocks; i++)
+        {
+          MagickFreeResourceLimitedMemory(cache_info->blocks[i].data);
+          if (cache_info->blocks[i].on_disk)
+            LiberateMagickResource(DiskResource,cache_info->block_length);
+        }
+      MagickFreeResourceLimitedMemory(cache_info->blocks);
+    }
+  if (cache_info->file != -1)
+    {
+      (void) close(cache_info->file);
+      cache_info->file=(-1);
+      LiberateMagickResource(FileResource,1);
+      (void) LogMagickEvent(CacheEvent,GetMagickModule(),
+                            "remove %.1024s (%.1024s)",cache_info->filename,
+                            cache_info->cache_filename);
+      (void) LiberateTemporaryFile(cache_info->cache_filename);
+    }
+  if (cache_info->slots != (CompressedSlot *) NULL)
+    {
+      for (i=0; i < cache_info->number_slots; i++)
+        MagickFreeResourceLimitedMemory(cache_info->slots[i].pixels);
+      MagickFreeResourceLimitedMemory(cache_info->slots);
+    }
+  MagickFreeResourceLimitedMemory(cache_info->compress_buffer);
+  cache_info->compress_buffer_length=0;
+  cache_info->number_blocks=0;
+  cache_info->number_slots=0;
+  cache_info->blocks_across=0;
+  cache_info->compressed_columns=0;
+  cache_info->compressed_rows=0;
+}
+/*
+
+  Allocate the blocks of a compressed cache for the current cache
+  dimensions.  The blocks of an existing compressed cache with the
+  same dimensions (and therefore its pixels) are retained.
+
+*/
+static MagickPassFail
+OpenCompressedCache(CacheInfo *cache_info)
+{
+  unsigned long
+    blocks_down,
+    i;
+
+  if ((cache_info->type == CompressedCache) &&
+      (cache_info->blocks != (CompressedBlock *) NULL) &&
+      (cache_info->compressed_columns == cache_info->columns) &&
+      (cache_info->compressed_rows == cache_info->rows))
+    return MagickPass;
+  DestroyCompressedCache(cache_info);
+  cache_info->blocks_across=(cache_info->columns+CompressedCacheBlockSize-1)/
+    CompressedCacheBlockSize;
+  blocks_down=(cache_info->rows+CompressedCacheBlockSize-1)/
+    CompressedCacheBlockSize;
+  cache_info->number_blocks=cache_info->blocks_across*blocks_down;
+  if (cache_info->number_blocks/blocks_down != cache_info->blocks_across)
+    return MagickFail;
+  /*
+    Keep enough blocks uncompressed for a full row or column of blocks
+    so that sweeping the image by rows or by column strips uncompresses
+    each block only once.
+  */
+  cache_info->number_slots=Min(cache_info->number_blocks,
+                               Max(cache_info->blocks_across,blocks_down)+
+                               CompressedCacheSlots);
+  cache_info->block_length=(size_t) CompressedCacheBlockSize*
+    CompressedCacheBlockSize*(sizeof(PixelPacket)+sizeof(IndexPacket));
+  cache_info->compressed_columns=cache_info->columns;
+  cache_info->compressed_rows=cache_info->rows;
+  cache_info->blocks=MagickAllocateResourceLimitedClearedArray(CompressedBlock *,
+    cache_info->number_blocks,sizeof(CompressedBlock));
+  cache_info->slots=MagickAllocateResourceLimitedClearedArray(CompressedSlot *,
+    cache_info->number_slots,sizeof(CompressedSlot));
+  cache_info->compress_buffer_length=(size_t)
+    compressBound((uLong) cache_info->block_length);
+  cache_info->compress_buffer=
+    MagickAllocateResourceLimitedMemory(unsigned char *,
+                                        cache_info->compress_buffer_length);
+  if ((cache_info->blocks == (CompressedBlock *) NULL) ||
+      (cache_info->slots == (CompressedSlot *) NULL) ||
+      (cache_info->compress_buffer == (unsigned char *) NULL))
+    {
+      DestroyCompressedCache(cache_info);
+      return MagickFail;
+    }
+  for (i=0; i < cache_info->number_blocks; i++)
+    cache_info->blocks[i].slot=(-1);
+  for (i=0; i < cache_info->number_slots; i++)
+    cache_info->slots[i].block=(-1);
+  cache_info->slot_clock=0;
+  return MagickPass;
+}
+/*
+
+  Copy the blocks of compressed cache 'cache_info' to compressed cache
+  'clone_info', which has the same dimensions, without uncompressing
+  them.
+
+*/
+static MagickPassFail
+CloneCompressedCache(CacheInfo *cache_info,CacheInfo *clone_info)
+{
+  CompressedBlock
+    *block,
+    *clone_block;
+
+  unsigned char
+    *data;
+
+  unsigned long
+    i;
+
+  MagickPassFail
+    status=MagickPass;
+
+  if (cache_info->number_blocks != clone_info->number_blocks)
+    return MagickFail;
+  LockSemaphoreInfo(cache_info->file_semaphore);
+  LockSemaphoreInfo(clone_info->file_semaphore);
+  for (i=0; (status != MagickFail) && (i < cache_info->number_slots); i++)
+    if (cache_info->slots[i].block >= 0)
+      status=FlushCompressedCacheSlot(cache_info,&cache_info->slots[i]);
+  for (i=0; (status != MagickFail) && (i < clone_info->number_slots); i++)
+    if (clone_info->slots[i].block >= 0)
+      {
+        clone_info->blocks[clone_info->slots[i].block].slot=(-1);
+        clone_info->slots[i].block=(-1);
+        clone_info->slots[i].dirty=MagickFalse;
+        clone_info->slots[i].stamp=0;
+      }
+  for (i=0; (status != MagickFail) && (i < cache_info->number_blocks); i++)
+    {
+      block=&cache_info->blocks[i];
+      clone_block=&clone_info->blocks[i];
+      MagickFreeResourceLimitedMemory(clone_block->data);
+      clone_block->length=0;
+      if (clone_block->on_disk)
+        {
+          LiberateMagickResource(DiskResource,clone_info->block_length);
+          clone_block->on_disk=MagickFalse;
+        }
+      data=block->data;
+      if (block->on_disk)
+        {
+          data=clone_info->compress_buffer;
+          if (FilePositionRead(cache_info->file,data,block->length,
+                               (magick_off_t) i*cache_info->block_length) <
+              (ssize_t) block->length)
+            status=MagickFail;
+        }
+      if ((status != MagickFail) && (data != (unsigned char *) NULL))
+        status=StoreCompressedCacheBlock(clone_info,(long) i,data,
+                                         block->length);
+    }
+  UnlockSemaphoreInfo(clone_info->file_semaphore);
+  UnlockSemaphoreInfo(cache_info->file_semaphore);
+  return status;
+}
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   T r a n s f e r C o m p r e s s e d C a c h e R e g i o n                 %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  TransferCompressedCacheRegion() copies the pixels or indexes of a nexus
+%  region between the nexus staging area and a compressed pixel cache.
+%  The cache is stored as individually compressed square blocks of pixels,
+%  and recently used blocks are kept uncompressed for access.  Modified
+%  blocks are compressed again when their slot is needed for another
+%  block.
+%
+%  The format of the TransferCompressedCacheRegion() method is:
+%
+%      MagickPassFail TransferCompressedCacheRegion(CacheInfo *cache_info,
+%        const NexusInfo *nexus_info,const MagickBool write_cache,
+%        const MagickBool indexes)
+%
+%  A description of each parameter follows:
+%
+%    o cache_info: The pixel cache.
 %
-%    o x,y,columns,rows:  These values define the perimeter of a region of
-%      pixels.
+%    o nexus_info: The cache nexus.
 %
-%    o nexus_info: specifies which cache nexus to set.
+%    o write_cache: MagickTrue to write the nexus to the cache, MagickFalse
+%      to read the nexus from the cache.
 %
-%    o exception: any error is reported here.
+%    o indexes: MagickTrue to transfer indexes rather than pixels.
 %
 */
-static PixelPacket *
-SetCacheNexus(Image *image,const long x,const long y,
-              const unsigned long columns,const unsigned long rows,
-              NexusInfo *nexus_info,ExceptionInfo *exception)
+static MagickPassFail
+TransferCompressedCacheRegion(CacheInfo *cache_info,
+                              const NexusInfo *nexus_info,
+                              const MagickBool write_cache,
+                              const MagickBool indexes)
 {
-  PixelPacket
-    *pixels;
+  CompressedSlot
+    *slot=(CompressedSlot *) NULL;
 
-  assert(image != (Image *) NULL);
-  assert(image->signature == MagickSignature);
-  pixels=(PixelPacket *) NULL;
-#if 0
-  {
-    const CacheInfo
-      * restrict cache_info = (const CacheInfo * restrict) image->cache;
+  char
+    *buffer,
+    *cache_buffer;
 
-    if ((cache_info->reference_count != 1) || (cache_info->read_only))
-      fprintf(stderr,"SetCacheNexus: Thread %d enters (cache_info = %p, reference_count=%lu, read_only=%u)\n",
-              omp_get_thread_num(),image->cache, cache_info->reference_count, cache_info->read_only);
-#if 0
-    if (cache_info->type == UndefinedCache)
-      fprintf(stderr,"SetCacheNexus: Pixel cache is not open!\n");
-#endif
-    if ((cache_info->storage_class != UndefinedClass) &&
-        (image->storage_class != cache_info->storage_class))
-      fprintf(stderr,"SetCacheNexus: Pixel cache storage class mismatch! (image: %s, cache: %s)\n",
-              ClassTypeToString(image->storage_class),ClassTypeToString(cache_info->storage_class));
-#if 0
-    if ((cache_info->colorspace != UndefinedColorspace) &&
-        (image->colorspace != cache_info->colorspace))
-      fprintf(stderr,"SetCacheNexus: Pixel cache colorspace mismatch! (image: %s, cache: %s)\n",
-              ColorspaceTypeToString(image->colorspace), ColorspaceTypeToString(cache_info->colorspace));
-#endif
-  }
-#endif
+  long
+    block,
+    run,
+    x,
+    x_end,
+    y,
+    y_end;
 
+  size_t
+    length,
+    packet_size;
 
-  if (ModifyCache(image,exception) != MagickFail)
+  unsigned long
+    offset;
+
+  packet_size=indexes ? sizeof(IndexPacket) : sizeof(PixelPacket);
+  buffer=indexes ? (char *) nexus_info->indexes : (char *) nexus_info->pixels;
+  x_end=nexus_info->region.x+(long) nexus_info->region.width;
+  y_end=nexus_info->region.y+(long) nexus_info->region.height;
+  LockSemaphoreInfo(cache_info->file_semaphore);
+  for (y=nexus_info->region.y; y < y_end; y++)
     {
-      /*
-        Return pixel cache.
-      */
-      pixels=SetNexus(image,x,y,columns,rows,nexus_info,MagickTrue,exception);
-#if 0
-      if (!pixels)
-        fprintf(stderr,"%s: SetNexus returns null (%lux%lu%+ld%+ld)\n",
-                __func__,columns,rows,x,y);
-#endif
+      for (x=nexus_info->region.x; x < x_end; x+=run)
+        {
+          block=(long) ((unsigned long) y/CompressedCacheBlockSize*
+                        cache_info->blocks_across+
+                        (unsigned long) x/CompressedCacheBlockSize);
+          if ((slot == (CompressedSlot *) NULL) || (slot->block != block))
+            {
+              slot=AccessCompressedCacheBlock(cache_info,block);
+              if (slot == (CompressedSlot *) NULL)
+                break;
+            }
+          run=Min(CompressedCacheBlockSize-(x % CompressedCacheBlockSize),
+                  x_end-x);
+          length=(size_t) run*packet_size;
+          offset=(unsigned long) (y % CompressedCacheBlockSize)*
+            CompressedCacheBlockSize+(unsigned long)
+            (x % CompressedCacheBlockSize);
+          if (indexes)
+            cache_buffer=(char *) ((IndexPacket *) (slot->pixels+
+              CompressedCacheBlockSize*CompressedCacheBlockSize)+offset);
+          else
+            cache_buffer=(char *) (slot->pixels+offset);
+          if (write_cache)
+            {
+              (void) memcpy(cache_buffer,buffer,length);
+              slot->dirty=MagickTrue;
+            }
+          else
+            (void) memcpy(buffer,cache_buffer,length);
+          buffer+=length;
+        }
+      if (x < x_end)
+        break;
     }
-
-  return pixels;
+  UnlockSemaphoreInfo(cache_info->file_semaphore);
+  if (QuantumTick(nexus_info->region.y,cache_info->rows))
+    (void) LogMagickEvent(CacheEvent,GetMagickModule(),"%lux%lu%+ld%+ld",
+                          nexus_info->region.width,nexus_info->region.height,
+                          nexus_info->region.x,nexus_info->region.y);
+  return(y == y_end);
 }
-
+
+
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
@@ -1026,6 +1975,12 @@ ReadCacheIndexes(const Cache cache,const NexusInfo *nexus_info,
     return(MagickFail);
   if (nexus_info->in_core)
     return(MagickPass);
+  if (cache_info->type == CompressedCache)
+    return(TransferCompressedCacheRegion(cache_info,nexus_info,MagickFalse,
+                                         MagickTrue));
+  if (cache_info->tile_columns != 0)
+    return(TransferTiledCacheRegion(cache_info,nexus_info,MagickFalse,
+                                    MagickTrue));
   offset=nexus_info->region.y*(magick_off_t) cache_info->columns+nexus_info->region.x;
   length=nexus_info->region.width*sizeof(IndexPacket);
   rows=nexus_info->region.height;
@@ -1080,6 +2035,12 @@ ReadCacheIndexes(const Cache cache,const NexusInfo *nexus_info,
     if (file != -1)
       {
         number_pixels=(magick_uint64_t) cache_info->columns*cache_info->rows;
+        DiskCacheReadAhead(file,&cache_info->read_stream[1],
+                           cache_info->offset+number_pixels*sizeof(PixelPacket)+
+                           offset*sizeof(IndexPacket),
+                           cache_info->offset+number_pixels*sizeof(PixelPacket)+
+                           (offset+(rows-1)*(magick_off_t) cache_info->columns)*
+                           sizeof(IndexPacket)+length);
         for (y=0; y < (long) rows; y++)
           {
             if ((FilePositionRead(file,indexes,length,cache_info->offset+
@@ -1169,6 +2130,12 @@ ReadCachePixels(const Cache cache,const NexusInfo *nexus_info,
   assert(cache_info->signature == MagickSignature);
   if (nexus_info->in_core)
     return(MagickPass);
+  if (cache_info->type == CompressedCache)
+    return(TransferCompressedCacheRegion(cache_info,nexus_info,MagickFalse,
+                                         MagickFalse));
+  if (cache_info->tile_columns != 0)
+    return(TransferTiledCacheRegion(cache_info,nexus_info,MagickFalse,
+                                    MagickFalse));
   offset=nexus_info->region.y*(magick_off_t) cache_info->columns;
   if ((long) (offset/cache_info->columns) != nexus_info->region.y)
     return MagickFail;
@@ -1229,6 +2196,11 @@ ReadCachePixels(const Cache cache,const NexusInfo *nexus_info,
           open(cache_info->cache_filename,O_RDONLY | O_BINARY));
     if (file != -1)
       {
+        DiskCacheReadAhead(file,&cache_info->read_stream[0],
+                           cache_info->offset+offset*sizeof(PixelPacket),
+                           cache_info->offset+(offset+(rows-1)*(magick_off_t)
+                                               cache_info->columns)*
+                           sizeof(PixelPacket)+length);
         for (y=0; y < (long) rows; y++)
           {
             if ((FilePositionRead(file,pixels,length,
@@ -1315,6 +2287,12 @@ WriteCacheIndexes(Cache cache,const NexusInfo *nexus_info)
     return(MagickFail);
   if (nexus_info->in_core)
     return(MagickPass);
+  if (cache_info->type == CompressedCache)
+    return(TransferCompressedCacheRegion(cache_info,nexus_info,MagickTrue,
+                                         MagickTrue));
+  if (cache_info->tile_columns != 0)
+    return(TransferTiledCacheRegion(cache_info,nexus_info,MagickTrue,
+                                    MagickTrue));
   offset=nexus_info->region.y*(magick_off_t) cache_info->columns+nexus_info->region.x;
   length=nexus_info->region.width*sizeof(IndexPacket);
   rows=nexus_info->region.height;
@@ -1379,6 +2357,7 @@ WriteCacheIndexes(Cache cache,const NexusInfo *nexus_info)
     if (file != -1)
       {
         magick_off_t
+          region_offset,
           row_offset;
 
         ssize_t
@@ -1387,6 +2366,7 @@ WriteCacheIndexes(Cache cache,const NexusInfo *nexus_info)
         number_pixels=(magick_uint64_t) cache_info->columns*cache_info->rows;
         row_offset=cache_info->offset+number_pixels*sizeof(PixelPacket)+offset
           *sizeof(IndexPacket);
+        region_offset=row_offset;
         for (y=0; y < (long) rows; y++)
           {
             if ((bytes_written=FilePositionWrite(file,indexes,length,row_offset))
@@ -1404,8 +2384,12 @@ WriteCacheIndexes(Cache cache,const NexusInfo *nexus_info)
                 break;
               }
             indexes+=nexus_info->region.width;
-            offset+=cache_info->columns;
+            row_offset+=cache_info->columns*sizeof(IndexPacket);
           }
+        if (cache_info->write_behind && (y == (long) rows))
+          DiskCacheWriteBehind(file,&cache_info->write_stream[1],region_offset,
+                               row_offset-cache_info->columns*
+                               sizeof(IndexPacket)+length);
         if (cache_info->file == -1)
           (void) close(file);
         if (QuantumTick(nexus_info->region.y,cache_info->rows))
@@ -1481,6 +2465,12 @@ WriteCachePixels(Cache cache,const NexusInfo *nexus_info)
   assert(cache_info->signature == MagickSignature);
   if (nexus_info->in_core)
     return(MagickPass);
+  if (cache_info->type == CompressedCache)
+    return(TransferCompressedCacheRegion(cache_info,nexus_info,MagickTrue,
+                                         MagickFalse));
+  if (cache_info->tile_columns != 0)
+    return(TransferTiledCacheRegion(cache_info,nexus_info,MagickTrue,
+                                    MagickFalse));
   offset=nexus_info->region.y*(magick_off_t) cache_info->columns+nexus_info->region.x;
   length=nexus_info->region.width*sizeof(PixelPacket);
   rows=nexus_info->region.height;
@@ -1570,6 +2560,14 @@ WriteCachePixels(Cache cache,const NexusInfo *nexus_info)
             pixels+=nexus_info->region.width;
             offset+=cache_info->columns;
           }
+        if (cache_info->write_behind && (y == (long) rows))
+          DiskCacheWriteBehind(file,&cache_info->write_stream[0],
+                               cache_info->offset+(offset-rows*(magick_off_t)
+                                                   cache_info->columns)*
+                               sizeof(PixelPacket),
+                               cache_info->offset+(offset-(magick_off_t)
+                                                   cache_info->columns)*
+                               sizeof(PixelPacket)+length);
         if (cache_info->file == -1)
           (void) close(file);
         if (QuantumTick(nexus_info->region.y,cache_info->rows))
@@ -2426,6 +3424,28 @@ OpenCache(Image *image,const MapMode mode,ExceptionInfo *exception)
     }
   cache_info->rows=image->rows;
   cache_info->columns=image->columns;
+  if (cache_info->tile_columns != 0)
+    {
+      magick_uint64_t
+        tiles_down;
+
+      /*
+        Pixel storage is rounded up to whole tiles.
+      */
+      cache_info->tiles_across=(image->columns+cache_info->tile_columns-1)/
+        cache_info->tile_columns;
+      tiles_down=(image->rows+cache_info->tile_rows-1)/cache_info->tile_rows;
+      number_pixels=(magick_uint64_t) cache_info->tiles_across*tiles_down*
+        cache_info->tile_columns*cache_info->tile_rows;
+      if (number_pixels/cache_info->tile_columns/cache_info->tile_rows/
+          tiles_down != cache_info->tiles_across)
+        {
+          ThrowException(exception,ResourceLimitError,
+                         PixelCacheAllocationFailed,image->filename);
+          return MagickFail;
+        }
+    }
+  cache_info->storage_pixels=number_pixels;
   if (cache_info->storage_class != UndefinedClass)
     {
       /*
@@ -2461,6 +3481,11 @@ OpenCache(Image *image,const MapMode mode,ExceptionInfo *exception)
             LiberateMagickResource(MapResource,cache_info->length);
             break;
           }
+        case CompressedCache:
+          {
+            /* Blocks are retained by OpenCompressedCache() if possible */
+            break;
+          }
         }
     }
 #if 0
@@ -2517,7 +3542,7 @@ OpenCache(Image *image,const MapMode mode,ExceptionInfo *exception)
   if (cache_info->indexes_valid)
     packet_size+=sizeof(IndexPacket);
   offset=number_pixels*packet_size;
-  if ((cache_info->columns != (offset/cache_info->rows/packet_size)) ||
+  if ((number_pixels != (offset/packet_size)) ||
       ((magick_uint64_t) ((magick_off_t) offset) != offset))
     {
       ThrowException(exception,ResourceLimitError,PixelCacheAllocationFailed,
@@ -2570,6 +3595,32 @@ OpenCache(Image *image,const MapMode mode,ExceptionInfo *exception)
           return(MagickPass);
         }
     }
+  /*
+    Attempt to create compressed pixel cache in memory.
+  */
+  if (cache_info->compress && (cache_info->tile_columns == 0) &&
+      ((cache_info->type == UndefinedCache) ||
+       (cache_info->type == CompressedCache)))
+    {
+      if (OpenCompressedCache(cache_info) == MagickPass)
+        {
+          cache_info->storage_class=image->storage_class;
+          cache_info->colorspace=image->colorspace;
+          cache_info->type=CompressedCache;
+          cache_info->pixels=(PixelPacket *) NULL;
+          cache_info->indexes=(IndexPacket *) NULL;
+          FormatSize(cache_info->length,format);
+          if (cache_info->logging)
+            (void) LogMagickEvent(CacheEvent,GetMagickModule(),
+                                  "open %.1024s (%.1024s compressed, %lu"
+                                  " blocks) storage_class=%s,"
+                                  " colorspace=%s",cache_info->filename,
+                                  format,cache_info->number_blocks,
+                                  ClassTypeToString(cache_info->storage_class),
+                                  ColorspaceTypeToString(cache_info->colorspace));
+          return(MagickPass);
+        }
+    }
   /*
     Create pixel cache on disk.
   */
@@ -2671,6 +3722,22 @@ OpenCache(Image *image,const MapMode mode,ExceptionInfo *exception)
         cache_info->file=file;
       else
         (void) close(file);
+      /*
+        Caches which fit in the system file cache are better left to
+        the operating system, so only request write-behind for caches
+        known to be larger than physical memory.
+      */
+      (void) memset(cache_info->read_stream,0,sizeof(cache_info->read_stream));
+      (void) memset(cache_info->write_stream,0,
+                    sizeof(cache_info->write_stream));
+      {
+        magick_uint64_t
+          physical_memory;
+
+        physical_memory=DiskCachePhysicalMemory();
+        cache_info->write_behind=((physical_memory != 0) &&
+                                  (cache_info->length > physical_memory));
+      }
     }
 #if defined(SIGBUS)
   /*   (void) signal(SIGBUS,CacheSignalHandler); */
@@ -3038,7 +4105,7 @@ AcquireOneCacheViewPixelInlined(View *view_info,
       magick_off_t
         offset;
 
-      offset=y*(magick_off_t) cache_info->columns+x;
+      offset=CachePixelOffset(cache_info,x,y);
       if ((cache_info->indexes_valid) &&
           (PseudoClass == cache_info->storage_class))
         *pixel=image->colormap[cache_info->indexes[offset]];
@@ -3334,7 +4401,11 @@ ClonePixelCache(Image *image,Image *clone_image,ExceptionInfo *exception)
 
   cache_info=(CacheInfo *) image->cache;
   clone_info=(CacheInfo *) clone_image->cache;
-  if (cache_info->length != clone_info->length)
+  if ((cache_info->length != clone_info->length) ||
+      (cache_info->tile_columns != clone_info->tile_columns) ||
+      (cache_info->tile_rows != clone_info->tile_rows) ||
+      ((cache_info->type == CompressedCache) !=
+       (clone_info->type == CompressedCache)))
     {
       Image
         *clip_mask,
@@ -3406,6 +4477,16 @@ ClonePixelCache(Image *image,Image *clone_image,ExceptionInfo *exception)
   /*
     Optimized pixel cache clone.
   */
+  if (cache_info->type == CompressedCache)
+    {
+      (void) LogMagickEvent(CacheEvent,GetMagickModule(),
+                            "compressed => compressed clone");
+      status=CloneCompressedCache(cache_info,clone_info);
+      if (status == MagickFail)
+        ThrowException(exception,CacheError,UnableToCloneCache,
+                       image->filename);
+      return(status);
+    }
   if ((cache_info->type != DiskCache) && (clone_info->type != DiskCache))
     {
       (void) LogMagickEvent(CacheEvent,GetMagickModule(),
@@ -3669,6 +4750,10 @@ DestroyCacheInfo(Cache cache_info)
       cache_info->pixels = NULL;
       LiberateMagickResource(MapResource,cache_info->length);
     }
+  else if (CompressedCache == cache_info->type)
+    {
+      DestroyCompressedCache(cache_info);
+    }
 
   /*
     Release Cache File Resources
@@ -3729,6 +4814,51 @@ DestroyImagePixels(Image *image)
   image->cache=(Cache) NULL;
 }
 
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   G e t C a c h e C o m p r e s s i o n                                     %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  GetCacheCompression() returns MagickTrue if a compressed in-memory pixel
+%  cache is used when the pixel cache does not fit in memory.
+%
+%  The format of the GetCacheCompression() method is:
+%
+%      MagickBool GetCacheCompression(const Cache cache)
+%
+%  A description of each parameter follows:
+%
+%    o cache: The pixel cache.
+%
+*/
+MagickBool
+GetCacheCompression(const Cache cache)
+{
+  const CacheInfo
+    *cache_info=(const CacheInfo *) cache;
+
+  assert(cache_info != (const CacheInfo *) NULL);
+  return cache_info->compress;
+}
+
+/*
+  Default tiled storage layout and compression of new pixel caches,
+  read from MAGICK_CACHE_TILE and MAGICK_CACHE_COMPRESS by
+  InitializePixelCache().
+*/
+static unsigned long
+  default_tile_columns = 0,
+  default_tile_rows = 0;
+
+static MagickBool
+  default_compress = MagickFalse;
+
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
@@ -3794,9 +4924,61 @@ GetCacheInfo(Cache *cache)
 
   cache_info->logging=IsEventLogged(CacheEvent);
 
+  /*
+    Optional default tiled storage layout.
+  */
+  if (default_tile_columns != 0)
+    SetCacheTileSize(cache_info,default_tile_columns,default_tile_rows);
+
+  /*
+    Optional compressed in-memory cache.
+  */
+  if (default_compress)
+    SetCacheCompression(cache_info,MagickTrue);
+
   cache_info->signature=MagickSignature;
   *cache=cache_info;
 }
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   G e t C a c h e T i l e S i z e                                           %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  GetCacheTileSize() returns the tile dimensions used to store the pixel
+%  cache, or zero dimensions if pixels are stored in row order.
+%
+%  The format of the GetCacheTileSize() method is:
+%
+%      void GetCacheTileSize(const Cache cache,unsigned long *columns,
+%        unsigned long *rows)
+%
+%  A description of each parameter follows:
+%
+%    o cache: The pixel cache.
+%
+%    o columns: The tile width is returned here.
+%
+%    o rows: The tile height is returned here.
+%
+*/
+void
+GetCacheTileSize(const Cache cache,unsigned long *columns,unsigned long *rows)
+{
+  const CacheInfo
+    *cache_info=(const CacheInfo *) cache;
+
+  assert(cache_info != (const CacheInfo *) NULL);
+  *columns=cache_info->tile_columns;
+  *rows=cache_info->tile_rows;
+}
+
 
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -4392,6 +5574,64 @@ GetPixelCachePresent(const Image *image)
   return MagickTrue;
 }
 
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   I n i t i a l i z e P i x e l C a c h e                                   %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  InitializePixelCache() reads the environment variables which select
+%  the defaults of new pixel caches (MAGICK_CACHE_TILE and
+%  MAGICK_CACHE_COMPRESS), so that they are not looked up for every image
+%  allocated.
+%
+%  The format of the InitializePixelCache method is:
+%
+%      MagickPassFail InitializePixelCache(void)
+%
+%
+*/
+MagickPassFail
+InitializePixelCache(void)
+{
+  const char
+    *value;
+
+  unsigned long
+    tile_columns,
+    tile_rows;
+
+  /*
+    Optional default tiled storage layout.
+  */
+  default_tile_columns=default_tile_rows=0;
+  if ((value=getenv("MAGICK_CACHE_TILE")) != (const char *) NULL)
+    {
+      tile_columns=tile_rows=0;
+      if (sscanf(value,"%lux%lu",&tile_columns,&tile_rows) == 1)
+        tile_rows=tile_columns;
+      if ((tile_columns != 0) && (tile_rows != 0) &&
+          (tile_columns <= (unsigned long) LONG_MAX) &&
+          (tile_rows <= (unsigned long) LONG_MAX))
+        {
+          default_tile_columns=tile_columns;
+          default_tile_rows=tile_rows;
+        }
+    }
+  /*
+    Optional compressed in-memory cache.
+  */
+  default_compress=MagickFalse;
+  if ((value=getenv("MAGICK_CACHE_COMPRESS")) != (const char *) NULL)
+    default_compress=(LocaleCompare(value,"TRUE") == 0);
+  return MagickPass;
+}
+
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
@@ -4583,6 +5823,9 @@ ModifyCache(Image *image, ExceptionInfo *exception)
           clone_image.reference_count=1;
 
           GetCacheInfo(&clone_image.cache);
+          SetCacheTileSize(clone_image.cache,cache_info->tile_columns,
+                           cache_info->tile_rows);
+          SetCacheCompression(clone_image.cache,cache_info->compress);
           status=OpenCache(&clone_image,IOMode,exception);
           if (status != MagickFail)
             {
@@ -4771,6 +6014,8 @@ PersistCache(Image *image,const char *filename,
         Attach persistent pixel cache.
       */
       (void) strlcpy(cache_info->cache_filename,filename,MaxTextExtent);
+      cache_info->tile_columns=0;
+      cache_info->tile_rows=0;
       cache_info->type=DiskCache;
       cache_info->offset=(*offset);
       if (!OpenCache(image,ReadMode,exception))
@@ -4784,7 +6029,9 @@ PersistCache(Image *image,const char *filename,
     }
   LockSemaphoreInfo(cache_info->reference_semaphore);
   if ((cache_info->reference_count == 1) &&
-      (cache_info->type != MemoryCache))
+      (cache_info->type != MemoryCache) &&
+      (cache_info->type != CompressedCache) &&
+      (cache_info->tile_columns == 0))
     {
       /*
         Usurp resident persistent pixel cache.
@@ -4810,6 +6057,9 @@ PersistCache(Image *image,const char *filename,
     return(MagickFail);
   cache_info=(CacheInfo *) clone_image->cache;
   (void) strlcpy(cache_info->cache_filename,filename,MaxTextExtent);
+  /* Persistent caches are always stored in row order */
+  cache_info->tile_columns=0;
+  cache_info->tile_rows=0;
   cache_info->type=DiskCache;
   cache_info->offset=(*offset);
   if (!OpenCache(clone_image,IOMode,exception))
@@ -4901,6 +6151,103 @@ ReferenceCache(Cache cache_info)
   UnlockSemaphoreInfo(cache_info->reference_semaphore);
   return(cache_info);
 }
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   S e t C a c h e C o m p r e s s i o n                                     %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  SetCacheCompression() selects whether a pixel cache which has not been
+%  opened yet, and which does not fit in memory, is kept in memory as
+%  individually compressed blocks of pixels rather than being stored on
+%  disk.  Images with large uniform areas (e.g. scanned documents)
+%  compress so well that images several times larger than the memory
+%  limit may be processed without disk access.  Images which do not
+%  compress well may exhaust the memory limit while being processed.
+%
+%  The format of the SetCacheCompression() method is:
+%
+%      void SetCacheCompression(Cache cache,const MagickBool compress)
+%
+%  A description of each parameter follows:
+%
+%    o cache: The pixel cache.
+%
+%    o compress: MagickTrue to allow a compressed pixel cache.
+%
+*/
+void
+SetCacheCompression(Cache cache,const MagickBool compress)
+{
+  CacheInfo
+    *cache_info=(CacheInfo *) cache;
+
+  assert(cache_info != (CacheInfo *) NULL);
+  if (cache_info->type != UndefinedCache)
+    return;
+  cache_info->compress=compress;
+}
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   S e t C a c h e T i l e S i z e                                           %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  SetCacheTileSize() selects a tiled storage layout for a pixel cache
+%  which has not been opened yet.  Pixels are then stored one tile at a
+%  time, which gives column-oriented algorithms (e.g. vertical filters,
+%  shears, and rotations) much better locality, particularly for disk
+%  caches.  Rows which are accessed in full are copied through the cache
+%  nexus rather than accessed in place, so row-oriented algorithms become
+%  somewhat slower.  Zero dimensions select the default row order.
+%
+%  The format of the SetCacheTileSize() method is:
+%
+%      void SetCacheTileSize(Cache cache,const unsigned long columns,
+%        const unsigned long rows)
+%
+%  A description of each parameter follows:
+%
+%    o cache: The pixel cache.
+%
+%    o columns: The tile width.
+%
+%    o rows: The tile height.
+%
+*/
+void
+SetCacheTileSize(Cache cache,const unsigned long columns,
+                 const unsigned long rows)
+{
+  CacheInfo
+    *cache_info=(CacheInfo *) cache;
+
+  assert(cache_info != (CacheInfo *) NULL);
+  if (cache_info->type != UndefinedCache)
+    return;
+  if ((columns == 0) || (rows == 0) ||
+      (columns > (unsigned long) LONG_MAX) || (rows > (unsigned long) LONG_MAX))
+    {
+      cache_info->tile_columns=0;
+      cache_info->tile_rows=0;
+      return;
+    }
+  cache_info->tile_columns=columns;
+  cache_info->tile_rows=rows;
+}
+
 
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
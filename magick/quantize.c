@@ -177,6 +177,7 @@
 #include "magick/colormap.h"
 #include "magick/enhance.h"
 #include "magick/monitor.h"
+#include "magick/omp_data_view.h"
 #include "magick/pixel_cache.h"
 #include "magick/quantize.h"
 #include "magick/utility.h"
@@ -185,11 +186,35 @@
   Define declarations.
 */
 #define CacheShift  (QuantumDepth-6)
+#define ClassifyBandRows  32
+#define DitherPrimeLevel  3
+#define DitherSegmentLevel  8
 #define ExceptionQueueLength  16
+#define InverseColormapCells  (1 << 18)
+#define InverseColormapEntriesInAList  16384
+#define MaxDitherSegmentLevels  6
 #define MaxNodes  266817
 #define MaxTreeDepth  8
 #define NodesInAList  1536
 
+/*
+  Cells of the inverse colormap are built on demand and published to
+  other threads using atomic operations.  Without them, the inverse
+  colormap is only used when OpenMP is not.
+*/
+#if defined(__GCC_ATOMIC_POINTER_LOCK_FREE) && (__GCC_ATOMIC_POINTER_LOCK_FREE == 2)
+#  define MAGICK_INVERSE_COLORMAP 1
+#  define InverseColormapLoad(cell) __atomic_load_n(&(cell),__ATOMIC_ACQUIRE)
+#  define InverseColormapStore(cell,value) \
+  __atomic_store_n(&(cell),value,__ATOMIC_RELEASE)
+#else
+#  if !defined(HAVE_OPENMP)
+#    define MAGICK_INVERSE_COLORMAP 1
+#  endif
+#  define InverseColormapLoad(cell) (cell)
+#  define InverseColormapStore(cell,value) ((cell)=(value))
+#endif
+
 #define ColorToNodeId(red,green,blue,index) ((unsigned int) \
             (((ScaleQuantumToChar(red) >> index) & 0x01) << 2 | \
              ((ScaleQuantumToChar(green) >> index) & 0x01) << 1 | \
@@ -238,6 +263,35 @@ typedef struct _Nodes
     *next;
 } Nodes;
 
+typedef struct _InverseColormapEntries
+{
+  unsigned long
+    *entries;
+
+  struct _InverseColormapEntries
+    *next;
+} InverseColormapEntries;
+
+typedef struct _InverseColormap
+{
+  const unsigned long
+    **cells;
+
+  InverseColormapEntries
+    *entries_queue;
+
+  unsigned long
+    *next_entry,
+    free_entries,
+    colors;
+
+  unsigned long
+    *candidates;
+
+  double
+    *candidate_distances;
+} InverseColormap;
+
 typedef struct _CubeInfo
 {
   NodeInfo
@@ -268,7 +322,9 @@ typedef struct _CubeInfo
     *node_queue;
 
   long
-    *cache;
+    *cache,
+    *cache_stamps,
+    cache_stamp;
 
   DoublePixelPacket
     error[ExceptionQueueLength];
@@ -279,33 +335,154 @@ typedef struct _CubeInfo
   const QuantizeInfo
     *quantize_info;
 
+  InverseColormap
+    *inverse_colormap;
+
   long
     x,
     y;
 
   unsigned long
     depth;
+
+  const PixelPacket
+    *region_pixels;
+
+  PixelPacket
+    *region_output;
+
+  IndexPacket
+    *region_indexes;
+
+  RectangleInfo
+    region;
 } CubeInfo;
+
+typedef struct _DitherSegment
+{
+  long
+    x,
+    y;
+
+  unsigned int
+    direction,
+    exit;
+
+  DoublePixelPacket
+    error[ExceptionQueueLength];
+} DitherSegment;
+
+typedef struct _DitherPlan
+{
+  DitherSegment
+    *segments;
+
+  unsigned long
+    number_segments,
+    level;
+
+  long
+    x,
+    y;
+} DitherPlan;
 
 /*
   Method prototypes.
 */
+static MagickPassFail
+  ClassifyImageRows(CubeInfo *,const Image *,const long,const long,
+    unsigned long *,ExceptionInfo *),
+  MergeCubeInfo(CubeInfo *,NodeInfo *,const NodeInfo *);
+
 static void
-  ClosestColor(Image *,CubeInfo *,const NodeInfo *);
+  ClosestColor(Image *,CubeInfo *,const NodeInfo *),
+  CountCubeColors(CubeInfo *,const NodeInfo *),
+  DestroyCubeInfo(CubeInfo *),
+  DestroyInverseColormap(InverseColormap *);
+
+static CubeInfo
+  *GetCubeInfo(const QuantizeInfo *,unsigned long);
+
+static InverseColormap
+  *AllocateInverseColormap(const unsigned long);
+
+static unsigned long
+  FindClosestColor(Image *,CubeInfo *,const PixelPacket *);
+
+static const unsigned long
+  *GetInverseColormapCell(Image *,CubeInfo *,const PixelPacket *);
 
 static NodeInfo
   *GetNodeInfo(CubeInfo *,const unsigned int,const unsigned int,NodeInfo *);
 
 static unsigned int
-  DitherImage(CubeInfo *,Image *);
+  DitherImage(CubeInfo *,Image *),
+  DitherImageSegments(CubeInfo *,Image *,const unsigned long);
 
 static void
   DefineImageColormap(Image *,NodeInfo *),
   HilbertCurve(CubeInfo *,Image *,const unsigned long,const unsigned int),
+  HilbertSegments(DitherPlan *,const unsigned long,const unsigned int),
   PruneLevel(CubeInfo *,const NodeInfo *),
   PruneToCubeDepth(CubeInfo *,const NodeInfo *),
   ReduceImageColors(const char *filename,CubeInfo *,const unsigned long,ExceptionInfo *);
 
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   A l l o c a t e I n v e r s e C o l o r m a p                             %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  AllocateInverseColormap() allocates an inverse colormap, which maps
+%  cells of the RGB cube at 6-bit precision to the colormap entries which
+%  ClosestColor() may select for a color within the cell.  The cells are
+%  filled in on demand by GetInverseColormapCell() and may be shared by
+%  all threads and by all images assigned colors from the same color
+%  cube.
+%
+%  The format of the AllocateInverseColormap method is:
+%
+%      InverseColormap *AllocateInverseColormap(const unsigned long colors)
+%
+%  A description of each parameter follows.
+%
+%    o colors: The number of entries in the colormap.
+%
+%
+*/
+static InverseColormap *AllocateInverseColormap(const unsigned long colors)
+{
+  InverseColormap
+    *inverse_colormap;
+
+  inverse_colormap=MagickAllocateMemory(InverseColormap *,
+                                        sizeof(InverseColormap));
+  if (inverse_colormap == (InverseColormap *) NULL)
+    return((InverseColormap *) NULL);
+  (void) memset(inverse_colormap,0,sizeof(InverseColormap));
+  inverse_colormap->colors=colors;
+  inverse_colormap->cells=MagickAllocateClearedArray(const unsigned long **,
+                                                     InverseColormapCells,
+                                                     sizeof(unsigned long *));
+  inverse_colormap->candidates=MagickAllocateArray(unsigned long *,colors,
+                                                   sizeof(unsigned long));
+  inverse_colormap->candidate_distances=MagickAllocateArray(double *,colors,
+                                                            sizeof(double));
+  if ((inverse_colormap->cells == (const unsigned long **) NULL) ||
+      (inverse_colormap->candidates == (unsigned long *) NULL) ||
+      (inverse_colormap->candidate_distances == (double *) NULL))
+    {
+      DestroyInverseColormap(inverse_colormap);
+      return((InverseColormap *) NULL);
+    }
+  return(inverse_colormap);
+}
+
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
@@ -373,6 +550,19 @@ static MagickPassFail AssignImageColors(CubeInfo *cube_info,Image *image)
   DefineImageColormap(image,cube_info->root);
   if (cube_info->quantize_info->colorspace == TransparentColorspace)
     image->storage_class=DirectClass;
+#if defined(MAGICK_INVERSE_COLORMAP)
+  /*
+    Images assigned colors from the same cube share its inverse colormap.
+  */
+  if ((cube_info->inverse_colormap != (InverseColormap *) NULL) &&
+      (cube_info->inverse_colormap->colors != image->colors))
+    {
+      DestroyInverseColormap(cube_info->inverse_colormap);
+      cube_info->inverse_colormap=(InverseColormap *) NULL;
+    }
+  if (cube_info->inverse_colormap == (InverseColormap *) NULL)
+    cube_info->inverse_colormap=AllocateInverseColormap(image->colors);
+#endif
   /*
     Create a reduced color image.
   */
@@ -381,14 +571,20 @@ static MagickPassFail AssignImageColors(CubeInfo *cube_info,Image *image)
     dither=DitherImage(cube_info,image);
   if (!dither)
     {
+      unsigned long
+        row_count=0;
+
       long
         y;
 
-      /*
-        FIXME: Use OpenMP?
-      */
+#if defined(HAVE_OPENMP)
+#  pragma omp parallel for schedule(static,4) shared(row_count, status)
+#endif
       for (y=0; y < (long) image->rows; y++)
         {
+          CubeInfo
+            search_info;
+
           IndexPacket
             index;
 
@@ -402,72 +598,77 @@ static MagickPassFail AssignImageColors(CubeInfo *cube_info,Image *image)
             i,
             x;
 
-          register const NodeInfo
-            *node_info;
-
           register PixelPacket
             *q;
 
-          unsigned int
-            id;
+          MagickPassFail
+            thread_status;
 
-          q=GetImagePixels(image,0,y,image->columns,1);
+          thread_status=status;
+          if (thread_status == MagickFail)
+            continue;
+
+          /*
+            The closest color search state is private to each row.
+          */
+          search_info=(*cube_info);
+          q=GetImagePixelsEx(image,0,y,image->columns,1,&image->exception);
           if (q == (PixelPacket *) NULL)
+            thread_status=MagickFail;
+          if (thread_status != MagickFail)
             {
-              status=MagickFail;
-              break;
-            }
-          indexes=AccessMutableIndexes(image);
-          for (x=0; x < (long) image->columns; x+=count)
-            {
-              /*
-                Identify the deepest node containing the pixel's color.
-              */
-              for (count=1; (x+count) < (long) image->columns; count++)
-                if (NotColorMatch(q,q+count))
-                  break;
-              node_info=cube_info->root;
-              for (index=MaxTreeDepth-1; (long) index > 0; index--)
-                {
-                  id=ColorToNodeId(q->red,q->green,q->blue,index);
-                  if (node_info->child[id] == (NodeInfo *) NULL)
-                    break;
-                  node_info=node_info->child[id];
-                }
-              /*
-                Find closest color among siblings and their children.
-              */
-              cube_info->color.red=q->red;
-              cube_info->color.green=q->green;
-              cube_info->color.blue=q->blue;
-              cube_info->distance=3.0*(MaxRGBDouble+1.0)*(MaxRGBDouble+1.0);
-              ClosestColor(image,cube_info,node_info->parent);
-              index=(IndexPacket) cube_info->color_number;
-              for (i=0; i < count; i++)
+              indexes=AccessMutableIndexes(image);
+              for (x=0; x < (long) image->columns; x+=count)
                 {
-                  if (image->storage_class == PseudoClass)
-                    indexes[x+i]=index;
-                  if (!cube_info->quantize_info->measure_error)
+                  /*
+                    Find the closest color for a run of identical pixels.
+                  */
+                  for (count=1; (x+count) < (long) image->columns; count++)
+                    if (NotColorMatch(q,q+count))
+                      break;
+                  index=(IndexPacket) FindClosestColor(image,&search_info,q);
+                  for (i=0; i < count; i++)
                     {
-                      q->red=image->colormap[index].red;
-                      q->green=image->colormap[index].green;
-                      q->blue=image->colormap[index].blue;
+                      if (image->storage_class == PseudoClass)
+                        indexes[x+i]=index;
+                      if (!cube_info->quantize_info->measure_error)
+                        {
+                          q->red=image->colormap[index].red;
+                          q->green=image->colormap[index].green;
+                          q->blue=image->colormap[index].blue;
+                        }
+                      q++;
                     }
-                  q++;
                 }
+              if (!SyncImagePixelsEx(image,&image->exception))
+                thread_status=MagickFail;
             }
-          if (!SyncImagePixels(image))
+          if (thread_status != MagickFail)
+            {
+              unsigned long
+                thread_row_count;
+
+#if defined(HAVE_OPENMP)
+#  pragma omp atomic
+#endif
+              row_count++;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (row_count)
+#endif
+              thread_row_count=row_count;
+              if (QuantumTick(thread_row_count,image->rows))
+                if (!MagickMonitorFormatted(thread_row_count,image->rows,
+                                            &image->exception,
+                                            AssignImageText,image->filename))
+                  thread_status=MagickFail;
+            }
+          if (thread_status == MagickFail)
             {
               status=MagickFail;
-              break;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (status)
+#endif
             }
-          if (QuantumTick(y,image->rows))
-            if (!MagickMonitorFormatted(y,image->rows,&image->exception,
-                                        AssignImageText,image->filename))
-              {
-                status=MagickFail;
-                break;
-              }
         }
     }
   if ((cube_info->quantize_info->number_colors == 2) &&
@@ -553,6 +754,14 @@ static MagickPassFail AssignImageColors(CubeInfo *cube_info,Image *image)
 %    within a node and the nodes' center.  This represents the quantization
 %    error for a node.
 %
+%  When several threads are available, bands of all but the last row are
+%  classified in parallel into partial trees which are then merged.  Since
+%  all of the node data are sums, the merged tree is the same as the tree
+%  built by classifying the rows in order.  The last row is then
+%  classified into the merged tree, so the tree is pruned to the cube
+%  depth only if classifying the rows in order would have found 256
+%  colors before the last row.
+%
 %  The format of the ClassifyImageColors() method is:
 %
 %      unsigned int ClassifyImageColorsCubeInfo *cube_info,const Image *image,
@@ -573,6 +782,204 @@ static MagickPassFail ClassifyImageColors(CubeInfo *cube_info,const Image *image
 {
 #define ClassifyImageText "[%s] Classify colors..."
 
+  CubeInfo
+    **partial_cubes;
+
+  QuantizeInfo
+    partial_info;
+
+  long
+    band;
+
+  unsigned long
+    bands,
+    row_count=0;
+
+  MagickBool
+    pruned=MagickFalse;
+
+  MagickPassFail
+    status=MagickPass;
+
+  bands=(unsigned long) omp_get_max_threads();
+  if (bands > (image->rows-1)/ClassifyBandRows)
+    bands=(image->rows-1)/ClassifyBandRows;
+  if (bands <= 1)
+    return(ClassifyImageRows(cube_info,image,0,(long) image->rows,&row_count,
+                             exception));
+  /*
+    Each band of rows is classified into its own partial color cube
+    which starts out at the depth of the shared cube.
+  */
+  partial_cubes=MagickAllocateClearedArray(CubeInfo **,bands,sizeof(CubeInfo *));
+  if (partial_cubes == (CubeInfo **) NULL)
+    {
+      ThrowException3(exception,ResourceLimitError,MemoryAllocationFailed,
+                      UnableToQuantizeImage);
+      return(MagickFail);
+    }
+  partial_info=(*cube_info->quantize_info);
+  partial_info.dither=MagickFalse;
+  for (band=0; band < (long) bands; band++)
+    {
+      partial_cubes[band]=GetCubeInfo(&partial_info,cube_info->depth);
+      if (partial_cubes[band] == (CubeInfo *) NULL)
+        {
+          ThrowException3(exception,ResourceLimitError,MemoryAllocationFailed,
+                          UnableToQuantizeImage);
+          status=MagickFail;
+          break;
+        }
+    }
+  if (status != MagickFail)
+    {
+#if defined(HAVE_OPENMP)
+#  pragma omp parallel for schedule(static,1) shared(row_count, status)
+#endif
+      for (band=0; band < (long) bands; band++)
+        {
+          MagickPassFail
+            thread_status;
+
+          thread_status=status;
+          if (thread_status == MagickFail)
+            continue;
+
+          thread_status=ClassifyImageRows(partial_cubes[band],image,
+                                          (long) ((band*(image->rows-1))/bands),
+                                          (long) (((band+1)*(image->rows-1))/
+                                                  bands),
+                                          &row_count,exception);
+          if (thread_status == MagickFail)
+            {
+              status=MagickFail;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (status)
+#endif
+            }
+        }
+    }
+  /*
+    Merge the partial cubes into the shared cube.  All node statistics
+    are sums, so the merged cube does not depend on the order in which
+    the bands were classified.
+  */
+  for (band=0; band < (long) bands; band++)
+    {
+      if (partial_cubes[band] == (CubeInfo *) NULL)
+        continue;
+      if (status != MagickFail)
+        {
+          if (partial_cubes[band]->colors >= 256)
+            pruned=MagickTrue;
+          if (partial_cubes[band]->depth < cube_info->depth)
+            cube_info->depth=partial_cubes[band]->depth;
+          if (!MergeCubeInfo(cube_info,cube_info->root,
+                             partial_cubes[band]->root))
+            {
+              ThrowException3(exception,ResourceLimitError,
+                              MemoryAllocationFailed,UnableToQuantizeImage);
+              status=MagickFail;
+            }
+        }
+      DestroyCubeInfo(partial_cubes[band]);
+    }
+  MagickFreeMemory(partial_cubes);
+  if (status == MagickFail)
+    return(status);
+  /*
+    As in the serial scan, the color count is not reduced by pruning, so
+    it stays at least 256 once the tree has been pruned to the cube depth
+    and is never less than the number of colors in the tree.
+  */
+  cube_info->colors=0;
+  CountCubeColors(cube_info,cube_info->root);
+  if (pruned || (cube_info->colors >= 256))
+    {
+      /*
+        More than 256 colors;  prune to the cube_info->depth tree depth.
+      */
+      PruneToCubeDepth(cube_info,cube_info->root);
+      if (cube_info->colors < 256)
+        cube_info->colors=256;
+    }
+  while (cube_info->nodes > MaxNodes)
+    {
+      /*
+        Prune one level if the color tree is too large.
+      */
+      PruneLevel(cube_info,cube_info->root);
+      cube_info->depth--;
+    }
+  /*
+    Classify the last row into the merged cube as the serial scan would.
+  */
+  return(ClassifyImageRows(cube_info,image,(long) image->rows-1,
+                           (long) image->rows,&row_count,exception));
+}
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   C l a s s i f y I m a g e R o w s                                         %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  ClassifyImageRows() classifies the colors of a band of image rows into
+%  a color cube as described for ClassifyImageColors().  Each band
+%  classified in parallel uses its own cube.
+%
+%  The format of the ClassifyImageRows() method is:
+%
+%      MagickPassFail ClassifyImageRows(CubeInfo *cube_info,
+%        const Image *image,const long first_row,const long last_row,
+%        unsigned long *row_count,ExceptionInfo *exception)
+%
+%  A description of each parameter follows.
+%
+%    o cube_info: A pointer to the Cube structure.
+%
+%    o image: The image.
+%
+%    o first_row, last_row: The band of rows [first_row,last_row) to
+%      classify.
+%
+%    o row_count: The number of rows classified so far, shared by all
+%      bands for progress reporting.
+%
+%    o exception: Return any errors or warnings in this structure.
+%
+*/
+static MagickBool ClassifyImageProgress(const Image *image,
+  unsigned long *row_count,ExceptionInfo *exception)
+{
+  unsigned long
+    thread_row_count;
+
+#if defined(HAVE_OPENMP)
+#  pragma omp atomic
+#endif
+  (*row_count)++;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush
+#endif
+  thread_row_count=(*row_count);
+  if (QuantumTick(thread_row_count,image->rows))
+    if (!MagickMonitorFormatted(thread_row_count,image->rows,exception,
+                                ClassifyImageText,image->filename))
+      return(MagickFalse);
+  return(MagickTrue);
+}
+
+static MagickPassFail ClassifyImageRows(CubeInfo *cube_info,const Image *image,
+  const long first_row,const long last_row,unsigned long *row_count,
+  ExceptionInfo *exception)
+{
+
   double
     bisect;
 
@@ -606,7 +1013,7 @@ static MagickPassFail ClassifyImageColors(CubeInfo *cube_info,const Image *image
   /*
     Classify the first 256 colors to a tree depth of 8.
   */
-  for (y=0; (y < (long) image->rows) && (cube_info->colors < 256); y++)
+  for (y=first_row; (y < last_row) && (cube_info->colors < 256); y++)
   {
     p=AcquireImagePixels(image,0,y,image->columns,1,exception);
     if (p == (const PixelPacket *) NULL)
@@ -682,21 +1089,19 @@ static MagickPassFail ClassifyImageColors(CubeInfo *cube_info,const Image *image
       node_info->total_blue+=(double) count*p->blue;
       p+=count;
     }
-    if (QuantumTick(y,image->rows))
-      if (!MagickMonitorFormatted(y,image->rows,exception,
-                                  ClassifyImageText,image->filename))
-        {
-          status=MagickFail;
-          break;
-        }
+    if (!ClassifyImageProgress(image,row_count,exception))
+      {
+        status=MagickFail;
+        break;
+      }
   }
-  if ((status == MagickFail) || (y == (long) image->rows))
+  if ((status == MagickFail) || (y == last_row))
     return status;
   /*
     More than 256 colors;  classify to the cube_info->depth tree depth.
   */
   PruneToCubeDepth(cube_info,cube_info->root);
-  for ( ; y < (long) image->rows; y++)
+  for ( ; y < last_row; y++)
   {
     p=AcquireImagePixels(image,0,y,image->columns,1,exception);
     if (p == (const PixelPacket *) NULL)
@@ -772,13 +1177,11 @@ static MagickPassFail ClassifyImageColors(CubeInfo *cube_info,const Image *image
       node_info->total_blue+=(double) count*p->blue;
       p+=count;
     }
-    if (QuantumTick(y,image->rows))
-      if (!MagickMonitorFormatted(y,image->rows,exception,
-                                  ClassifyImageText,image->filename))
-        {
-          status=MagickFail;
-          break;
-        }
+    if (!ClassifyImageProgress(image,row_count,exception))
+      {
+        status=MagickFail;
+        break;
+      }
   }
   return(status);
 }
@@ -948,6 +1351,50 @@ MagickExport void CompressImageColormap(Image *image)
   (void) QuantizeImage(&quantize_info,image);
 }
 
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   C o u n t C u b e C o l o r s                                             %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  CountCubeColors() adds the number of color cube tree nodes which define
+%  a colormap entry to the colors member of the cube.
+%
+%  This is a recursive function.
+%
+%  The format of the CountCubeColors method is:
+%
+%      void CountCubeColors(CubeInfo *cube_info,const NodeInfo *node_info)
+%
+%  A description of each parameter follows.
+%
+%    o cube_info: A pointer to the Cube structure.
+%
+%    o node_info: The address of a structure of type NodeInfo which points to a
+%      node in the color cube tree.
+%
+%
+*/
+static void CountCubeColors(CubeInfo *cube_info,const NodeInfo *node_info)
+{
+  register unsigned int
+    id;
+
+  /*
+    Traverse any children.
+  */
+  for (id=0; id < MaxTreeDepth; id++)
+    if (node_info->child[id] != (NodeInfo *) NULL)
+      CountCubeColors(cube_info,node_info->child[id]);
+  if (node_info->number_unique != 0)
+    cube_info->colors++;
+}
+
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
@@ -1046,9 +1493,53 @@ static void DestroyCubeInfo(CubeInfo *cube_info)
   } while (cube_info->node_queue != (Nodes *) NULL);
   if (cube_info->quantize_info->dither)
     MagickFreeMemory(cube_info->cache);
+  if (cube_info->inverse_colormap != (InverseColormap *) NULL)
+    DestroyInverseColormap(cube_info->inverse_colormap);
   MagickFreeMemory(cube_info);
 }
 
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   D e s t r o y I n v e r s e C o l o r m a p                               %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  DestroyInverseColormap() deallocates memory associated with an inverse
+%  colormap.
+%
+%  The format of the DestroyInverseColormap method is:
+%
+%      DestroyInverseColormap(InverseColormap *inverse_colormap)
+%
+%  A description of each parameter follows:
+%
+%    o inverse_colormap: The inverse colormap.
+%
+%
+*/
+static void DestroyInverseColormap(InverseColormap *inverse_colormap)
+{
+  InverseColormapEntries
+    *entries;
+
+  while (inverse_colormap->entries_queue != (InverseColormapEntries *) NULL)
+    {
+      entries=inverse_colormap->entries_queue->next;
+      MagickFreeMemory(inverse_colormap->entries_queue->entries);
+      MagickFreeMemory(inverse_colormap->entries_queue);
+      inverse_colormap->entries_queue=entries;
+    }
+  MagickFreeMemory(inverse_colormap->cells);
+  MagickFreeMemory(inverse_colormap->candidates);
+  MagickFreeMemory(inverse_colormap->candidate_distances);
+  MagickFreeMemory(inverse_colormap);
+}
+
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
@@ -1126,6 +1617,9 @@ static MagickPassFail Dither(CubeInfo *cube_info,Image *image,
   register CubeInfo
     *p;
 
+  register const PixelPacket
+    *r;
+
   register IndexPacket
     *indexes;
 
@@ -1136,19 +1630,47 @@ static MagickPassFail Dither(CubeInfo *cube_info,Image *image,
     *q;
 
   p=cube_info;
-  if ((p->x >= 0) && (p->x < (long) image->columns) &&
-      (p->y >= 0) && (p->y < (long) image->rows))
+  if (p->region_pixels != (const PixelPacket *) NULL)
     {
       /*
-        Distribute error.
+        Dither a region of pixels which has already been retrieved.
       */
+      if ((p->x < p->region.x) ||
+          (p->x >= p->region.x+(long) p->region.width) ||
+          (p->y < p->region.y) ||
+          (p->y >= p->region.y+(long) p->region.height))
+        r=(const PixelPacket *) NULL;
+      else
+        {
+          i=(p->y-p->region.y)*(long) p->region.width+(p->x-p->region.x);
+          r=p->region_pixels+i;
+          q=(PixelPacket *) NULL;
+          indexes=(IndexPacket *) NULL;
+          if (p->region_output != (PixelPacket *) NULL)
+            q=p->region_output+i;
+          if (p->region_indexes != (IndexPacket *) NULL)
+            indexes=p->region_indexes+i;
+        }
+    }
+  else if ((p->x >= 0) && (p->x < (long) image->columns) &&
+           (p->y >= 0) && (p->y < (long) image->rows))
+    {
       q=GetImagePixels(image,p->x,p->y,1,1);
       if (q == (PixelPacket *) NULL)
         return(MagickFail);
       indexes=AccessMutableIndexes(image);
-      error.red=q->red;
-      error.green=q->green;
-      error.blue=q->blue;
+      r=q;
+    }
+  else
+    r=(const PixelPacket *) NULL;
+  if (r != (const PixelPacket *) NULL)
+    {
+      /*
+        Distribute error.
+      */
+      error.red=r->red;
+      error.green=r->green;
+      error.blue=r->blue;
       for (i=0; i < ExceptionQueueLength; i++)
       {
         error.red+=p->error[i].red*p->weights[i];
@@ -1162,49 +1684,31 @@ static MagickPassFail Dither(CubeInfo *cube_info,Image *image,
 
       i=(pixel.blue >> CacheShift) << 12 | (pixel.green >> CacheShift) << 6 |
         (pixel.red >> CacheShift);
-      if (p->cache[i] < 0)
+      if ((p->cache[i] < 0) ||
+          ((p->cache_stamps != (long *) NULL) &&
+           (p->cache_stamps[i] != p->cache_stamp)))
         {
-          register NodeInfo
-            *node_info;
-
-          register unsigned int
-            id;
-
-          /*
-            Identify the deepest node containing the pixel's color.
-          */
-          node_info=p->root;
-          for (index=MaxTreeDepth-1; (long) index > 0; index--)
-          {
-            id=ColorToNodeId(pixel.red,pixel.green,pixel.blue,index);
-            if (node_info->child[id] == (NodeInfo *) NULL)
-              break;
-            node_info=node_info->child[id];
-          }
-          /*
-            Find closest color among siblings and their children.
-          */
-          p->color.red=pixel.red;
-          p->color.green=pixel.green;
-          p->color.blue=pixel.blue;
-          p->distance=3.0*(MaxRGBDouble+1.0)*(MaxRGBDouble+1.0);
-          ClosestColor(image,p,node_info->parent);
-          p->cache[i]=(long) p->color_number;
+          p->cache[i]=(long) FindClosestColor(image,p,&pixel);
+          if (p->cache_stamps != (long *) NULL)
+            p->cache_stamps[i]=p->cache_stamp;
         }
       /*
         Assign pixel to closest colormap entry.
       */
       index=(IndexPacket) p->cache[i];
-      if (image->storage_class == PseudoClass)
+      if ((image->storage_class == PseudoClass) &&
+          (indexes != (IndexPacket *) NULL))
         *indexes=index;
-      if (!cube_info->quantize_info->measure_error)
+      if ((!cube_info->quantize_info->measure_error) &&
+          (q != (PixelPacket *) NULL))
         {
           q->red=image->colormap[index].red;
           q->green=image->colormap[index].green;
           q->blue=image->colormap[index].blue;
         }
-      if (!SyncImagePixels(image))
-        return(MagickFail);
+      if (p->region_pixels == (const PixelPacket *) NULL)
+        if (!SyncImagePixels(image))
+          return(MagickFail);
       /*
         Propagate the error as the last entry of the error queue.
       */
@@ -1229,62 +1733,447 @@ static MagickPassFail Dither(CubeInfo *cube_info,Image *image,
 %                                                                             %
 %                                                                             %
 %                                                                             %
-+   D i t h e r I m a g e                                                     %
++   D i t h e r I m a g e                                                     %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  DitherImage() distributes the difference between an original image and the
+%  corresponding color reduced algorithm to neighboring pixels along a Hilbert
+%  curve.  DitherImage returns True if the image is dithered otherwise False.
+%
+%  This algorithm is strongly based on a similar algorithm by Thiadmer
+%  Riemersma.
+%
+%  The format of the DitherImage method is:
+%
+%      unsigned int DitherImage(CubeInfo *cube_info,Image *image)
+%
+%  A description of each parameter follows.
+%
+%    o cube_info: A pointer to the Cube structure.
+%
+%    o image: Specifies a pointer to an Image structure;  returned from
+%      ReadImage.
+%
+%
+*/
+static MagickPassFail DitherImage(CubeInfo *cube_info,Image *image)
+{
+  const char
+    *value;
+
+  register unsigned long
+    i;
+
+  unsigned long
+    depth;
+
+  /*
+    Initialize error queue.
+  */
+  for (i=0; i < ExceptionQueueLength; i++)
+  {
+    cube_info->error[i].red=0.0;
+    cube_info->error[i].green=0.0;
+    cube_info->error[i].blue=0.0;
+  }
+  /*
+    Distribute quantization error along a Hilbert curve.
+  */
+  cube_info->x=0;
+  cube_info->y=0;
+  i=image->columns > image->rows ? image->columns : image->rows;
+  for (depth=1; i != 0; depth++)
+    i>>=1;
+  /*
+    Dithering squares of the image in parallel changes the result, so
+    it is only done on request.
+  */
+  if ((depth-1 > DitherSegmentLevel) &&
+      ((value=getenv("MAGICK_DITHER_SEGMENTS")) != (const char *) NULL) &&
+      (LocaleCompare(value,"TRUE") == 0))
+    return(DitherImageSegments(cube_info,image,depth-1));
+  HilbertCurve(cube_info,image,depth-1,NorthGravity);
+  (void) Dither(cube_info,image,ForgetGravity);
+  return(MagickPass);
+}
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   D i t h e r I m a g e S e g m e n t s                                     %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  DitherImageSegments() dithers an image along the same Hilbert curve as
+%  DitherImage(), but splits the curve into the sub-curves which cover
+%  aligned squares of the image and dithers the squares in parallel.
+%
+%  Before any pixels are modified, the error queue at the start of each
+%  square is primed by dithering (without storing) the last few pixels of
+%  the curve in the preceding square.  This hides the seam between the
+%  squares.  The result does not depend on the number of threads used.
+%
+%  The format of the DitherImageSegments method is:
+%
+%      unsigned int DitherImageSegments(CubeInfo *cube_info,Image *image,
+%        const unsigned long level)
+%
+%  A description of each parameter follows.
+%
+%    o cube_info: A pointer to the Cube structure.
+%
+%    o image: The image.
+%
+%    o level: The level of the Hilbert curve which covers the image.
+%
+%
+*/
+
+static unsigned int HilbertLastQuadrant(const unsigned int direction)
+{
+  switch (direction)
+  {
+    case WestGravity: return(SouthGravity);
+    case EastGravity: return(NorthGravity);
+    case NorthGravity: return(EastGravity);
+    case SouthGravity: return(WestGravity);
+    default: break;
+  }
+  return(direction);
+}
+
+static void HilbertMove(long *x,long *y,const unsigned int direction,
+  const long span)
+{
+  /*
+    Move from the start to the end of a Hilbert curve which spans span+1
+    pixels in the given direction.
+  */
+  switch (direction)
+  {
+    case WestGravity: *y+=span; break;
+    case EastGravity: *y-=span; break;
+    case NorthGravity: *x+=span; break;
+    case SouthGravity: *x-=span; break;
+    default: break;
+  }
+}
+
+static MagickBool DitherRegion(const Image *image,const long x,const long y,
+  const unsigned long level,RectangleInfo *region)
+{
+  long
+    side;
+
+  /*
+    Intersect the image with the square of the given level which holds x,y.
+  */
+  side=1L << level;
+  region->x=(x/side)*side;
+  region->y=(y/side)*side;
+  if ((region->x >= (long) image->columns) ||
+      (region->y >= (long) image->rows))
+    return(MagickFalse);
+  region->width=Min((unsigned long) side,image->columns-region->x);
+  region->height=Min((unsigned long) side,image->rows-region->y);
+  return(MagickTrue);
+}
+
+static MagickPassFail DitherImageSegments(CubeInfo *cube_info,Image *image,
+  const unsigned long level)
+{
+  DitherPlan
+    plan;
+
+  long
+    segment;
+
+  ThreadViewDataSet
+    *caches;
+
+  MagickPassFail
+    status=MagickPass;
+
+  /*
+    Split the Hilbert curve into sub-curves.
+  */
+  plan.level=DitherSegmentLevel;
+  if (level > plan.level+MaxDitherSegmentLevels)
+    plan.level=level-MaxDitherSegmentLevels;
+  plan.number_segments=0;
+  plan.x=0;
+  plan.y=0;
+  plan.segments=MagickAllocateArray(DitherSegment *,
+                                    (size_t) 1 << (2*(level-plan.level)),
+                                    sizeof(DitherSegment));
+  if (plan.segments == (DitherSegment *) NULL)
+    ThrowBinaryException3(ResourceLimitError,MemoryAllocationFailed,
+                          UnableToQuantizeImage);
+  HilbertSegments(&plan,level,NorthGravity);
+  /*
+    Each thread uses its own closest color cache.  Cache entries are
+    stamped with the segment which stored them, so that the colors
+    chosen within a segment do not depend on which segments the thread
+    dithered before.
+  */
+  caches=AllocateThreadViewDataArray(image,&image->exception,2*(1 << 18),
+                                     sizeof(long));
+  if (caches == (ThreadViewDataSet *) NULL)
+    {
+      MagickFreeMemory(plan.segments);
+      return(MagickFail);
+    }
+  /*
+    Prime the error queue of each segment from the original pixels at
+    the end of the preceding segment.
+  */
+#if defined(HAVE_OPENMP)
+#  pragma omp parallel for schedule(guided) shared(status)
+#endif
+  for (segment=0; segment < (long) plan.number_segments; segment++)
+    {
+      CubeInfo
+        thread_info;
+
+      DitherSegment
+        *previous;
+
+      RectangleInfo
+        region;
+
+      register long
+        j;
+
+      long
+        x,
+        y;
+
+      unsigned int
+        direction;
+
+      (void) memset(plan.segments[segment].error,0,
+                    sizeof(plan.segments[segment].error));
+      if ((segment == 0) || (status == MagickFail))
+        continue;
+      if (!DitherRegion(image,plan.segments[segment].x,
+                        plan.segments[segment].y,plan.level,&region))
+        continue;
+      previous=plan.segments+segment-1;
+      x=previous->x;
+      y=previous->y;
+      HilbertMove(&x,&y,previous->direction,(1L << plan.level)-1);
+      direction=previous->direction;
+      for (j=(long) plan.level; j > DitherPrimeLevel; j--)
+        direction=HilbertLastQuadrant(direction);
+      HilbertMove(&x,&y,direction,1-(1L << DitherPrimeLevel));
+      if (!DitherRegion(image,x,y,DitherPrimeLevel,&region))
+        continue;
+      thread_info=(*cube_info);
+      thread_info.cache=(long *) AccessThreadViewData(caches);
+      thread_info.cache_stamps=thread_info.cache+(1 << 18);
+      thread_info.cache_stamp=2*segment+1;
+      (void) memset(thread_info.error,0,sizeof(thread_info.error));
+      thread_info.region=region;
+      thread_info.region_output=(PixelPacket *) NULL;
+      thread_info.region_indexes=(IndexPacket *) NULL;
+      thread_info.region_pixels=AcquireImagePixels(image,region.x,region.y,
+                                                   region.width,region.height,
+                                                   &image->exception);
+      if (thread_info.region_pixels == (const PixelPacket *) NULL)
+        {
+          status=MagickFail;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (status)
+#endif
+          continue;
+        }
+      thread_info.x=x;
+      thread_info.y=y;
+      HilbertCurve(&thread_info,image,DitherPrimeLevel,direction);
+      (void) Dither(&thread_info,image,previous->exit);
+      (void) memcpy(plan.segments[segment].error,thread_info.error,
+                    sizeof(thread_info.error));
+    }
+  /*
+    Dither the segments.
+  */
+#if defined(HAVE_OPENMP)
+#  pragma omp parallel for schedule(guided) shared(status)
+#endif
+  for (segment=0; segment < (long) plan.number_segments; segment++)
+    {
+      CubeInfo
+        thread_info;
+
+      RectangleInfo
+        region;
+
+      PixelPacket
+        *q;
+
+      if (status == MagickFail)
+        continue;
+      if (!DitherRegion(image,plan.segments[segment].x,
+                        plan.segments[segment].y,plan.level,&region))
+        continue;
+      q=GetImagePixelsEx(image,region.x,region.y,region.width,region.height,
+                         &image->exception);
+      if (q == (PixelPacket *) NULL)
+        {
+          status=MagickFail;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (status)
+#endif
+          continue;
+        }
+      thread_info=(*cube_info);
+      thread_info.cache=(long *) AccessThreadViewData(caches);
+      thread_info.cache_stamps=thread_info.cache+(1 << 18);
+      thread_info.cache_stamp=2*segment+2;
+      (void) memcpy(thread_info.error,plan.segments[segment].error,
+                    sizeof(thread_info.error));
+      thread_info.region=region;
+      thread_info.region_pixels=q;
+      thread_info.region_output=q;
+      thread_info.region_indexes=AccessMutableIndexes(image);
+      thread_info.x=plan.segments[segment].x;
+      thread_info.y=plan.segments[segment].y;
+      HilbertCurve(&thread_info,image,plan.level,
+                   plan.segments[segment].direction);
+      (void) Dither(&thread_info,image,plan.segments[segment].exit);
+      if (!SyncImagePixelsEx(image,&image->exception))
+        {
+          status=MagickFail;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (status)
+#endif
+        }
+    }
+  DestroyThreadViewDataSet(caches);
+  MagickFreeMemory(plan.segments);
+  return(status);
+}
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   F i n d C l o s e s t C o l o r                                           %
 %                                                                             %
 %                                                                             %
 %                                                                             %
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %
-%  DitherImage() distributes the difference between an original image and the
-%  corresponding color reduced algorithm to neighboring pixels along a Hilbert
-%  curve.  DitherImage returns True if the image is dithered otherwise False.
-%
-%  This algorithm is strongly based on a similar algorithm by Thiadmer
-%  Riemersma.
+%  FindClosestColor() returns the colormap entry which best represents a
+%  color, which is the closest color among the siblings and children of
+%  the deepest node in the color cube tree containing the color.  When the
+%  cube has an inverse colormap, only the colormap entries which may be
+%  closest to some color within the same inverse colormap cell are
+%  compared, which selects the same entry.
 %
-%  The format of the DitherImage method is:
+%  The format of the FindClosestColor method is:
 %
-%      unsigned int DitherImage(CubeInfo *cube_info,Image *image)
+%      unsigned long FindClosestColor(Image *image,CubeInfo *cube_info,
+%        const PixelPacket *color)
 %
 %  A description of each parameter follows.
 %
+%    o image: The image.
+%
 %    o cube_info: A pointer to the Cube structure.
 %
-%    o image: Specifies a pointer to an Image structure;  returned from
-%      ReadImage.
+%    o color: The color to find.
 %
 %
 */
-static MagickPassFail DitherImage(CubeInfo *cube_info,Image *image)
+static unsigned long FindClosestColor(Image *image,CubeInfo *cube_info,
+  const PixelPacket *color)
 {
-  register unsigned long
-    i;
+  register const NodeInfo
+    *node_info;
 
-  unsigned long
-    depth;
+  register long
+    index;
+
+  unsigned int
+    id;
+
+  if (cube_info->inverse_colormap != (InverseColormap *) NULL)
+    {
+      const unsigned long
+        *cell;
+
+      cell=GetInverseColormapCell(image,cube_info,color);
+      if ((cell != (const unsigned long *) NULL) && (cell[0] != 0))
+        {
+          double
+            distance,
+            minimum_distance;
 
+          DoublePixelPacket
+            pixel;
+
+          register const PixelPacket
+            *entry;
+
+          register unsigned long
+            i;
+
+          unsigned long
+            color_number;
+
+          /*
+            Find the closest of the candidate colors in tree order.
+          */
+          color_number=cell[1];
+          minimum_distance=3.0*(MaxRGBDouble+1.0)*(MaxRGBDouble+1.0);
+          for (i=1; i <= cell[0]; i++)
+            {
+              entry=image->colormap+cell[i];
+              pixel.red=(double) entry->red-color->red;
+              pixel.green=(double) entry->green-color->green;
+              pixel.blue=(double) entry->blue-color->blue;
+              distance=pixel.red*pixel.red+pixel.green*pixel.green+
+                pixel.blue*pixel.blue;
+              if (distance < minimum_distance)
+                {
+                  minimum_distance=distance;
+                  color_number=cell[i];
+                }
+            }
+          return(color_number);
+        }
+    }
   /*
-    Initialize error queue.
+    Identify the deepest node containing the pixel's color.
   */
-  for (i=0; i < ExceptionQueueLength; i++)
-  {
-    cube_info->error[i].red=0.0;
-    cube_info->error[i].green=0.0;
-    cube_info->error[i].blue=0.0;
-  }
+  node_info=cube_info->root;
+  for (index=MaxTreeDepth-1; index > 0; index--)
+    {
+      id=ColorToNodeId(color->red,color->green,color->blue,index);
+      if (node_info->child[id] == (NodeInfo *) NULL)
+        break;
+      node_info=node_info->child[id];
+    }
   /*
-    Distribute quantization error along a Hilbert curve.
+    Find closest color among siblings and their children.
   */
-  cube_info->x=0;
-  cube_info->y=0;
-  i=image->columns > image->rows ? image->columns : image->rows;
-  for (depth=1; i != 0; depth++)
-    i>>=1;
-  HilbertCurve(cube_info,image,depth-1,NorthGravity);
-  (void) Dither(cube_info,image,ForgetGravity);
-  return(MagickPass);
+  cube_info->color.red=color->red;
+  cube_info->color.green=color->green;
+  cube_info->color.blue=color->blue;
+  cube_info->distance=3.0*(MaxRGBDouble+1.0)*(MaxRGBDouble+1.0);
+  ClosestColor(image,cube_info,node_info->parent);
+  return(cube_info->color_number);
 }
-
+
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
@@ -1576,6 +2465,251 @@ MagickExport MagickPassFail GetImageQuantizeError(Image *image)
   return(status);
 }
 
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   G e t I n v e r s e C o l o r m a p C e l l                               %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  GetInverseColormapCell() returns the inverse colormap cell containing a
+%  color, building it if necessary.  The first element of the cell is the
+%  number of candidate colormap entries which follow it, in the order
+%  ClosestColor() visits them.  A count of zero indicates that colors in
+%  the cell start their search from different color cube nodes, so the
+%  color cube tree must be searched instead.
+%
+%  The format of the GetInverseColormapCell method is:
+%
+%      const unsigned long *GetInverseColormapCell(Image *image,
+%        CubeInfo *cube_info,const PixelPacket *color)
+%
+%  A description of each parameter follows.
+%
+%    o image: The image.
+%
+%    o cube_info: A pointer to the Cube structure.
+%
+%    o color: The color.
+%
+%
+*/
+
+static const unsigned long
+  search_tree_cell[1] = { 0 };
+
+static void CollectColormapCandidates(InverseColormap *inverse_colormap,
+  const NodeInfo *node_info,unsigned long *number_candidates)
+{
+  register unsigned int
+    id;
+
+  /*
+    Collect colormap entries in the order ClosestColor() visits them.
+  */
+  for (id=0; id < MaxTreeDepth; id++)
+    if (node_info->child[id] != (NodeInfo *) NULL)
+      CollectColormapCandidates(inverse_colormap,node_info->child[id],
+                                number_candidates);
+  if ((node_info->number_unique != 0) &&
+      (*number_candidates < inverse_colormap->colors))
+    inverse_colormap->candidates[(*number_candidates)++]=
+      node_info->color_number;
+}
+
+static double CellDistance(const double value,const double lower,
+  const double upper,const MagickBool farthest)
+{
+  double
+    distance;
+
+  if (farthest)
+    distance=Max(value-lower,upper-value);
+  else if (value < lower)
+    distance=lower-value;
+  else if (value > upper)
+    distance=value-upper;
+  else
+    distance=0.0;
+  return(distance*distance);
+}
+
+static const unsigned long *BuildInverseColormapCell(Image *image,
+  CubeInfo *cube_info,const unsigned int key)
+{
+  double
+    farthest,
+    lower[3],
+    threshold,
+    upper[3];
+
+  InverseColormap
+    *inverse_colormap;
+
+  register const NodeInfo
+    *node_info;
+
+  register long
+    i;
+
+  register unsigned long
+    *cell;
+
+  unsigned char
+    cell_color[3];
+
+  unsigned int
+    children,
+    id;
+
+  unsigned long
+    number_candidates,
+    number_entries;
+
+  inverse_colormap=cube_info->inverse_colormap;
+  cell_color[0]=(unsigned char) (((key >> 12) & 0x3f) << 2);
+  cell_color[1]=(unsigned char) (((key >> 6) & 0x3f) << 2);
+  cell_color[2]=(unsigned char) ((key & 0x3f) << 2);
+  /*
+    Descend the tree as far as the cell determines the path, which is
+    through the levels indexed by the six most significant bits.
+  */
+  node_info=cube_info->root;
+  for (i=MaxTreeDepth-1; i > 1; i--)
+    {
+      id=(((cell_color[0] >> i) & 0x01) << 2 |
+          ((cell_color[1] >> i) & 0x01) << 1 |
+          ((cell_color[2] >> i) & 0x01));
+      if (node_info->child[id] == (NodeInfo *) NULL)
+        break;
+      node_info=node_info->child[id];
+    }
+  if (i == 1)
+    {
+      /*
+        The deepest node depends on the least significant bits unless
+        the node has no children or all of them.
+      */
+      children=0;
+      for (id=0; id < MaxTreeDepth; id++)
+        if (node_info->child[id] != (NodeInfo *) NULL)
+          children++;
+      if (children == MaxTreeDepth)
+        node_info=node_info->child[0];
+      else if (children != 0)
+        return(search_tree_cell);
+    }
+  number_candidates=0;
+  CollectColormapCandidates(inverse_colormap,node_info->parent,
+                            &number_candidates);
+  if (number_candidates == 0)
+    return(search_tree_cell);
+  /*
+    Discard the candidates which are farther from every color in the cell
+    than some other candidate is from all of them.
+  */
+  for (i=0; i < 3; i++)
+    {
+      lower[i]=(double) ScaleCharToQuantum(cell_color[i]);
+      if (cell_color[i] >= 252)
+        upper[i]=MaxRGBDouble;
+      else
+        upper[i]=(double) ScaleCharToQuantum(cell_color[i]+4)-1.0;
+    }
+  threshold=3.0*(MaxRGBDouble+1.0)*(MaxRGBDouble+1.0);
+  for (i=0; i < (long) number_candidates; i++)
+    {
+      register const PixelPacket
+        *entry;
+
+      entry=image->colormap+inverse_colormap->candidates[i];
+      inverse_colormap->candidate_distances[i]=
+        CellDistance(entry->red,lower[0],upper[0],MagickFalse)+
+        CellDistance(entry->green,lower[1],upper[1],MagickFalse)+
+        CellDistance(entry->blue,lower[2],upper[2],MagickFalse);
+      farthest=CellDistance(entry->red,lower[0],upper[0],MagickTrue)+
+        CellDistance(entry->green,lower[1],upper[1],MagickTrue)+
+        CellDistance(entry->blue,lower[2],upper[2],MagickTrue);
+      if (farthest < threshold)
+        threshold=farthest;
+    }
+  number_entries=0;
+  for (i=0; i < (long) number_candidates; i++)
+    if (inverse_colormap->candidate_distances[i] <= threshold)
+      number_entries++;
+  if (inverse_colormap->free_entries < number_entries+1)
+    {
+      InverseColormapEntries
+        *entries;
+
+      size_t
+        length;
+
+      /*
+        Allocate a new list of entries.
+      */
+      length=Max(InverseColormapEntriesInAList,number_entries+1);
+      entries=MagickAllocateMemory(InverseColormapEntries *,
+                                   sizeof(InverseColormapEntries));
+      if (entries == (InverseColormapEntries *) NULL)
+        return((const unsigned long *) NULL);
+      entries->entries=MagickAllocateArray(unsigned long *,length,
+                                           sizeof(unsigned long));
+      if (entries->entries == (unsigned long *) NULL)
+        {
+          MagickFreeMemory(entries);
+          return((const unsigned long *) NULL);
+        }
+      entries->next=inverse_colormap->entries_queue;
+      inverse_colormap->entries_queue=entries;
+      inverse_colormap->next_entry=entries->entries;
+      inverse_colormap->free_entries=length;
+    }
+  cell=inverse_colormap->next_entry;
+  inverse_colormap->next_entry+=number_entries+1;
+  inverse_colormap->free_entries-=number_entries+1;
+  cell[0]=number_entries;
+  number_entries=0;
+  for (i=0; i < (long) number_candidates; i++)
+    if (inverse_colormap->candidate_distances[i] <= threshold)
+      cell[++number_entries]=inverse_colormap->candidates[i];
+  return(cell);
+}
+
+static const unsigned long *GetInverseColormapCell(Image *image,
+  CubeInfo *cube_info,const PixelPacket *color)
+{
+  const unsigned long
+    *cell;
+
+  unsigned int
+    key;
+
+  key=((unsigned int) (ScaleQuantumToChar(color->red) >> 2) << 12) |
+    ((unsigned int) (ScaleQuantumToChar(color->green) >> 2) << 6) |
+    ((unsigned int) (ScaleQuantumToChar(color->blue) >> 2));
+  cell=InverseColormapLoad(cube_info->inverse_colormap->cells[key]);
+  if (cell != (const unsigned long *) NULL)
+    return(cell);
+#if defined(HAVE_OPENMP)
+#  pragma omp critical (GM_GetInverseColormapCell)
+#endif
+  {
+    cell=cube_info->inverse_colormap->cells[key];
+    if (cell == (const unsigned long *) NULL)
+      {
+        cell=BuildInverseColormapCell(image,cube_info,key);
+        if (cell != (const unsigned long *) NULL)
+          InverseColormapStore(cube_info->inverse_colormap->cells[key],cell);
+      }
+  }
+  return(cell);
+}
+
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
@@ -1996,6 +3130,122 @@ static void HilbertCurve(CubeInfo *cube_info,Image *image,
   }
 }
 
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   H i l b e r t S e g m e n t s                                             %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  HilbertSegments() follows the same path as HilbertCurve() but, rather
+%  than dithering, records the start position and direction of each
+%  sub-curve at the level of the plan, along with the direction of the
+%  step which connects it to the next sub-curve.
+%
+%  This is a recursive function.
+%
+%  The format of the HilbertSegments method is:
+%
+%      void HilbertSegments(DitherPlan *plan,const unsigned long level,
+%        const unsigned int direction)
+%
+%  A description of each parameter follows.
+%
+%    o plan: The dither plan to add segments to.
+%
+%    o level: The level of the curve.
+%
+%    o direction:  This unsigned direction describes which direction
+%      to move to next to follow the Hilbert curve.
+%
+%
+*/
+
+static void HilbertStep(DitherPlan *plan,const unsigned int direction)
+{
+  plan->segments[plan->number_segments-1].exit=direction;
+  switch (direction)
+  {
+    case WestGravity: plan->x--; break;
+    case EastGravity: plan->x++; break;
+    case NorthGravity: plan->y--; break;
+    case SouthGravity: plan->y++; break;
+    default: break;
+  }
+}
+
+static void HilbertSegments(DitherPlan *plan,const unsigned long level,
+  const unsigned int direction)
+{
+  if (level == plan->level)
+    {
+      DitherSegment
+        *segment;
+
+      segment=plan->segments+plan->number_segments++;
+      segment->x=plan->x;
+      segment->y=plan->y;
+      segment->direction=direction;
+      segment->exit=ForgetGravity;
+      HilbertMove(&plan->x,&plan->y,direction,(1L << level)-1);
+      return;
+    }
+  switch (direction)
+  {
+    case WestGravity:
+    {
+      HilbertSegments(plan,level-1,NorthGravity);
+      HilbertStep(plan,EastGravity);
+      HilbertSegments(plan,level-1,WestGravity);
+      HilbertStep(plan,SouthGravity);
+      HilbertSegments(plan,level-1,WestGravity);
+      HilbertStep(plan,WestGravity);
+      HilbertSegments(plan,level-1,SouthGravity);
+      break;
+    }
+    case EastGravity:
+    {
+      HilbertSegments(plan,level-1,SouthGravity);
+      HilbertStep(plan,WestGravity);
+      HilbertSegments(plan,level-1,EastGravity);
+      HilbertStep(plan,NorthGravity);
+      HilbertSegments(plan,level-1,EastGravity);
+      HilbertStep(plan,EastGravity);
+      HilbertSegments(plan,level-1,NorthGravity);
+      break;
+    }
+    case NorthGravity:
+    {
+      HilbertSegments(plan,level-1,WestGravity);
+      HilbertStep(plan,SouthGravity);
+      HilbertSegments(plan,level-1,NorthGravity);
+      HilbertStep(plan,EastGravity);
+      HilbertSegments(plan,level-1,NorthGravity);
+      HilbertStep(plan,NorthGravity);
+      HilbertSegments(plan,level-1,EastGravity);
+      break;
+    }
+    case SouthGravity:
+    {
+      HilbertSegments(plan,level-1,EastGravity);
+      HilbertStep(plan,NorthGravity);
+      HilbertSegments(plan,level-1,SouthGravity);
+      HilbertStep(plan,WestGravity);
+      HilbertSegments(plan,level-1,SouthGravity);
+      HilbertStep(plan,SouthGravity);
+      HilbertSegments(plan,level-1,WestGravity);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
@@ -2161,6 +3411,67 @@ MagickExport MagickPassFail MapImages(Image *images,const Image *map_image,
   return(status);
 }
 
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   M e r g e C u b e I n f o                                                 %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  MergeCubeInfo() adds the color statistics of a color cube tree node and
+%  all of its children to the corresponding nodes of another color cube,
+%  allocating any nodes which are not yet present.
+%
+%  This is a recursive function.
+%
+%  The format of the MergeCubeInfo method is:
+%
+%      MagickPassFail MergeCubeInfo(CubeInfo *cube_info,NodeInfo *destination,
+%        const NodeInfo *source)
+%
+%  A description of each parameter follows.
+%
+%    o cube_info: A pointer to the Cube structure to merge into.
+%
+%    o destination: The node of cube_info corresponding to source.
+%
+%    o source: The node of the color cube tree to merge.
+%
+%
+*/
+static MagickPassFail MergeCubeInfo(CubeInfo *cube_info,NodeInfo *destination,
+  const NodeInfo *source)
+{
+  register unsigned int
+    id;
+
+  destination->number_unique+=source->number_unique;
+  destination->total_red+=source->total_red;
+  destination->total_green+=source->total_green;
+  destination->total_blue+=source->total_blue;
+  destination->quantize_error+=source->quantize_error;
+  for (id=0; id < MaxTreeDepth; id++)
+    {
+      if (source->child[id] == (NodeInfo *) NULL)
+        continue;
+      if (destination->child[id] == (NodeInfo *) NULL)
+        {
+          destination->child[id]=GetNodeInfo(cube_info,id,
+                                             source->child[id]->level,
+                                             destination);
+          if (destination->child[id] == (NodeInfo *) NULL)
+            return(MagickFail);
+        }
+      if (!MergeCubeInfo(cube_info,destination->child[id],source->child[id]))
+        return(MagickFail);
+    }
+  return(MagickPass);
+}
+
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
@@ -51,6 +51,12 @@ typedef struct _PrimitiveInfo
 #define PRIMINF_SET_IS_CLOSED_SUBPATH(pi,zero_or_one) ((pi)->flags=((pi)->flags&(~1U))|(unsigned long)zero_or_one)
 } PrimitiveInfo;
 
+extern void
+  DestroyAnnotateInfo(void);
+
+extern MagickPassFail
+  InitializeAnnotateInfo(void);
+
 /*
  * Local Variables:
  * mode: c
@@ -92,14 +92,10 @@ typedef struct _EdgeInfo
   SegmentInfo
     bounds;
 
-  double
-    scanline;
-
   PointInfo
     *points;
 
   size_t
-    highwater,
     number_points;
 
   long
@@ -119,6 +115,53 @@ typedef struct _PolygonInfo
     number_edges;
 } PolygonInfo;
 
+typedef struct _ActiveEdgeInfo
+{
+  const EdgeInfo
+    *edge;
+
+  size_t
+    first,
+    last;
+
+  const PointInfo
+    *segment;
+
+  double
+    enter,
+    leave;
+} ActiveEdgeInfo;
+
+typedef struct _ActiveEdgeTable
+{
+  long
+    y;
+
+  size_t
+    allocated_edges,
+    number_edges,
+    started,
+    crossed,
+    number_pending,
+    *pending,
+    *highwater;
+
+  ActiveEdgeInfo
+    *stroke_edges,
+    *fill_edges;
+
+  size_t
+    number_stroke_edges,
+    next_stroke_edge,
+    live_stroke_edges,
+    number_fill_edges,
+    next_fill_edge,
+    live_fill_edges;
+
+  int
+    winding_number;
+} ActiveEdgeTable;
+
 typedef enum
 {
   MoveToCode,
@@ -157,6 +200,77 @@ typedef struct _PrimitiveInfoMgr
   ExceptionInfo *  p_Exception;       /* for when reallocation fails */
 } PrimitiveInfoMgr;
 
+/*
+  A display list records the primitives parsed by DrawImage() together
+  with the graphic context they were drawn with, so that they may be
+  drawn again without parsing the primitive text.
+*/
+typedef struct _DrawDisplayItem
+{
+  DrawInfo
+    *draw_info;
+
+  PrimitiveInfo
+    *primitive_info;
+
+  size_t
+    number_points;
+} DrawDisplayItem;
+
+struct _DrawDisplayList
+{
+  DrawInfo
+    *draw_info;
+
+  DrawDisplayItem
+    *items;
+
+  size_t
+    number_items,
+    allocated_items;
+
+  MagickBool
+    replayable;
+
+  unsigned long
+    signature;
+};
+
+
+/*
+  Polygons collected by DrawPolygonPrimitive() for drawing by horizontal
+  bands of the image rather than one at a time.
+*/
+typedef struct _DeferredPolygonInfo
+{
+  DrawInfo
+    *draw_info;
+
+  PolygonInfo
+    *polygon_info;
+
+  double
+    mid;
+
+  unsigned int
+    fill;
+
+  long
+    x_start,
+    x_stop,
+    y_start,
+    y_stop;
+} DeferredPolygonInfo;
+
+typedef struct _DeferredPolygonList
+{
+  DeferredPolygonInfo
+    *polygons;
+
+  size_t
+    number_polygons,
+    allocated_polygons;
+} DeferredPolygonList;
 
 /*
   DrawInfoExtra allows for expansion of DrawInfo without increasing its
@@ -177,6 +291,13 @@ typedef struct _DrawInfoExtra
       the composite path's graphical elements.
     */
     *composite_path;
+
+  /*
+    When not null, DrawPolygonPrimitive() appends polygons to this list
+    instead of drawing them.
+  */
+  DeferredPolygonList
+    *deferred_polygons;
 } DrawInfoExtra;
 
 /* provide public access to the clip_path member of DrawInfo */
@@ -199,9 +320,20 @@ DrawInfoGetCompositePath(const DrawInfo * draw_info)
 static PrimitiveInfo  /* added Image* param so DrawInfo::stroke_width can be clamped */
   *TraceStrokePolygon(const Image *,const DrawInfo *,const PrimitiveInfo *,ExceptionInfo *exception);
 
+static void
+  DestroyDeferredPolygons(DeferredPolygonList *);
+
+static DeferredPolygonList
+  *InitializeDeferredPolygons(const Image *,DeferredPolygonList *);
+
+static MagickBool
+  IsDeferrablePrimitive(const PrimitiveType);
+
 static MagickPassFail
   DrawBoundingRectangles(Image *image,const DrawInfo *draw_info,
                          const PolygonInfo *polygon_info) MAGICK_FUNC_WARN_UNUSED_RESULT,
+  DrawDeferredPolygons(Image *,const DeferredPolygonList *) MAGICK_FUNC_WARN_UNUSED_RESULT,
+  FlushDeferredPolygons(Image *,DeferredPolygonList *) MAGICK_FUNC_WARN_UNUSED_RESULT,
   DrawPrimitive(Image *,const DrawInfo *,const PrimitiveInfo *) MAGICK_FUNC_WARN_UNUSED_RESULT,
   DrawStrokePolygon(Image *,const DrawInfo *,const PrimitiveInfo *) MAGICK_FUNC_WARN_UNUSED_RESULT,
   PrimitiveInfoRealloc(PrimitiveInfoMgr *p_PIMgr,const size_t Needed) MAGICK_FUNC_WARN_UNUSED_RESULT,
@@ -352,6 +484,7 @@ CloneDrawInfo(const ImageInfo *image_info,const DrawInfo *draw_info)
     clone_info->extra->clip_path=AllocateString(draw_info->extra->clip_path);
   if (draw_info->extra->composite_path != (char *) NULL)
     clone_info->extra->composite_path=AllocateString(draw_info->extra->composite_path);
+  clone_info->extra->deferred_polygons=draw_info->extra->deferred_polygons;
   clone_info->bounds=draw_info->bounds;
   clone_info->clip_units=draw_info->clip_units;
   clone_info->render=draw_info->render;
@@ -640,8 +773,6 @@ ConvertPathToPolygon(const PathInfo *path_info, ExceptionInfo *exception)
   (void) memset(&point,0,sizeof(PointInfo));
   (void) memset(&bounds,0,sizeof(SegmentInfo));
   polygon_info->edges[edge].number_points=n;
-  polygon_info->edges[edge].scanline=0.0;
-  polygon_info->edges[edge].highwater=0;
   polygon_info->edges[edge].ghostline=ghostline;
   polygon_info->edges[edge].direction=direction;
   polygon_info->edges[edge].points=points;
@@ -676,8 +807,6 @@ ConvertPathToPolygon(const PathInfo *path_info, ExceptionInfo *exception)
                 polygon_info->edges=new_edges;
               }
             polygon_info->edges[edge].number_points=n;
-            polygon_info->edges[edge].scanline=(-1.0);
-            polygon_info->edges[edge].highwater=0;
             polygon_info->edges[edge].ghostline=ghostline;
             polygon_info->edges[edge].direction=direction > 0;
             if (direction < 0)
@@ -747,8 +876,6 @@ ConvertPathToPolygon(const PathInfo *path_info, ExceptionInfo *exception)
             polygon_info->edges=new_edges;
           }
         polygon_info->edges[edge].number_points=n;
-        polygon_info->edges[edge].scanline=(-1.0);
-        polygon_info->edges[edge].highwater=0;
         polygon_info->edges[edge].ghostline=ghostline;
         polygon_info->edges[edge].direction=direction > 0;
         if (direction < 0)
@@ -829,8 +956,6 @@ ConvertPathToPolygon(const PathInfo *path_info, ExceptionInfo *exception)
               polygon_info->edges=new_edges;
             }
           polygon_info->edges[edge].number_points=n;
-          polygon_info->edges[edge].scanline=(-1.0);
-          polygon_info->edges[edge].highwater=0;
           polygon_info->edges[edge].ghostline=ghostline;
           polygon_info->edges[edge].direction=direction > 0;
           if (direction < 0)
@@ -1088,43 +1213,6 @@ DestroyDrawInfo(DrawInfo *draw_info)
 %                                                                             %
 %                                                                             %
 %                                                                             %
-+   D e s t r o y E d g e                                                     %
-%                                                                             %
-%                                                                             %
-%                                                                             %
-%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
-%
-%  Method DestroyEdge destroys the specified polygon edge.
-%
-%  The format of the DestroyEdge method is:
-%
-%      size_t DestroyEdge(PolygonInfo *polygon_info,const size_t edge)
-%
-%  A description of each parameter follows:
-%
-%    o polygon_info: Specifies a pointer to an PolygonInfo structure.
-%
-%    o edge: the polygon edge number to destroy.
-%
-%
-*/
-static size_t
-DestroyEdge(PolygonInfo * restrict polygon_info,const size_t edge)
-{
-  assert(edge < polygon_info->number_edges);
-  MagickFreeResourceLimitedMemory(polygon_info->edges[edge].points);
-  polygon_info->number_edges--;
-  if (edge < polygon_info->number_edges)
-    (void) memmove(polygon_info->edges+edge,polygon_info->edges+edge+1,
-      (polygon_info->number_edges-edge)*sizeof(EdgeInfo));
-  return(polygon_info->number_edges);
-}
-
-/*
-%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
-%                                                                             %
-%                                                                             %
-%                                                                             %
 +   D e s t r o y G r a d i e n t I n f o                                     %
 %                                                                             %
 %                                                                             %
@@ -2616,8 +2704,70 @@ PrimitiveInfoRealloc(PrimitiveInfoMgr * p_PIMgr, const size_t Needed)
 }/*PrimitiveInfoRealloc*/
 
 
-MagickExport MagickPassFail
-DrawImage(Image *image,const DrawInfo *draw_info)
+/*
+  Append a copy of the primitive and of its graphic context to the
+  display list.
+*/
+static MagickPassFail
+RecordDrawPrimitive(DrawDisplayList *display_list,const DrawInfo *draw_info,
+                    const PrimitiveInfo *primitive_info,
+                    ExceptionInfo *exception)
+{
+  DrawDisplayItem
+    *item;
+
+  size_t
+    number_points;
+
+  for (number_points=0;
+       primitive_info[number_points].primitive != UndefinedPrimitive;
+       number_points++);
+  number_points++;
+  if (display_list->number_items == display_list->allocated_items)
+    {
+      size_t
+        allocated_items;
+
+      allocated_items=Max(2*display_list->allocated_items,16);
+      MagickReallocMemory(DrawDisplayItem *,display_list->items,
+                          MagickArraySize(allocated_items,
+                                          sizeof(DrawDisplayItem)));
+      if (display_list->items == (DrawDisplayItem *) NULL)
+        {
+          display_list->number_items=0;
+          display_list->allocated_items=0;
+          ThrowException3(exception,ResourceLimitError,MemoryAllocationFailed,
+                          UnableToDrawOnImage);
+          return(MagickFail);
+        }
+      display_list->allocated_items=allocated_items;
+    }
+  item=display_list->items+display_list->number_items;
+  item->number_points=number_points;
+  item->primitive_info=MagickAllocateArray(PrimitiveInfo *,number_points,
+                                           sizeof(PrimitiveInfo));
+  item->draw_info=CloneDrawInfo((ImageInfo *) NULL,draw_info);
+  if ((item->primitive_info == (PrimitiveInfo *) NULL) ||
+      (item->draw_info == (DrawInfo *) NULL))
+    {
+      MagickFreeMemory(item->primitive_info);
+      if (item->draw_info != (DrawInfo *) NULL)
+        DestroyDrawInfo(item->draw_info);
+      ThrowException3(exception,ResourceLimitError,MemoryAllocationFailed,
+                      UnableToDrawOnImage);
+      return(MagickFail);
+    }
+  (void) memcpy(item->primitive_info,primitive_info,
+                number_points*sizeof(PrimitiveInfo));
+  if (primitive_info->text != (char *) NULL)
+    item->primitive_info->text=AllocateString(primitive_info->text);
+  display_list->number_items++;
+  return(MagickPass);
+}
+
+static MagickPassFail
+DrawImageInternal(Image *image,const DrawInfo *draw_info,
+                  DrawDisplayList *display_list)
 {
 #define RenderImageText "[%s] Render..."
 
@@ -2640,6 +2790,10 @@ DrawImage(Image *image,const DrawInfo *draw_info)
     factor,
     points_length;  /* primitive_extent is now a size_t */
 
+  DeferredPolygonList
+    deferred_polygons,
+    *deferred;
+
   DrawInfo
     **graphic_context;
 
@@ -2754,6 +2908,14 @@ DrawImage(Image *image,const DrawInfo *draw_info)
       MagickFreeMemory(primitive);
       return MagickPass;
     }
+  /*
+    Consecutive primitives which are drawn as polygons are collected and
+    drawn together by horizontal bands, using several threads.  They are
+    drawn before anything else modifies the image or its masks.
+  */
+  deferred=(DeferredPolygonList *) NULL;
+  if (display_list == (DrawDisplayList *) NULL)
+    deferred=InitializeDeferredPolygons(image,&deferred_polygons);
   n=0;
   /*
     Allocate primitive info memory.
@@ -2959,6 +3121,13 @@ DrawImage(Image *image,const DrawInfo *draw_info)
                 break;
               }
             (void) CloneString(&graphic_context[n]->extra->clip_path,token);
+            if (display_list != (DrawDisplayList *) NULL)
+              display_list->replayable=MagickFalse;
+            if (FlushDeferredPolygons(image,deferred) == MagickFail)
+              {
+                status=MagickFail;
+                break;
+              }
             if (DrawClipPath(image,graphic_context[n],
                              graphic_context[n]->extra->clip_path) == MagickFail)
               status=MagickFail;
@@ -3305,6 +3474,9 @@ DrawImage(Image *image,const DrawInfo *draw_info)
                   break;
                 }
               (void) CloneString(&graphic_context[n]->extra->composite_path,token);
+              if (display_list != (DrawDisplayList *) NULL)
+                display_list->replayable=MagickFalse;
+              status &= FlushDeferredPolygons(image,deferred);
               status &= DrawCompositeMask(image,graphic_context[n],
                                           graphic_context[n]->extra->composite_path);
               break;
@@ -3431,13 +3603,19 @@ DrawImage(Image *image,const DrawInfo *draw_info)
                 if (graphic_context[n]->extra->clip_path != (char *) NULL)
                   if (LocaleCompare(graphic_context[n]->extra->clip_path,
                       graphic_context[n-1]->extra->clip_path) != 0)
-                    (void) SetImageClipMask(image,(Image *) NULL);
+                    {
+                      status &= FlushDeferredPolygons(image,deferred);
+                      (void) SetImageClipMask(image,(Image *) NULL);
+                    }
                 if (graphic_context[n]->extra->composite_path != (char *) NULL)
                   {
                     /* clean up composite mask if different from parent */
                     if (LocaleCompare(graphic_context[n]->extra->composite_path,
                         graphic_context[n-1]->extra->composite_path) != 0)
-                      (void) SetImageCompositeMask(image,(Image *) NULL);
+                      {
+                        status &= FlushDeferredPolygons(image,deferred);
+                        (void) SetImageCompositeMask(image,(Image *) NULL);
+                      }
                   }
                 DestroyDrawInfo(graphic_context[n]);
                 n--;
@@ -3906,6 +4084,8 @@ DrawImage(Image *image,const DrawInfo *draw_info)
             MagickGetToken(q,&q,token,token_max_length);
             if ((status &= QueryColorDatabase(token,&stop_color,&image->exception)) == MagickFail)
               break;
+            if (display_list != (DrawDisplayList *) NULL)
+              display_list->replayable=MagickFalse;
             (void) GradientImage(image,&start_color,&stop_color);
             start_color=stop_color;
             MagickGetToken(q,&q,token,token_max_length);
@@ -4868,25 +5048,61 @@ DrawImage(Image *image,const DrawInfo *draw_info)
       if (primitive_info[i].primitive == ImagePrimitive)
         break;
     }
-    if (graphic_context[n]->render)
+    if (graphic_context[n]->render && (display_list != (DrawDisplayList *) NULL))
+      {
+        /*
+          Record the primitive rather than drawing it.  Clip paths and
+          composite masks are applied to the image itself so they can
+          not be replayed.
+        */
+        if ((graphic_context[n]->extra->clip_path != (char *) NULL) ||
+            (graphic_context[n]->extra->composite_path != (char *) NULL))
+          display_list->replayable=MagickFalse;
+        if (display_list->replayable &&
+            (RecordDrawPrimitive(display_list,graphic_context[n],primitive_info,
+                                 &image->exception) == MagickFail))
+          status=MagickFail;
+      }
+    else if (graphic_context[n]->render)
       {
         if ((n != 0) && (graphic_context[n]->extra->clip_path != (char *) NULL) &&
             (LocaleCompare(graphic_context[n]->extra->clip_path,
              graphic_context[n-1]->extra->clip_path) != 0))
-          if (DrawClipPath(image,graphic_context[n],
-                           graphic_context[n]->extra->clip_path) == MagickFail)
-            status=MagickFail;
+          {
+            if (FlushDeferredPolygons(image,deferred) == MagickFail)
+              status=MagickFail;
+            if (DrawClipPath(image,graphic_context[n],
+                             graphic_context[n]->extra->clip_path) == MagickFail)
+              status=MagickFail;
+          }
         if ((n != 0) && (graphic_context[n]->extra->composite_path != (char *) NULL) &&
             (LocaleCompare(graphic_context[n]->extra->composite_path,
             graphic_context[n-1]->extra->composite_path) != 0))
           {
+            if (FlushDeferredPolygons(image,deferred) == MagickFail)
+              status=MagickFail;
             if (DrawCompositeMask(image,graphic_context[n],
                 graphic_context[n]->extra->composite_path) == MagickFail)
               status=MagickFail;
           }
-        if (DrawPrimitive(image,graphic_context[n],primitive_info)
-            == MagickFail)
-          status=MagickFail;
+        if ((deferred != (DeferredPolygonList *) NULL) &&
+            IsDeferrablePrimitive(primitive_info->primitive))
+          {
+            graphic_context[n]->extra->deferred_polygons=deferred;
+            if (DrawPrimitive(image,graphic_context[n],primitive_info)
+                == MagickFail)
+              status=MagickFail;
+            graphic_context[n]->extra->deferred_polygons=
+              (DeferredPolygonList *) NULL;
+          }
+        else
+          {
+            if (FlushDeferredPolygons(image,deferred) == MagickFail)
+              status=MagickFail;
+            if (DrawPrimitive(image,graphic_context[n],primitive_info)
+                == MagickFail)
+              status=MagickFail;
+          }
       }
     if (primitive_info->text != (char *) NULL)
       MagickFreeMemory(primitive_info->text);
@@ -4898,6 +5114,12 @@ DrawImage(Image *image,const DrawInfo *draw_info)
     if (status == MagickFail)
       break;
   }
+  if (deferred != (DeferredPolygonList *) NULL)
+    {
+      if (status != MagickFail)
+        status&=FlushDeferredPolygons(image,deferred);
+      DestroyDeferredPolygons(deferred);
+    }
   (void) LogMagickEvent(RenderEvent,GetMagickModule(),"end draw-image");
   /*
     Free resources.
@@ -4917,113 +5139,480 @@ DrawImage(Image *image,const DrawInfo *draw_info)
                          keyword);
   return(status);
 }
-
+
+MagickExport MagickPassFail
+DrawImage(Image *image,const DrawInfo *draw_info)
+{
+  return(DrawImageInternal(image,draw_info,(DrawDisplayList *) NULL));
+}
+
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
 %                                                                             %
 %                                                                             %
-%   D r a w P a t t e r n P a t h                                             %
+%   C o m p i l e D r a w D i s p l a y L i s t                               %
 %                                                                             %
 %                                                                             %
 %                                                                             %
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %
-%  DrawPatternPath() draws a pattern.
-%
-%  The format of the DrawPatternPath method is:
+%  CompileDrawDisplayList() parses the drawing primitives of the draw info
+%  once into a display list which may then be drawn on any number of images
+%  with DrawDisplayListImage().  This avoids tokenizing the primitive text
+%  and tracing paths, arcs, and curves each time the same drawing is
+%  applied to another image.
 %
-%      MagickPassFail DrawPatternPath(Image *image,const DrawInfo *draw_info,
-%        const char *name,Image **pattern)
+%  Drawings which rely on state stored in the image itself (clip paths,
+%  composite masks, and legacy gradients) are not recorded.  Such display
+%  lists are drawn by DrawImage() instead, so the result is always the same
+%  as drawing the primitives directly.
 %
-%  A description of each parameter follows:
+%  The format of the CompileDrawDisplayList method is:
 %
-%    o image: The image.
+%      DrawDisplayList *CompileDrawDisplayList(const DrawInfo *draw_info,
+%        ExceptionInfo *exception)
 %
-%    o draw_info: The draw info.
+%  A description of each parameter follows:
 %
-%    o name: The pattern name.
+%    o draw_info: The draw info.  The primitive may be a string or an
+%      "at" sign (@) followed by the name of a file to read it from.
 %
-%    o image: The image.
+%    o exception: Return any errors or warnings in this structure.
 %
 %
 */
-MagickExport MagickPassFail
-DrawPatternPath(Image *image,const DrawInfo *draw_info,const char *name,
-                Image **pattern)
+MagickExport DrawDisplayList *
+CompileDrawDisplayList(const DrawInfo *draw_info,ExceptionInfo *exception)
 {
-  char
-    attribute[MaxTextExtent];
-
-  const ImageAttribute
-    *geometry,
-    *path;
-
-  DrawInfo
-    *clone_info;
+  DrawDisplayList
+    *display_list;
 
-  ImageInfo
-    *image_info;
+  Image
+    *image;
 
   MagickPassFail
-    status = MagickPass;
+    status;
 
-  assert(image != (Image *) NULL);
-  assert(image->signature == MagickSignature);
-  assert(draw_info != (const DrawInfo *) NULL);
-  assert(name != (const char *) NULL);
-  FormatString(attribute,"[MVG:%.1024s]",name);
-  path=GetImageAttribute(image,attribute);
-  if (path == (ImageAttribute *) NULL)
-    return(MagickFail);
-  FormatString(attribute,"[MVG:%.1024s-geometry]",name);
-  geometry=GetImageAttribute(image,attribute);
-  if (geometry == (ImageAttribute *) NULL)
-    return(MagickFail);
-  if ((*pattern) != (Image *) NULL)
-    DestroyImage(*pattern);
-  image_info=CloneImageInfo((ImageInfo *) NULL);
-  image_info->size=AllocateString(geometry->value);
-  *pattern=AllocateImage(image_info);
-  DestroyImageInfo(image_info);
-  status &= QueryColorDatabase("none",&(*pattern)->background_color,
-    &image->exception);
-  (void) SetImage(*pattern,OpaqueOpacity);
-  (void) LogMagickEvent(RenderEvent,GetMagickModule(),
-    "begin pattern-path %.1024s %.1024s",name,geometry->value);
-  clone_info=CloneDrawInfo((ImageInfo *) NULL,draw_info);
-  DestroyImage(clone_info->fill_pattern);
-  clone_info->fill_pattern=(Image *) NULL;
-  DestroyImage(clone_info->stroke_pattern);
-  clone_info->stroke_pattern=(Image *) NULL;
-  (void) CloneString(&clone_info->primitive,path->value);
-  if ((status &= DrawImage(*pattern,clone_info)) == MagickFail)
+  assert(draw_info != (DrawInfo *) NULL);
+  assert(draw_info->signature == MagickSignature);
+  assert(draw_info->primitive != (char *) NULL);
+  assert(exception != (ExceptionInfo *) NULL);
+  display_list=MagickAllocateMemory(DrawDisplayList *,sizeof(DrawDisplayList));
+  if (display_list == (DrawDisplayList *) NULL)
     {
-      /* Copy exception into base image */
-      if ((*pattern)->exception.severity > image->exception.severity)
-        CopyException(&image->exception, &(*pattern)->exception);
+      ThrowException3(exception,ResourceLimitError,MemoryAllocationFailed,
+                      UnableToDrawOnImage);
+      return((DrawDisplayList *) NULL);
     }
-  DestroyDrawInfo(clone_info);
-  (void) LogMagickEvent(RenderEvent,GetMagickModule(),"end pattern-path");
-  return(status);
+  (void) memset(display_list,0,sizeof(DrawDisplayList));
+  display_list->replayable=MagickTrue;
+  display_list->signature=MagickSignature;
+  /*
+    Parse the primitives against a scratch image so that side effects
+    of parsing (e.g. pattern definitions) do not alter any caller image.
+  */
+  image=AllocateImage((ImageInfo *) NULL);
+  if (image == (Image *) NULL)
+    {
+      ThrowException3(exception,ResourceLimitError,MemoryAllocationFailed,
+                      UnableToDrawOnImage);
+      DestroyDrawDisplayList(display_list);
+      return((DrawDisplayList *) NULL);
+    }
+  image->columns=1;
+  image->rows=1;
+  display_list->draw_info=CloneDrawInfo((ImageInfo *) NULL,draw_info);
+  if (*draw_info->primitive == '@')
+    {
+      size_t
+        length;
+
+      /*
+        Keep the primitive text itself for drawing a display list
+        which may not be replayed.
+      */
+      display_list->draw_info->primitive=(char *)
+        FileToBlob(draw_info->primitive+1,&length,exception);
+    }
+  else
+    {
+      display_list->draw_info->primitive=AllocateString(draw_info->primitive);
+    }
+  if (display_list->draw_info->primitive == (char *) NULL)
+    {
+      DestroyImage(image);
+      DestroyDrawDisplayList(display_list);
+      return((DrawDisplayList *) NULL);
+    }
+  status=DrawImageInternal(image,display_list->draw_info,display_list);
+  if (image->exception.severity > exception->severity)
+    CopyException(exception,&image->exception);
+  DestroyImage(image);
+  if (status == MagickFail)
+    {
+      DestroyDrawDisplayList(display_list);
+      return((DrawDisplayList *) NULL);
+    }
+  (void) LogMagickEvent(RenderEvent,GetMagickModule(),
+                        "compiled display list: %lu primitives, %s",
+                        (unsigned long) display_list->number_items,
+                        display_list->replayable ? "replayable" :
+                        "not replayable");
+  return(display_list);
 }
-
+
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
 %                                                                             %
 %                                                                             %
-+   D r a w P o l y g o n P r i m i t i v e                                   %
+%   D e s t r o y D r a w D i s p l a y L i s t                               %
 %                                                                             %
 %                                                                             %
 %                                                                             %
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %
-%  Method DrawPolygonPrimitive draws a polygon on the image.
+%  DestroyDrawDisplayList() deallocates memory associated with a display
+%  list returned by CompileDrawDisplayList().
 %
-%  The format of the DrawPolygonPrimitive method is:
+%  The format of the DestroyDrawDisplayList method is:
 %
-%      unsigned int DrawPolygonPrimitive(Image *image,const DrawInfo *draw_info,
+%      void DestroyDrawDisplayList(DrawDisplayList *display_list)
+%
+%  A description of each parameter follows:
+%
+%    o display_list: The display list to destroy.
+%
+%
+*/
+MagickExport void
+DestroyDrawDisplayList(DrawDisplayList *display_list)
+{
+  size_t
+    i;
+
+  if (display_list == (DrawDisplayList *) NULL)
+    return;
+  assert(display_list->signature == MagickSignature);
+  for (i=0; i < display_list->number_items; i++)
+    {
+      MagickFreeMemory(display_list->items[i].primitive_info->text);
+      MagickFreeMemory(display_list->items[i].primitive_info);
+      DestroyDrawInfo(display_list->items[i].draw_info);
+    }
+  MagickFreeMemory(display_list->items);
+  if (display_list->draw_info != (DrawInfo *) NULL)
+    DestroyDrawInfo(display_list->draw_info);
+  display_list->signature=0;
+  MagickFreeMemory(display_list);
+}
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%   D r a w D i s p l a y L i s t I m a g e                                   %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  DrawDisplayListImage() draws a display list returned by
+%  CompileDrawDisplayList() on an image.  An optional affine transform is
+%  applied on top of the transforms specified by the drawing, for example
+%  to offset the drawing on each image.
+%
+%  The format of the DrawDisplayListImage method is:
+%
+%      MagickPassFail DrawDisplayListImage(Image *image,
+%        const DrawDisplayList *display_list,const AffineMatrix *affine)
+%
+%  A description of each parameter follows:
+%
+%    o image: The image.
+%
+%    o display_list: The display list.
+%
+%    o affine: An affine transform to apply to the drawing, or NULL.
+%
+%
+*/
+MagickExport MagickPassFail
+DrawDisplayListImage(Image *image,const DrawDisplayList *display_list,
+                     const AffineMatrix *affine)
+{
+#define RenderDisplayListText "[%s] Render display list..."
+
+  DeferredPolygonList
+    deferred_polygons,
+    *deferred,
+    *item_deferred;
+
+  DrawInfo
+    *draw_info;
+
+  MagickBool
+    transform;
+
+  MagickPassFail
+    status = MagickPass;
+
+  size_t
+    i;
+
+  assert(image != (Image *) NULL);
+  assert(image->signature == MagickSignature);
+  assert(display_list != (const DrawDisplayList *) NULL);
+  assert(display_list->signature == MagickSignature);
+  transform=(affine != (const AffineMatrix *) NULL) &&
+    ((affine->sx != 1.0) || (affine->rx != 0.0) || (affine->ry != 0.0) ||
+     (affine->sy != 1.0) || (affine->tx != 0.0) || (affine->ty != 0.0));
+  if (!display_list->replayable)
+    {
+      /*
+        Draw the primitive text with the affine transform as the
+        outermost transform.
+      */
+      if (!transform)
+        return(DrawImage(image,display_list->draw_info));
+      draw_info=CloneDrawInfo((ImageInfo *) NULL,display_list->draw_info);
+      (void) CloneString(&draw_info->primitive,display_list->draw_info->primitive);
+      draw_info->affine.sx=affine->sx*display_list->draw_info->affine.sx+
+        affine->ry*display_list->draw_info->affine.rx;
+      draw_info->affine.rx=affine->rx*display_list->draw_info->affine.sx+
+        affine->sy*display_list->draw_info->affine.rx;
+      draw_info->affine.ry=affine->sx*display_list->draw_info->affine.ry+
+        affine->ry*display_list->draw_info->affine.sy;
+      draw_info->affine.sy=affine->rx*display_list->draw_info->affine.ry+
+        affine->sy*display_list->draw_info->affine.sy;
+      draw_info->affine.tx=affine->sx*display_list->draw_info->affine.tx+
+        affine->ry*display_list->draw_info->affine.ty+affine->tx;
+      draw_info->affine.ty=affine->rx*display_list->draw_info->affine.tx+
+        affine->sy*display_list->draw_info->affine.ty+affine->ty;
+      status=DrawImage(image,draw_info);
+      DestroyDrawInfo(draw_info);
+      return(status);
+    }
+  if (getenv("MAGICK_SKIP_RENDERING") != NULL)
+    return(MagickPass);
+  if (DrawImageRecurseIn(image) == MagickFail)
+    return(MagickFail);
+  (void) LogMagickEvent(RenderEvent,GetMagickModule(),
+                        "begin draw-display-list");
+  status &= SetImageType(image,TrueColorType);
+  /*
+    Consecutive primitives which are drawn as polygons are collected and
+    drawn together by horizontal bands, using several threads.
+  */
+  deferred=InitializeDeferredPolygons(image,&deferred_polygons);
+  for (i=0; (status != MagickFail) && (i < display_list->number_items); i++)
+    {
+      const DrawDisplayItem
+        *item;
+
+      PrimitiveInfo
+        *primitive_info;
+
+      item=display_list->items+i;
+      item_deferred=deferred;
+      if (!IsDeferrablePrimitive(item->primitive_info->primitive))
+        {
+          status&=FlushDeferredPolygons(image,deferred);
+          item_deferred=(DeferredPolygonList *) NULL;
+        }
+      if (!transform && (item_deferred == (DeferredPolygonList *) NULL))
+        {
+          status&=DrawPrimitive(image,item->draw_info,item->primitive_info);
+        }
+      else if (!transform)
+        {
+          draw_info=CloneDrawInfo((ImageInfo *) NULL,item->draw_info);
+          draw_info->extra->deferred_polygons=item_deferred;
+          status&=DrawPrimitive(image,draw_info,item->primitive_info);
+          DestroyDrawInfo(draw_info);
+        }
+      else
+        {
+          const AffineMatrix
+            *current;
+
+          PointInfo
+            point;
+
+          size_t
+            j;
+
+          /*
+            Transform a copy of the recorded points, and compose the
+            transform with the recorded one for the benefit of stroke
+            widths, text, and images.
+          */
+          primitive_info=MagickAllocateArray(PrimitiveInfo *,
+                                             item->number_points,
+                                             sizeof(PrimitiveInfo));
+          draw_info=CloneDrawInfo((ImageInfo *) NULL,item->draw_info);
+          if ((primitive_info == (PrimitiveInfo *) NULL) ||
+              (draw_info == (DrawInfo *) NULL))
+            {
+              MagickFreeMemory(primitive_info);
+              if (draw_info != (DrawInfo *) NULL)
+                DestroyDrawInfo(draw_info);
+              ThrowException3(&image->exception,ResourceLimitError,
+                              MemoryAllocationFailed,UnableToDrawOnImage);
+              status=MagickFail;
+              break;
+            }
+          (void) memcpy(primitive_info,item->primitive_info,
+                        item->number_points*sizeof(PrimitiveInfo));
+          for (j=0; primitive_info[j].primitive != UndefinedPrimitive; j++)
+            {
+              point=primitive_info[j].point;
+              primitive_info[j].point.x=affine->sx*point.x+affine->ry*point.y+
+                affine->tx;
+              primitive_info[j].point.y=affine->rx*point.x+affine->sy*point.y+
+                affine->ty;
+              if (primitive_info[j].primitive == ImagePrimitive)
+                break;
+            }
+          current=&item->draw_info->affine;
+          draw_info->affine.sx=affine->sx*current->sx+affine->ry*current->rx;
+          draw_info->affine.rx=affine->rx*current->sx+affine->sy*current->rx;
+          draw_info->affine.ry=affine->sx*current->ry+affine->ry*current->sy;
+          draw_info->affine.sy=affine->rx*current->ry+affine->sy*current->sy;
+          draw_info->affine.tx=affine->sx*current->tx+affine->ry*current->ty+
+            affine->tx;
+          draw_info->affine.ty=affine->rx*current->tx+affine->sy*current->ty+
+            affine->ty;
+          draw_info->extra->deferred_polygons=item_deferred;
+          status&=DrawPrimitive(image,draw_info,primitive_info);
+          DestroyDrawInfo(draw_info);
+          MagickFreeMemory(primitive_info);
+        }
+      if (MagickMonitorFormatted(i,display_list->number_items,
+                                 &image->exception,RenderDisplayListText,
+                                 image->filename) == MagickFail)
+        status=MagickFail;
+    }
+  if (deferred != (DeferredPolygonList *) NULL)
+    {
+      if (status != MagickFail)
+        status&=FlushDeferredPolygons(image,deferred);
+      DestroyDeferredPolygons(deferred);
+    }
+  (void) LogMagickEvent(RenderEvent,GetMagickModule(),
+                        "end draw-display-list");
+  DrawImageRecurseOut(image);
+  return(status);
+}
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%   D r a w P a t t e r n P a t h                                             %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  DrawPatternPath() draws a pattern.
+%
+%  The format of the DrawPatternPath method is:
+%
+%      MagickPassFail DrawPatternPath(Image *image,const DrawInfo *draw_info,
+%        const char *name,Image **pattern)
+%
+%  A description of each parameter follows:
+%
+%    o image: The image.
+%
+%    o draw_info: The draw info.
+%
+%    o name: The pattern name.
+%
+%    o image: The image.
+%
+%
+*/
+MagickExport MagickPassFail
+DrawPatternPath(Image *image,const DrawInfo *draw_info,const char *name,
+                Image **pattern)
+{
+  char
+    attribute[MaxTextExtent];
+
+  const ImageAttribute
+    *geometry,
+    *path;
+
+  DrawInfo
+    *clone_info;
+
+  ImageInfo
+    *image_info;
+
+  MagickPassFail
+    status = MagickPass;
+
+  assert(image != (Image *) NULL);
+  assert(image->signature == MagickSignature);
+  assert(draw_info != (const DrawInfo *) NULL);
+  assert(name != (const char *) NULL);
+  FormatString(attribute,"[MVG:%.1024s]",name);
+  path=GetImageAttribute(image,attribute);
+  if (path == (ImageAttribute *) NULL)
+    return(MagickFail);
+  FormatString(attribute,"[MVG:%.1024s-geometry]",name);
+  geometry=GetImageAttribute(image,attribute);
+  if (geometry == (ImageAttribute *) NULL)
+    return(MagickFail);
+  if ((*pattern) != (Image *) NULL)
+    DestroyImage(*pattern);
+  image_info=CloneImageInfo((ImageInfo *) NULL);
+  image_info->size=AllocateString(geometry->value);
+  *pattern=AllocateImage(image_info);
+  DestroyImageInfo(image_info);
+  status &= QueryColorDatabase("none",&(*pattern)->background_color,
+    &image->exception);
+  (void) SetImage(*pattern,OpaqueOpacity);
+  (void) LogMagickEvent(RenderEvent,GetMagickModule(),
+    "begin pattern-path %.1024s %.1024s",name,geometry->value);
+  clone_info=CloneDrawInfo((ImageInfo *) NULL,draw_info);
+  DestroyImage(clone_info->fill_pattern);
+  clone_info->fill_pattern=(Image *) NULL;
+  DestroyImage(clone_info->stroke_pattern);
+  clone_info->stroke_pattern=(Image *) NULL;
+  (void) CloneString(&clone_info->primitive,path->value);
+  if ((status &= DrawImage(*pattern,clone_info)) == MagickFail)
+    {
+      /* Copy exception into base image */
+      if ((*pattern)->exception.severity > image->exception.severity)
+        CopyException(&image->exception, &(*pattern)->exception);
+    }
+  DestroyDrawInfo(clone_info);
+  (void) LogMagickEvent(RenderEvent,GetMagickModule(),"end pattern-path");
+  return(status);
+}
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   D r a w P o l y g o n P r i m i t i v e                                   %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  Method DrawPolygonPrimitive draws a polygon on the image.
+%
+%  The format of the DrawPolygonPrimitive method is:
+%
+%      unsigned int DrawPolygonPrimitive(Image *image,const DrawInfo *draw_info,
 %        const PrimitiveInfo *primitive_info)
 %
 %  A description of each parameter follows:
@@ -5037,8 +5626,222 @@ DrawPatternPath(Image *image,const DrawInfo *draw_info,const char *name,
 %
 */
 
+static void
+DestroyActiveEdgeTable(void *edge_table_void)
+{
+  ActiveEdgeTable
+    *edge_table = (ActiveEdgeTable *) edge_table_void;
+
+  if (edge_table != (ActiveEdgeTable *) NULL)
+    {
+      MagickFreeMemory(edge_table->pending);
+      MagickFreeMemory(edge_table->highwater);
+      MagickFreeMemory(edge_table->stroke_edges);
+      MagickFreeMemory(edge_table->fill_edges);
+      MagickFreeMemory(edge_table);
+    }
+}
+
+/*
+  Prepare an active edge table for drawing a polygon, growing it as
+  needed.
+*/
+static MagickPassFail
+PrepareActiveEdgeTable(ActiveEdgeTable *edge_table,
+                       const PolygonInfo *polygon_info)
+{
+  size_t
+    number_edges;
+
+  number_edges=Max(polygon_info->number_edges,1);
+  if (number_edges > edge_table->allocated_edges)
+    {
+      MagickFreeMemory(edge_table->pending);
+      MagickFreeMemory(edge_table->highwater);
+      MagickFreeMemory(edge_table->stroke_edges);
+      MagickFreeMemory(edge_table->fill_edges);
+      edge_table->allocated_edges=0;
+      edge_table->pending=MagickAllocateArray(size_t *,number_edges,
+                                              sizeof(size_t));
+      edge_table->highwater=MagickAllocateArray(size_t *,number_edges,
+                                                sizeof(size_t));
+      edge_table->stroke_edges=MagickAllocateArray(ActiveEdgeInfo *,
+                                                   number_edges,
+                                                   sizeof(ActiveEdgeInfo));
+      edge_table->fill_edges=MagickAllocateArray(ActiveEdgeInfo *,
+                                                 number_edges,
+                                                 sizeof(ActiveEdgeInfo));
+      if ((edge_table->pending == (size_t *) NULL) ||
+          (edge_table->highwater == (size_t *) NULL) ||
+          (edge_table->stroke_edges == (ActiveEdgeInfo *) NULL) ||
+          (edge_table->fill_edges == (ActiveEdgeInfo *) NULL))
+        return(MagickFail);
+      edge_table->allocated_edges=number_edges;
+    }
+  edge_table->number_edges=polygon_info->number_edges;
+  edge_table->y=(-1L);
+  edge_table->started=0;
+  edge_table->crossed=0;
+  edge_table->number_pending=0;
+  (void) memset(edge_table->highwater,0,number_edges*sizeof(size_t));
+  return(MagickPass);
+}
+
+static ActiveEdgeTable *
+AllocateActiveEdgeTable(const PolygonInfo *polygon_info)
+{
+  ActiveEdgeTable
+    *edge_table;
+
+  edge_table=MagickAllocateMemory(ActiveEdgeTable *,sizeof(ActiveEdgeTable));
+  if (edge_table == (ActiveEdgeTable *) NULL)
+    return((ActiveEdgeTable *) NULL);
+  (void) memset(edge_table,0,sizeof(ActiveEdgeTable));
+  if (PrepareActiveEdgeTable(edge_table,polygon_info) == MagickFail)
+    {
+      DestroyActiveEdgeTable(edge_table);
+      edge_table=(ActiveEdgeTable *) NULL;
+    }
+  return(edge_table);
+}
+
+static int
+CompareActiveEdges(const void *edge0,const void *edge1)
+{
+  double
+    enter0,
+    enter1;
+
+  enter0=((const ActiveEdgeInfo *) edge0)->enter;
+  enter1=((const ActiveEdgeInfo *) edge1)->enter;
+  if (enter0 < enter1)
+    return(-1);
+  if (enter0 > enter1)
+    return(1);
+  return(0);
+}
+
+/*
+  Prepare the active edge table for scanline y.
+
+  Edges are sorted by their starting y coordinate, so edges start
+  contributing in order and are retired once the scanline moves past
+  their (stroke expanded) ending y coordinate.  For each edge which
+  may touch the scanline the range of segments near the scanline is
+  located once, and the edges are sorted by their left x bound so that
+  GetPixelOpacity() only visits edges near the current pixel as it
+  sweeps from left to right.  Edges which the sweep has passed
+  entirely are accumulated into the winding number of the scanline.
+
+  The edges visited and the order of tests match the former per pixel
+  scan over the whole polygon, except that the former scan skipped the
+  edge following each edge it retired.  That left unpainted pixels, for
+  example at the corners of dashed strokes, which are now drawn.
+*/
+static void
+GetActiveEdges(ActiveEdgeTable * restrict edge_table,
+               const PolygonInfo * restrict polygon_info,const double mid,
+               const long y)
+{
+  register const EdgeInfo
+    *p;
+
+  register size_t
+    i;
+
+  size_t
+    j,
+    k;
+
+  if (y < edge_table->y)
+    {
+      /*
+        Scanlines are normally visited in increasing order.  Start over
+        if that is not the case.
+      */
+      edge_table->started=0;
+      edge_table->crossed=0;
+      edge_table->number_pending=0;
+      (void) memset(edge_table->highwater,0,
+                    edge_table->number_edges*sizeof(size_t));
+    }
+  edge_table->y=y;
+  /*
+    Add edges which start on this scanline.
+  */
+  while ((edge_table->started < polygon_info->number_edges) &&
+         (y > (polygon_info->edges[edge_table->started].bounds.y1-mid-0.5)))
+    edge_table->pending[edge_table->number_pending++]=edge_table->started++;
+  while ((edge_table->crossed < edge_table->started) &&
+         (y > polygon_info->edges[edge_table->crossed].bounds.y1))
+    edge_table->crossed++;
+  /*
+    Retire edges which ended before this scanline and build the stroke
+    and fill edge lists.
+  */
+  edge_table->number_stroke_edges=0;
+  edge_table->number_fill_edges=0;
+  for (j=0, k=0; j < edge_table->number_pending; j++)
+    {
+      ActiveEdgeInfo
+        *active_edge;
+
+      size_t
+        edge;
+
+      edge=edge_table->pending[j];
+      p=polygon_info->edges+edge;
+      if (y > (p->bounds.y2+mid+0.5))
+        continue;
+      edge_table->pending[k++]=edge;
+      /*
+        Locate the segments which are within reach of this scanline.
+      */
+      for (i=Max(edge_table->highwater[edge],1); i < p->number_points; i++)
+        if (!(y > (p->points[i].y+mid+0.5)))
+          break;
+      edge_table->highwater[edge]=i;
+      active_edge=edge_table->stroke_edges+edge_table->number_stroke_edges++;
+      active_edge->edge=p;
+      active_edge->first=i;
+      for ( ; i < p->number_points; i++)
+        if (y <= (p->points[i-1].y-mid-0.5))
+          break;
+      active_edge->last=i;
+      active_edge->segment=(const PointInfo *) NULL;
+      active_edge->enter=p->bounds.x1-mid-0.5;
+      active_edge->leave=p->bounds.x2+mid+0.5;
+      if ((edge < edge_table->crossed) && (y <= p->bounds.y2))
+        {
+          /*
+            Locate the segment crossing this scanline.
+          */
+          for (i=Max(active_edge->first,1); i < p->number_points; i++)
+            if (y <= p->points[i].y)
+              break;
+          active_edge=edge_table->fill_edges+edge_table->number_fill_edges++;
+          active_edge->edge=p;
+          active_edge->first=0;
+          active_edge->last=0;
+          active_edge->segment=p->points+i-1;
+          active_edge->enter=p->bounds.x1;
+          active_edge->leave=p->bounds.x2;
+        }
+    }
+  edge_table->number_pending=k;
+  qsort(edge_table->stroke_edges,edge_table->number_stroke_edges,
+        sizeof(ActiveEdgeInfo),CompareActiveEdges);
+  qsort(edge_table->fill_edges,edge_table->number_fill_edges,
+        sizeof(ActiveEdgeInfo),CompareActiveEdges);
+  edge_table->next_stroke_edge=0;
+  edge_table->live_stroke_edges=0;
+  edge_table->next_fill_edge=0;
+  edge_table->live_fill_edges=0;
+  edge_table->winding_number=0;
+}
+
 static double
-GetPixelOpacity(PolygonInfo * restrict polygon_info,const double mid,
+GetPixelOpacity(ActiveEdgeTable * restrict edge_table,const double mid,
                 const unsigned int fill,const FillRule fill_rule,const long x,
                 const long y,double * restrict stroke_opacity)
 {
@@ -5055,12 +5858,15 @@ GetPixelOpacity(PolygonInfo * restrict polygon_info,const double mid,
     dx,
     dy;
 
-  register EdgeInfo
+  register const EdgeInfo
     *p;
 
   register const PointInfo
     *q;
 
+  register ActiveEdgeInfo
+    *active_edge;
+
   register size_t
     i;
 
@@ -5068,42 +5874,27 @@ GetPixelOpacity(PolygonInfo * restrict polygon_info,const double mid,
     j;
 
   /*
-    Compute fill & stroke opacity for this (x,y) point.
+    Compute fill & stroke opacity for this (x,y) point.  Edges which
+    the sweep has reached are moved to the front of the stroke edge
+    list and are dropped once it has passed them.
   */
   *stroke_opacity=0.0;
   subpath_opacity=0.0;
-  p=polygon_info->edges;
-  for (j=0; j < polygon_info->number_edges; j++)
+  while ((edge_table->next_stroke_edge < edge_table->number_stroke_edges) &&
+         (x > edge_table->stroke_edges[edge_table->next_stroke_edge].enter))
+    edge_table->stroke_edges[edge_table->live_stroke_edges++]=
+      edge_table->stroke_edges[edge_table->next_stroke_edge++];
+  for (j=0; j < edge_table->live_stroke_edges; )
   {
-    if (y <= (p->bounds.y1-mid-0.5))
-      break;
-    if (y > (p->bounds.y2+mid+0.5))
-      {
-        (void) DestroyEdge(polygon_info,j);
-        p++;
-        continue;
-      }
-    if (x <= (p->bounds.x1-mid-0.5))
-      {
-        p++;
-        continue;
-      }
-    if (x > (p->bounds.x2+mid+0.5))
+    active_edge=edge_table->stroke_edges+j;
+    if (x > active_edge->leave)
       {
-        p++;
+        *active_edge=edge_table->stroke_edges[--edge_table->live_stroke_edges];
         continue;
       }
-    for (i=Max(p->highwater,1); i < p->number_points; i++)
+    p=active_edge->edge;
+    for (i=active_edge->first; i < active_edge->last; i++)
     {
-      if (y <= (p->points[i-1].y-mid-0.5))
-        break;
-      if (y > (p->points[i].y+mid+0.5))
-        continue;
-      if (p->scanline != y)
-        {
-          p->scanline=y;
-          p->highwater=i;
-        }
       /*
         Compute distance between a point and an edge.
 
@@ -5182,123 +5973,501 @@ GetPixelOpacity(PolygonInfo * restrict polygon_info,const double mid,
           if (distance != 1.0)
             beta=sqrt(distance);
         }
-      alpha=beta-1.0;
-      if (subpath_opacity < (alpha*alpha))
-        subpath_opacity=alpha*alpha;
+      alpha=beta-1.0;
+      if (subpath_opacity < (alpha*alpha))
+        subpath_opacity=alpha*alpha;
+    }
+    j++;
+  }
+  /*
+    Compute fill opacity.
+  */
+  if (!fill)
+    return(0.0);
+  if (subpath_opacity >= 1.0)
+    return(1.0);
+  /*
+    Determine winding number.  Edges entirely to the left of the
+    sweep contribute their direction to the winding number of the
+    scanline.
+  */
+  while ((edge_table->next_fill_edge < edge_table->number_fill_edges) &&
+         (x > edge_table->fill_edges[edge_table->next_fill_edge].enter))
+    edge_table->fill_edges[edge_table->live_fill_edges++]=
+      edge_table->fill_edges[edge_table->next_fill_edge++];
+  winding_number=0;
+  for (j=0; j < edge_table->live_fill_edges; )
+  {
+    active_edge=edge_table->fill_edges+j;
+    p=active_edge->edge;
+    if (x > active_edge->leave)
+      {
+        edge_table->winding_number+=p->direction ? 1 : -1;
+        *active_edge=edge_table->fill_edges[--edge_table->live_fill_edges];
+        continue;
+      }
+    q=active_edge->segment;
+    dx=(q+1)->x-q->x;
+    dy=(q+1)->y-q->y;
+    if ((dx*(y-q->y)) <= (dy*(x-q->x)))
+      winding_number+=p->direction ? 1 : -1;
+    j++;
+  }
+  winding_number+=edge_table->winding_number;
+  if (fill_rule != NonZeroRule)
+    {
+      if (AbsoluteValue(winding_number) & 0x01)
+        return(1.0);
+    }
+  else
+    if (AbsoluteValue(winding_number) > 0)
+      return(1.0);
+  return(subpath_opacity);
+}
+
+/*
+  Draw one row of a polygon.  The active edge table must not be shared
+  with concurrent callers.
+*/
+static MagickPassFail
+DrawPolygonRow(Image *image,const DrawInfo *draw_info,
+               const PolygonInfo *polygon_info,ActiveEdgeTable *edge_table,
+               const double mid,const unsigned int fill,const long x_start,
+               const long x_stop,const long y)
+{
+  const Image
+    *fill_pattern=draw_info->fill_pattern,
+    *stroke_pattern=draw_info->stroke_pattern;
+
+  PixelPacket
+    fill_color,
+    stroke_color;
+
+  double
+    fill_opacity,
+    stroke_opacity;
+
+  long
+    x;
+
+  PixelPacket
+    * restrict q;
+
+  GetActiveEdges(edge_table,polygon_info,mid,y);
+  fill_color=draw_info->fill;
+  stroke_color=draw_info->stroke;
+  x=x_start;
+  q=GetImagePixelsEx(image,x,y,x_stop-x+1,1,&image->exception);
+  if (q == (PixelPacket *) NULL)
+    return(MagickFail);
+  for ( ; x <= x_stop; x++)
+    {
+      /*
+        Fill and/or stroke.  The fill_opacity returned by GetPixelOpacity()
+        handles partial pixel coverage at the edge of a polygon, where
+        0==no coverage and 1==full coverage
+
+        GetPixelOpacity() advances the scanline sweep in edge_table.
+      */
+      fill_opacity=GetPixelOpacity(edge_table,mid,fill,
+                                   draw_info->fill_rule,
+                                   x,y,&stroke_opacity);
+      if (!draw_info->stroke_antialias)
+        {
+          /* When stroke antialiasing is disabled, only draw for
+             opacities >= 0.99 in order to ensure that lines are not
+             drawn wider than requested. */
+          if (fill_opacity < 0.99)
+            fill_opacity=0.0;
+          if (stroke_opacity < 0.99)
+            stroke_opacity=0.0;
+        }
+      if ((fill_pattern != (Image *) NULL) &&
+          (fill_pattern->columns != 0) &&
+          (fill_pattern->rows != 0))
+        {
+          (void) AcquireOnePixelByReference
+            (fill_pattern,&fill_color,
+            (long) (x-fill_pattern->tile_info.x) % fill_pattern->columns,
+            (long) (y-fill_pattern->tile_info.y) % fill_pattern->rows,
+            &image->exception);
+          /* apply the group opacity value to the pattern pixel */
+          fill_color.opacity = MaxRGB-((MaxRGB-fill_color.opacity)*(MaxRGB-draw_info->opacity)+(MaxRGB>>1))/MaxRGB;
+        }
+      /* combine fill_opacity with the fill color's opacity */
+      fill_opacity=MaxRGBDouble-fill_opacity*
+        (MaxRGBDouble-(double) fill_color.opacity);
+      /*
+        Notes on call to AlphaCompositePixel():
+
+          fill_color: the polygon or pattern fill color, not premultiplied
+            by its opacity value
+          fill_opacity: product of the fill color opacity and opacity due
+            to partial pixel coverage (e.g., at the edge of the polygon)
+          q: (input) the background pixel, (output) the composited pixel;
+            neither is premultiplied by its opacity value
+          q->opacity: the background pixel opacity
+
+        The previous version of this code substituted "OpaqueOpacity"
+        for q->opacity if q->opacity was transparent.  I think this was
+        originally done to avoid a divide-by-zero in AlphaCompositePixel().
+        However, this substitution results in an incorrect result if the
+        background pixel is completely transparent.  Since the current
+        version of AlphaCompositePixel() has code in it to prevent a
+        divide-by-zero, the code has been fixed to always use q->opacity
+        as the background pixel opacity.
+      */
+      AlphaCompositePixel(q,&fill_color,fill_opacity,q,q->opacity);
+      if ((stroke_pattern != (Image *) NULL) &&
+          (stroke_pattern->columns != 0) &&
+          (stroke_pattern->rows != 0))
+        {
+          (void) AcquireOnePixelByReference
+            (stroke_pattern,&stroke_color,
+            (long) (x-stroke_pattern->tile_info.x) % stroke_pattern->columns,
+            (long) (y-stroke_pattern->tile_info.y) % stroke_pattern->rows,
+            &image->exception);
+          /* apply the group opacity value to the pattern pixel */
+          stroke_color.opacity = MaxRGB-((MaxRGB-stroke_color.opacity)*(MaxRGB-draw_info->opacity)+(MaxRGB>>1))/MaxRGB;
+        }
+      stroke_opacity=MaxRGBDouble-stroke_opacity*
+        (MaxRGBDouble-(double)stroke_color.opacity);
+      /*
+        In the call to AlphaCompositePixel() below, q->opacity is now always
+        used as the background pixel opacity for the same reason as described
+        in the call to AlphaCompositePixel() above.
+      */
+      AlphaCompositePixel(q,&stroke_color,stroke_opacity,q,q->opacity);
+      q++;
+    } /* for ( ; x <= x_stop; x++) */
+  return(SyncImagePixelsEx(image,&image->exception));
+}
+
+/*
+  Append a polygon to a deferred polygon list, which takes ownership of
+  the polygon.
+*/
+static MagickPassFail
+DeferPolygon(DeferredPolygonList *deferred_polygons,const DrawInfo *draw_info,
+             PolygonInfo *polygon_info,const double mid,const unsigned int fill,
+             const long x_start,const long x_stop,const long y_start,
+             const long y_stop,ExceptionInfo *exception)
+{
+  DeferredPolygonInfo
+    *polygon;
+
+  if (deferred_polygons->number_polygons ==
+      deferred_polygons->allocated_polygons)
+    {
+      DeferredPolygonInfo
+        *polygons;
+
+      size_t
+        allocated_polygons;
+
+      allocated_polygons=Max(2*deferred_polygons->allocated_polygons,64);
+      polygons=MagickAllocateArray(DeferredPolygonInfo *,allocated_polygons,
+                                   sizeof(DeferredPolygonInfo));
+      if (polygons == (DeferredPolygonInfo *) NULL)
+        {
+          DestroyPolygonInfo(polygon_info);
+          ThrowException3(exception,ResourceLimitError,MemoryAllocationFailed,
+                          UnableToDrawOnImage);
+          return(MagickFail);
+        }
+      if (deferred_polygons->number_polygons != 0)
+        (void) memcpy(polygons,deferred_polygons->polygons,
+                      deferred_polygons->number_polygons*
+                      sizeof(DeferredPolygonInfo));
+      MagickFreeMemory(deferred_polygons->polygons);
+      deferred_polygons->polygons=polygons;
+      deferred_polygons->allocated_polygons=allocated_polygons;
     }
-    p++;
-  }
-  /*
-    Compute fill opacity.
-  */
-  if (!fill)
-    return(0.0);
-  if (subpath_opacity >= 1.0)
-    return(1.0);
-  /*
-    Determine winding number.
-  */
-  winding_number=0;
-  p=polygon_info->edges;
-  for (j=0; j < polygon_info->number_edges; j++)
-  {
-    if (y <= p->bounds.y1)
-      break;
-    if (y > p->bounds.y2)
-      {
-        p++;
-        continue;
-      }
-    if (x <= p->bounds.x1)
-      {
-        p++;
-        continue;
-      }
-    if (x > p->bounds.x2)
-      {
-        winding_number+=p->direction ? 1 : -1;
-        p++;
-        continue;
-      }
-    for (i=Max(p->highwater,1); i < p->number_points; i++)
-      if (y <= p->points[i].y)
-        break;
-    q=p->points+i-1;
-    dx=(q+1)->x-q->x;
-    dy=(q+1)->y-q->y;
-    if ((dx*(y-q->y)) <= (dy*(x-q->x)))
-      winding_number+=p->direction ? 1 : -1;
-    p++;
-  }
-  if (fill_rule != NonZeroRule)
+  polygon=deferred_polygons->polygons+deferred_polygons->number_polygons;
+  polygon->draw_info=CloneDrawInfo((ImageInfo *) NULL,draw_info);
+  polygon->draw_info->extra->deferred_polygons=(DeferredPolygonList *) NULL;
+  polygon->polygon_info=polygon_info;
+  polygon->mid=mid;
+  polygon->fill=fill;
+  polygon->x_start=x_start;
+  polygon->x_stop=x_stop;
+  polygon->y_start=y_start;
+  polygon->y_stop=y_stop;
+  deferred_polygons->number_polygons++;
+  return(MagickPass);
+}
+
+static void
+DestroyDeferredPolygons(DeferredPolygonList *deferred_polygons)
+{
+  size_t
+    i;
+
+  for (i=0; i < deferred_polygons->number_polygons; i++)
     {
-      if (AbsoluteValue(winding_number) & 0x01)
-        return(1.0);
+      DestroyDrawInfo(deferred_polygons->polygons[i].draw_info);
+      DestroyPolygonInfo(deferred_polygons->polygons[i].polygon_info);
     }
-  else
-    if (AbsoluteValue(winding_number) > 0)
-      return(1.0);
-  return(subpath_opacity);
+  MagickFreeMemory(deferred_polygons->polygons);
+  deferred_polygons->number_polygons=0;
+  deferred_polygons->allocated_polygons=0;
 }
 
-static PolygonInfo* ClonePolygonInfo(const PolygonInfo* orig_polygon_info, ExceptionInfo *exception)
+/*
+  Draw deferred polygons by horizontal bands of the image.  Each band is
+  drawn by one thread, which draws the polygons overlapping the band in
+  the order they were deferred, so the result is the same as drawing the
+  polygons one after another.  The polygons overlapping each band are
+  listed once before drawing starts.
+*/
+static MagickPassFail
+DrawDeferredPolygons(Image *image,const DeferredPolygonList *deferred_polygons)
 {
-  PolygonInfo
-    *polygon_info = (PolygonInfo *) NULL;
+#define DeferredPolygonRows 32
+#define RenderDeferredPolygonsText "[%s] Render..."
+
+  long
+    band;
 
   size_t
-    edge;
+    i,
+    *band_offsets,
+    *band_polygons;
+
+  ThreadViewDataSet
+    *edge_tables;
+
+  unsigned int
+    index;
+
+  unsigned long
+    number_bands,
+    row_count=0;
 
-  if (orig_polygon_info == (PolygonInfo *) NULL)
-    return polygon_info;
+  MagickPassFail
+    status=MagickPass;
 
-  if ((polygon_info=MagickAllocateMemory(PolygonInfo *,sizeof(PolygonInfo))) == (PolygonInfo *) NULL)
+  if (deferred_polygons->number_polygons == 0)
+    return(MagickPass);
+  number_bands=(image->rows+DeferredPolygonRows-1)/DeferredPolygonRows;
+  /*
+    Bin the polygons by band.  band_offsets[band] is the index in
+    band_polygons of the first polygon overlapping the band, and the
+    polygons of each band are listed in the order they were deferred.
+  */
+  band_offsets=MagickAllocateClearedArray(size_t *,(size_t) number_bands+1,
+                                          sizeof(size_t));
+  if (band_offsets == (size_t *) NULL)
     {
-      ThrowException3(exception,ResourceLimitError,MemoryAllocationFailed,
-                      UnableToDrawOnImage);
-      return polygon_info;
+      ThrowException3(&image->exception,ResourceLimitError,
+                      MemoryAllocationFailed,UnableToDrawOnImage);
+      return(MagickFail);
     }
+  for (i=0; i < deferred_polygons->number_polygons; i++)
+    {
+      const DeferredPolygonInfo
+        *polygon;
 
-  polygon_info->number_edges=0;
+      polygon=deferred_polygons->polygons+i;
+      for (band=polygon->y_start/DeferredPolygonRows;
+           band <= polygon->y_stop/DeferredPolygonRows; band++)
+        band_offsets[band+1]++;
+    }
+  for (band=0; band < (long) number_bands; band++)
+    band_offsets[band+1]+=band_offsets[band];
+  band_polygons=MagickAllocateArray(size_t *,
+                                    Max(band_offsets[number_bands],1),
+                                    sizeof(size_t));
+  if (band_polygons == (size_t *) NULL)
+    {
+      MagickFreeMemory(band_offsets);
+      ThrowException3(&image->exception,ResourceLimitError,
+                      MemoryAllocationFailed,UnableToDrawOnImage);
+      return(MagickFail);
+    }
+  for (i=0; i < deferred_polygons->number_polygons; i++)
+    {
+      const DeferredPolygonInfo
+        *polygon;
 
-  if ((polygon_info->edges=
-       MagickAllocateResourceLimitedArray(EdgeInfo *,
-                                          orig_polygon_info->number_edges,
-                                          sizeof(EdgeInfo))) == (EdgeInfo *) NULL)
+      polygon=deferred_polygons->polygons+i;
+      for (band=polygon->y_start/DeferredPolygonRows;
+           band <= polygon->y_stop/DeferredPolygonRows; band++)
+        band_polygons[band_offsets[band]++]=i;
+    }
+  for (band=(long) number_bands; band > 0; band--)
+    band_offsets[band]=band_offsets[band-1];
+  band_offsets[0]=0;
+  edge_tables=AllocateThreadViewDataSet(DestroyActiveEdgeTable,image,
+                                        &image->exception);
+  if (edge_tables == (ThreadViewDataSet *) NULL)
     {
-      ThrowException3(exception,ResourceLimitError,MemoryAllocationFailed,
-                      UnableToDrawOnImage);
-      DestroyPolygonInfo(polygon_info);
-      polygon_info=(PolygonInfo *) NULL;
-      return polygon_info;
+      MagickFreeMemory(band_polygons);
+      MagickFreeMemory(band_offsets);
+      return(MagickFail);
+    }
+  for (index=0; index < GetThreadViewDataSetAllocatedViews(edge_tables); index++)
+    {
+      AssignThreadViewData(edge_tables,index,
+                           AllocateActiveEdgeTable(deferred_polygons->
+                                                   polygons[0].polygon_info));
+      if (AccessThreadViewDataById(edge_tables,index) == (void *) NULL)
+        {
+          DestroyThreadViewDataSet(edge_tables);
+          MagickFreeMemory(band_polygons);
+          MagickFreeMemory(band_offsets);
+          ThrowException3(&image->exception,ResourceLimitError,
+                          MemoryAllocationFailed,UnableToDrawOnImage);
+          return(MagickFail);
+        }
     }
+#if defined(HAVE_OPENMP)
+#  if defined(TUNE_OPENMP)
+#    pragma omp parallel for schedule(runtime) shared(row_count, status)
+#  else
+#    pragma omp parallel for schedule(dynamic) shared(row_count, status)
+#  endif
+#endif
+  for (band=0; band < (long) number_bands; band++)
+    {
+      ActiveEdgeTable
+        *edge_table;
+
+      long
+        band_start,
+        band_stop,
+        y;
 
-  (void) memcpy(polygon_info->edges,orig_polygon_info->edges,
-                orig_polygon_info->number_edges*sizeof(EdgeInfo));
+      size_t
+        j;
 
-  for (edge = 0; edge < orig_polygon_info->number_edges; edge++)
-    polygon_info->edges[edge].points = (PointInfo *) NULL;
+      MagickPassFail
+        thread_status;
 
-  polygon_info->number_edges=orig_polygon_info->number_edges;
-  for (edge = 0; edge < polygon_info->number_edges; edge++)
-    {
-      if ((polygon_info->edges[edge].points=
-           MagickAllocateResourceLimitedArray(PointInfo *,
-                                              polygon_info->edges[edge].number_points,
-                                              sizeof(PointInfo))) == (PointInfo *) NULL)
+      thread_status=status;
+      if (thread_status == MagickFail)
+        continue;
+
+      edge_table=(ActiveEdgeTable *) AccessThreadViewData(edge_tables);
+      band_start=band*DeferredPolygonRows;
+      band_stop=Min(band_start+DeferredPolygonRows,(long) image->rows)-1;
+      for (j=band_offsets[band]; j < band_offsets[band+1]; j++)
         {
-          ThrowException3(exception,ResourceLimitError,MemoryAllocationFailed,
-                          UnableToDrawOnImage);
-          DestroyPolygonInfo(polygon_info);
-          polygon_info=(PolygonInfo *) NULL;
-          return polygon_info;
+          const DeferredPolygonInfo
+            *polygon;
+
+          polygon=deferred_polygons->polygons+band_polygons[j];
+          if (PrepareActiveEdgeTable(edge_table,polygon->polygon_info)
+              == MagickFail)
+            {
+              ThrowException3(&image->exception,ResourceLimitError,
+                              MemoryAllocationFailed,UnableToDrawOnImage);
+              thread_status=MagickFail;
+              break;
+            }
+          for (y=Max(polygon->y_start,band_start);
+               y <= Min(polygon->y_stop,band_stop); y++)
+            if (DrawPolygonRow(image,polygon->draw_info,polygon->polygon_info,
+                               edge_table,polygon->mid,polygon->fill,
+                               polygon->x_start,polygon->x_stop,y)
+                == MagickFail)
+              {
+                thread_status=MagickFail;
+                break;
+              }
+          if (thread_status == MagickFail)
+            break;
+        }
+
+      if (thread_status != MagickFail)
+        {
+          unsigned long
+            thread_row_count;
+
+#if defined(HAVE_OPENMP)
+#  pragma omp atomic
+#endif
+          row_count++;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (row_count)
+#endif
+          thread_row_count=row_count;
+          if (QuantumTick(thread_row_count,number_bands))
+            if (!MagickMonitorFormatted(thread_row_count,number_bands,
+                                        &image->exception,
+                                        RenderDeferredPolygonsText,
+                                        image->filename))
+              thread_status=MagickFail;
+        }
+
+      if (thread_status == MagickFail)
+        {
+          status=MagickFail;
+#if defined(HAVE_OPENMP)
+#  pragma omp flush (status)
+#endif
         }
+    }
+  DestroyThreadViewDataSet(edge_tables);
+  MagickFreeMemory(band_polygons);
+  MagickFreeMemory(band_offsets);
+  return(status);
+}
+
+/*
+  Draw and discard any deferred polygons.  This must be done before the
+  image is modified other than by a deferred polygon, or before the clip
+  mask or composite mask of the image changes.
+*/
+static MagickPassFail
+FlushDeferredPolygons(Image *image,DeferredPolygonList *deferred_polygons)
+{
+  MagickPassFail
+    status=MagickPass;
+
+  if ((deferred_polygons == (DeferredPolygonList *) NULL) ||
+      (deferred_polygons->number_polygons == 0))
+    return(MagickPass);
+  status=DrawDeferredPolygons(image,deferred_polygons);
+  DestroyDeferredPolygons(deferred_polygons);
+  return(status);
+}
 
-      (void) memcpy(polygon_info->edges[edge].points,orig_polygon_info->edges[edge].points,
-                    polygon_info->edges[edge].number_points*sizeof(PointInfo));
+/*
+  Return true if a primitive is drawn only through DrawPolygonPrimitive(),
+  and may therefore be deferred.
+*/
+static MagickBool
+IsDeferrablePrimitive(const PrimitiveType primitive)
+{
+  switch (primitive)
+    {
+    case PointPrimitive:
+    case ColorPrimitive:
+    case MattePrimitive:
+    case TextPrimitive:
+    case ImagePrimitive:
+      return(MagickFalse);
+    default:
+      break;
     }
+  return(MagickTrue);
+}
 
-  return polygon_info;
+/*
+  Return the list polygons should be deferred to when drawing on an
+  image, or NULL if they should be drawn immediately.  Deferring is only
+  worthwhile when several threads would be used.
+*/
+static DeferredPolygonList *
+InitializeDeferredPolygons(const Image *image,
+                           DeferredPolygonList *deferred_polygons)
+{
+  (void) memset(deferred_polygons,0,sizeof(*deferred_polygons));
+  if ((omp_get_max_threads() > 1) &&
+      (((magick_uint64_t) image->rows*image->columns) >= 250000UL))
+    return(deferred_polygons);
+  return((DeferredPolygonList *) NULL);
 }
 
 static MagickPassFail
@@ -5312,8 +6481,11 @@ DrawPolygonPrimitive(Image *image,const DrawInfo *draw_info,
   SegmentInfo
     bounds;
 
+  PolygonInfo
+    * restrict polygon_info = (PolygonInfo *) NULL;
+
   ThreadViewDataSet
-    * restrict polygon_set = (ThreadViewDataSet *) NULL;
+    * restrict edge_tables = (ThreadViewDataSet *) NULL;
 
   magick_uint64_t
     total_pixels;
@@ -5355,70 +6527,20 @@ DrawPolygonPrimitive(Image *image,const DrawInfo *draw_info,
 
   {
     /*
-      Allocate and initialize thread-specific polygon sets.
-
-      There are thread-specific sets because GetPixelOpacity modifies
-      Edges (via DestroyEdge() and modifies Edge scanline and
-      highwater)
+      Convert the primitive to a polygon which is shared by all
+      threads.
     */
     PathInfo
       * restrict path_info;
 
-    unsigned int
-      index;
-
     path_info=(PathInfo *) NULL;
     if ((path_info=ConvertPrimitiveToPath(draw_info,primitive_info,&image->exception))
         != (PathInfo *) NULL)
       {
-        if ((polygon_set=AllocateThreadViewDataSet(DestroyPolygonInfo,image,
-                                                   &image->exception))
-            != (ThreadViewDataSet *) NULL)
-          {
-            unsigned int
-              allocated_views;
-
-            PolygonInfo
-              *polygon_info;
-
-            allocated_views=GetThreadViewDataSetAllocatedViews(polygon_set);
-            if ((int) allocated_views > num_threads)
-              allocated_views=num_threads;
-
-            /*
-              Assign polygon for each worker thread.
-
-              Only the first polygon set needs to be from
-              ConvertPathToPolygon() since they start off the same.
-              Otherwise an optimized clone can be used instead.
-
-              To that end, we have now written ClonePolygonInfo()
-
-              FIXME: A better solution would be to figure out how
-              threads can share common data while adding minimal
-              locking.  The current algorithms do unfriendly things
-              such as compacting the structure using memmove().
-            */
-            polygon_info=ConvertPathToPolygon(path_info,&image->exception);
-            for (index=0; index < allocated_views; index++)
-            AssignThreadViewData(polygon_set,index,index == 0 ? (void *) polygon_info :
-                                 ClonePolygonInfo(polygon_info,&image->exception));
-
-            /*
-              Verify worker thread allocations.
-            */
-            for (index=0; index < allocated_views; index++)
-              if (AccessThreadViewDataById(polygon_set,index) == (void *) NULL)
-                {
-                  DestroyThreadViewDataSet(polygon_set);
-                  polygon_set=(ThreadViewDataSet *) NULL;
-                  break;
-                }
-          }
-
+        polygon_info=ConvertPathToPolygon(path_info,&image->exception);
         MagickFreeResourceLimitedMemory(path_info);
       }
-    if (polygon_set == (ThreadViewDataSet *) NULL)
+    if (polygon_info == (PolygonInfo *) NULL)
       {
         ThrowException3(&image->exception,ResourceLimitError,MemoryAllocationFailed,
                         UnableToDrawOnImage);
@@ -5430,13 +6552,9 @@ DrawPolygonPrimitive(Image *image,const DrawInfo *draw_info,
     Compute bounding box.
   */
   {
-    const PolygonInfo
-      * restrict polygon_info;
-
     register size_t
       i;
 
-    polygon_info=(const PolygonInfo *) AccessThreadViewData(polygon_set);
     bounds=polygon_info->edges[0].bounds;
 
     if (0) /* DEBUG ??? */
@@ -5494,8 +6612,8 @@ DrawPolygonPrimitive(Image *image,const DrawInfo *draw_info,
          || (bounds.x2 <= 0.0) || (bounds.y2 <= 0.0) )
       {
         /* object completely outside image */
-        DestroyThreadViewDataSet(polygon_set);
-        polygon_set = (ThreadViewDataSet *) NULL;
+        DestroyPolygonInfo(polygon_info);
+        polygon_info = (PolygonInfo *) NULL;
         return(MagickPass);
       }
     bounds.x1=bounds.x1 <= 0.0 ? 0.0 : bounds.x1 >= image->columns-1 ?
@@ -5590,10 +6708,6 @@ DrawPolygonPrimitive(Image *image,const DrawInfo *draw_info,
         y_stop,
         y;
 
-      const Image
-        *fill_pattern=draw_info->fill_pattern,
-        *stroke_pattern=draw_info->stroke_pattern;
-
       unsigned int
         fill;
 
@@ -5605,6 +6719,56 @@ DrawPolygonPrimitive(Image *image,const DrawInfo *draw_info,
       y_start=(long) ceil(bounds.y1-0.5); /* FIXME: validate */
       y_stop=(long) floor(bounds.y2+0.5); /* FIXME: validate */
 
+      if (draw_info->extra->deferred_polygons != (DeferredPolygonList *) NULL)
+        {
+          /*
+            Defer drawing to DrawDeferredPolygons().
+          */
+          status=DeferPolygon(draw_info->extra->deferred_polygons,draw_info,
+                              polygon_info,mid,fill,x_start,x_stop,y_start,
+                              y_stop,&image->exception);
+          polygon_info=(PolygonInfo *) NULL;
+          goto draw_polygon_primitive_end;
+        }
+
+      /*
+        Allocate thread-specific active edge tables.
+      */
+      if ((edge_tables=AllocateThreadViewDataSet(DestroyActiveEdgeTable,image,
+                                                 &image->exception))
+          != (ThreadViewDataSet *) NULL)
+        {
+          unsigned int
+            allocated_views,
+            index;
+
+          allocated_views=GetThreadViewDataSetAllocatedViews(edge_tables);
+          if ((int) allocated_views > num_threads)
+            allocated_views=num_threads;
+
+          for (index=0; index < allocated_views; index++)
+            AssignThreadViewData(edge_tables,index,
+                                 AllocateActiveEdgeTable(polygon_info));
+
+          /*
+            Verify worker thread allocations.
+          */
+          for (index=0; index < allocated_views; index++)
+            if (AccessThreadViewDataById(edge_tables,index) == (void *) NULL)
+              {
+                DestroyThreadViewDataSet(edge_tables);
+                edge_tables=(ThreadViewDataSet *) NULL;
+                break;
+              }
+        }
+      if (edge_tables == (ThreadViewDataSet *) NULL)
+        {
+          ThrowException3(&image->exception,ResourceLimitError,MemoryAllocationFailed,
+                          UnableToDrawOnImage);
+          status=MagickFail;
+          goto draw_polygon_primitive_end;
+        }
+
 #if 1
 #if defined(HAVE_OPENMP)
 #  if defined(TUNE_OPENMP)
@@ -5616,23 +6780,6 @@ DrawPolygonPrimitive(Image *image,const DrawInfo *draw_info,
 #endif
       for (y=y_start; y <= y_stop; y++)
         {
-          PixelPacket
-            fill_color,
-            stroke_color;
-
-          double
-            fill_opacity,
-            stroke_opacity;
-
-          long
-            x;
-
-          PolygonInfo
-            * restrict polygon_info;
-
-          PixelPacket
-            * restrict q;
-
           MagickPassFail
             thread_status;
 
@@ -5640,100 +6787,10 @@ DrawPolygonPrimitive(Image *image,const DrawInfo *draw_info,
           if (thread_status == MagickFail)
             continue;
 
-          polygon_info=(PolygonInfo *) AccessThreadViewData(polygon_set);
-          fill_color=draw_info->fill;
-          stroke_color=draw_info->stroke;
-          x=x_start;
-          q=GetImagePixelsEx(image,x,y,x_stop-x+1,1,&image->exception);
-          if (q == (PixelPacket *) NULL)
-            thread_status=MagickFail;
-
-          if (thread_status != MagickFail)
-            {
-              for ( ; x <= x_stop; x++)
-                {
-                  /*
-                    Fill and/or stroke.  The fill_opacity returned by GetPixelOpacity()
-                    handles partial pixel coverage at the edge of a polygon, where
-                    0==no coverage and 1==full coverage
-
-                    GetPixelOpacity() modifies some properties referenced by polygon_info.
-                  */
-                  fill_opacity=GetPixelOpacity(polygon_info,mid,fill,
-                                               draw_info->fill_rule,
-                                               x,y,&stroke_opacity);
-                  if (!draw_info->stroke_antialias)
-                    {
-                      /* When stroke antialiasing is disabled, only draw for
-                         opacities >= 0.99 in order to ensure that lines are not
-                         drawn wider than requested. */
-                      if (fill_opacity < 0.99)
-                        fill_opacity=0.0;
-                      if (stroke_opacity < 0.99)
-                        stroke_opacity=0.0;
-                    }
-                  if ((fill_pattern != (Image *) NULL) &&
-                      (fill_pattern->columns != 0) &&
-                      (fill_pattern->rows != 0))
-                    {
-                      (void) AcquireOnePixelByReference
-                        (fill_pattern,&fill_color,
-                        (long) (x-fill_pattern->tile_info.x) % fill_pattern->columns,
-                        (long) (y-fill_pattern->tile_info.y) % fill_pattern->rows,
-                        &image->exception);
-                      /* apply the group opacity value to the pattern pixel */
-                      fill_color.opacity = MaxRGB-((MaxRGB-fill_color.opacity)*(MaxRGB-draw_info->opacity)+(MaxRGB>>1))/MaxRGB;
-                    }
-                  /* combine fill_opacity with the fill color's opacity */
-                  fill_opacity=MaxRGBDouble-fill_opacity*
-                    (MaxRGBDouble-(double) fill_color.opacity);
-                  /*
-                    Notes on call to AlphaCompositePixel():
-
-                      fill_color: the polygon or pattern fill color, not premultiplied
-                        by its opacity value
-                      fill_opacity: product of the fill color opacity and opacity due
-                        to partial pixel coverage (e.g., at the edge of the polygon)
-                      q: (input) the background pixel, (output) the composited pixel;
-                        neither is premultiplied by its opacity value
-                      q->opacity: the background pixel opacity
-
-                    The previous version of this code substituted "OpaqueOpacity"
-                    for q->opacity if q->opacity was transparent.  I think this was
-                    originally done to avoid a divide-by-zero in AlphaCompositePixel().
-                    However, this substitution results in an incorrect result if the
-                    background pixel is completely transparent.  Since the current
-                    version of AlphaCompositePixel() has code in it to prevent a
-                    divide-by-zero, the code has been fixed to always use q->opacity
-                    as the background pixel opacity.
-                  */
-                  AlphaCompositePixel(q,&fill_color,fill_opacity,q,q->opacity);
-                  if ((stroke_pattern != (Image *) NULL) &&
-                      (stroke_pattern->columns != 0) &&
-                      (stroke_pattern->rows != 0))
-                    {
-                      (void) AcquireOnePixelByReference
-                        (stroke_pattern,&stroke_color,
-                        (long) (x-stroke_pattern->tile_info.x) % stroke_pattern->columns,
-                        (long) (y-stroke_pattern->tile_info.y) % stroke_pattern->rows,
-                        &image->exception);
-                      /* apply the group opacity value to the pattern pixel */
-                      stroke_color.opacity = MaxRGB-((MaxRGB-stroke_color.opacity)*(MaxRGB-draw_info->opacity)+(MaxRGB>>1))/MaxRGB;
-                    }
-                  stroke_opacity=MaxRGBDouble-stroke_opacity*
-                    (MaxRGBDouble-(double)stroke_color.opacity);
-                  /*
-                    In the call to AlphaCompositePixel() below, q->opacity is now always
-                    used as the background pixel opacity for the same reason as described
-                    in the call to AlphaCompositePixel() above.
-                  */
-                  AlphaCompositePixel(q,&stroke_color,stroke_opacity,q,q->opacity);
-                  q++;
-                } /* for ( ; x <= x_stop; x++) */
-              if (!SyncImagePixelsEx(image,&image->exception))
-                thread_status=MagickFail;
-
-            } /* if (thread_status != MagickFail) */
+          thread_status=DrawPolygonRow(image,draw_info,polygon_info,
+                                       (ActiveEdgeTable *)
+                                       AccessThreadViewData(edge_tables),
+                                       mid,fill,x_start,x_stop,y);
           if (thread_status == MagickFail)
             {
               status=thread_status;
@@ -5747,7 +6804,8 @@ DrawPolygonPrimitive(Image *image,const DrawInfo *draw_info,
 
  draw_polygon_primitive_end:;
 
-  DestroyThreadViewDataSet(polygon_set);
+  DestroyThreadViewDataSet(edge_tables);
+  DestroyPolygonInfo(polygon_info);
 
   return(status);
 }
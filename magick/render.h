@@ -339,21 +339,31 @@ typedef struct _TypeMetric
     underline_thickness;
 } TypeMetric;
 
+/*
+  Opaque display list of parsed drawing primitives.
+*/
+typedef struct _DrawDisplayList DrawDisplayList;
+
 /*
   Method declarations.
 */
 extern MagickExport DrawInfo
   *CloneDrawInfo(const ImageInfo *,const DrawInfo *);
 
+extern MagickExport DrawDisplayList
+  *CompileDrawDisplayList(const DrawInfo *,ExceptionInfo *);
+
 extern MagickExport MagickPassFail
   AnnotateImage(Image *,const DrawInfo *),
   DrawAffineImage(Image *,const Image *,const AffineMatrix *),
   DrawClipPath(Image *,const DrawInfo *,const char *),
+  DrawDisplayListImage(Image *,const DrawDisplayList *,const AffineMatrix *),
   DrawImage(Image *,const DrawInfo *),
   DrawPatternPath(Image *,const DrawInfo *,const char *,Image **),
   GetTypeMetrics(Image *,const DrawInfo *,TypeMetric *);
 
 extern MagickExport void
+  DestroyDrawDisplayList(DrawDisplayList *),
   DestroyDrawInfo(DrawInfo *),
   GetDrawInfo(const ImageInfo *,DrawInfo *);
 
@@ -0,0 +1,150 @@
+/*
+  Copyright (C) 2026 GraphicsMagick Group
+
+  This program is covered by multiple licenses, which are described in
+  Copyright.txt. You should have received a copy of Copyright.txt with this
+  package; otherwise see http://www.graphicsmagick.org/www/Copyright.html.
+
+  GraphicsMagick Image Resize Methods.
+*/
+
+/*
+  Number of fractional bits in fixed-point contribution weights.
+*/
+#define ContributionWeightShift 14
+
+/*
+  Maximum number of contributions per destination pixel for which
+  fixed-point weights are provided.  Each fixed-point weight may be off
+  by up to half a unit, so wider filters (extreme reductions) would
+  accumulate more error than the vectorized kernels allow.
+*/
+#define ContributionFixedMaxCount 64
+
+/*
+  Filter contributions for resizing one image dimension.  The
+  contributions for each destination pixel are stored contiguously in
+  'weights' starting at 'destination pixel * stride', and are padded
+  with zero weights to a multiple of four entries so that they may be
+  processed several at a time.  The same weights are also provided in
+  'fixed_weights' scaled by 2^ContributionWeightShift and adjusted so
+  that the weights for each destination pixel sum to exactly
+  2^ContributionWeightShift, unless more than ContributionFixedMaxCount
+  source pixels contribute, in which case 'fixed_weights' is NULL.
+  Tables depend only on the source and destination sizes, the filter,
+  and the blur factor, and are shared read-only between threads and
+  between ResizeImage() calls.
+*/
+typedef struct _ContributionTable
+{
+  unsigned long
+    source_size,          /* Source pixels in this dimension */
+    destination_size;     /* Destination pixels in this dimension */
+
+  FilterTypes
+    filter;               /* Filter (never UndefinedFilter) */
+
+  double
+    blur,                 /* Blur factor */
+    factor,               /* destination_size/source_size */
+    support;              /* Scaled filter support */
+
+  size_t
+    stride;               /* Padded number of weights per destination pixel */
+
+  long
+    *start,               /* First contributing source pixel */
+    *nearest;             /* Source pixel nearest to the filter center */
+
+  unsigned long
+    *count;               /* Number of contributing source pixels */
+
+  double
+    *weights;             /* Normalized filter weights */
+
+  magick_int16_t
+    *fixed_weights;       /* Fixed-point filter weights */
+
+  unsigned long
+    references;           /* Number of users of this table */
+
+  struct _ContributionTable
+    *previous,
+    *next;
+} ContributionTable;
+
+/*
+  Kernels which apply 'fixed_weights' to opaque pixels.  A horizontal
+  kernel computes one destination pixel for each of 'rows' source rows
+  of 'count' pixels.  A vertical kernel computes 'columns' destination
+  pixels from 'count' source rows of 'columns' pixels.
+*/
+typedef void
+  (*HorizontalResizeKernel)(const PixelPacket * restrict p,
+                            const unsigned long count,
+                            const magick_int16_t * restrict weights,
+                            PixelPacket * restrict q,
+                            const unsigned long rows);
+
+typedef void
+  (*VerticalResizeKernel)(const PixelPacket * restrict p,
+                          const unsigned long columns,
+                          const unsigned long count,
+                          const magick_int16_t * restrict weights,
+                          PixelPacket * restrict q);
+
+typedef struct _ResizeKernelInfo
+{
+  const char
+    *name;                /* Kernel name (e.g. "SSE2") */
+
+  HorizontalResizeKernel
+    horizontal;           /* NULL for the scalar implementation */
+
+  VerticalResizeKernel
+    vertical;             /* NULL for the scalar implementation */
+} ResizeKernelInfo;
+
+/*
+  State for resizing an image supplied one row at a time.
+*/
+typedef struct _ResizeRowsInfo ResizeRowsInfo;
+
+extern ContributionTable
+  *AcquireContributionTable(const unsigned long source_size,
+                            const unsigned long destination_size,
+                            const FilterTypes filter,const double blur,
+                            ExceptionInfo *exception);
+
+extern void
+  DestroyResizeInfo(void),
+  ReleaseContributionTable(ContributionTable *table);
+
+extern MagickPassFail
+  InitializeResizeInfo(void);
+
+extern const ResizeKernelInfo
+  *SelectResizeKernels(const char *name);
+
+extern MagickExport ResizeRowsInfo
+  *AllocateResizeRowsInfo(const Image *image,const unsigned long columns,
+                          const unsigned long rows,const FilterTypes filter,
+                          const double blur,ExceptionInfo *exception);
+
+extern MagickExport MagickPassFail
+  FinishResizeRows(ResizeRowsInfo *resize_info,Image *image,
+                   ExceptionInfo *exception),
+  ResizeRow(ResizeRowsInfo *resize_info,const PixelPacket *pixels,
+            const IndexPacket *indexes,const unsigned long y,
+            ExceptionInfo *exception);
+
+extern MagickExport void
+  DestroyResizeRowsInfo(ResizeRowsInfo *resize_info);
+
+/*
+ * Local Variables:
+ * mode: c
+ * c-basic-offset: 2
+ * fill-column: 78
+ * End:
+ */
@@ -36,29 +36,37 @@
 #include "magick/enum_strings.h"
 #include "magick/log.h"
 #include "magick/monitor.h"
-#include "magick/omp_data_view.h"
 #include "magick/pixel_cache.h"
 #include "magick/resize.h"
+#include "magick/semaphore.h"
 #include "magick/utility.h"
 
 /*
-  Typedef declarations.
+  Maximum number of unused contribution tables to retain.
 */
-typedef struct _ContributionInfo
-{
-  double
-    weight;
-
-  long
-    pixel;
-} ContributionInfo;
+#define MaxContributionTables 8
 
+/*
+  Typedef declarations.
+*/
 typedef struct _FilterInfo
 {
   double
     (*function)(const double,const double),
     support;
 } FilterInfo;
+
+/*
+  Global declarations.
+*/
+static SemaphoreInfo
+  *resize_semaphore = (SemaphoreInfo *) NULL;
+
+static ContributionTable
+  *contribution_tables = (ContributionTable *) NULL;
+
+static const ResizeKernelInfo
+  *resize_kernels = (const ResizeKernelInfo *) NULL;
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
 %                                                                             %
@@ -824,19 +832,450 @@ static double Triangle(const double x,const double support)
   return(0.0);
 }
 
-static MagickPassFail
-HorizontalFilter(const Image * restrict source,Image * restrict destination,
-                 const double x_factor,const FilterInfo * restrict filter_info,
-                 const double blur,ThreadViewDataSet *view_data_set,
-                 const size_t span,unsigned long * restrict quantum_p,
-                 ExceptionInfo *exception)
+/*
+  Filters, indexed by FilterTypes.
+*/
+static const FilterInfo
+  filters[SincFilter+1] =
+  {
+    { Box, 0.0 },
+    { Box, 0.0 },
+    { Box, 0.5 },
+    { Triangle, 1.0 },
+    { Hermite, 1.0 },
+    { Hanning, 1.0 },
+    { Hamming, 1.0 },
+    { Blackman, 1.0 },
+    { Gaussian, 1.25 },
+    { Quadratic, 1.5 },
+    { Cubic, 2.0 },
+    { Catrom, 2.0 },
+    { Mitchell, 2.0 },
+    { Lanczos, 3.0 },
+    { BlackmanBessel, 3.2383 },
+    { BlackmanSinc, 4.0 }
+  };
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   A c q u i r e C o n t r i b u t i o n T a b l e                           %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  AcquireContributionTable() returns the filter contribution table for
+%  resizing one image dimension from source_size to destination_size
+%  pixels.  Recently used tables are retained so that resizing many images
+%  of the same size re-uses the same table.  The returned table must be
+%  released using ReleaseContributionTable().  NULL is returned, and the
+%  exception is updated, if memory can not be allocated.
+%
+%  The format of the AcquireContributionTable method is:
+%
+%      ContributionTable *AcquireContributionTable(
+%        const unsigned long source_size,const unsigned long destination_size,
+%        const FilterTypes filter,const double blur,ExceptionInfo *exception)
+%
+%  A description of each parameter follows:
+%
+%    o source_size: The number of source pixels.
+%
+%    o destination_size: The number of destination pixels.
+%
+%    o filter: Image filter to use (must not be UndefinedFilter).
+%
+%    o blur: The blur factor where > 1 is blurry, < 1 is sharp.
+%
+%    o exception: Return any errors or warnings in this structure.
+%
+%
+*/
+static void DestroyContributionTable(ContributionTable *table)
 {
-#define ResizeImageText "[%s] Resize..."
+  MagickFreeMemory(table->start);
+  MagickFreeMemory(table->nearest);
+  MagickFreeMemory(table->count);
+  MagickFreeMemory(table->weights);
+  MagickFreeMemory(table->fixed_weights);
+  MagickFreeMemory(table);
+}
+
+/*
+  Destroy unreferenced tables at the end of the list until no more than
+  MaxContributionTables remain.  Must be called with resize_semaphore
+  locked.
+*/
+static void TrimContributionTables(void)
+{
+  ContributionTable
+    *table,
+    *previous;
+
+  unsigned int
+    count;
+
+  count=0;
+  for (table=contribution_tables; table != (ContributionTable *) NULL;
+       table=table->next)
+    count++;
+  for (table=contribution_tables; (table != (ContributionTable *) NULL) &&
+         (table->next != (ContributionTable *) NULL); table=table->next)
+    ;
+  while ((table != (ContributionTable *) NULL) &&
+         (count > MaxContributionTables))
+    {
+      previous=table->previous;
+      if (table->references == 0)
+        {
+          if (table->previous != (ContributionTable *) NULL)
+            table->previous->next=table->next;
+          else
+            contribution_tables=table->next;
+          if (table->next != (ContributionTable *) NULL)
+            table->next->previous=table->previous;
+          DestroyContributionTable(table);
+          count--;
+        }
+      table=previous;
+    }
+}
+
+ContributionTable *
+AcquireContributionTable(const unsigned long source_size,
+                         const unsigned long destination_size,
+                         const FilterTypes filter,const double blur,
+                         ExceptionInfo *exception)
+{
+  ContributionTable
+    *table;
 
   double
+    center,
+    density,
     scale,
     support;
 
+  long
+    x;
+
+  register long
+    i;
+
+  size_t
+    count;
+
+  assert(((int) filter > (int) UndefinedFilter) &&
+         ((int) filter <= (int) SincFilter));
+  assert(source_size != 0);
+  assert(destination_size != 0);
+
+  LockSemaphoreInfo(resize_semaphore);
+  for (table=contribution_tables; table != (ContributionTable *) NULL;
+       table=table->next)
+    if ((table->source_size == source_size) &&
+        (table->destination_size == destination_size) &&
+        (table->filter == filter) && (table->blur == blur))
+      break;
+  if (table != (ContributionTable *) NULL)
+    {
+      /*
+        Move to head of list.
+      */
+      if (table->previous != (ContributionTable *) NULL)
+        {
+          table->previous->next=table->next;
+          if (table->next != (ContributionTable *) NULL)
+            table->next->previous=table->previous;
+          table->previous=(ContributionTable *) NULL;
+          table->next=contribution_tables;
+          contribution_tables->previous=table;
+          contribution_tables=table;
+        }
+      table->references++;
+      UnlockSemaphoreInfo(resize_semaphore);
+      return(table);
+    }
+  UnlockSemaphoreInfo(resize_semaphore);
+
+  table=MagickAllocateClearedMemory(ContributionTable *,
+                                    sizeof(ContributionTable));
+  if (table == (ContributionTable *) NULL)
+    {
+      ThrowException3(exception,ResourceLimitError,MemoryAllocationFailed,
+                      UnableToResizeImage);
+      return((ContributionTable *) NULL);
+    }
+  table->source_size=source_size;
+  table->destination_size=destination_size;
+  table->filter=filter;
+  table->blur=blur;
+  table->factor=(double) destination_size/source_size;
+  scale=blur*Max(1.0/table->factor,1.0);
+  support=scale*filters[filter].support;
+  table->support=support;
+  if (support <= 0.5)
+    {
+      /*
+        Reduce to point sampling.
+      */
+      support=0.5+MagickEpsilon;
+      scale=1.0;
+    }
+  scale=1.0/scale;
+
+  /*
+    Determine the contributing source pixels for each destination
+    pixel.
+  */
+  table->start=MagickAllocateArray(long *,destination_size,sizeof(long));
+  table->nearest=MagickAllocateArray(long *,destination_size,sizeof(long));
+  table->count=MagickAllocateArray(unsigned long *,destination_size,
+                                   sizeof(unsigned long));
+  if ((table->start == (long *) NULL) || (table->nearest == (long *) NULL) ||
+      (table->count == (unsigned long *) NULL))
+    {
+      DestroyContributionTable(table);
+      ThrowException3(exception,ResourceLimitError,MemoryAllocationFailed,
+                      UnableToResizeImage);
+      return((ContributionTable *) NULL);
+    }
+  count=1;
+  for (x=0; x < (long) destination_size; x++)
+    {
+      long
+        start,
+        stop;
+
+      center=(double) (x+0.5)/table->factor;
+      start=(long) Max(center-support+0.5,0);
+      stop=(long) Min(center+support+0.5,source_size);
+      table->start[x]=start;
+      table->count[x]=(unsigned long) (stop-start);
+      table->nearest[x]=Min(Max((long) (center+0.5),start),stop-1);
+      if ((size_t) table->count[x] > count)
+        count=table->count[x];
+    }
+  table->stride=RoundUpToAlignment(count,4);
+  table->weights=MagickAllocateClearedArray(double *,
+                                            MagickArraySize(destination_size,
+                                                            table->stride),
+                                            sizeof(double));
+  if (count <= ContributionFixedMaxCount)
+    table->fixed_weights=MagickAllocateClearedArray(magick_int16_t *,
+                                                    MagickArraySize(destination_size,
+                                                                    table->stride),
+                                                    sizeof(magick_int16_t));
+  if ((table->weights == (double *) NULL) ||
+      ((count <= ContributionFixedMaxCount) &&
+       (table->fixed_weights == (magick_int16_t *) NULL)))
+    {
+      DestroyContributionTable(table);
+      ThrowException3(exception,ResourceLimitError,MemoryAllocationFailed,
+                      UnableToResizeImage);
+      return((ContributionTable *) NULL);
+    }
+  /*
+    Compute normalized weights.
+  */
+  for (x=0; x < (long) destination_size; x++)
+    {
+      double
+        sum,
+        *weights;
+
+      long
+        fixed_sum,
+        n;
+
+      magick_int16_t
+        *fixed_weights;
+
+      weights=table->weights+(size_t) x*table->stride;
+      center=(double) (x+0.5)/table->factor;
+      n=(long) table->count[x];
+      density=0.0;
+      for (i=0; i < n; i++)
+        {
+          weights[i]=filters[filter].function(scale*((double) table->start[x]+
+                                                     i-center+0.5),
+                                              filters[filter].support);
+          density+=weights[i];
+        }
+      if ((density != 0.0) && (density != 1.0))
+        {
+          /*
+            Normalize.
+          */
+          density=1.0/density;
+          for (i=0; i < n; i++)
+            weights[i]*=density;
+        }
+      if (table->fixed_weights == (magick_int16_t *) NULL)
+        continue;
+      /*
+        Fixed-point weights are derived by rounding the running sum of
+        the weights, so that rounding errors do not accumulate across
+        the filter.  Any remaining error is assigned to the weight of the
+        nearest source pixel.
+      */
+      fixed_weights=table->fixed_weights+(size_t) x*table->stride;
+      fixed_sum=0;
+      sum=0.0;
+      for (i=0; i < n; i++)
+        {
+          double
+            value;
+
+          sum+=weights[i];
+          value=sum*(1L << ContributionWeightShift);
+          value=(value < 0.0 ? value-0.5 : value+0.5);
+          value=Max(Min(value,1048576.0),-1048576.0);
+          value=Max(Min((long) value-fixed_sum,32767L),-32768L);
+          fixed_weights[i]=(magick_int16_t) value;
+          fixed_sum+=fixed_weights[i];
+        }
+      if (n != 0)
+        {
+          i=table->nearest[x]-table->start[x];
+          fixed_sum=fixed_weights[i]+((1L << ContributionWeightShift)-
+                                      fixed_sum);
+          fixed_weights[i]=(magick_int16_t)
+            Max(Min(fixed_sum,32767L),-32768L);
+        }
+    }
+  if (IsEventLogged(TransformEvent))
+    (void) LogMagickEvent(TransformEvent,GetMagickModule(),
+                          "Computed %s filter contributions for %lu => %lu "
+                          "(blur %g, stride %"MAGICK_SIZE_T_F"u, %s weights)",
+                          ResizeFilterToString(filter),source_size,
+                          destination_size,blur,
+                          (MAGICK_SIZE_T) table->stride,
+                          table->fixed_weights != (magick_int16_t *) NULL ?
+                          "fixed-point" : "floating-point");
+
+  /*
+    Add to head of cached table list.
+  */
+  table->references=1;
+  LockSemaphoreInfo(resize_semaphore);
+  table->next=contribution_tables;
+  if (contribution_tables != (ContributionTable *) NULL)
+    contribution_tables->previous=table;
+  contribution_tables=table;
+  TrimContributionTables();
+  UnlockSemaphoreInfo(resize_semaphore);
+  return(table);
+}
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   D e s t r o y R e s i z e I n f o                                         %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  DestroyResizeInfo() deallocates the retained filter contribution tables.
+%
+%  The format of the DestroyResizeInfo method is:
+%
+%      void DestroyResizeInfo(void)
+%
+%
+*/
+void DestroyResizeInfo(void)
+{
+  ContributionTable
+    *table;
+
+  while (contribution_tables != (ContributionTable *) NULL)
+    {
+      table=contribution_tables;
+      contribution_tables=contribution_tables->next;
+      DestroyContributionTable(table);
+    }
+  DestroySemaphoreInfo(&resize_semaphore);
+}
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   I n i t i a l i z e R e s i z e I n f o                                   %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  InitializeResizeInfo() initializes the resize facility and selects the
+%  resize kernels to use.  The MAGICK_RESIZE_KERNEL environment variable
+%  may be used to request specific kernels (e.g. "scalar").
+%
+%  The format of the InitializeResizeInfo method is:
+%
+%      MagickPassFail InitializeResizeInfo(void)
+%
+%
+*/
+MagickPassFail
+InitializeResizeInfo(void)
+{
+  assert(resize_semaphore == (SemaphoreInfo *) NULL);
+  resize_semaphore=AllocateSemaphoreInfo();
+  resize_kernels=SelectResizeKernels(getenv("MAGICK_RESIZE_KERNEL"));
+  return MagickPass;
+}
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   R e l e a s e C o n t r i b u t i o n T a b l e                           %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  ReleaseContributionTable() releases a table obtained from
+%  AcquireContributionTable().
+%
+%  The format of the ReleaseContributionTable method is:
+%
+%      void ReleaseContributionTable(ContributionTable *table)
+%
+%  A description of each parameter follows:
+%
+%    o table: The contribution table.
+%
+%
+*/
+void ReleaseContributionTable(ContributionTable *table)
+{
+  if (table == (ContributionTable *) NULL)
+    return;
+  LockSemaphoreInfo(resize_semaphore);
+  assert(table->references > 0);
+  table->references--;
+  TrimContributionTables();
+  UnlockSemaphoreInfo(resize_semaphore);
+}
+
+static MagickPassFail
+HorizontalFilter(const Image * restrict source,Image * restrict destination,
+                 const ContributionTable * restrict table,const size_t span,unsigned long * restrict quantum_p,
+                 ExceptionInfo *exception)
+{
+#define ResizeImageText "[%s] Resize..."
+
   DoublePixelPacket
     zero;
 
@@ -861,24 +1300,14 @@ HorizontalFilter(const Image * restrict source,Image * restrict destination,
                           "(x_factor %g, blur %g, span %"MAGICK_SIZE_T_F"u) ...",
                           source->columns, source->rows,
                           destination->columns, destination->rows,
-                          x_factor, blur, (MAGICK_SIZE_T) span);
+                          table->factor, table->blur,
+                          (MAGICK_SIZE_T) span);
 
   quantum = *quantum_p;
 
-  scale=blur*Max(1.0/x_factor,1.0);
-  support=scale*filter_info->support;
   destination->storage_class=source->storage_class;
-  if (support > 0.5)
+  if (table->support > 0.5)
     destination->storage_class=DirectClass;
-  else
-    {
-      /*
-        Reduce to point sampling.
-      */
-      support=0.5+MagickEpsilon;
-      scale=1.0;
-    }
-  scale=1.0/scale;
   (void) memset(&zero,0,sizeof(DoublePixelPacket));
 
   monitor_active=MagickMonitorActive();
@@ -896,12 +1325,8 @@ HorizontalFilter(const Image * restrict source,Image * restrict destination,
 #endif
   for (x=0; x < (long) destination->columns; x++)
     {
-      double
-        center,
-        density;
-
-      ContributionInfo
-        * restrict contribution;
+      const double
+        * restrict weights;
 
       register const PixelPacket
         * restrict p;
@@ -917,8 +1342,8 @@ HorizontalFilter(const Image * restrict source,Image * restrict destination,
 
       long
         n,
+        nearest,
         start,
-        stop,
         y;
 
       MagickBool
@@ -928,35 +1353,12 @@ HorizontalFilter(const Image * restrict source,Image * restrict destination,
       if (thread_status == MagickFail)
         continue;
 
-      contribution=AccessThreadViewData(view_data_set);
-      /* fprintf(stderr,"Thread %d contribution %p\n",omp_get_thread_num(),contribution); */
-      center=(double) (x+0.5)/x_factor;
-      start=(long) Max(center-support+0.5,0);
-      stop=(long) Min(center+support+0.5,source->columns);
-      density=0.0;
-      for (n=0; n < (stop-start); n++)
-        {
-          contribution[n].pixel=start+n;
-          contribution[n].weight=
-            filter_info->function(scale*((double) start+n-center+0.5),filter_info->support);
-          density+=contribution[n].weight;
-        }
-      if ((density != 0.0) && (density != 1.0))
-        {
-          /*
-            Normalize.
-          */
-          long
-            i;
+      start=table->start[x];
+      n=(long) table->count[x];
+      nearest=table->nearest[x]-start;
+      weights=table->weights+(size_t) x*table->stride;
 
-          density=1.0/density;
-          for (i=0; i < n; i++)
-            contribution[i].weight*=density;
-        }
-
-      p=AcquireImagePixels(source,contribution[0].pixel,0,
-                           contribution[n-1].pixel-contribution[0].pixel+1,
-                           source->rows,exception);
+      p=AcquireImagePixels(source,start,0,n,source->rows,exception);
       if (p == (const PixelPacket *) NULL)
         thread_status=MagickFail;
 
@@ -991,9 +1393,8 @@ HorizontalFilter(const Image * restrict source,Image * restrict destination,
                   normalize=0.0;
                   for (i=0; i < n; i++)
                     {
-                      j=y*(contribution[n-1].pixel-contribution[0].pixel+1)+
-                        (contribution[i].pixel-contribution[0].pixel);
-                      weight=contribution[i].weight;
+                      j=y*n+i;
+                      weight=weights[i];
                       transparency_coeff = weight * (1 - ((double) p[j].opacity/TransparentOpacity));
                       pixel.red+=transparency_coeff*p[j].red;
                       pixel.green+=transparency_coeff*p[j].green;
@@ -1013,13 +1414,23 @@ HorizontalFilter(const Image * restrict source,Image * restrict destination,
                   if ((indexes != (IndexPacket *) NULL) &&
                       (source_indexes != (IndexPacket *) NULL))
                     {
-                      i=Min(Max((long) (center+0.5),start),stop-1);
-                      j=y*(contribution[n-1].pixel-contribution[0].pixel+1)+
-                        (contribution[i-start].pixel-contribution[0].pixel);
+                      j=y*n+nearest;
                       indexes[y]=source_indexes[j];
                     }
                 }
             }
+          else if ((resize_kernels->horizontal != (HorizontalResizeKernel) NULL) &&
+                   (table->fixed_weights != (magick_int16_t *) NULL))
+            {
+              resize_kernels->horizontal(p,(unsigned long) n,
+                                         table->fixed_weights+
+                                         (size_t) x*table->stride,
+                                         q,destination->rows);
+              if ((indexes != (IndexPacket *) NULL) &&
+                  (source_indexes != (IndexPacket *) NULL))
+                for (y=0; y < (long) destination->rows; y++)
+                  indexes[y]=source_indexes[y*n+nearest];
+            }
           else
             {
               for (y=0; y < (long) destination->rows; y++)
@@ -1038,9 +1449,8 @@ HorizontalFilter(const Image * restrict source,Image * restrict destination,
 
                   for (i=0; i < n; i++)
                     {
-                      j=(long) (y*(contribution[n-1].pixel-contribution[0].pixel+1)+
-                                (contribution[i].pixel-contribution[0].pixel));
-                      weight=contribution[i].weight;
+                      j=y*n+i;
+                      weight=weights[i];
                       pixel.red+=weight*p[j].red;
                       pixel.green+=weight*p[j].green;
                       pixel.blue+=weight*p[j].blue;
@@ -1053,9 +1463,7 @@ HorizontalFilter(const Image * restrict source,Image * restrict destination,
                   if ((indexes != (IndexPacket *) NULL) &&
                       (source_indexes != (IndexPacket *) NULL))
                     {
-                      i=Min(Max((long) (center+0.5),start),stop-1);
-                      j=y*(contribution[n-1].pixel-contribution[0].pixel+1)+
-                        (contribution[i-start].pixel-contribution[0].pixel);
+                      j=y*n+nearest;
                       indexes[y]=source_indexes[j];
                     }
                 }
@@ -1105,15 +1513,9 @@ HorizontalFilter(const Image * restrict source,Image * restrict destination,
 
 static MagickPassFail
 VerticalFilter(const Image * restrict source,Image * restrict destination,
-               const double y_factor,const FilterInfo * restrict filter_info,
-               const double blur,ThreadViewDataSet *view_data_set,
-               const size_t span,unsigned long * restrict quantum_p,
+               const ContributionTable * restrict table,const size_t span,unsigned long * restrict quantum_p,
                ExceptionInfo *exception)
 {
-  double
-    scale,
-    support;
-
   DoublePixelPacket
     zero;
 
@@ -1138,27 +1540,17 @@ VerticalFilter(const Image * restrict source,Image * restrict destination,
                           "(y_factor %g, blur %g, span %"MAGICK_SIZE_T_F"u) ...",
                           source->columns, source->rows,
                           destination->columns, destination->rows,
-                          y_factor, blur, (MAGICK_SIZE_T) span);
+                          table->factor, table->blur,
+                          (MAGICK_SIZE_T) span);
 
   quantum = *quantum_p;
 
   /*
     Apply filter to resize vertically from source to destination.
   */
-  scale=blur*Max(1.0/y_factor,1.0);
-  support=scale*filter_info->support;
   destination->storage_class=source->storage_class;
-  if (support > 0.5)
+  if (table->support > 0.5)
     destination->storage_class=DirectClass;
-  else
-    {
-      /*
-        Reduce to point sampling.
-      */
-      support=0.5+MagickEpsilon;
-      scale=1.0;
-    }
-  scale=1.0/scale;
   (void) memset(&zero,0,sizeof(DoublePixelPacket));
 
   monitor_active=MagickMonitorActive();
@@ -1176,12 +1568,8 @@ VerticalFilter(const Image * restrict source,Image * restrict destination,
 #endif
   for (y=0; y < (long) destination->rows; y++)
     {
-      double
-        center,
-        density;
-
-      ContributionInfo
-        * restrict contribution;
+      const double
+        * restrict weights;
 
       register const PixelPacket
         * restrict p;
@@ -1197,8 +1585,8 @@ VerticalFilter(const Image * restrict source,Image * restrict destination,
 
       long
         n,
+        nearest,
         start,
-        stop,
         x;
 
       MagickBool
@@ -1208,34 +1596,12 @@ VerticalFilter(const Image * restrict source,Image * restrict destination,
       if (thread_status == MagickFail)
         continue;
 
-      contribution=AccessThreadViewData(view_data_set);
-      center=(double) (y+0.5)/y_factor;
-      start=(long) Max(center-support+0.5,0);
-      stop=(long) Min(center+support+0.5,source->rows);
-      density=0.0;
-      for (n=0; n < (stop-start); n++)
-        {
-          contribution[n].pixel=start+n;
-          contribution[n].weight=
-            filter_info->function(scale*((double) start+n-center+0.5),filter_info->support);
-          density+=contribution[n].weight;
-        }
-      if ((density != 0.0) && (density != 1.0))
-        {
-          /*
-            Normalize.
-          */
-          long
-            i;
+      start=table->start[y];
+      n=(long) table->count[y];
+      nearest=table->nearest[y]-start;
+      weights=table->weights+(size_t) y*table->stride;
 
-          density=1.0/density;
-          for (i=0; i < n; i++)
-            contribution[i].weight*=density;
-        }
-
-      p=AcquireImagePixels(source,0,contribution[0].pixel,source->columns,
-                           contribution[n-1].pixel-contribution[0].pixel+1,
-                           exception);
+      p=AcquireImagePixels(source,0,start,source->columns,n,exception);
       if (p == (const PixelPacket *) NULL)
         thread_status=MagickFail;
 
@@ -1269,9 +1635,8 @@ VerticalFilter(const Image * restrict source,Image * restrict destination,
                   normalize=0.0;
                   for (i=0; i < n; i++)
                     {
-                      j=(long) ((contribution[i].pixel-contribution[0].pixel)*
-                                source->columns+x);
-                      weight=contribution[i].weight;
+                      j=(long) (i*source->columns+x);
+                      weight=weights[i];
                       transparency_coeff = weight * (1 - ((double) p[j].opacity/TransparentOpacity));
                       pixel.red+=transparency_coeff*p[j].red;
                       pixel.green+=transparency_coeff*p[j].green;
@@ -1292,13 +1657,22 @@ VerticalFilter(const Image * restrict source,Image * restrict destination,
                   if ((indexes != (IndexPacket *) NULL) &&
                       (source_indexes != (IndexPacket *) NULL))
                     {
-                      i=Min(Max((long) (center+0.5),start),stop-1);
-                      j=(long) ((contribution[i-start].pixel-contribution[0].pixel)*
-                                source->columns+x);
+                      j=(long) (nearest*source->columns+x);
                       indexes[x]=source_indexes[j];
                     }
                 }
             }
+          else if ((resize_kernels->vertical != (VerticalResizeKernel) NULL) &&
+                   (table->fixed_weights != (magick_int16_t *) NULL))
+            {
+              resize_kernels->vertical(p,source->columns,(unsigned long) n,
+                                       table->fixed_weights+
+                                       (size_t) y*table->stride,q);
+              if ((indexes != (IndexPacket *) NULL) &&
+                  (source_indexes != (IndexPacket *) NULL))
+                for (x=0; x < (long) destination->columns; x++)
+                  indexes[x]=source_indexes[nearest*source->columns+x];
+            }
           else
             {
               for (x=0; x < (long) destination->columns; x++)
@@ -1318,9 +1692,8 @@ VerticalFilter(const Image * restrict source,Image * restrict destination,
                   pixel=zero;
                   for (i=0; i < n; i++)
                     {
-                      j=(long) ((contribution[i].pixel-contribution[0].pixel)*
-                                source->columns+x);
-                      weight=contribution[i].weight;
+                      j=(long) (i*source->columns+x);
+                      weight=weights[i];
                       pixel.red+=weight*p[j].red;
                       pixel.green+=weight*p[j].green;
                       pixel.blue+=weight*p[j].blue;
@@ -1333,9 +1706,7 @@ VerticalFilter(const Image * restrict source,Image * restrict destination,
                   if ((indexes != (IndexPacket *) NULL) &&
                       (source_indexes != (IndexPacket *) NULL))
                     {
-                      i=Min(Max((long) (center+0.5),start),stop-1);
-                      j=(long) ((contribution[i-start].pixel-contribution[0].pixel)*
-                                source->columns+x);
+                      j=(long) (nearest*source->columns+x);
                       indexes[x]=source_indexes[j];
                     }
                 }
@@ -1389,15 +1760,13 @@ MagickExport Image *ResizeImage(const Image *image,const unsigned long columns,
                                 const double blur,
                                 ExceptionInfo *exception)
 {
-  ThreadViewDataSet
-    *view_data_set;
+  ContributionTable
+    *x_table,
+    *y_table;
 
   double
-    support,
     x_factor,
-    x_support,
-    y_factor,
-    y_support;
+    y_factor;
 
   Image
     *source_image,
@@ -1406,27 +1775,6 @@ MagickExport Image *ResizeImage(const Image *image,const unsigned long columns,
   register long
     i;
 
-  static const FilterInfo
-    filters[SincFilter+1] =
-    {
-      { Box, 0.0 },
-      { Box, 0.0 },
-      { Box, 0.5 },
-      { Triangle, 1.0 },
-      { Hermite, 1.0 },
-      { Hanning, 1.0 },
-      { Hamming, 1.0 },
-      { Blackman, 1.0 },
-      { Gaussian, 1.25 },
-      { Quadratic, 1.5 },
-      { Cubic, 2.0 },
-      { Catrom, 2.0 },
-      { Mitchell, 2.0 },
-      { Lanczos, 3.0 },
-      { BlackmanBessel, 3.2383 },
-      { BlackmanSinc, 4.0 }
-    };
-
   size_t
     span;
 
@@ -1487,27 +1835,27 @@ MagickExport Image *ResizeImage(const Image *image,const unsigned long columns,
 
   if (IsEventLogged(TransformEvent))
     (void) LogMagickEvent(TransformEvent,GetMagickModule(),
-                          "Resizing image of size %lux%lu to %lux%lu using %s filter",
+                          "Resizing image of size %lux%lu to %lux%lu using %s filter "
+                          "(%s kernels)",
                           image->columns,image->rows,columns,rows,
-                          ResizeFilterToString((FilterTypes)i));
+                          ResizeFilterToString((FilterTypes)i),
+                          resize_kernels->name);
 
-  x_support=blur*Max(1.0/x_factor,1.0)*filters[i].support;
-  y_support=blur*Max(1.0/y_factor,1.0)*filters[i].support;
-  support=Max(x_support,y_support);
-  if (support < filters[i].support)
-    support=filters[i].support;
   /*
-    Allocate view data set.
+    Acquire filter contribution tables.
   */
-  view_data_set=AllocateThreadViewDataArray(image,exception,
-                                            (size_t) (2.0*Max(support,0.5)+3),
-                                            sizeof(ContributionInfo));
-  if (view_data_set == (ThreadViewDataSet *) NULL)
+  x_table=AcquireContributionTable(image->columns,columns,(FilterTypes) i,
+                                   blur,exception);
+  y_table=(ContributionTable *) NULL;
+  if (x_table != (ContributionTable *) NULL)
+    y_table=AcquireContributionTable(image->rows,rows,(FilterTypes) i,blur,
+                                     exception);
+  if (y_table == (ContributionTable *) NULL)
     {
+      ReleaseContributionTable(x_table);
       DestroyImage(resize_image);
       DestroyImage(source_image);
-      ThrowImageException3(ResourceLimitError,MemoryAllocationFailed,
-                           UnableToResizeImage);
+      return ((Image *) NULL);
     }
   /*
     Resize image.
@@ -1521,25 +1869,26 @@ MagickExport Image *ResizeImage(const Image *image,const unsigned long columns,
   if (order)
     {
       span=(size_t) source_image->columns+resize_image->rows;
-      status=HorizontalFilter(image,source_image,x_factor,&filters[i],blur,
-                              view_data_set,span,&quantum,exception);
+      status=HorizontalFilter(image,source_image,x_table,span,&quantum,
+                              exception);
       if (status != MagickFail)
-        status=VerticalFilter(source_image,resize_image,y_factor,&filters[i],
-                              blur,view_data_set,span,&quantum,exception);
+        status=VerticalFilter(source_image,resize_image,y_table,span,&quantum,
+                              exception);
     }
   else
     {
       span=(size_t) resize_image->columns+source_image->rows;
-      status=VerticalFilter(image,source_image,y_factor,&filters[i],blur,
-                            view_data_set,span,&quantum,exception);
+      status=VerticalFilter(image,source_image,y_table,span,&quantum,
+                            exception);
       if (status != MagickFail)
-        status=HorizontalFilter(source_image,resize_image,x_factor,&filters[i],
-                                blur,view_data_set,span,&quantum,exception);
+        status=HorizontalFilter(source_image,resize_image,x_table,span,
+                                &quantum,exception);
     }
   /*
     Free allocated memory.
   */
-  DestroyThreadViewDataSet(view_data_set);
+  ReleaseContributionTable(x_table);
+  ReleaseContributionTable(y_table);
   DestroyImage(source_image);
   if (status == MagickFail)
     {
@@ -1549,6 +1898,263 @@ MagickExport Image *ResizeImage(const Image *image,const unsigned long columns,
   resize_image->is_grayscale=image->is_grayscale;
   return(resize_image);
 }
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   R e s i z e R o w s                                                       %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  These methods resize an image which is supplied one row at a time (e.g.
+%  by a decoder) so that the full size image never needs to be stored.
+%  Each row is passed through the horizontal filter as it is supplied, and
+%  the vertical filter is applied by FinishResizeRows() once all rows have
+%  been supplied.
+%
+%  AllocateResizeRowsInfo() prepares to resize the rows of image (which
+%  supplies the source dimensions and attributes) to columns x rows pixels.
+%  Each source row is then passed to ResizeRow().  FinishResizeRows()
+%  stores the resized image into the pixels of a destination image which
+%  must already have the requested dimensions and no pixels.  The
+%  ResizeRowsInfo must be deallocated using DestroyResizeRowsInfo().
+%
+%  The format of these methods are:
+%
+%      ResizeRowsInfo *AllocateResizeRowsInfo(const Image *image,
+%        const unsigned long columns,const unsigned long rows,
+%        const FilterTypes filter,const double blur,ExceptionInfo *exception)
+%
+%      MagickPassFail ResizeRow(ResizeRowsInfo *resize_info,
+%        const PixelPacket *pixels,const IndexPacket *indexes,
+%        const unsigned long y,ExceptionInfo *exception)
+%
+%      MagickPassFail FinishResizeRows(ResizeRowsInfo *resize_info,
+%        Image *image,ExceptionInfo *exception)
+%
+%      void DestroyResizeRowsInfo(ResizeRowsInfo *resize_info)
+%
+%  A description of each parameter follows:
+%
+%    o image: The source image (AllocateResizeRowsInfo()), or the
+%      destination image (FinishResizeRows()).
+%
+%    o columns: The number of columns in the resized image.
+%
+%    o rows: The number of rows in the resized image.
+%
+%    o filter: Image filter to use.
+%
+%    o blur: The blur factor where > 1 is blurry, < 1 is sharp.
+%
+%    o resize_info: The row resize state.
+%
+%    o pixels: The pixels of source row y.
+%
+%    o indexes: The colormap indexes of source row y, or NULL.
+%
+%    o y: The source row number.
+%
+%    o exception: Return any errors or warnings in this structure.
+%
+%
+*/
+struct _ResizeRowsInfo
+{
+  ContributionTable
+    *x_table,
+    *y_table;
+
+  Image
+    *intermediate;        /* Horizontally resized rows */
+
+  MagickBool
+    matte;
+};
+
+MagickExport ResizeRowsInfo *
+AllocateResizeRowsInfo(const Image *image,const unsigned long columns,
+                       const unsigned long rows,const FilterTypes filter,
+                       const double blur,ExceptionInfo *exception)
+{
+  ResizeRowsInfo
+    *resize_info;
+
+  assert(image != (Image *) NULL);
+  assert(image->signature == MagickSignature);
+  assert(((int) filter > (int) UndefinedFilter) &&
+         ((int) filter <= (int) SincFilter));
+
+  if ((image->columns == 0UL) || (image->rows == 0UL) ||
+      (columns == 0UL) || (rows == 0UL))
+    {
+      ThrowException(exception,ImageError,UnableToResizeImage,
+                     MagickMsg(OptionError,NonzeroWidthAndHeightRequired));
+      return((ResizeRowsInfo *) NULL);
+    }
+  resize_info=MagickAllocateClearedMemory(ResizeRowsInfo *,
+                                          sizeof(ResizeRowsInfo));
+  if (resize_info == (ResizeRowsInfo *) NULL)
+    {
+      ThrowException3(exception,ResourceLimitError,MemoryAllocationFailed,
+                      UnableToResizeImage);
+      return((ResizeRowsInfo *) NULL);
+    }
+  resize_info->matte=((image->matte) ||
+                      (image->colorspace == CMYKColorspace));
+  resize_info->x_table=AcquireContributionTable(image->columns,columns,filter,
+                                                blur,exception);
+  if (resize_info->x_table != (ContributionTable *) NULL)
+    resize_info->y_table=AcquireContributionTable(image->rows,rows,filter,
+                                                  blur,exception);
+  if (resize_info->y_table != (ContributionTable *) NULL)
+    resize_info->intermediate=CloneImage(image,columns,image->rows,True,
+                                         exception);
+  if (resize_info->intermediate == (Image *) NULL)
+    {
+      DestroyResizeRowsInfo(resize_info);
+      return((ResizeRowsInfo *) NULL);
+    }
+  if (resize_info->x_table->support > 0.5)
+    resize_info->intermediate->storage_class=DirectClass;
+  if (IsEventLogged(TransformEvent))
+    (void) LogMagickEvent(TransformEvent,GetMagickModule(),
+                          "Resizing rows of size %lux%lu to %lux%lu using %s "
+                          "filter (%s kernels)",
+                          image->columns,image->rows,columns,rows,
+                          ResizeFilterToString(filter),resize_kernels->name);
+  return(resize_info);
+}
+
+MagickExport MagickPassFail
+ResizeRow(ResizeRowsInfo *resize_info,const PixelPacket *pixels,
+          const IndexPacket *indexes,const unsigned long y,
+          ExceptionInfo *exception)
+{
+  const ContributionTable
+    *table;
+
+  IndexPacket
+    *q_indexes;
+
+  long
+    x;
+
+  register PixelPacket
+    *q;
+
+  assert(resize_info != (ResizeRowsInfo *) NULL);
+  table=resize_info->x_table;
+  q=SetImagePixelsEx(resize_info->intermediate,0,(long) y,
+                     resize_info->intermediate->columns,1,exception);
+  if (q == (PixelPacket *) NULL)
+    return(MagickFail);
+  q_indexes=AccessMutableIndexes(resize_info->intermediate);
+  for (x=0; x < (long) resize_info->intermediate->columns; x++)
+    {
+      const double
+        *weights;
+
+      const PixelPacket
+        *p;
+
+      DoublePixelPacket
+        pixel;
+
+      double
+        normalize,
+        transparency_coeff;
+
+      register long
+        i;
+
+      long
+        n;
+
+      p=pixels+table->start[x];
+      n=(long) table->count[x];
+      weights=table->weights+(size_t) x*table->stride;
+      if (resize_info->matte)
+        {
+          (void) memset(&pixel,0,sizeof(pixel));
+          normalize=0.0;
+          for (i=0; i < n; i++)
+            {
+              transparency_coeff=weights[i]*
+                (1-((double) p[i].opacity/TransparentOpacity));
+              pixel.red+=transparency_coeff*p[i].red;
+              pixel.green+=transparency_coeff*p[i].green;
+              pixel.blue+=transparency_coeff*p[i].blue;
+              pixel.opacity+=weights[i]*p[i].opacity;
+              normalize+=transparency_coeff;
+            }
+          normalize=1.0/(AbsoluteValue(normalize) <= MagickEpsilon ? 1.0 :
+                         normalize);
+          q[x].red=RoundDoubleToQuantum(pixel.red*normalize);
+          q[x].green=RoundDoubleToQuantum(pixel.green*normalize);
+          q[x].blue=RoundDoubleToQuantum(pixel.blue*normalize);
+          q[x].opacity=RoundDoubleToQuantum(pixel.opacity);
+        }
+      else if ((resize_kernels->horizontal != (HorizontalResizeKernel) NULL) &&
+               (table->fixed_weights != (magick_int16_t *) NULL))
+        {
+          resize_kernels->horizontal(p,(unsigned long) n,
+                                     table->fixed_weights+
+                                     (size_t) x*table->stride,q+x,1);
+        }
+      else
+        {
+          (void) memset(&pixel,0,sizeof(pixel));
+          for (i=0; i < n; i++)
+            {
+              pixel.red+=weights[i]*p[i].red;
+              pixel.green+=weights[i]*p[i].green;
+              pixel.blue+=weights[i]*p[i].blue;
+            }
+          q[x].red=RoundDoubleToQuantum(pixel.red);
+          q[x].green=RoundDoubleToQuantum(pixel.green);
+          q[x].blue=RoundDoubleToQuantum(pixel.blue);
+          q[x].opacity=OpaqueOpacity;
+        }
+      if ((q_indexes != (IndexPacket *) NULL) &&
+          (indexes != (const IndexPacket *) NULL))
+        q_indexes[x]=indexes[table->nearest[x]];
+    }
+  return(SyncImagePixelsEx(resize_info->intermediate,exception));
+}
+
+MagickExport MagickPassFail
+FinishResizeRows(ResizeRowsInfo *resize_info,Image *image,
+                 ExceptionInfo *exception)
+{
+  unsigned long
+    quantum;
+
+  assert(resize_info != (ResizeRowsInfo *) NULL);
+  assert(image != (Image *) NULL);
+  assert(image->signature == MagickSignature);
+  assert(image->columns == resize_info->intermediate->columns);
+  assert(image->rows == resize_info->y_table->destination_size);
+  quantum=0;
+  return(VerticalFilter(resize_info->intermediate,image,resize_info->y_table,
+                        image->rows,&quantum,exception));
+}
+
+MagickExport void
+DestroyResizeRowsInfo(ResizeRowsInfo *resize_info)
+{
+  if (resize_info == (ResizeRowsInfo *) NULL)
+    return;
+  if (resize_info->intermediate != (Image *) NULL)
+    DestroyImage(resize_info->intermediate);
+  ReleaseContributionTable(resize_info->x_table);
+  ReleaseContributionTable(resize_info->y_table);
+  MagickFreeMemory(resize_info);
+}
 
 /*
 %%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
@@ -0,0 +1,561 @@
+/*
+% Copyright (C) 2026 GraphicsMagick Group
+%
+% This program is covered by multiple licenses, which are described in
+% Copyright.txt. You should have received a copy of Copyright.txt with this
+% package; otherwise see http://www.graphicsmagick.org/www/Copyright.html.
+%
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%               GraphicsMagick Vectorized Image Resize Kernels                %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+% These kernels apply the fixed-point weights of a ContributionTable to
+% opaque QuantumDepth 8 pixels, processing the four samples of a
+% PixelPacket together and several destination pixels per iteration.
+% The double-precision code in resize.c remains the reference
+% implementation and is used for all other cases.
+%
+*/
+
+/*
+  Include declarations.
+*/
+#include "magick/studio.h"
+#include "magick/resize.h"
+#include "magick/utility.h"
+
+#if (QuantumDepth == 8) && !defined(WORDS_BIGENDIAN)
+#  if (defined(__x86_64__) || defined(__i386__)) && \
+  (defined(__clang__) || \
+   (defined(__GNUC__) && ((__GNUC__ > 4) || \
+                          ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))))
+#    define HAVE_RESIZE_X86_KERNELS 1
+#    include <immintrin.h>
+#    define MAGICK_TARGET_SSE2 __attribute__((target("sse2")))
+#    define MAGICK_TARGET_AVX2 __attribute__((target("avx2")))
+#  endif
+#  if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#    define HAVE_RESIZE_NEON_KERNELS 1
+#    include <arm_neon.h>
+#  endif
+#endif
+
+#if defined(HAVE_RESIZE_X86_KERNELS) || defined(HAVE_RESIZE_NEON_KERNELS)
+/*
+  Accumulators start at one half so that the final arithmetic shift
+  rounds to nearest.
+*/
+#define ResizeRoundingBias (1L << (ContributionWeightShift-1))
+
+static inline magick_uint32_t LoadPixel(const PixelPacket *p)
+{
+  magick_uint32_t
+    value;
+
+  (void) memcpy(&value,p,sizeof(value));
+  return value;
+}
+
+static inline void StorePixel(PixelPacket *q,const magick_uint32_t value)
+{
+  (void) memcpy(q,&value,sizeof(value));
+}
+#endif /* defined(HAVE_RESIZE_X86_KERNELS) || defined(HAVE_RESIZE_NEON_KERNELS) */
+
+#if defined(HAVE_RESIZE_X86_KERNELS)
+/*
+  The opacity sample is the last byte of a PixelPacket and is always
+  OpaqueOpacity (zero) in the result.
+*/
+#define OpaqueMask ((int) 0x00ffffff)
+
+/*
+  Return a vector of 32-bit values each holding the weight pair w0
+  (low) and w1 (high) for use with _mm_madd_epi16().
+*/
+MAGICK_TARGET_SSE2 static inline __m128i
+SSE2WeightPair(const magick_int16_t *w)
+{
+  return _mm_set1_epi32((int) (((magick_uint32_t) (magick_uint16_t) w[1] << 16) |
+                               (magick_uint16_t) w[0]));
+}
+
+/*
+  Return the weighted sum of pixels a and b (held in the low 32 bits)
+  for each of the four samples.
+*/
+MAGICK_TARGET_SSE2 static inline __m128i
+SSE2MultiplyPair(const __m128i a,const __m128i b,const __m128i w)
+{
+  __m128i
+    v;
+
+  v=_mm_unpacklo_epi8(a,b);
+  v=_mm_unpacklo_epi8(v,_mm_setzero_si128());
+  return _mm_madd_epi16(v,w);
+}
+
+/*
+  Return the weighted sum of four consecutive pixels for each of the
+  four samples.
+*/
+MAGICK_TARGET_SSE2 static inline __m128i
+SSE2MultiplyQuad(const PixelPacket *p,const __m128i w01,const __m128i w23)
+{
+  __m128i
+    v;
+
+  v=_mm_loadu_si128((const __m128i *) p);
+  v=_mm_shuffle_epi32(v,_MM_SHUFFLE(3,1,2,0));
+  v=_mm_unpacklo_epi8(v,_mm_unpackhi_epi64(v,v));
+  return _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(v,_mm_setzero_si128()),w01),
+                       _mm_madd_epi16(_mm_unpackhi_epi8(v,_mm_setzero_si128()),w23));
+}
+
+/*
+  Return the weighted sum of 'count' consecutive pixels.
+*/
+MAGICK_TARGET_SSE2 static inline __m128i
+SSE2HorizontalSum(const PixelPacket * restrict p,const unsigned long count,
+                  const magick_int16_t * restrict weights,__m128i acc,
+                  unsigned long i)
+{
+  for ( ; i+4 <= count; i+=4)
+    acc=_mm_add_epi32(acc,SSE2MultiplyQuad(p+i,SSE2WeightPair(weights+i),
+                                           SSE2WeightPair(weights+i+2)));
+  for ( ; i < count; i+=2)
+    acc=_mm_add_epi32(acc,SSE2MultiplyPair(_mm_cvtsi32_si128((int) LoadPixel(p+i)),
+                                           (i+1 < count ?
+                                            _mm_cvtsi32_si128((int) LoadPixel(p+i+1)) :
+                                            _mm_setzero_si128()),
+                                           SSE2WeightPair(weights+i)));
+  return acc;
+}
+
+/*
+  Convert two accumulators to two opaque pixels in the low 64 bits.
+*/
+MAGICK_TARGET_SSE2 static inline __m128i
+SSE2PackPixels(const __m128i acc0,const __m128i acc1)
+{
+  __m128i
+    v;
+
+  v=_mm_packs_epi32(_mm_srai_epi32(acc0,ContributionWeightShift),
+                    _mm_srai_epi32(acc1,ContributionWeightShift));
+  v=_mm_packus_epi16(v,v);
+  return _mm_and_si128(v,_mm_set1_epi32(OpaqueMask));
+}
+
+MAGICK_TARGET_SSE2 static void
+HorizontalSSE2(const PixelPacket * restrict p,const unsigned long count,
+               const magick_int16_t * restrict weights,
+               PixelPacket * restrict q,const unsigned long rows)
+{
+  const __m128i
+    bias = _mm_set1_epi32(ResizeRoundingBias);
+
+  unsigned long
+    y;
+
+  for (y=0; y+2 <= rows; y+=2)
+    {
+      __m128i
+        acc0,
+        acc1;
+
+      acc0=SSE2HorizontalSum(p+y*count,count,weights,bias,0);
+      acc1=SSE2HorizontalSum(p+(y+1)*count,count,weights,bias,0);
+      _mm_storel_epi64((__m128i *) (q+y),SSE2PackPixels(acc0,acc1));
+    }
+  if (y < rows)
+    StorePixel(q+y,(magick_uint32_t)
+               _mm_cvtsi128_si32(SSE2PackPixels(SSE2HorizontalSum(p+y*count,count,
+                                                                  weights,bias,0),
+                                                bias)));
+}
+
+/*
+  Vertical filter over 'width' destination pixels where source rows are
+  'stride' pixels apart.
+*/
+MAGICK_TARGET_SSE2 static void
+SSE2VerticalFilter(const PixelPacket * restrict p,const unsigned long stride,
+                   const unsigned long width,const unsigned long count,
+                   const magick_int16_t * restrict weights,
+                   PixelPacket * restrict q)
+{
+  const __m128i
+    bias = _mm_set1_epi32(ResizeRoundingBias),
+    zero = _mm_setzero_si128();
+
+  unsigned long
+    i,
+    x;
+
+  for (x=0; x+4 <= width; x+=4)
+    {
+      __m128i
+        acc0=bias,
+        acc1=bias,
+        acc2=bias,
+        acc3=bias;
+
+      for (i=0; i < count; i+=2)
+        {
+          __m128i
+            hi,
+            lo,
+            r0,
+            r1,
+            w;
+
+          r0=_mm_loadu_si128((const __m128i *) (p+i*stride+x));
+          r1=zero;
+          if (i+1 < count)
+            r1=_mm_loadu_si128((const __m128i *) (p+(i+1)*stride+x));
+          w=SSE2WeightPair(weights+i);
+          lo=_mm_unpacklo_epi8(r0,r1);
+          hi=_mm_unpackhi_epi8(r0,r1);
+          acc0=_mm_add_epi32(acc0,_mm_madd_epi16(_mm_unpacklo_epi8(lo,zero),w));
+          acc1=_mm_add_epi32(acc1,_mm_madd_epi16(_mm_unpackhi_epi8(lo,zero),w));
+          acc2=_mm_add_epi32(acc2,_mm_madd_epi16(_mm_unpacklo_epi8(hi,zero),w));
+          acc3=_mm_add_epi32(acc3,_mm_madd_epi16(_mm_unpackhi_epi8(hi,zero),w));
+        }
+      _mm_storel_epi64((__m128i *) (q+x),SSE2PackPixels(acc0,acc1));
+      _mm_storel_epi64((__m128i *) (q+x+2),SSE2PackPixels(acc2,acc3));
+    }
+  for ( ; x < width; x++)
+    {
+      __m128i
+        acc=bias;
+
+      for (i=0; i < count; i+=2)
+        acc=_mm_add_epi32(acc,SSE2MultiplyPair(_mm_cvtsi32_si128((int) LoadPixel(p+i*stride+x)),
+                                               (i+1 < count ?
+                                                _mm_cvtsi32_si128((int) LoadPixel(p+(i+1)*stride+x)) :
+                                                zero),
+                                               SSE2WeightPair(weights+i)));
+      StorePixel(q+x,(magick_uint32_t) _mm_cvtsi128_si32(SSE2PackPixels(acc,bias)));
+    }
+}
+
+MAGICK_TARGET_SSE2 static void
+VerticalSSE2(const PixelPacket * restrict p,const unsigned long columns,
+             const unsigned long count,const magick_int16_t * restrict weights,
+             PixelPacket * restrict q)
+{
+  SSE2VerticalFilter(p,columns,columns,count,weights,q);
+}
+
+MAGICK_TARGET_AVX2 static void
+HorizontalAVX2(const PixelPacket * restrict p,const unsigned long count,
+               const magick_int16_t * restrict weights,
+               PixelPacket * restrict q,const unsigned long rows)
+{
+  const __m128i
+    bias = _mm_set1_epi32(ResizeRoundingBias);
+
+  unsigned long
+    i,
+    y;
+
+  /*
+    Two rows are processed at once, one in each 128-bit lane.
+  */
+  for (y=0; y+2 <= rows; y+=2)
+    {
+      const PixelPacket
+        *p0 = p+y*count,
+        *p1 = p0+count;
+
+      __m256i
+        acc;
+
+      acc=_mm256_set1_epi32(ResizeRoundingBias);
+      for (i=0; i+4 <= count; i+=4)
+        {
+          __m256i
+            v;
+
+          v=_mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) (p0+i))),
+                                    _mm_loadu_si128((const __m128i *) (p1+i)),1);
+          v=_mm256_shuffle_epi32(v,_MM_SHUFFLE(3,1,2,0));
+          v=_mm256_unpacklo_epi8(v,_mm256_unpackhi_epi64(v,v));
+          acc=_mm256_add_epi32(acc,
+                               _mm256_madd_epi16(_mm256_unpacklo_epi8(v,_mm256_setzero_si256()),
+                                                 _mm256_broadcastsi128_si256(SSE2WeightPair(weights+i))));
+          acc=_mm256_add_epi32(acc,
+                               _mm256_madd_epi16(_mm256_unpackhi_epi8(v,_mm256_setzero_si256()),
+                                                 _mm256_broadcastsi128_si256(SSE2WeightPair(weights+i+2))));
+        }
+      _mm_storel_epi64((__m128i *) (q+y),
+                       SSE2PackPixels(SSE2HorizontalSum(p0,count,weights,
+                                                        _mm256_castsi256_si128(acc),i),
+                                      SSE2HorizontalSum(p1,count,weights,
+                                                        _mm256_extracti128_si256(acc,1),i)));
+    }
+  if (y < rows)
+    StorePixel(q+y,(magick_uint32_t)
+               _mm_cvtsi128_si32(SSE2PackPixels(SSE2HorizontalSum(p+y*count,count,
+                                                                  weights,bias,0),
+                                                bias)));
+}
+
+MAGICK_TARGET_AVX2 static void
+VerticalAVX2(const PixelPacket * restrict p,const unsigned long columns,
+             const unsigned long count,const magick_int16_t * restrict weights,
+             PixelPacket * restrict q)
+{
+  const __m256i
+    zero = _mm256_setzero_si256();
+
+  unsigned long
+    i,
+    x;
+
+  for (x=0; x+8 <= columns; x+=8)
+    {
+      __m256i
+        acc0,
+        acc1,
+        acc2,
+        acc3,
+        v;
+
+      acc0=acc1=acc2=acc3=_mm256_set1_epi32(ResizeRoundingBias);
+      for (i=0; i < count; i+=2)
+        {
+          __m256i
+            hi,
+            lo,
+            r0,
+            r1,
+            w;
+
+          r0=_mm256_loadu_si256((const __m256i *) (p+i*columns+x));
+          r1=zero;
+          if (i+1 < count)
+            r1=_mm256_loadu_si256((const __m256i *) (p+(i+1)*columns+x));
+          w=_mm256_broadcastsi128_si256(SSE2WeightPair(weights+i));
+          /*
+            Within each lane, lo holds pixels 0 and 1 and hi holds
+            pixels 2 and 3.
+          */
+          lo=_mm256_unpacklo_epi8(r0,r1);
+          hi=_mm256_unpackhi_epi8(r0,r1);
+          acc0=_mm256_add_epi32(acc0,_mm256_madd_epi16(_mm256_unpacklo_epi8(lo,zero),w));
+          acc1=_mm256_add_epi32(acc1,_mm256_madd_epi16(_mm256_unpackhi_epi8(lo,zero),w));
+          acc2=_mm256_add_epi32(acc2,_mm256_madd_epi16(_mm256_unpacklo_epi8(hi,zero),w));
+          acc3=_mm256_add_epi32(acc3,_mm256_madd_epi16(_mm256_unpackhi_epi8(hi,zero),w));
+        }
+      acc0=_mm256_srai_epi32(acc0,ContributionWeightShift);
+      acc1=_mm256_srai_epi32(acc1,ContributionWeightShift);
+      acc2=_mm256_srai_epi32(acc2,ContributionWeightShift);
+      acc3=_mm256_srai_epi32(acc3,ContributionWeightShift);
+      v=_mm256_packus_epi16(_mm256_packs_epi32(acc0,acc1),
+                            _mm256_packs_epi32(acc2,acc3));
+      v=_mm256_and_si256(v,_mm256_set1_epi32(OpaqueMask));
+      _mm256_storeu_si256((__m256i *) (q+x),v);
+    }
+  if (x < columns)
+    SSE2VerticalFilter(p+x,columns,columns-x,count,weights,q+x);
+}
+#endif /* defined(HAVE_RESIZE_X86_KERNELS) */
+
+#if defined(HAVE_RESIZE_NEON_KERNELS)
+static inline int32x4_t
+NEONHorizontalSum(const PixelPacket * restrict p,const unsigned long count,
+                  const magick_int16_t * restrict weights)
+{
+  int32x4_t
+    acc;
+
+  unsigned long
+    i;
+
+  acc=vdupq_n_s32(ResizeRoundingBias);
+  for (i=0; i < count; i++)
+    {
+      int16x4_t
+        v;
+
+      v=vget_low_s16(vreinterpretq_s16_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(LoadPixel(p+i))))));
+      acc=vmlal_n_s16(acc,v,weights[i]);
+    }
+  return acc;
+}
+
+/*
+  Convert two accumulators to two opaque pixels.
+*/
+static inline uint8x8_t
+NEONPackPixels(const int32x4_t acc0,const int32x4_t acc1)
+{
+  static const uint8_t
+    opaque_mask[8] = { 0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00 };
+
+  uint8x8_t
+    v;
+
+  v=vqmovn_u16(vcombine_u16(vqshrun_n_s32(acc0,ContributionWeightShift),
+                            vqshrun_n_s32(acc1,ContributionWeightShift)));
+  return vand_u8(v,vld1_u8(opaque_mask));
+}
+
+static void
+HorizontalNEON(const PixelPacket * restrict p,const unsigned long count,
+               const magick_int16_t * restrict weights,
+               PixelPacket * restrict q,const unsigned long rows)
+{
+  unsigned long
+    y;
+
+  for (y=0; y+2 <= rows; y+=2)
+    vst1_u8((uint8_t *) (q+y),
+            NEONPackPixels(NEONHorizontalSum(p+y*count,count,weights),
+                           NEONHorizontalSum(p+(y+1)*count,count,weights)));
+  if (y < rows)
+    {
+      int32x4_t
+        acc;
+
+      acc=NEONHorizontalSum(p+y*count,count,weights);
+      StorePixel(q+y,vget_lane_u32(vreinterpret_u32_u8(NEONPackPixels(acc,acc)),0));
+    }
+}
+
+static void
+VerticalNEON(const PixelPacket * restrict p,const unsigned long columns,
+             const unsigned long count,const magick_int16_t * restrict weights,
+             PixelPacket * restrict q)
+{
+  unsigned long
+    i,
+    x;
+
+  for (x=0; x+4 <= columns; x+=4)
+    {
+      int32x4_t
+        acc0,
+        acc1,
+        acc2,
+        acc3;
+
+      acc0=acc1=acc2=acc3=vdupq_n_s32(ResizeRoundingBias);
+      for (i=0; i < count; i++)
+        {
+          int16x8_t
+            hi,
+            lo;
+
+          uint8x16_t
+            v;
+
+          v=vld1q_u8((const uint8_t *) (p+i*columns+x));
+          lo=vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(v)));
+          hi=vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(v)));
+          acc0=vmlal_n_s16(acc0,vget_low_s16(lo),weights[i]);
+          acc1=vmlal_n_s16(acc1,vget_high_s16(lo),weights[i]);
+          acc2=vmlal_n_s16(acc2,vget_low_s16(hi),weights[i]);
+          acc3=vmlal_n_s16(acc3,vget_high_s16(hi),weights[i]);
+        }
+      vst1q_u8((uint8_t *) (q+x),vcombine_u8(NEONPackPixels(acc0,acc1),
+                                             NEONPackPixels(acc2,acc3)));
+    }
+  for ( ; x < columns; x++)
+    {
+      int32x4_t
+        acc;
+
+      acc=vdupq_n_s32(ResizeRoundingBias);
+      for (i=0; i < count; i++)
+        {
+          int16x4_t
+            v;
+
+          v=vget_low_s16(vreinterpretq_s16_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(LoadPixel(p+i*columns+x))))));
+          acc=vmlal_n_s16(acc,v,weights[i]);
+        }
+      StorePixel(q+x,vget_lane_u32(vreinterpret_u32_u8(NEONPackPixels(acc,acc)),0));
+    }
+}
+#endif /* defined(HAVE_RESIZE_NEON_KERNELS) */
+
+/*
+  Available kernels, in order of preference.
+*/
+static const ResizeKernelInfo
+  resize_kernels[] =
+  {
+#if defined(HAVE_RESIZE_X86_KERNELS)
+    { "AVX2", HorizontalAVX2, VerticalAVX2 },
+    { "SSE2", HorizontalSSE2, VerticalSSE2 },
+#endif
+#if defined(HAVE_RESIZE_NEON_KERNELS)
+    { "NEON", HorizontalNEON, VerticalNEON },
+#endif
+    { "scalar", (HorizontalResizeKernel) NULL, (VerticalResizeKernel) NULL }
+  };
+
+static MagickBool IsResizeKernelSupported(const ResizeKernelInfo *kernel)
+{
+#if defined(HAVE_RESIZE_X86_KERNELS)
+  __builtin_cpu_init();
+  if (kernel->horizontal == HorizontalAVX2)
+    return (__builtin_cpu_supports("avx2") ? MagickTrue : MagickFalse);
+  if (kernel->horizontal == HorizontalSSE2)
+    return (__builtin_cpu_supports("sse2") ? MagickTrue : MagickFalse);
+#endif
+  ARG_NOT_USED(kernel);
+  return MagickTrue;
+}
+
+/*
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%                                                                             %
+%                                                                             %
+%                                                                             %
++   S e l e c t R e s i z e K e r n e l s                                     %
+%                                                                             %
+%                                                                             %
+%                                                                             %
+%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%
+%
+%  SelectResizeKernels() returns the resize kernels to use on this CPU.
+%  If name is not NULL and names kernels supported by this build and
+%  CPU (e.g. "SSE2", or "scalar" for the reference implementation), then
+%  those are returned.  Otherwise the fastest supported kernels are
+%  returned.  The "scalar" kernels have NULL kernel functions.
+%
+%  The format of the SelectResizeKernels method is:
+%
+%      const ResizeKernelInfo *SelectResizeKernels(const char *name)
+%
+%  A description of each parameter follows:
+%
+%    o name: The preferred kernels, or NULL.
+%
+%
+*/
+const ResizeKernelInfo *SelectResizeKernels(const char *name)
+{
+  unsigned int
+    i;
+
+  if (name != (const char *) NULL)
+    for (i=0; i < ArraySize(resize_kernels); i++)
+      if ((LocaleCompare(name,resize_kernels[i].name) == 0) &&
+          IsResizeKernelSupported(&resize_kernels[i]))
+        return &resize_kernels[i];
+  for (i=0; i < ArraySize(resize_kernels); i++)
+    if (IsResizeKernelSupported(&resize_kernels[i]))
+      break;
+  return &resize_kernels[i];
+}
@@ -50,6 +50,23 @@
 /* #define MagickResourceInfinity ((magick_int64_t) (~((magick_uint64_t) 0) >> 1)) */
 #define ResourceInfoMaxIndex ((unsigned int) (sizeof(resource_info)/sizeof(resource_info[0])-1))
 
+/*
+  Resource values, limits, and highwater marks are updated using
+  lock-free atomic operations when the compiler provides them for 64-bit
+  integers, so that threads acquiring memory or disk concurrently do not
+  serialize on the resource semaphore.  The semaphore is still used to
+  serialize changing limits and reporting.
+*/
+#if defined(__GCC_ATOMIC_LLONG_LOCK_FREE) && (__GCC_ATOMIC_LLONG_LOCK_FREE == 2)
+#  define MAGICK_ATOMIC_RESOURCES 1
+#  define ResourceLoad(field) __atomic_load_n(&(field),__ATOMIC_ACQUIRE)
+#  define ResourceStore(field,value) \
+  __atomic_store_n(&(field),value,__ATOMIC_RELEASE)
+#else
+#  define ResourceLoad(field) (field)
+#  define ResourceStore(field,value) ((field)=(value))
+#endif
+
 /*
   Typedef declarations.
 */
@@ -106,7 +123,8 @@ static ResourceInfo resource_info[] =
    { "width",  "P", "MAGICK_LIMIT_WIDTH",  0, 1,    PIXEL_LIMIT,            0, AbsoluteLimit, 0  },
    { "height", "P", "MAGICK_LIMIT_HEIGHT", 0, 1,    PIXEL_LIMIT,            0, AbsoluteLimit, 0  },
    { "read",   "B", "MAGICK_LIMIT_READ",   0, 4096, MagickResourceInfinity, 0, AbsoluteLimit, 0  },
-   { "write",  "B", "MAGICK_LIMIT_WRITE",  0, 4096, MagickResourceInfinity, 0, AbsoluteLimit, 0  }
+   { "write",  "B", "MAGICK_LIMIT_WRITE",  0, 4096, MagickResourceInfinity, 0, AbsoluteLimit, 0  },
+   { "fonts",  "",  "MAGICK_LIMIT_FONTS",  0, 0,    32,                     0, SummationLimit, 0 }
   };
 
 /*
@@ -152,6 +170,35 @@ static ResourceInfo *GetResourceInfo(const ResourceType type)
   return info;
 }
 
+/*
+  Raise the highwater mark to value if it is larger.  Returns MagickTrue
+  if the highwater mark was raised.  Without atomic support, the caller
+  must hold the resource semaphore.
+*/
+static MagickBool RaiseResourceHighwater(ResourceInfo *info,
+                                         const magick_int64_t value)
+{
+#if defined(MAGICK_ATOMIC_RESOURCES)
+  magick_int64_t
+    highwater;
+
+  highwater=__atomic_load_n(&info->highwater,__ATOMIC_RELAXED);
+  while (value > highwater)
+    if (__atomic_compare_exchange_n(&info->highwater,&highwater,value,
+                                    MagickTrue,__ATOMIC_RELAXED,
+                                    __ATOMIC_RELAXED))
+      return MagickTrue;
+  return MagickFalse;
+#else
+  if (value > info->highwater)
+    {
+      info->highwater=value;
+      return MagickTrue;
+    }
+  return MagickFalse;
+#endif
+}
+
 MagickExport MagickPassFail
 AcquireMagickResource(const ResourceType type,
                       const magick_uint64_t size)
@@ -166,9 +213,13 @@ AcquireMagickResource(const ResourceType type,
 
   if ((info=GetResourceInfo(type)))
     {
+      magick_int64_t
+        maximum;
+
       magick_uint64_t
         value=0;
 
+      maximum=ResourceLoad(info->maximum);
       switch(info->limit_type)
         {
         case AbsoluteLimit:
@@ -176,18 +227,21 @@ AcquireMagickResource(const ResourceType type,
             /*
               Limit depends only on the currently requested size.
             */
-            value=info->value;
-            if ((info->maximum != MagickResourceInfinity) &&
-                (size > (magick_uint64_t) info->maximum))
+            value=ResourceLoad(info->value);
+            if ((maximum != MagickResourceInfinity) &&
+                (size > (magick_uint64_t) maximum))
               {
                 status=MagickFail;
               }
-            else
+            else if (size <= (magick_uint64_t) MagickResourceInfinity)
               {
+#if !defined(MAGICK_ATOMIC_RESOURCES)
                 LockSemaphoreInfo(info->semaphore);
-                if (size > (magick_uint64_t) info->highwater)
-                  info->highwater = size;
+#endif
+                (void) RaiseResourceHighwater(info,(magick_int64_t) size);
+#if !defined(MAGICK_ATOMIC_RESOURCES)
                 UnlockSemaphoreInfo(info->semaphore);
+#endif
               }
             break;
           }
@@ -197,6 +251,33 @@ AcquireMagickResource(const ResourceType type,
               Limit depends on sum of previous allocations as well as
               the currently requested size.
             */
+#if defined(MAGICK_ATOMIC_RESOURCES)
+            magick_int64_t
+              current;
+
+            /*
+              Reserve the allocation with a compare-and-swap so that the
+              limit is never exceeded, even transiently.
+            */
+            current=__atomic_load_n(&info->value,__ATOMIC_RELAXED);
+            do
+              {
+                value=(magick_uint64_t) current+size;
+                if ((maximum != MagickResourceInfinity) &&
+                    (value > (magick_uint64_t) maximum))
+                  {
+                    value=(magick_uint64_t) current;
+                    status=MagickFail;
+                    break;
+                  }
+              }
+            while (!__atomic_compare_exchange_n(&info->value,&current,
+                                                (magick_int64_t) value,
+                                                MagickTrue,__ATOMIC_ACQ_REL,
+                                                __ATOMIC_RELAXED));
+            if (status != MagickFail)
+              (void) RaiseResourceHighwater(info,(magick_int64_t) value);
+#else
             LockSemaphoreInfo(info->semaphore);
             value=info->value+size;
             if ((info->maximum != MagickResourceInfinity) &&
@@ -208,10 +289,10 @@ AcquireMagickResource(const ResourceType type,
             else
               {
                 info->value=value;
-                if (value > (magick_uint64_t) info->highwater)
-                  info->highwater = value;
+                (void) RaiseResourceHighwater(info,(magick_int64_t) value);
               }
             UnlockSemaphoreInfo(info->semaphore);
+#endif
             break;
           }
         }
@@ -383,7 +464,7 @@ MagickExport magick_int64_t GetMagickResource(const ResourceType type)
   if ((info=GetResourceInfo(type)))
     {
       LockSemaphoreInfo(info->semaphore);
-      resource=info->value;
+      resource=ResourceLoad(info->value);
       UnlockSemaphoreInfo(info->semaphore);
     }
 
@@ -428,7 +509,7 @@ MagickExport magick_int64_t GetMagickResourceLimit(const ResourceType type)
   if ((info=GetResourceInfo(type)))
     {
       LockSemaphoreInfo(info->semaphore);
-      resource=info->maximum;
+      resource=ResourceLoad(info->maximum);
       UnlockSemaphoreInfo(info->semaphore);
     }
 
@@ -466,7 +547,8 @@ MagickExport void InitializeMagickResources(void)
     max_width=-1,
     max_height=-1,
     max_read=-1,
-    max_write=-1;
+    max_write=-1,
+    max_fonts=32;
 
   size_t
     index;
@@ -671,6 +753,9 @@ MagickExport void InitializeMagickResources(void)
     if ((envp=getenv("MAGICK_LIMIT_WRITE")))
       max_write=MagickSizeStrToInt64(envp,1024);
 
+    if ((envp=getenv("MAGICK_LIMIT_FONTS")))
+      max_fonts=MagickSizeStrToInt64(envp,1024);
+
 #if defined(HAVE_OPENMP)
     max_threads=omp_get_num_procs();
     (void) LogMagickEvent(ResourceEvent,GetMagickModule(),
@@ -781,6 +866,8 @@ MagickExport void InitializeMagickResources(void)
     (void) SetMagickResourceLimit(ReadResource,max_read);
   if (max_write >= 0)
     (void) SetMagickResourceLimit(WriteResource,max_write);
+  if (max_fonts >= 0)
+    (void) SetMagickResourceLimit(FontsResource,max_fonts);
 }
 
 /*
@@ -835,13 +922,19 @@ MagickExport void LiberateMagickResource(const ResourceType type,
               Limit depends on sum of previous allocations as well as
               the currently requested size.
             */
+#if defined(MAGICK_ATOMIC_RESOURCES)
+            value=(magick_uint64_t)
+              __atomic_sub_fetch(&info->value,(magick_int64_t) size,
+                                 __ATOMIC_ACQ_REL);
+#else
             LockSemaphoreInfo(info->semaphore);
             info->value-=size;
-#if defined(DEBUG_MAGICK_RESOURCES) && DEBUG_MAGICK_RESOURCES
-            assert(info->value >= info->minimum);
-#endif /* if defined(DEBUG_MAGICK_RESOURCES) && DEBUG_MAGICK_RESOURCES */
             value=info->value;
             UnlockSemaphoreInfo(info->semaphore);
+#endif
+#if defined(DEBUG_MAGICK_RESOURCES) && DEBUG_MAGICK_RESOURCES
+            assert((magick_int64_t) value >= info->minimum);
+#endif /* if defined(DEBUG_MAGICK_RESOURCES) && DEBUG_MAGICK_RESOURCES */
             break;
           }
         }
@@ -991,6 +1084,7 @@ MagickExport MagickPassFail ListMagickResourceInfo(FILE *file,
 %    HeightResource  -- Pixels
 %    ReadResource    -- Bytes
 %    WriteResource   -- Bytes
+%    FontsResource   -- Open font faces
 %
 %  The format of the SetMagickResourceLimit() method is:
 %
@@ -1026,10 +1120,10 @@ MagickExport MagickPassFail SetMagickResourceLimit(const ResourceType type,
 
 
           FormatSize((magick_int64_t) limit, f_limit);
-          info->maximum = limit;
+          ResourceStore(info->maximum,limit);
           /* Cap highwater to new maximum */
-          if (info->maximum < info->highwater)
-            info->highwater = info->maximum;
+          if (limit < ResourceLoad(info->highwater))
+            ResourceStore(info->highwater,limit);
 #if defined(HAVE_OPENMP)
           if (ThreadsResource == type)
             omp_set_num_threads((int) limit);
@@ -1097,15 +1191,15 @@ extern MagickPassFail _UpdateMagickResourceHighwater(const ResourceType type,
   if ((info=GetResourceInfo(type)))
     {
       LockSemaphoreInfo(info->semaphore);
-      if ((highwater > info->minimum) && (highwater <= info->maximum)
-          && (highwater > info->highwater))
+      if ((highwater > info->minimum) &&
+          (highwater <= ResourceLoad(info->maximum)) &&
+          RaiseResourceHighwater(info,highwater))
         {
           char
             f_highwater[MaxTextExtent];
 
 
           FormatSize((magick_int64_t) highwater, f_highwater);
-          info->highwater = highwater;
           (void) LogMagickEvent(ResourceEvent,GetMagickModule(),
                                 "Updated %s resource highwater to %s%s",
                                 info->name,f_highwater,info->units);
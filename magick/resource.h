@@ -30,7 +30,8 @@ typedef enum
   WidthResource,       /* Maximum pixel width of an image (Pixels) */
   HeightResource,      /* Maximum pixel height of an image (Pixels) */
   ReadResource,        /* Maximum amount of uncompressed file data which may be read from one file */
-  WriteResource        /* Maximum amount of uncompressed file data which may be written to one file */
+  WriteResource,       /* Maximum amount of uncompressed file data which may be written to one file */
+  FontsResource        /* Maximum number of open font faces retained by the font cache */
 } ResourceType;
 
 
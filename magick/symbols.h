@@ -24,6 +24,7 @@
 #define AcquireCacheView GmAcquireCacheView
 #define AcquireCacheViewIndexes GmAcquireCacheViewIndexes
 #define AcquireCacheViewPixels GmAcquireCacheViewPixels
+#define AcquireContributionTable GmAcquireContributionTable
 #define AcquireImagePixels GmAcquireImagePixels
 #define AcquireMagickRandomKernel GmAcquireMagickRandomKernel
 #define AcquireMagickResource GmAcquireMagickResource
@@ -46,6 +47,7 @@
 #define AllocateImage GmAllocateImage
 #define AllocateImageProfileIterator GmAllocateImageProfileIterator
 #define AllocateNextImage GmAllocateNextImage
+#define AllocateResizeRowsInfo GmAllocateResizeRowsInfo
 #define AllocateSemaphoreInfo GmAllocateSemaphoreInfo
 #define AllocateString GmAllocateString
 #define AllocateThreadViewDataArray GmAllocateThreadViewDataArray
@@ -79,6 +81,7 @@
 #define BlobWriteByteHook GmBlobWriteByteHook
 #define BlurImageChannel GmBlurImageChannel
 #define BlurImage GmBlurImage
+#define BlurImageMethod GmBlurImageMethod
 #define BorderImage GmBorderImage
 #define CatchException GmCatchException
 #define CatchImageException GmCatchImageException
@@ -110,6 +113,7 @@
 #define ColorMatrixImage GmColorMatrixImage
 #define ColorspaceTypeToString GmColorspaceTypeToString
 #define CompareImageCommand GmCompareImageCommand
+#define CompileDrawDisplayList GmCompileDrawDisplayList
 #define CompositeImageCommand GmCompositeImageCommand
 #define CompositeImage GmCompositeImage
 #define CompositeImageRegion GmCompositeImageRegion
@@ -128,6 +132,7 @@
 #define ContrastImage GmContrastImage
 #define ConvertImageCommand GmConvertImageCommand
 #define ConvolveImage GmConvolveImage
+#define ConvolveImageMethod GmConvolveImageMethod
 #define CopyException GmCopyException
 #define CropImage GmCropImage
 #define CycleColormapImage GmCycleColormapImage
@@ -140,12 +145,14 @@
 #define DeleteMagickRegistry GmDeleteMagickRegistry
 #define DescribeImage GmDescribeImage
 #define DespeckleImage GmDespeckleImage
+#define DestroyAnnotateInfo GmDestroyAnnotateInfo
 #define DestroyBlob GmDestroyBlob
 #define DestroyBlobInfo GmDestroyBlobInfo
 #define DestroyCacheInfo GmDestroyCacheInfo
 #define DestroyColorInfo GmDestroyColorInfo
 #define DestroyConstitute GmDestroyConstitute
 #define DestroyDelegateInfo GmDestroyDelegateInfo
+#define DestroyDrawDisplayList GmDestroyDrawDisplayList
 #define DestroyDrawInfo GmDestroyDrawInfo
 #define DestroyExceptionInfo GmDestroyExceptionInfo
 #define DestroyImageAttributes GmDestroyImageAttributes
@@ -164,6 +171,8 @@
 #define DestroyMagickResources GmDestroyMagickResources
 #define DestroyMontageInfo GmDestroyMontageInfo
 #define DestroyQuantizeInfo GmDestroyQuantizeInfo
+#define DestroyResizeInfo GmDestroyResizeInfo
+#define DestroyResizeRowsInfo GmDestroyResizeRowsInfo
 #define DestroySemaphore GmDestroySemaphore
 #define DestroySemaphoreInfo GmDestroySemaphoreInfo
 #define DestroyTemporaryFiles GmDestroyTemporaryFiles
@@ -188,6 +197,7 @@
 #define DrawColor GmDrawColor
 #define DrawComment GmDrawComment
 #define DrawComposite GmDrawComposite
+#define DrawDisplayListImage GmDrawDisplayListImage
 #define DrawCompositeMask GmDrawCompositeMask
 #define DrawDestroyContext GmDrawDestroyContext
 #define DrawEllipse GmDrawEllipse
@@ -314,6 +324,7 @@
 #define ExtentImage GmExtentImage
 #define FileToBlob GmFileToBlob
 #define FinalizeSignature GmFinalizeSignature
+#define FinishResizeRows GmFinishResizeRows
 #define FlattenImages GmFlattenImages
 #define FlipImage GmFlipImage
 #define FlopImage GmFlopImage
@@ -325,6 +336,7 @@
 #define GammaImage GmGammaImage
 #define GaussianBlurImageChannel GmGaussianBlurImageChannel
 #define GaussianBlurImage GmGaussianBlurImage
+#define GaussianBlurImageMethod GmGaussianBlurImageMethod
 #define GenerateDifferentialNoise GmGenerateDifferentialNoise
 #define GenerateNoise GmGenerateNoise
 #define GetBlobFileHandle GmGetBlobFileHandle
@@ -335,7 +347,10 @@
 #define GetBlobStatus GmGetBlobStatus
 #define GetBlobStreamData GmGetBlobStreamData
 #define GetBlobTemporary GmGetBlobTemporary
+#define GetBlurMethod GmGetBlurMethod
+#define GetCacheCompression GmGetCacheCompression
 #define GetCacheInfo GmGetCacheInfo
+#define GetCacheTileSize GmGetCacheTileSize
 #define GetCacheViewArea GmGetCacheViewArea
 #define GetCacheView GmGetCacheView
 #define GetCacheViewImage GmGetCacheViewImage
@@ -351,6 +366,7 @@
 #define GetColorList GmGetColorList
 #define GetColorTuple GmGetColorTuple
 #define GetConfigureBlob GmGetConfigureBlob
+#define GetConvolveMethod GmGetConvolveMethod
 #define GetDelegateCommand GmGetDelegateCommand
 #define GetDelegateInfo GmGetDelegateInfo
 #define GetDrawInfo GmGetDrawInfo
@@ -458,6 +474,7 @@
 #define ImportImagePixelArea GmImportImagePixelArea
 #define ImportPixelAreaOptionsInit GmImportPixelAreaOptionsInit
 #define ImportViewPixelArea GmImportViewPixelArea
+#define InitializeAnnotateInfo GmInitializeAnnotateInfo
 #define InitializeColorInfo GmInitializeColorInfo
 #define InitializeConstitute GmInitializeConstitute
 #define InitializeDelegateInfo GmInitializeDelegateInfo
@@ -475,7 +492,9 @@
 #define InitializeMagickRandomKernel GmInitializeMagickRandomKernel
 #define InitializeMagickRegistry GmInitializeMagickRegistry
 #define InitializeMagickResources GmInitializeMagickResources
+#define InitializePixelCache GmInitializePixelCache
 #define InitializePixelIteratorOptions GmInitializePixelIteratorOptions
+#define InitializeResizeInfo GmInitializeResizeInfo
 #define InitializeSemaphore GmInitializeSemaphore
 #define InitializeTemporaryFiles GmInitializeTemporaryFiles
 #define InitializeTypeInfo GmInitializeTypeInfo
@@ -499,6 +518,7 @@
 #define IsMonochromeImage GmIsMonochromeImage
 #define IsOpaqueImage GmIsOpaqueImage
 #define IsPaletteImage GmIsPaletteImage
+#define IsRecursiveBlur GmIsRecursiveBlur
 #define IsSubimage GmIsSubimage
 #define IsTaintImage GmIsTaintImage
 #define IsWriteable GmIsWriteable
@@ -907,6 +927,7 @@
 #define RegisterXPMImage GmRegisterXPMImage
 #define RegisterXWDImage GmRegisterXWDImage
 #define RegisterYUVImage GmRegisterYUVImage
+#define ReleaseContributionTable GmReleaseContributionTable
 #define RemoveDefinitions GmRemoveDefinitions
 #define RemoveFirstImageFromList GmRemoveFirstImageFromList
 #define RemoveLastImageFromList GmRemoveLastImageFromList
@@ -916,6 +937,7 @@
 #define ResetTimer GmResetTimer
 #define ResizeFilterToString GmResizeFilterToString
 #define ResizeImage GmResizeImage
+#define ResizeRow GmResizeRow
 #define ResolutionTypeToString GmResolutionTypeToString
 #define ReverseImageList GmReverseImageList
 #define RGBTransformImage GmRGBTransformImage
@@ -924,8 +946,11 @@
 #define SampleImage GmSampleImage
 #define ScaleImage GmScaleImage
 #define SeekBlob GmSeekBlob
+#define SelectResizeKernels GmSelectResizeKernels
 #define SetBlobClosable GmSetBlobClosable
 #define SetBlobTemporary GmSetBlobTemporary
+#define SetCacheCompression GmSetCacheCompression
+#define SetCacheTileSize GmSetCacheTileSize
 #define SetCacheView GmSetCacheView
 #define SetCacheViewPixels GmSetCacheViewPixels
 #define SetClientFilename GmSetClientFilename
@@ -1139,6 +1164,7 @@
 #define UnregisterYUVImage GmUnregisterYUVImage
 #define UnsharpMaskImageChannel GmUnsharpMaskImageChannel
 #define UnsharpMaskImage GmUnsharpMaskImage
+#define UnsharpMaskImageMethod GmUnsharpMaskImageMethod
 #define UpdateSignature GmUpdateSignature
 #define WaveImage GmWaveImage
 #define WhiteThresholdImage GmWhiteThresholdImage
@@ -345,6 +345,116 @@ static void ScribbleImage ( Image *image)
   DrawDestroyContext(context);
 }
 
+/*
+ * Verify that drawing primitives via a compiled display list produces
+ * the same image as drawing them directly.
+ */
+static int CheckDisplayList ( const ImageInfo *image_info,
+                              const char *primitive,
+                              const AffineMatrix *affine )
+{
+  DrawDisplayList *display_list;
+  DrawInfo *draw_info;
+  Image *direct, *replayed;
+  ExceptionInfo exception;
+  int status = 1;
+
+  GetExceptionInfo( &exception );
+  direct = ReadImage ( image_info, &exception );
+  replayed = ReadImage ( image_info, &exception );
+  if (exception.severity != UndefinedException)
+    CatchException(&exception);
+  if ( (direct == (Image *) NULL) || (replayed == (Image *) NULL) )
+    {
+      (void) printf ( "Failed to read canvas image %s\n", image_info->filename );
+      status = 0;
+    }
+  else
+    {
+      draw_info = CloneDrawInfo(image_info, (DrawInfo*) NULL);
+      (void) CloneString(&draw_info->primitive, primitive);
+      display_list = CompileDrawDisplayList(draw_info, &exception);
+      if (display_list == (DrawDisplayList *) NULL)
+        {
+          CatchException(&exception);
+          (void) printf ( "Failed to compile display list\n" );
+          status = 0;
+        }
+      else
+        {
+          if (affine != (const AffineMatrix *) NULL)
+            draw_info->affine = *affine;
+          (void) DrawImage(direct, draw_info);
+          (void) DrawDisplayListImage(replayed, display_list, affine);
+          if (!IsImagesEqual(replayed, direct))
+            {
+              (void) printf ( "Display list drawing differs (mean error %g)\n",
+                              replayed->error.mean_error_per_pixel );
+              status = 0;
+            }
+          DestroyDrawDisplayList(display_list);
+        }
+      DestroyDrawInfo(draw_info);
+    }
+  if (direct != (Image *) NULL)
+    DestroyImage(direct);
+  if (replayed != (Image *) NULL)
+    DestroyImage(replayed);
+  DestroyExceptionInfo( &exception );
+  return status;
+}
+
+/*
+ * Verify that the corners of a dashed, stroked bezier are filled.  The
+ * edge following each retired polygon edge used to be skipped, which
+ * left some of these corner pixels unpainted.
+ */
+static int CheckDashedBezier ( void )
+{
+  static const char
+    primitive[] =
+      "stroke black fill none stroke-width 7 stroke-dasharray 10 5\n"
+      "bezier 10,10 400,600 700,10 790,590\n";
+
+  DrawInfo *draw_info;
+  Image *image;
+  ImageInfo *image_info;
+  ExceptionInfo exception;
+  PixelPacket pixel;
+  int status = 1;
+
+  GetExceptionInfo( &exception );
+  image_info=CloneImageInfo((ImageInfo*)NULL);
+  (void) CloneString(&image_info->size, "800x600");
+  (void) strcpy( image_info->filename, "xc:white");
+  image = ReadImage ( image_info, &exception );
+  if (exception.severity != UndefinedException)
+    CatchException(&exception);
+  if ( image == (Image *) NULL )
+    {
+      (void) printf ( "Failed to read canvas image %s\n", image_info->filename );
+      status = 0;
+    }
+  else
+    {
+      draw_info = CloneDrawInfo(image_info, (DrawInfo*) NULL);
+      (void) CloneString(&draw_info->primitive, primitive);
+      (void) DrawImage(image, draw_info);
+      pixel = AcquireOnePixel(image, 759, 467, &exception);
+      if (pixel.red > MaxRGB/2)
+        {
+          (void) printf ( "Dashed bezier corner pixel not drawn (red %u)\n",
+                          (unsigned int) pixel.red );
+          status = 0;
+        }
+      DestroyDrawInfo(draw_info);
+      DestroyImage(image);
+    }
+  DestroyImageInfo(image_info);
+  DestroyExceptionInfo( &exception );
+  return status;
+}
+
 int main ( int argc, char **argv )
 {
   Image *canvas = (Image *)NULL;
@@ -403,6 +513,49 @@ int main ( int argc, char **argv )
    */
   ScribbleImage( canvas );
 
+  /*
+   * Draw the same primitives via display lists
+   */
+  {
+    static const char
+      shapes[] =
+        "fill #ff000080 stroke blue stroke-width 3\n"
+        "rectangle 20,20 200,120\n"
+        "push graphic-context\n"
+        "  affine 0.9 0.2 -0.2 0.9 40 30\n"
+        "  fill-rule evenodd\n"
+        "  path 'M 100 100 C 300 400 500 0 550 500 Q 300 300 100 600 Z'\n"
+        "  ellipse 300,300 150,80 0,360\n"
+        "pop graphic-context\n"
+        "stroke-dasharray 10 5\n"
+        "polyline 10,800 300,400 590,800\n";
+
+    AffineMatrix
+      translate;
+
+    const ImageAttribute
+      *mvg;
+
+    translate.sx=1.0;
+    translate.rx=0.0;
+    translate.ry=0.0;
+    translate.sy=1.0;
+    translate.tx=16.0;
+    translate.ty=-8.0;
+
+    if (!CheckDisplayList(image_info, shapes, (const AffineMatrix *) NULL))
+      exit(1);
+    if (!CheckDisplayList(image_info, shapes, &translate))
+      exit(1);
+    mvg=GetImageAttribute(canvas,"[MVG]");
+    if ((mvg == (const ImageAttribute *) NULL) ||
+        !CheckDisplayList(image_info, mvg->value, &translate))
+      exit(1);
+  }
+
+  if (!CheckDashedBezier())
+    exit(1);
+
   /*
    * Save image to file
    */